@@ -4,6 +4,11 @@
 #include <stdint.h>
 
 #define C_MAX_ARGS (10)
+
+/* Arguments of each class a typed extension function can take. */
+#define FFI_MAX_INT_ARGS (6)
+#define FFI_MAX_SSE_ARGS (8)
+
 typedef enum arg_value_type_ {
     C_INT, C_UINT, C_DBL, C_STR, C_PTR
 } arg_value_type_t;
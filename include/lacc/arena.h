@@ -0,0 +1,42 @@
+#ifndef ARENA_H
+#define ARENA_H
+#if !defined(INTERNAL) || !defined(EXTERNAL)
+# error Missing amalgamation macros
+#endif
+
+#include <stddef.h>
+
+/*
+ * Region of memory where objects sharing the same lifetime are placed
+ * one after another, and released all at once. There is no way to free
+ * a single object.
+ *
+ * [block] -> [block] -> [block]
+ *               ^ next      ^ end
+ *
+ * Blocks are kept when the arena is reset, and filled again from the
+ * start. A zero initialized arena is empty and ready to use.
+ */
+struct arena {
+    /* First and current block in chain. */
+    struct arena_block *head;
+    struct arena_block *current;
+
+    /* Free space remaining in current block. */
+    char *next;
+    char *end;
+};
+
+/* Allocate uninitialized memory, aligned for any type. */
+INTERNAL void *arena_alloc(struct arena *arena, size_t size);
+
+/* Allocate memory initialized to zero. */
+INTERNAL void *arena_calloc(struct arena *arena, size_t size);
+
+/* Release all objects, keeping blocks for reuse. */
+INTERNAL void arena_reset(struct arena *arena);
+
+/* Release all objects and memory owned by arena. */
+INTERNAL void arena_free(struct arena *arena);
+
+#endif
@@ -33,6 +33,9 @@ INTERNAL struct context {
     uint32_t pic : 1;               /* position independent code */
     uint32_t debug : 1;             /* Generate debug information. */
     uint32_t is_string_input : 1;   /* Input from string */
+    uint32_t fast_math : 1;         /* Allow reassociation of real math. */
+    uint32_t vectorize : 1;         /* Vectorize simple counted loops. */
+    uint32_t avx2 : 1;              /* Target supports AVX2. */
     enum target target;
     enum cstd standard;
 } context;
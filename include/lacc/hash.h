@@ -7,9 +7,15 @@
 #include "string.h"
 
 struct hash_table {
-    /* Number of slots in the top level array. */
+    /*
+     * Number of slots in the table, always a power of two. Grows when
+     * the number of elements exceeds the load factor.
+     */
     unsigned capacity;
 
+    /* Number of elements stored. */
+    unsigned length;
+
     /*
      * Retrieve string representing the key we are hashing on. Keys are
      * unique identifiers of the elements, meaning they can be compared
@@ -31,19 +37,21 @@ struct hash_table {
     void (*del)(void *);
 
     /*
-     * First level array of entries, of length capacity. Resolve
-     * collisions by chaining elements.
+     * Open addressing with linear probing, storing hash value and data
+     * pointer inline. Collisions are resolved Robin Hood style, keeping
+     * elements ordered by distance from their home slot.
      *
-     * [A] -> [B]
-     * [ ]
-     * [C]
-     * [ ]
+     * [A] [B] [ ] [C] [D] [E] [ ]
+     *  0   1       0   0   1
      *
      */
     struct hash_entry *table;
 };
 
-/* Initialize hash structure. Must be freed by hash_destroy. */
+/*
+ * Initialize hash structure, with room for at least cap elements before
+ * growing. Must be freed by hash_destroy.
+ */
 INTERNAL struct hash_table *hash_init(
     struct hash_table *tab,
     unsigned cap,
@@ -51,7 +59,7 @@ INTERNAL struct hash_table *hash_init(
     void *(*add)(void *),
     void (*del)(void *));
 
-/* Reset table, clearing all values. Does not deallocate memory. */
+/* Reset table, clearing all values. Keeps current capacity. */
 INTERNAL void hash_clear(struct hash_table *tab);
 
 /* Free resources owned by table. */
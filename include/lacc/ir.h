@@ -208,6 +208,16 @@ struct block {
     /* Liveness at the start and end of the block. */
     uint64_t in;
     uint64_t out;
+
+    /* Position in list of nodes of the definition. */
+    int index;
+
+    /*
+     * Number of times the block was entered, and false branch taken,
+     * according to profile data. Zero if there is no profile.
+     */
+    uint64_t count;
+    uint64_t false_count;
 };
 
 /*
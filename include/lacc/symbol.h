@@ -44,7 +44,7 @@ struct symbol {
     uint32_t linkage : 8;
     uint32_t referenced : 1; /* Mark symbol as used. */
     uint32_t slot : 7;       /* Register allocation slot. */
-    uint32_t index : 8;      /* Enumeration used in optimization. */
+    uint32_t reads : 2;      /* Reads of temporary, saturating at 2. */
 
     /*
      * Tag to disambiguate temporaries, strings, constants, labels, and
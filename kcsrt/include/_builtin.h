@@ -28,6 +28,13 @@ void __kcc_builtin_call(void *h, const char *name);
 int __kcc_builtin_call_i(void *h, const char *name);
 double __kcc_builtin_call_d(void *h, const char *name);
 void *__kcc_builtin_call_p(void *h, const char *name);
+void *__kcc_builtin_getfunc(void *h, const char *name);
+void __kcc_builtin_invoke(void *f);
+int __kcc_builtin_invoke_i(void *f);
+double __kcc_builtin_invoke_d(void *f);
+void *__kcc_builtin_invoke_p(void *f);
+long long __kcc_builtin_ffi_i(void *f, const char *sig, ...);
+double __kcc_builtin_ffi_d(void *f, const char *sig, ...);
 
 int __kcc_builtin_putc(int ch);
 int __kcc_builtin_printf_d(const char *fmt, int v);
@@ -42,6 +49,7 @@ int __kcc_builtin_sprintf_f(const char *fmt, double v, char *buf);
 int __kcc_builtin_sprintf_lf(const char *fmt, long double v, char *buf);
 int __kcc_builtin_sprintf_p(const char *fmt, void *v, char *buf);
 int __kcc_builtin_sprintf_s(const char *fmt, char *v, char *buf);
+int __kcc_builtin_vformat(char *buf, size_t size, const char *fmt, void *ap);
 
 size_t __kcc_builtin_strlen(const char *str);
 char *__kcc_builtin_strcpy(char *dst, const char *src);
@@ -49,9 +57,26 @@ char *__kcc_builtin_strncpy(char *dst, const char *src, int n);
 void *__kcc_builtin_memset(void *dst, int val, size_t len);
 void *__kcc_builtin_memcpy(void *dst, void *src, size_t len);
 void *__kcc_builtin_memmove(void *dst, void *src, size_t len);
+char *__kcc_builtin_strcat(char *dst, const char *src);
+char *__kcc_builtin_strncat(char *dst, const char *src, size_t n);
+int __kcc_builtin_strcmp(const char *s1, const char *s2);
+int __kcc_builtin_strncmp(const char *s1, const char *s2, size_t n);
+char *__kcc_builtin_strchr(const char *s, int c);
+char *__kcc_builtin_strrchr(const char *s, int c);
+char *__kcc_builtin_strstr(const char *s1, const char *s2);
+size_t __kcc_builtin_strspn(const char *s1, const char *s2);
+size_t __kcc_builtin_strcspn(const char *s1, const char *s2);
+int __kcc_builtin_memcmp(const void *s1, const void *s2, size_t n);
+void *__kcc_builtin_memchr(const void *s, int c, size_t n);
+void __kcc_builtin_qsort_int(int *base, size_t n);
+void __kcc_builtin_qsort_double(double *base, size_t n);
+void __kcc_builtin_qsort_str(char **base, size_t n);
 
 int atexit(void (*kcc_atexit_func)(void));
 void __kcc_call_atexit_funcs(void);
+void __kcc_exit(int code);
+void __kcc_flush_on_abort(void);
+void __kcc_abort(void);
 
 void __kcc_builtin_abort(void);
 void __kcc_builtin_exit(int code);
@@ -7,6 +7,29 @@
 
 void *kcc_extlib(void);
 
+/*
+ * Look up a function of the external dll module on first use only, and
+ * keep it in the static pointer f for __kcc_builtin_invoke*().
+ */
+#define kcc_extfunc(f, name) \
+    ((f) ? (f) : ((f) = __kcc_builtin_getfunc(kcc_extlib(), (name))))
+
+/*
+ * Call typed extension function f with the given arguments, without
+ * going through the argument list of __kcc_builtin_add_arg_*(). Code
+ * compiled by the JIT calls f directly as a pointer of type proto. The
+ * VM needs the argument types spelled out in sig, one character each:
+ * 'd' for double, 'f' for float, and 'i' or 'p' for integer or pointer.
+ * Only available when __KCC_FFI__ is defined.
+ */
+#if defined(__KCC_JIT__)
+#define kcc_extcall(proto, f, sig, ...)     (((proto)(f))(__VA_ARGS__))
+#define kcc_extcall_d(proto, f, sig, ...)   (((proto)(f))(__VA_ARGS__))
+#else
+#define kcc_extcall(proto, f, sig, ...)     __kcc_builtin_ffi_i((f), (sig), __VA_ARGS__)
+#define kcc_extcall_d(proto, f, sig, ...)   __kcc_builtin_ffi_d((f), (sig), __VA_ARGS__)
+#endif
+
 #ifndef KCC_NO_IMPORT
 #if defined(__KCC_JIT__) || defined(__KCC__)
 #include <../libsrc/kcs/ext.c>
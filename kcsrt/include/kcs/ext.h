@@ -24,6 +24,7 @@ typedef struct string_ {
 extern string_t string_init(const char *s);
 extern string_t string_init_alloc(const char *cstr);
 extern string_t string_substr(const string_t str, int start, int len);
+extern void string_reserve(string_t *str, unsigned int len);
 
 #define string_reset(str, s) \
     if ((str)->cstr) { \
@@ -34,64 +35,64 @@ extern string_t string_substr(const string_t str, int start, int len);
     } \
     /**/
 
-#define string_append_cstr_with_len_to_empty(lhs, rhs, rlen) \
-    unsigned int cap = KCC_CAPACITY(rlen); \
-    (lhs)->cstr = (char *)malloc(cap * sizeof(char)); \
-    if (rlen > 0) { \
-        memcpy((lhs)->cstr, rhs, rlen); \
-    } \
-    (lhs)->len = rlen; \
-    (lhs)->cap = cap; \
-    /**/
-
-#define string_append_cstr_with_len_to_allocated(lhs, rhs, rlen) \
-    int len = (lhs)->len + rlen; \
-    if (len < (lhs)->cap) { \
-        memcpy((lhs)->cstr + (lhs)->len, rhs, rlen); \
-        (lhs)->cstr[len] = 0; \
-        (lhs)->len = len; \
-    } else { \
-        unsigned int cap = KCC_CAPACITY(len); \
-        char *buf = (char *)malloc(cap * sizeof(char)); \
-        memcpy(buf, (lhs)->cstr, (lhs)->len); \
-        memcpy(buf + (lhs)->len, rhs, rlen); \
-        buf[len] = 0; \
-        string_free(lhs); \
-        (lhs)->len = len; \
-        (lhs)->cap = cap; \
-        (lhs)->cstr = buf; \
-    } \
-    /**/
-
-#define string_append(lhs, rhs) \
-    if (!(lhs)->cstr) { \
-        string_append_cstr_with_len_to_empty(lhs, (rhs).cstr, (rhs).len); \
-    } else { \
-        string_append_cstr_with_len_to_allocated(lhs, (rhs).cstr, (rhs).len); \
-    } \
-    /**/
-
+/* The buffer at least doubles when it grows, so appending is amortized O(1). */
 #define string_append_cstr_with_len(lhs, rhs, rlen) \
-    if (!(lhs)->cstr) { \
-        string_append_cstr_with_len_to_empty(lhs, rhs, rlen); \
-    } else { \
-        string_append_cstr_with_len_to_allocated(lhs, rhs, rlen); \
-    } \
+    do { \
+        unsigned int kcc_rlen_ = (rlen); \
+        unsigned int kcc_len_ = ((lhs)->cstr ? (lhs)->len : 0) + kcc_rlen_; \
+        if (!(lhs)->cstr || kcc_len_ >= (lhs)->cap) { \
+            string_reserve(lhs, kcc_len_); \
+        } \
+        memcpy((lhs)->cstr + (lhs)->len, rhs, kcc_rlen_); \
+        (lhs)->cstr[kcc_len_] = 0; \
+        (lhs)->len = kcc_len_; \
+    } while (0) \
     /**/
 
-#define string_append_cstr(lhs, rhs) \
-    int rlen = strlen(rhs); \
-    if (!(lhs)->cstr) { \
-        string_append_cstr_with_len_to_empty(lhs, rhs, rlen); \
-    } else { \
-        string_append_cstr_with_len_to_allocated(lhs, rhs, rlen); \
-    } \
-    /**/
+#define string_append(lhs, rhs)         string_append_cstr_with_len(lhs, (rhs).cstr, (rhs).len)
+#define string_append_cstr(lhs, rhs)    string_append_cstr_with_len(lhs, rhs, strlen(rhs))
 
 #define string_copy(str)    string_init(str.cstr);
 #define string_free(str)    free((str)->cstr)
 #define string_clear(str)   (((str)->cstr ? ((str)->cstr[0] = 0) : 0), (str)->len = 0)
 
+/*
+ * Builder for a string made by many appends. Short strings stay in the
+ * inline buffer, so the builder must not be copied while in use. It is
+ * turned into a string_t by string_builder_detach without copying once
+ * the text is on the heap.
+ */
+#define KCC_STRING_BUILDER_INLINE (64)
+
+typedef struct string_builder_ {
+    char            *buf;   // buffer, which is small until it outgrows it.
+    unsigned int    cap;    // capacity of a buffer.
+    unsigned int    len;    // actual length of a string.
+    char            small[KCC_STRING_BUILDER_INLINE];
+} string_builder_t;
+
+extern void string_builder_init(string_builder_t *sb);
+extern void string_builder_reserve(string_builder_t *sb, unsigned int len);
+extern void string_builder_append_cstr_with_len(string_builder_t *sb, const char *s, unsigned int len);
+extern int string_builder_appendf(string_builder_t *sb, const char *fmt, ...);
+extern string_t string_builder_detach(string_builder_t *sb);
+extern void string_builder_free(string_builder_t *sb);
+
+#define string_builder_append_char(sb, ch) \
+    do { \
+        if ((sb)->len + 1 >= (sb)->cap) { \
+            string_builder_reserve(sb, (sb)->len + 1); \
+        } \
+        (sb)->buf[(sb)->len++] = (ch); \
+        (sb)->buf[(sb)->len] = 0; \
+    } while (0) \
+    /**/
+
+#define string_builder_append(sb, str)      string_builder_append_cstr_with_len(sb, (str).cstr, (str).len)
+#define string_builder_append_cstr(sb, s)   string_builder_append_cstr_with_len(sb, s, strlen(s))
+#define string_builder_cstr(sb)             ((sb)->buf)
+#define string_builder_clear(sb)            ((sb)->buf[0] = 0, (sb)->len = 0)
+
 #ifndef KCC_NO_IMPORT
 #if defined(__KCC_JIT__) || defined(__KCC__)
 #include <../libsrc/kcs/ext_string.c>
@@ -219,31 +220,127 @@ void vec_delete(void *vector);
 #endif
 #endif
 
+/* ---------------------------------------------------------------------------------------------
+    KCC Extended Library - deque
+        A circular buffer with a power of two capacity, so push and pop at both ends are O(1).
+        head only moves by one in either direction and wraps around with the unsigned type,
+        and element [I] from the front is at index (head + [I]) & (allocated - 1).
+--------------------------------------------------------------------------------------------- */
+
+typedef struct {
+    size_t allocated;
+    size_t used;
+    size_t head;
+} deque_t;
+
+#define deque_of_(type, v) type* v = NULL
+
+/* Doubles the capacity of [DEQUE] when it is full */
+#define deque_try_grow(DEQUE) \
+    ((!(DEQUE) || deque_meta(DEQUE)->used == deque_meta(DEQUE)->allocated) ? \
+        (void)deq_grow(((void **)&(DEQUE)), sizeof(*(DEQUE))) : (void)0)
+
+/* Get the metadata block for [DEQUE] */
+#define deque_meta(DEQUE) \
+    ((deque_t *)(((unsigned char *)(DEQUE)) - sizeof(deque_t)))
+
+/* Get the storage index for position [POS] of [DEQUE] */
+#define deque_index(DEQUE, POS) \
+    ((POS) & (deque_meta(DEQUE)->allocated - 1))
+
+/* Deletes [DEQUE] and sets it to NULL */
+#define deque_free(DEQUE) \
+    ((void)((DEQUE) ? (deq_delete((void *)(DEQUE)), (DEQUE) = NULL) : 0))
+
+/* Get the size of [DEQUE] */
+#define deque_size(DEQUE) \
+    ((DEQUE) ? deque_meta(DEQUE)->used : 0)
+
+/* Get the capacity of [DEQUE] */
+#define deque_capacity(DEQUE) \
+    ((DEQUE) ? deque_meta(DEQUE)->allocated : 0)
+
+/* Get element [I] from the front of [DEQUE] */
+#define deque_at(DEQUE, I) \
+    ((DEQUE)[deque_index(DEQUE, deque_meta(DEQUE)->head + (I))])
+
+/* Get the front element in [DEQUE] */
+#define deque_front(DEQUE) \
+    deque_at(DEQUE, 0)
+
+/* Get the back element in [DEQUE] */
+#define deque_back(DEQUE) \
+    deque_at(DEQUE, deque_meta(DEQUE)->used - 1)
+
+/* Pushes back [VALUE] into [DEQUE] */
+#define deque_push_back(DEQUE, VALUE) \
+    (deque_try_grow(DEQUE), deque_push_back_uncheck(DEQUE, VALUE))
+
+#define deque_push_back_uncheck(DEQUE, VALUE) \
+    deque_at(DEQUE, deque_meta(DEQUE)->used++) = (VALUE)
+
+/* Pushes front [VALUE] into [DEQUE] */
+#define deque_push_front(DEQUE, VALUE) \
+    (\
+        deque_try_grow(DEQUE),\
+        ++(deque_meta(DEQUE)->used),\
+        (DEQUE)[deque_index(DEQUE, --(deque_meta(DEQUE)->head))] = (VALUE)\
+    )
+
+/* Pops the back element off [DEQUE], and returns it */
+#define deque_pop_back(DEQUE) \
+    deque_at(DEQUE, --(deque_meta(DEQUE)->used))
+
+/* Pops the front element off [DEQUE], and returns it */
+#define deque_pop_front(DEQUE) \
+    ((void)(deque_meta(DEQUE)->used -= 1), (DEQUE)[deque_index(DEQUE, deque_meta(DEQUE)->head++)])
+
+void deq_grow(void **deque, size_t s);
+void deq_delete(void *deque);
+
+#ifndef KCC_NO_IMPORT
+#if defined(__KCC_JIT__) || defined(__KCC__)
+#include <../libsrc/kcs/ext_deque.c>
+#endif
+#endif
+
 /* ---------------------------------------------------------------------------------------------
     KCC Extended Library - stack
 --------------------------------------------------------------------------------------------- */
 
-#define stack_of_(type, v)                  vector_of_(type, v)
-#define stack_free(STACK)                   vector_free(STACK)
-#define stack_push(STACK, VALUE)            vector_push(STACK, VALUE)
-#define stack_push_uncheck(STACK, VALUE)    vector_push_uncheck(STACK, VALUE)
-#define stack_last_by(STACK, i)             vector_last_by(STACK, i)
-#define stack_size(STACK)                   vector_size(STACK)
-#define stack_capacity(STACK)               vector_capacity(STACK)
-#define stack_last(STACK)                   vector_last(STACK)
-#define stack_pop(STACK)                    ((void)(vector_meta(STACK)->used -= 1), ((STACK)[vector_meta(STACK)->used]))
+#define stack_of_(type, v)                  deque_of_(type, v)
+#define stack_free(STACK)                   deque_free(STACK)
+#define stack_push(STACK, VALUE)            deque_push_back(STACK, VALUE)
+#define stack_push_uncheck(STACK, VALUE)    deque_push_back_uncheck(STACK, VALUE)
+#define stack_last_by(STACK, i)             deque_at(STACK, deque_meta(STACK)->used - (i))
+#define stack_size(STACK)                   deque_size(STACK)
+#define stack_capacity(STACK)               deque_capacity(STACK)
+#define stack_last(STACK)                   deque_back(STACK)
+#define stack_pop(STACK)                    deque_pop_back(STACK)
 
 /* ---------------------------------------------------------------------------------------------
     KCC Extended Library - queue
+        Elements are enqueued at the back and dequeued from the front, and queue_last gets
+        the one to be dequeued next.
+--------------------------------------------------------------------------------------------- */
+
+#define queue_of_(type, v)                  deque_of_(type, v)
+#define queue_free(QUEUE)                   deque_free(QUEUE)
+#define queue_enqueue(QUEUE, VALUE)         deque_push_back(QUEUE, VALUE)
+#define queue_size(QUEUE)                   deque_size(QUEUE)
+#define queue_capacity(QUEUE)               deque_capacity(QUEUE)
+#define queue_last(QUEUE)                   deque_front(QUEUE)
+#define queue_dequeue(QUEUE)                deque_pop_front(QUEUE)
+
+/* ---------------------------------------------------------------------------------------------
+    KCC Extended Library - sort
+        Sorts an array in ascending order without calling a comparison function.
+        qsort_double puts NaN last, and qsort_str compares by strcmp.
 --------------------------------------------------------------------------------------------- */
 
-#define queue_of_(type, v)                  vector_of_(type, v)
-#define queue_free(QUEUE)                   vector_free(QUEUE)
-#define queue_enqueue(QUEUE, VALUE)         vector_unshift(QUEUE, VALUE)
-#define queue_size(QUEUE)                   vector_size(QUEUE)
-#define queue_capacity(QUEUE)               vector_capacity(QUEUE)
-#define queue_last(QUEUE)                   vector_last(QUEUE)
-#define queue_dequeue(QUEUE)                ((void)(vector_meta(QUEUE)->used -= 1), ((QUEUE)[vector_meta(QUEUE)->used]))
+#define qsort_int(base, n)                  __kcc_builtin_qsort_int(base, n)
+#define qsort_double(base, n)               __kcc_builtin_qsort_double(base, n)
+#define qsort_str(base, n)                  __kcc_builtin_qsort_str(base, n)
 
 /* ---------------------------------------------------------------------------------------------
     KCC Extended Library - timer
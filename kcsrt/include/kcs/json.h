@@ -41,6 +41,11 @@ typedef struct __json_object_ {
 
     string_t                key;        /* key if exists */
     __json_value_t          value;      /* value of json object */
+
+    int                     count;      /* number of properties or elements */
+    unsigned int            hash;       /* hash of key once indexed */
+    unsigned int            icap;       /* capacity of index */
+    struct __json_object_   **index;    /* hash of properties or vector of elements, built on demand */
 } __json_object_t;
 
 extern __json_object_t *__json_parse(const char *str);
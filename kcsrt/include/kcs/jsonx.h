@@ -0,0 +1,94 @@
+#ifndef JSONX_H
+#define JSONX_H
+
+#include <_ext.h>
+#include <stdint.h>
+
+/*
+ * Native JSON parsing of the extension library: a streaming reader of
+ * events, and a DOM whose values are kept in an arena.
+ */
+
+typedef enum {
+    JSONX_END,              /* end of input */
+    JSONX_NULL,
+    JSONX_FALSE,
+    JSONX_TRUE,
+    JSONX_INTEGER,
+    JSONX_REAL,
+    JSONX_STRING,
+    JSONX_KEY,              /* key of an object member, events only */
+    JSONX_OBJECT,           /* start of an object for events */
+    JSONX_ARRAY,            /* start of an array for events */
+    JSONX_OBJECT_END,
+    JSONX_ARRAY_END,
+    JSONX_ERROR
+} jsonx_type_t;
+
+/* The members are filled by the extension library on each event. */
+typedef struct jsonx_reader_ {
+    int                     type;       /* type of the current event */
+    int                     depth;      /* nesting depth after the event */
+    const char              *str;       /* key, string or error message, valid until the next event */
+    int64_t                 len;        /* length of str */
+    int64_t                 i;          /* integer value */
+    double                  d;          /* real value */
+    int64_t                 line;       /* current line */
+} jsonx_reader_t;
+
+typedef int (*jsonx_handler_t)(jsonx_reader_t *r, void *user);
+
+typedef struct jsonx_value_ {
+    int                     type;
+    int                     len;        /* length of a string, or the number of members */
+    const char              *key;       /* key of an object member, otherwise NULL */
+    union {
+        int64_t             i;
+        double              d;
+        const char          *s;
+        struct jsonx_value_ *a;         /* members of an object or array */
+    } u;
+} jsonx_value_t;
+
+typedef struct jsonx_doc_ {
+    jsonx_value_t           *root;      /* NULL if parsing failed */
+    const char              *error;     /* NULL unless the last parse failed */
+    int64_t                 line;       /* line of the error, or the last line read */
+} jsonx_doc_t;
+
+/* streaming reader */
+jsonx_reader_t *jsonx_reader_open(const char *filename);
+jsonx_reader_t *jsonx_reader_open_string(const char *str);
+int jsonx_reader_next(jsonx_reader_t *r);
+void jsonx_reader_close(jsonx_reader_t *r);
+int jsonx_stream(jsonx_reader_t *r, jsonx_handler_t handler, void *user);
+int jsonx_stream_file(const char *filename, jsonx_handler_t handler, void *user);
+
+/* DOM */
+jsonx_doc_t *jsonx_parse(const char *text);
+jsonx_doc_t *jsonx_parse_file(const char *filename);
+jsonx_doc_t *jsonx_open_lines(const char *filename);
+int jsonx_next_line(jsonx_doc_t *doc);
+void jsonx_free(jsonx_doc_t *doc);
+
+/* accessors */
+jsonx_value_t *jsonx_get(jsonx_value_t *v, const char *key);
+jsonx_value_t *jsonx_at(jsonx_value_t *v, int index);
+int jsonx_size(jsonx_value_t *v);
+const char *jsonx_string(jsonx_value_t *v);
+int64_t jsonx_integer(jsonx_value_t *v);
+double jsonx_real(jsonx_value_t *v);
+int jsonx_boolean(jsonx_value_t *v);
+void jsonx_set_string(jsonx_doc_t *doc, jsonx_value_t *v, const char *str);
+void jsonx_set_integer(jsonx_value_t *v, int64_t i);
+void jsonx_set_real(jsonx_value_t *v, double d);
+
+#define jsonx_type(v)   ((v) ? (v)->type : JSONX_END)
+
+#ifndef KCC_NO_IMPORT
+#if defined(__KCC_JIT__) || defined(__KCC__)
+#include <../libsrc/kcs/ext_jsonx.c>
+#endif
+#endif
+
+#endif /* JSONX_H */
@@ -8,7 +8,25 @@
 # define EOF (-1)
 #endif
 
-typedef void FILE;
+#define BUFSIZ  (4096)
+#define _IOFBF  (0)
+#define _IOLBF  (1)
+#define _IONBF  (2)
+
+/*
+ * Buffered stream on top of a stream of the extension library. stdout
+ * is line buffered when it is a terminal, stderr is unbuffered, and all
+ * other streams are fully buffered.
+ */
+typedef struct _kcc_file_t {
+    void *handle;
+    char *buf;
+    int len;
+    int size;
+    int mode;
+    int flags;
+    struct _kcc_file_t *next;
+} FILE;
 typedef long int fpos_t;
 
 extern FILE* _kcc_iobuf[3];
@@ -21,7 +39,9 @@ extern FILE* _kcc_iobuf[3];
 #define SEEK_CUR (1)
 #define SEEK_END (2)
 
-#define putchar(c)  __kcc_builtin_putc(c)
+#define putchar(c)  __kcc_putchar(c)
+
+int __kcc_putchar(int c);
 
 int puts(const char *s);
 
@@ -43,6 +63,8 @@ int fclose(FILE *stream);
 int fgetpos(FILE *stream, int64_t *pos);
 int fsetpos(FILE *stream, int64_t *pos);
 int fflush(FILE *stream);
+int setvbuf(FILE *stream, char *buf, int mode, size_t size);
+void setbuf(FILE *stream, char *buf);
 int feof(FILE *stream);
 int fgetc(FILE *stream);
 char *fgets(char *s, int n, FILE *stream);
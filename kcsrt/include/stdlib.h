@@ -6,8 +6,8 @@
 #define EXIT_SUCCESS (0)
 #define EXIT_FAILURE (2)
 
-#define abort()                     __kcc_builtin_abort()
-#define exit(code)                  __kcc_builtin_exit(code)
+#define abort()                     __kcc_abort()
+#define exit(code)                  __kcc_exit(code)
 
 #define malloc(size)                __kcc_builtin_malloc(size)
 #define calloc(size, n)             __kcc_builtin_calloc(size, n)
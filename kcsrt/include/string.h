@@ -3,28 +3,42 @@
 
 #include <_builtin.h>
 
-#if !defined(__KCC_JIT__)
-#define strlen(size)                __kcc_builtin_strlen(size)
-#else
-int strlen(const char *s);
-#endif
+#define strlen(str)                 __kcc_builtin_strlen(str)
 #define strcpy(dst, src)            __kcc_builtin_strcpy(dst, src)
 #define strncpy(dst, src, len)      __kcc_builtin_strncpy(dst, src, len)
+#define strcat(dst, src)            __kcc_builtin_strcat(dst, src)
+#define strncat(dst, src, len)      __kcc_builtin_strncat(dst, src, len)
+#define strcmp(s1, s2)              __kcc_builtin_strcmp(s1, s2)
+#define strncmp(s1, s2, len)        __kcc_builtin_strncmp(s1, s2, len)
+#define strchr(s, c)                __kcc_builtin_strchr(s, c)
+#define strrchr(s, c)               __kcc_builtin_strrchr(s, c)
+#define strstr(s1, s2)              __kcc_builtin_strstr(s1, s2)
+#define strspn(s1, s2)              __kcc_builtin_strspn(s1, s2)
+#define strcspn(s1, s2)             __kcc_builtin_strcspn(s1, s2)
 #define memset(dst, value, size)    __kcc_builtin_memset(dst, value, size)
 #define memcpy(dst, src, size)      __kcc_builtin_memcpy(dst, src, size)
 #define memmove(dst, src, size)     __kcc_builtin_memmove(dst, src, size)
+#define memcmp(s1, s2, size)        __kcc_builtin_memcmp(s1, s2, size)
+#define memchr(s, c, size)          __kcc_builtin_memchr(s, c, size)
 
-char* strcat(char* s1, const char* s2);
-char* strncat(char* s1, const char* s2, size_t n);
-int strcmp(const char* s1, const char* s2);
-int strncmp(const char *s1, const char *s2, size_t n);
-char* strchr(const char* s, int c);
-size_t strcspn(const char *s1, const char *s2);
+/*
+ * Calls go to the builtins above. Functions are still defined for when
+ * the address is taken.
+ */
+char *(strcat)(char *s1, const char *s2);
+char *(strncat)(char *s1, const char *s2, size_t n);
+int (strcmp)(const char *s1, const char *s2);
+int (strncmp)(const char *s1, const char *s2, size_t n);
+char *(strchr)(const char *s, int c);
+char *(strrchr)(const char *s, int c);
+char *(strstr)(const char *s1, const char *s2);
+size_t (strspn)(const char *s1, const char *s2);
+size_t (strcspn)(const char *s1, const char *s2);
+int (memcmp)(const void *s1, const void *s2, size_t n);
+void *(memchr)(const void *s, int c, size_t n);
 char *strdup(const char *s);
-char* index(const char* s, int c);
-char* strrchr(const char* s, int c);
-char* rindex(const char* s, int c);
-int memcmp(const void *s1, const void *s2, size_t n);
+char *index(const char *s, int c);
+char *rindex(const char *s, int c);
 
 #ifndef KCC_NO_IMPORT
 #if defined(__KCC_JIT__) || defined(__KCC__)
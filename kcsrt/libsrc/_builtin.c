@@ -8,6 +8,13 @@ static int kcc_atexit_func_count = 0;
 
 int puts(const char *s);
 
+/*
+ * Set by the extension library to unload itself after all atexit
+ * functions have run, and by stdio to flush streams before that.
+ */
+void (*__kcc_extlib_cleanup)(void) = 0;
+void (*__kcc_stdio_cleanup)(void) = 0;
+
 int atexit(kcc_atexit_func_t func)
 {
     if (!kcc_atexit_func) {
@@ -35,6 +42,34 @@ void __kcc_call_atexit_funcs(void)
         __kcc_builtin_free(kcc_atexit_func);
         kcc_atexit_func = 0;
     }
+    if (__kcc_extlib_cleanup) {
+        (*__kcc_extlib_cleanup)();
+        __kcc_extlib_cleanup = 0;
+    }
+}
+
+/*
+ * Flush stream buffers before the program ends without running the
+ * atexit functions, by abort() or a runtime error of the VM.
+ */
+void __kcc_flush_on_abort(void)
+{
+    if (__kcc_stdio_cleanup) {
+        (*__kcc_stdio_cleanup)();
+    }
+}
+
+void __kcc_abort(void)
+{
+    __kcc_flush_on_abort();
+    __kcc_builtin_abort();
+}
+
+/* exit() runs the atexit functions, as on return from main. */
+void __kcc_exit(int code)
+{
+    __kcc_call_atexit_funcs();
+    __kcc_builtin_exit(code);
 }
 
 #endif /* KCC_BUILTIN_C */
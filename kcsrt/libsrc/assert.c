@@ -9,9 +9,9 @@
 
 void __kcc_assert_fail(const char *file, int line, const char *msg)
 {
-    printf("Assertion failed at %s:%d\n", file, line);
-    printf("Error: %s\n", msg);
-    __kcc_builtin_abort();
+    fprintf(stderr, "Assertion failed at %s:%d\n", file, line);
+    fprintf(stderr, "Error: %s\n", msg);
+    __kcc_abort();
 }
 
 #endif  /* KCC_ASSERT_ASSERT_C */
@@ -6,6 +6,9 @@ static void *kccext_handle = NULL;
 static void kcc_ext_atexit(void)
 {
     if (kccext_handle) {
+        if (__kcc_stdio_cleanup) {
+            (*__kcc_stdio_cleanup)();
+        }
         __kcc_builtin_unloadlib(kccext_handle);
     }
 }
@@ -14,7 +17,7 @@ void *kcc_extlib(void)
 {
     if (!kccext_handle) {
         kccext_handle = __kcc_builtin_loadlib("kcsext", NULL);
-        atexit(kcc_ext_atexit);
+        __kcc_extlib_cleanup = kcc_ext_atexit;
     }
     return kccext_handle;
 }
@@ -0,0 +1,38 @@
+#include <kcs/ext.h>
+
+/* ---------------------------------------------------------------------------------------------
+    KCC Extended Library - deque
+--------------------------------------------------------------------------------------------- */
+
+#define KCC_DEQUE_INITIAL (8)
+
+void deq_grow(void **deque, size_t type_size)
+{
+    deque_t *meta;
+    size_t count;
+
+    if (*deque) {
+        /*
+         * Only called when full, so the elements wrapped around to the start of the
+         * storage are the first head ones. Move them right after the old end.
+         */
+        meta = deque_meta(*deque);
+        count = meta->allocated;
+        meta = (deque_t *)realloc(meta, sizeof(*meta) + type_size * count * 2);
+        meta->head &= count - 1;
+        memcpy((char *)(meta + 1) + type_size * count, meta + 1, type_size * meta->head);
+        meta->allocated = count * 2;
+    } else {
+        meta = (deque_t *)malloc(sizeof(*meta) + type_size * KCC_DEQUE_INITIAL);
+        meta->allocated = KCC_DEQUE_INITIAL;
+        meta->used = 0;
+        meta->head = 0;
+    }
+
+    *deque = meta + 1;
+}
+
+void deq_delete(void *deque)
+{
+    free(deque_meta(deque));
+}
@@ -0,0 +1,1434 @@
+#line 1 "kcsrt/libsrc/kcs/json.y"
+
+#include <assert.h>
+#include <math.h>
+#include <kcs/ext.h>
+#include <kcs/json.h>
+
+int __json_yylex();
+typedef union __json_yyin_ {
+    FILE       *fp;
+    const char *str;
+} __json_yyin_t;
+__json_yyin_t __json_yyin;
+
+#line 15 "kcsrt/libsrc/kcs/json.y"
+typedef union {
+    __json_object_t *object;
+} __json_yyunion;
+#define JSON_YYSTYPE __json_yyunion
+short __json_yyini = 0;
+short __json_yyntoks = 29;
+short __json_yyr1[] = {
+   2,   1,   1,   1,   2,   4,   2,   4,   1,   3,
+   1,   3,   1,   3,   1,   3,   1,   3,   1,   3,
+   1,   3,   1,   3,   1,   3,   3,   1,   3,   3,
+   3,   1,   2,   2,   1,   1,   1,   1,   1,   1,
+   1,   3,   0,   1
+};
+short __json_yyr2[] = {
+   0,   1,   2,   2,   3,   3,   4,   4,   5,   5,
+   6,   7,   8,   8,   9,   9,  10,  10,  11,  11,
+  12,  12,  13,  13,  14,  14,  14,  15,  15,  15,
+  15,  16,  16,  16,  17,  17,  17,  17,  17,  17,
+  17,  17,  18,  18
+};
+short __json_yyadef[] = {
+  -1,  -1,   0,   1,   2,   3,  -1,   4,  42,  -1,
+   5,  -1,   6,  42,  -1,   7,   8,  43,   9,  10,
+  -1,  -1,  11,  12,  43,  13,  14,  -1,  15,  16,
+  -1,  17,  18,  -1,  19,  20,  -1,  21,  22,  -1,
+  23,  24,  -1,  25,  -1,  26,  27,  -1,  28,  -1,
+  29,  -1,  30,  31,  -1,  32,  -1,  33,  34,  35,
+  36,  37,  38,  39,  40,  -1,  -1,  41
+};
+short __json_yygdef[] = {
+  -1,   1,  58,   4,   5,   8,  23,  16,  13,  19,
+  26,  29,  32,  35,  38,  41,  46,  53,   9
+};
+short __json_yyadsp[] = {
+  -9,   3, -29, -29, -29, -29,  11, -29, -13,  12,
+ -29,  -6, -29,   6,  13, -29, -29,   8, -29,  30,
+  14,  15, -29, -29,  15, -29,  33,  15,  33,  40,
+  15,  40,  29,  15,  29,  42,  15,  42,   7,  15,
+   7,   2,  15,   2,  15,   2, -29,  15, -29,  15,
+ -29,  15, -29, -29,  31, -29,  31, -29, -29, -29,
+ -29, -29, -29, -29, -29,  15,  32, -29
+};
+short __json_yygdsp[] = {
+ -68, -68,  45, -68, -68, -68,  37,  33, -68, -68,
+  32,  36,  34,  32,  30,   7,  13,   9,  57
+};
+short __json_yyact[] = {
+  54,  56,   6,   2,  11,   6,  17,  11,  12,  65,
+  47,  49,  51,  42,  44,  59,  60,  61,  62,  63,
+  64,  54,  56,   7,  10,  24,   6,  15,  11,  20,
+  65,  27,  20,  36,  21,  30,  59,  60,  61,  62,
+  63,  64,   6,  33,  11,   3,  65,  39,  67,  43,
+  18,  45,  59,  60,  61,  62,  63,  64,  22,  28,
+  48,  25,  50,  55,  52,  57,  31,  34,  37,  40,
+  14,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+  -1,  -1,  66
+};
+short __json_yychk[] = {
+   6,   7,  11,   0,  13,  11,  19,  13,  14,  15,
+   8,   9,  10,   6,   7,  21,  22,  23,  24,  25,
+  26,   6,   7,  12,  12,  19,  11,  14,  13,  21,
+  15,   1,  21,   4,  20,   2,  21,  22,  23,  24,
+  25,  26,  11,   3,  13,  31,  15,   5,  16,  44,
+  36,  44,  21,  22,  23,  24,  25,  26,  35,  39,
+  45,  35,  45,  46,  45,  46,  40,  41,  42,  43,
+  47,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+  -1,  -1,  35
+};
+#define JSON_OP_LOR 128
+#define JSON_OP_LAND 129
+#define JSON_OP_OR 130
+#define JSON_OP_XOR 131
+#define JSON_OP_AND 132
+#define JSON_OP_ADD 133
+#define JSON_OP_SUB 134
+#define JSON_OP_MUL 135
+#define JSON_OP_DIV 136
+#define JSON_OP_MOD 137
+#define JSON_TOKEN_OBEG 138
+#define JSON_TOKEN_OEND 139
+#define JSON_TOKEN_ABEG 140
+#define JSON_TOKEN_AEND 141
+#define JSON_TOKEN_LB 142
+#define JSON_TOKEN_RB 143
+#define JSON_TOKEN_LP 144
+#define JSON_TOKEN_RP 145
+#define JSON_TOKEN_COMMA 146
+#define JSON_TOKEN_COLON 147
+#define JSON_TOKEN_STR 148
+#define JSON_TOKEN_INT 149
+#define JSON_TOKEN_DBL 150
+#define JSON_TOKEN_NULL 151
+#define JSON_TOKEN_TRUE 152
+#define JSON_TOKEN_FALSE 153
+#define JSON_TOKEN_ERROR 154
+#define JSON_TOKEN_END 155
+short __json_yytrns[] = {
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+   0,   0,   0,   0,   0,   0,   0,   0,   1,   2,
+   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,
+  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,
+  23,  24,  25,  26,  27,  28
+};
+
+#define yyerror __json_yyerror
+#define yyparse __json_yyparse
+#ifndef JSON_YYSTYPE
+#define JSON_YYSTYPE int
+#endif
+int __json_yyerror(const char *);
+JSON_YYSTYPE __json_yylval;
+
+int
+__json_yyparse()
+{
+	enum {
+		StackSize = 100,
+		ActSz = sizeof __json_yyact / sizeof __json_yyact[0],
+	};
+	struct {
+		JSON_YYSTYPE val;
+		int state;
+	} stk[StackSize], *ps;
+	int r, h, n, s, tk;
+	JSON_YYSTYPE __json_yyval;
+
+	ps = stk;
+	ps->state = s = __json_yyini;
+	tk = -1;
+loop:
+	n = __json_yyadsp[s];
+	if (tk < 0 && n > -__json_yyntoks)
+		tk = __json_yytrns[__json_yylex()];
+	n += tk;
+	if (n < 0 || n >= ActSz || __json_yychk[n] != tk) {
+		r = __json_yyadef[s];
+		if (r < 0) {
+			__json_yyerror("syntax error");
+			return -1;
+		}
+		goto reduce;
+	}
+	n = __json_yyact[n];
+	if (n == -1)
+		return -1;
+	if (n < 0) {
+		r = - (n+2);
+		goto reduce;
+	}
+	tk = -1;
+	__json_yyval = __json_yylval;
+stack:
+	ps++;
+	if (ps-stk >= StackSize)
+		return -2;
+	s = n;
+	ps->state = s;
+	ps->val = __json_yyval;
+	goto loop;
+reduce:
+	ps -= __json_yyr1[r];
+	h = __json_yyr2[r];
+	s = ps->state;
+	n = __json_yygdsp[h] + s;
+	if (n < 0 || n >= ActSz || __json_yychk[n] != __json_yyntoks+h)
+		n = __json_yygdef[h];
+	else
+		n = __json_yyact[n];
+	switch (r) {
+	case 0:
+		__json_yyval = ps[1].val; return 0;
+		break;
+	case 1:
+#line 71 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_set_top(ps[1].val.object);              }
+		break;
+	case 2:
+		break;
+	case 3:
+		break;
+	case 4:
+#line 80 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_gen_object();             }
+		break;
+	case 5:
+#line 81 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = ps[2].val.object;                              }
+		break;
+	case 6:
+#line 94 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_gen_array();              }
+		break;
+	case 7:
+#line 95 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = ps[2].val.object;                              }
+		break;
+	case 8:
+#line 85 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_append_pair(NULL, ps[1].val.object);    }
+		break;
+	case 9:
+#line 86 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_append_pair(ps[1].val.object, ps[3].val.object);      }
+		break;
+	case 10:
+		break;
+	case 11:
+#line 90 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_gen_pair(ps[1].val.object, ps[3].val.object);         }
+		break;
+	case 12:
+#line 99 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_append_value(NULL, ps[1].val.object);   }
+		break;
+	case 13:
+#line 100 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_append_value(ps[1].val.object, ps[3].val.object);     }
+		break;
+	case 14:
+		break;
+	case 15:
+#line 114 "kcsrt/libsrc/kcs/json.y"
+{ if (ps[1].val.object) { __json_yyval.object = ps[1].val.object; } else if (ps[3].val.object) { __json_yyval.object = ps[3].val.object; } else { __json_yyval.object = __json_make_null(); } }
+		break;
+	case 16:
+		break;
+	case 17:
+#line 119 "kcsrt/libsrc/kcs/json.y"
+{ if (!ps[1].val.object) { __json_yyval.object = __json_make_null(); } else { __json_yyval.object = ps[3].val.object; } }
+		break;
+	case 18:
+		break;
+	case 19:
+#line 124 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_bit_or(ps[1].val.object, ps[3].val.object);           }
+		break;
+	case 20:
+		break;
+	case 21:
+#line 129 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_bit_xor(ps[1].val.object, ps[3].val.object);          }
+		break;
+	case 22:
+		break;
+	case 23:
+#line 134 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_bit_and(ps[1].val.object, ps[3].val.object);          }
+		break;
+	case 24:
+		break;
+	case 25:
+#line 139 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_add(ps[1].val.object, ps[3].val.object);              }
+		break;
+	case 26:
+#line 140 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_sub(ps[1].val.object, ps[3].val.object);              }
+		break;
+	case 27:
+		break;
+	case 28:
+#line 145 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_mul(ps[1].val.object, ps[3].val.object);              }
+		break;
+	case 29:
+#line 146 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_div(ps[1].val.object, ps[3].val.object);              }
+		break;
+	case 30:
+#line 147 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_mod(ps[1].val.object, ps[3].val.object);              }
+		break;
+	case 31:
+		break;
+	case 32:
+#line 152 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = ps[2].val.object;                              }
+		break;
+	case 33:
+#line 153 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_neg(ps[2].val.object);                  }
+		break;
+	case 34:
+		break;
+	case 35:
+		break;
+	case 36:
+		break;
+	case 37:
+		break;
+	case 38:
+#line 161 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_make_null();              }
+		break;
+	case 39:
+#line 162 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_make_boolean(1);          }
+		break;
+	case 40:
+#line 163 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = __json_make_boolean(0);          }
+		break;
+	case 41:
+#line 164 "kcsrt/libsrc/kcs/json.y"
+{ __json_yyval.object = ps[2].val.object;                              }
+		break;
+	case 42:
+		break;
+	case 43:
+		break;
+	}
+	goto stack;
+}
+#line 167 "kcsrt/libsrc/kcs/json.y"
+
+
+/* The parser returns 0 on success, and a negative value on errors. */
+#define JSON_FILE_NOT_FOUND     (1)
+
+/* Objects and arrays with at least this many members are indexed on the first lookup. */
+#define JSON_INDEX_MIN          (8)
+
+static int __g_json_parser_ch = 0;
+static string_t __json_string_alloc(const char *s);
+static void __json_string_free(string_t *s);
+static void (*__json_lex_next)(void);
+
+static int __json_status            = 0;
+static int __json_line              = 1;
+static int __json_pos               = 0;
+static int __json_object_allocated  = 0;
+static int __json_string_allocated  = 0;
+static const char *__json_file      = NULL;
+static __json_object_t *__json_mgr  = NULL;
+static __json_object_t *__json_root = NULL;
+
+void __json_setup(void)
+{
+    __json_status = 0;
+    __json_line  = 1;
+    __json_pos   = 0;
+    __json_file  = NULL;
+    __json_mgr   = NULL;
+    __json_root  = NULL;
+    __json_lex_next();
+}
+
+void __json_lex_next_from_string(void)
+{
+    if (__g_json_parser_ch != EOF) {
+        __g_json_parser_ch = *__json_yyin.str++;
+        ++__json_pos;
+        if (__g_json_parser_ch == '\n') {
+            ++__json_line;
+            __json_pos = 0;
+        }
+    }
+}
+
+void __json_lex_next_from_file(void)
+{
+    __g_json_parser_ch = fgetc(__json_yyin.fp);
+    ++__json_pos;
+    if (__g_json_parser_ch == EOF) {
+        __g_json_parser_ch = 0;
+    }
+    if (__g_json_parser_ch == '\n') {
+        ++__json_line;
+        __json_pos = 0;
+    }
+}
+
+int __json_is_whitespace(void)
+{
+    return
+        __g_json_parser_ch == ' ' ||
+        __g_json_parser_ch == '\t' ||
+        __g_json_parser_ch == '\r' ||
+        __g_json_parser_ch == '\n'
+    ;
+}
+
+int __json_is_number(void)
+{
+    return '0' <= __g_json_parser_ch && __g_json_parser_ch <= '9';
+}
+
+int __json_is_oct_number(void)
+{
+    return '0' <= __g_json_parser_ch && __g_json_parser_ch <= '7';
+}
+
+int __json_is_hex_number(void)
+{
+    return
+        ('0' <= __g_json_parser_ch && __g_json_parser_ch <= '9') ||
+        ('a' <= __g_json_parser_ch && __g_json_parser_ch <= 'f') ||
+        ('A' <= __g_json_parser_ch && __g_json_parser_ch <= 'F')
+    ;
+}
+
+int __json_lex_make_number(void)
+{
+    int is_real = 0;
+    int is_hex = 0;
+    int is_oct = 0;
+    int is_zero = __g_json_parser_ch == '0';
+    char str[2] = { __g_json_parser_ch, 0 };
+    string_t s = __json_string_alloc(str);
+
+    __json_lex_next();
+    if (is_zero) {
+        is_oct = 1;
+    } else if (__g_json_parser_ch == '.') {
+        str[0] = __g_json_parser_ch;
+        string_append_cstr(&s, str);
+        __json_lex_next();
+        is_real = 1;
+    } else if (__g_json_parser_ch == 'x') {
+        str[0] = __g_json_parser_ch;
+        string_append_cstr(&s, str);
+        __json_lex_next();
+        is_hex = 1;
+    }
+
+    if (is_real) {
+        while (__json_is_number()) {
+            str[0] = __g_json_parser_ch;
+            string_append_cstr(&s, str);
+            __json_lex_next();
+        }
+        __json_yylval.object = __json_gen_double_object(strtod(s.cstr, NULL));
+        __json_string_free(&s);
+        return JSON_TOKEN_DBL;
+    } else if (is_hex) {
+        while (__json_is_hex_number()) {
+            str[0] = __g_json_parser_ch;
+            string_append_cstr(&s, str);
+            __json_lex_next();
+        }
+        __json_yylval.object = __json_gen_integer_object(strtoll(s.cstr, NULL, 16));
+        __json_string_free(&s);
+        return JSON_TOKEN_INT;
+    } else if (is_oct) {
+        while (__json_is_oct_number()) {
+            str[0] = __g_json_parser_ch;
+            string_append_cstr(&s, str);
+            __json_lex_next();
+        }
+        __json_yylval.object = __json_gen_integer_object(strtoll(s.cstr, NULL, 8));
+        __json_string_free(&s);
+        return JSON_TOKEN_INT;
+    }
+
+    while (__json_is_number()) {
+        str[0] = __g_json_parser_ch;
+        string_append_cstr(&s, str);
+        __json_lex_next();
+    }
+    __json_yylval.object = __json_gen_integer_object(strtoll(s.cstr, NULL, 10));
+    __json_string_free(&s);
+    return JSON_TOKEN_INT;
+}
+
+int __json_is_begin_keyword(void)
+{
+    return
+        __g_json_parser_ch == '_' ||
+        ('a' <= __g_json_parser_ch && __g_json_parser_ch <= 'z') ||
+        ('A' <= __g_json_parser_ch && __g_json_parser_ch <= 'Z')
+    ;
+}
+
+int __json_lex_make_keyword(void)
+{
+    char str[2] = { __g_json_parser_ch, 0 };
+    string_t s = __json_string_alloc(str);
+
+    __json_lex_next();
+    while (__json_is_begin_keyword() || __json_is_number()) {
+        str[0] = __g_json_parser_ch;
+        string_append_cstr(&s, str);
+        __json_lex_next();
+    }
+
+    if (!strcmp(s.cstr, "null")) {
+        __json_string_free(&s);
+        return JSON_TOKEN_NULL;
+    } else if (!strcmp(s.cstr, "true")) {
+        __json_string_free(&s);
+        return JSON_TOKEN_TRUE;
+    } else if (!strcmp(s.cstr, "false")) {
+        __json_string_free(&s);
+        return JSON_TOKEN_FALSE;
+    }
+
+    __json_yylval.object = __json_gen_text_object(s);
+    return JSON_TOKEN_STR;
+}
+
+int __json_lex_make_string()
+{
+    if (__g_json_parser_ch == '"') {
+        __json_lex_next();
+    }
+    if (__g_json_parser_ch == '"') {
+        __json_lex_next();
+        __json_yylval.object = __json_gen_text_object(__json_string_alloc(""));
+        return JSON_TOKEN_STR;
+    }
+
+    char str[2] = { __g_json_parser_ch, 0 };
+    string_t s = __json_string_alloc(str);
+
+    __json_lex_next();
+    while (__g_json_parser_ch != '"') {
+        if (__g_json_parser_ch == '\\') {
+            __json_lex_next();
+        }
+        str[0] = __g_json_parser_ch;
+        string_append_cstr(&s, str);
+        __json_lex_next();
+    }
+
+    __json_yylval.object = __json_gen_text_object(s);
+    __json_lex_next();
+    return JSON_TOKEN_STR;
+}
+
+int __json_yylex_impl()
+{
+    while (__json_is_whitespace()) {
+        __json_lex_next();
+    }
+    if (!__g_json_parser_ch) {
+        return 0;
+    }
+
+    if (__json_is_number()) {
+        return __json_lex_make_number();
+    } else if (__json_is_begin_keyword()) {
+        return __json_lex_make_keyword();
+    }
+    switch (__g_json_parser_ch) {
+    case '{':
+        __json_lex_next();
+        return JSON_TOKEN_OBEG;
+    case '}':
+        __json_lex_next();
+        return JSON_TOKEN_OEND;
+    case '[':
+        __json_lex_next();
+        return JSON_TOKEN_ABEG;
+    case ']':
+        __json_lex_next();
+        return JSON_TOKEN_AEND;
+    case '(':
+        __json_lex_next();
+        return JSON_TOKEN_LB;
+    case ')':
+        __json_lex_next();
+        return JSON_TOKEN_RB;
+    case ',':
+        __json_lex_next();
+        return JSON_TOKEN_COMMA;
+    case ':':
+        __json_lex_next();
+        return JSON_TOKEN_COLON;
+    case '|':
+        __json_lex_next();
+        if (__g_json_parser_ch == '|') {
+            __json_lex_next();
+            return JSON_OP_LOR;
+        }
+        return JSON_OP_OR;
+    case '^':
+        __json_lex_next();
+        return JSON_OP_XOR;
+    case '&':
+        __json_lex_next();
+        if (__g_json_parser_ch == '&') {
+            __json_lex_next();
+            return JSON_OP_LAND;
+        }
+        return JSON_OP_AND;
+    case '+':
+        __json_lex_next();
+        return JSON_OP_ADD;
+    case '-':
+        __json_lex_next();
+        return JSON_OP_SUB;
+    case '*':
+        __json_lex_next();
+        return JSON_OP_MUL;
+    case '/':
+        __json_lex_next();
+        return JSON_OP_DIV;
+    case '%':
+        __json_lex_next();
+        return JSON_OP_MOD;
+    case '"':
+        __json_lex_make_string();
+        return JSON_TOKEN_STR;
+    }
+
+    return JSON_TOKEN_ERROR;
+}
+
+int __json_yylex()
+{
+    #ifndef JSON_PARSER_DEBUG
+    return __json_yylex_impl();
+    #else
+    int r = __json_yylex_impl();
+    switch (r) {
+    case JSON_OP_LOR:
+        printf("%%input JSON_OP_LOR\n");
+        break;
+    case JSON_OP_LAND:
+        printf("%%input JSON_OP_LAND\n");
+        break;
+    case JSON_OP_OR:
+        printf("%%input JSON_OP_OR\n");
+        break;
+    case JSON_OP_XOR:
+        printf("%%input JSON_OP_XOR\n");
+        break;
+    case JSON_OP_AND:
+        printf("%%input JSON_OP_AND\n");
+        break;
+    case JSON_OP_ADD:
+        printf("%%input JSON_OP_ADD\n");
+        break;
+    case JSON_OP_SUB:
+        printf("%%input JSON_OP_SUB\n");
+        break;
+    case JSON_OP_MUL:
+        printf("%%input JSON_OP_MUL\n");
+        break;
+    case JSON_OP_DIV:
+        printf("%%input JSON_OP_DIV\n");
+        break;
+    case JSON_OP_MOD:
+        printf("%%input JSON_OP_MOD\n");
+        break;
+    case JSON_TOKEN_OBEG:
+        printf("%%input JSON_TOKEN_OBEG\n");
+        break;
+    case JSON_TOKEN_OEND:
+        printf("%%input JSON_TOKEN_OEND\n");
+        break;
+    case JSON_TOKEN_ABEG:
+        printf("%%input JSON_TOKEN_ABEG\n");
+        break;
+    case JSON_TOKEN_AEND:
+        printf("%%input JSON_TOKEN_AEND\n");
+        break;
+    case JSON_TOKEN_LB:
+        printf("%%input JSON_TOKEN_LB\n");
+        break;
+    case JSON_TOKEN_RB:
+        printf("%%input JSON_TOKEN_RB\n");
+        break;
+    case JSON_TOKEN_LP:
+        printf("%%input JSON_TOKEN_LP\n");
+        break;
+    case JSON_TOKEN_RP:
+        printf("%%input JSON_TOKEN_RP\n");
+        break;
+    case JSON_TOKEN_COMMA:
+        printf("%%input JSON_TOKEN_COMMA\n");
+        break;
+    case JSON_TOKEN_COLON:
+        printf("%%input JSON_TOKEN_COLON\n");
+        break;
+    case JSON_TOKEN_STR:
+        printf("%%input JSON_TOKEN_STR: %s\n", __json_yylval.object->value.t.cstr);
+        break;
+    case JSON_TOKEN_INT:
+        printf("%%input JSON_TOKEN_INT: %d\n", __json_yylval.object->value.i);
+        break;
+    case JSON_TOKEN_DBL:
+        printf("%%input JSON_TOKEN_DBL: %f\n", __json_yylval.object->value.d);
+        break;
+    case JSON_TOKEN_NULL:
+        printf("%%input JSON_TOKEN_NULL\n");
+        break;
+    case JSON_TOKEN_TRUE:
+        printf("%%input JSON_TOKEN_TRUE\n");
+        break;
+    case JSON_TOKEN_FALSE:
+        printf("%%input JSON_TOKEN_FALSE\n");
+        break;
+    case JSON_TOKEN_ERROR:
+        printf("%%input JSON_TOKEN_ERROR\n");
+        break;
+    case JSON_TOKEN_END:
+        printf("%%input JSON_TOKEN_END\n");
+        break;
+    }
+    return r;
+    #endif
+}
+
+static string_t __json_string_alloc(const char *s)
+{
+    ++__json_string_allocated;
+    return string_init(s);
+}
+
+static void __json_string_free(string_t *s)
+{
+    string_free(s);
+    --__json_string_allocated;
+}
+
+static __json_object_t *__json_alloc(__json_type_t type)
+{
+    __json_object_t * j = (__json_object_t *)calloc(1, sizeof(__json_object_t));
+    if (!__json_mgr) {
+        __json_mgr = j;
+    } else {
+        j->link = __json_mgr->link;
+        __json_mgr->link = j;
+    }
+    j->type = type;
+    j->mgr  = __json_mgr;
+    ++__json_object_allocated;
+    return j;
+}
+
+static void __json_free_one(__json_object_t *j)
+{
+    if (!j) {
+        return;
+    }
+
+    switch (j->type) {
+    case JSON_OBJECT:
+    case JSON_ARRAY:
+        free(j->index);
+        break;
+    case JSON_TEXT:
+        __json_string_free(&j->value.t);
+        break;
+    case JSON_PAIR:
+        __json_string_free(&j->key);
+        break;
+    }
+    --__json_object_allocated;
+    free(j);
+}
+
+void __json_free_all(__json_object_t *j)
+{
+    if (!j) {
+        return;
+    }
+
+    __json_object_t *p = j->mgr ? j->mgr : j;
+    while (p) {
+        __json_object_t *n = p->link;
+        __json_free_one(p);
+        p = n;
+    }
+    #ifdef JSON_PARSER_DEBUG
+    printf("[freed] %d elems and %d strings\n", __json_object_allocated, __json_string_allocated);
+    #endif
+
+    assert(__json_object_allocated == 0);
+    assert(__json_string_allocated == 0);
+    __json_mgr = NULL;
+}
+
+static void __json_drop_index(__json_object_t *j)
+{
+    if (j->index) {
+        free(j->index);
+        j->index = NULL;
+        j->icap = 0;
+    }
+}
+
+static unsigned int __json_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Hash the properties of j with open addressing, keeping the table at most
+ * half full. Only the first of duplicate keys goes in, as a walk of the list
+ * would find that one.
+ */
+static void __json_index_properties(__json_object_t *j)
+{
+    unsigned int i, mask, cap = 16;
+    __json_object_t *n, *e;
+
+    while (cap < j->count * 2) {
+        cap *= 2;
+    }
+    j->index = (__json_object_t **)calloc(cap, sizeof(__json_object_t *));
+    j->icap = cap;
+    mask = cap - 1;
+    for (n = j->prop; n; n = n->prop) {
+        n->hash = __json_hash(n->key.cstr);
+        for (i = n->hash & mask; (e = j->index[i]) != NULL; i = (i + 1) & mask) {
+            if (e->hash == n->hash && strcmp(e->key.cstr, n->key.cstr) == 0) {
+                break;
+            }
+        }
+        if (!e) {
+            j->index[i] = n;
+        }
+    }
+}
+
+static void __json_index_elements(__json_object_t *j)
+{
+    int i = 0;
+    __json_object_t *n;
+
+    j->index = (__json_object_t **)malloc(j->count * sizeof(__json_object_t *));
+    j->icap = j->count;
+    for (n = j->next; n; n = n->next) {
+        j->index[i++] = n;
+    }
+}
+
+static void __json_print_indent(int indent)
+{
+    if (indent > 0) {
+        for (int i = 0; i < indent; ++i) {
+            printf("    ");
+        }
+    }
+}
+
+static void __json_pretty_print(__json_object_t *j, int indent, int comma, int contd)
+{
+    __json_object_t *n;
+    int cr = 1;
+    if (!contd) {
+        __json_print_indent(indent);
+    }
+    switch (j->type) {
+    case JSON_UNKNWON:
+        printf("(unknown)");
+        break;
+    case JSON_OBJECT:
+        printf("{");
+        n = j->prop;
+        if (n) {
+            printf("\n");
+            while (n) {
+                __json_object_t *next = n->prop;
+                __json_pretty_print(n, indent+1, next ? 1 : 0, 0);
+                n = next;
+            }
+            __json_print_indent(indent);
+        }
+        printf("}");
+        break;
+    case JSON_ARRAY:
+        printf("[");
+        n = j->next;
+        if (n) {
+            printf("\n");
+            while (n) {
+                __json_object_t *next = n->next;
+                __json_pretty_print(n, indent+1, next ? 1 : 0, 0);
+                n = next;
+            }
+            __json_print_indent(indent);
+        }
+        printf("]");
+        break;
+    case JSON_PAIR:
+        printf("\"%s\": ", j->key.cstr);
+        __json_pretty_print(j->value.o, indent, comma, 1);
+        cr = 0;
+        comma = 0;
+        break;
+    case JSON_TEXT:
+        printf("\"%s\"", j->value.t.cstr);
+        break;
+    case JSON_BOOLEAN:
+        printf("%s", j->value.b ? "true" : "false");
+        break;
+    case JSON_INTEGER:
+        printf("%lld", j->value.i);
+        break;
+    case JSON_REAL:
+        printf("%f", j->value.d);
+        break;
+    case JSON_NULL:
+        printf("null");
+        break;
+    }
+    if (comma) {
+        printf(",");
+    }
+    if (cr) {
+        printf("\n");
+    }
+}
+
+void __json_pretty_print_all(json_object_t *j)
+{
+    __json_pretty_print(j, 0, 0, 0);
+}
+
+__json_object_t *__json_set_top(__json_object_t *j)
+{
+    __json_object_t *p = j->mgr;
+    while (p) {
+        p->root = j;
+        p = p->link;
+    }
+    __json_root = j;
+    #ifdef JSON_PARSER_DEBUG
+    printf("[constructed] %d elems and %d strings\n", __json_object_allocated, __json_string_allocated);
+    #endif
+    return j;
+}
+
+__json_object_t *__json_gen_object(void)
+{
+    return __json_alloc(JSON_OBJECT);
+}
+
+__json_object_t *__json_append_pair(__json_object_t *j1, __json_object_t *j2)
+{
+    if (!j1) {
+        j1 = __json_gen_object();
+    }
+    assert(j1->type == JSON_OBJECT);
+    assert(j2->type == JSON_PAIR);
+    if (j1->lobj) {
+        j1->lobj->prop = j2;
+        j1->lobj = j2;
+    } else {
+        j1->prop = j1->lobj = j2;
+    }
+    __json_drop_index(j1);
+    ++j1->count;
+    return j1;
+}
+
+__json_object_t *__json_gen_pair(__json_object_t *j1, __json_object_t *j2)
+{
+    if (j1->type == JSON_TEXT) {
+        j1->type = JSON_PAIR;
+        j1->key = __json_string_alloc(j1->value.t.cstr);
+        __json_string_free(&(j1->value.t));
+        j1->value.o = j2;
+    }
+    return j1;
+}
+
+__json_object_t *__json_gen_array(void)
+{
+    return __json_alloc(JSON_ARRAY);
+}
+
+__json_object_t *__json_append_value(__json_object_t *j1, __json_object_t *j2)
+{
+    if (!j1) {
+        j1 = __json_gen_array();
+    }
+    assert(j1->type == JSON_ARRAY);
+    if (j1->lary) {
+        j1->lary->next = j2;
+        j1->lary = j2;
+    } else {
+        j1->next = j1->lary = j2;
+    }
+    __json_drop_index(j1);
+    ++j1->count;
+    return j1;
+}
+
+__json_object_t *__json_bit_or(__json_object_t *j1, __json_object_t *j2)
+{
+    if (j1->type == JSON_INTEGER && j2->type == JSON_INTEGER) {
+        j1->value.i |= j2->value.i;
+    }
+    return j1;
+}
+
+__json_object_t *__json_bit_xor(__json_object_t *j1, __json_object_t *j2)
+{
+    if (j1->type == JSON_INTEGER && j2->type == JSON_INTEGER) {
+        j1->value.i ^= j2->value.i;
+    }
+    return j1;
+}
+
+__json_object_t *__json_bit_and(__json_object_t *j1, __json_object_t *j2)
+{
+    if (j1->type == JSON_INTEGER && j2->type == JSON_INTEGER) {
+        j1->value.i &= j2->value.i;
+    }
+    return j1;
+}
+
+__json_object_t *__json_add(__json_object_t *j1, __json_object_t *j2)
+{
+    switch (j1->type) {
+    case JSON_INTEGER:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.i = j1->value.i + j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->type = JSON_REAL;
+            j1->value.d = (double)j1->value.i + j2->value.d;
+            break;
+        case JSON_TEXT: {
+            char buf[256] = {0};
+            sprintf(buf, "%lld", j1->value.i);
+            j1->type = JSON_TEXT;
+            j1->value.t = __json_string_alloc(buf);
+            string_append(&j1->value.t, j2->value.t);
+            break;
+        }
+        default:
+            break;
+        }
+        break;
+    case JSON_REAL:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.d = j1->value.d + (double)j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->value.d = j1->value.d + j2->value.d;
+            break;
+        case JSON_TEXT: {
+            char buf[256] = {0};
+            sprintf(buf, "%f", j1->value.d);
+            j1->type = JSON_TEXT;
+            j1->value.t = __json_string_alloc(buf);
+            string_append(&j1->value.t, j2->value.t);
+            break;
+        }
+        default:
+            break;
+        }
+        break;
+    case JSON_TEXT:
+        switch (j2->type) {
+        case JSON_INTEGER: {
+            char buf[256] = {0};
+            sprintf(buf, "%lld", j2->value.i);
+            string_append_cstr(&j1->value.t, buf);
+            break;
+        }
+        case JSON_REAL: {
+            char buf[256] = {0};
+            sprintf(buf, "%f", j1->value.d);
+            string_append_cstr(&j1->value.t, buf);
+            break;
+        }
+        case JSON_TEXT: {
+            string_append(&j1->value.t, j2->value.t);
+            break;
+        }
+        default:
+            break;
+        }
+        break;
+    }
+    return j1;
+}
+
+__json_object_t *__json_sub(__json_object_t *j1, __json_object_t *j2)
+{
+    switch (j1->type) {
+    case JSON_INTEGER:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.i = j1->value.i - j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->type = JSON_REAL;
+            j1->value.d = (double)j1->value.i - j2->value.d;
+            break;
+        }
+        break;
+    case JSON_REAL:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.d = j1->value.d - (double)j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->value.d = j1->value.d - j2->value.d;
+            break;
+        }
+        break;
+    }
+    return j1;
+}
+
+__json_object_t *__json_mul(__json_object_t *j1, __json_object_t *j2)
+{
+    switch (j1->type) {
+    case JSON_INTEGER:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.i = j1->value.i * j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->type = JSON_REAL;
+            j1->value.d = (double)j1->value.i * j2->value.d;
+            break;
+        }
+        break;
+    case JSON_REAL:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.d = j1->value.d * (double)j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->value.d = j1->value.d * j2->value.d;
+            break;
+        }
+        break;
+    }
+    return j1;
+}
+
+__json_object_t *__json_div(__json_object_t *j1, __json_object_t *j2)
+{
+    switch (j1->type) {
+    case JSON_INTEGER:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.i = j1->value.i / j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->type = JSON_REAL;
+            j1->value.d = (double)j1->value.i / j2->value.d;
+            break;
+        }
+        break;
+    case JSON_REAL:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.d = j1->value.d / (double)j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->value.d = j1->value.d / j2->value.d;
+            break;
+        }
+        break;
+    }
+    return j1;
+}
+
+__json_object_t *__json_mod(__json_object_t *j1, __json_object_t *j2)
+{
+    switch (j1->type) {
+    case JSON_INTEGER:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.i %= j2->value.i;
+            break;
+        case JSON_REAL:
+            j1->type = JSON_REAL;
+            j1->value.d = fmod((double)j1->value.i, j2->value.d);
+            break;
+        }
+        break;
+    case JSON_REAL:
+        switch (j2->type) {
+        case JSON_INTEGER:
+            j1->value.d = fmod(j1->value.d, (double)j2->value.i);
+            break;
+        case JSON_REAL:
+            j1->value.d = fmod(j1->value.d, j2->value.d);
+            break;
+        }
+        break;
+    }
+    return j1;
+}
+
+__json_object_t *__json_neg(__json_object_t *j)
+{
+    switch (j->type) {
+    case JSON_INTEGER:
+        j->value.i = -j->value.i;
+        break;
+    case JSON_REAL:
+        j->value.d = -j->value.d;
+        break;
+    }
+    return j;
+}
+
+__json_object_t *__json_gen_double_object(double d)
+{
+    __json_object_t *j = __json_alloc(JSON_REAL);
+    j->value.d = d;
+    return j;
+}
+
+__json_object_t *__json_gen_integer_object(int64_t i)
+{
+    __json_object_t *j = __json_alloc(JSON_INTEGER);
+    j->value.i = i;
+    return j;
+}
+
+__json_object_t *__json_gen_text_object(string_t s)
+{
+    __json_object_t *j = __json_alloc(JSON_TEXT);
+    j->value.t = s;
+    return j;
+}
+
+__json_object_t *__json_make_boolean(int i)
+{
+    __json_object_t *j = __json_alloc(JSON_BOOLEAN);
+    j->value.b = i;
+    return j;
+}
+
+__json_object_t *__json_make_null(void)
+{
+    return __json_alloc(JSON_NULL);
+}
+
+__json_object_t *__json_parse(const char *str)
+{
+    __json_file = "(text)";
+    __json_lex_next = __json_lex_next_from_string;
+    __json_yyin.str = str;
+    __json_setup();
+    __json_status = __json_yyparse();
+    if (__json_status == 0) {
+        return __json_root;
+    }
+    __json_free_all(__json_mgr);
+    return NULL;
+}
+
+__json_object_t *__json_parse_file(const char *filename)
+{
+    __json_file = filename;
+    __json_lex_next = __json_lex_next_from_file;
+    __json_yyin.fp = fopen(filename, "r");
+    if (!__json_yyin.fp) {
+        __json_status = JSON_FILE_NOT_FOUND;
+        return NULL;
+    }
+
+    __json_setup();
+    __json_status = __json_yyparse();
+    fclose(__json_yyin.fp);
+    if (__json_status == 0) {
+        return __json_root;
+    }
+
+    __json_free_all(__json_mgr);
+    return NULL;
+}
+
+int __json_yyerror(const char *msg)
+{
+    /* The position is reported by __json_error_message(). */
+    return 0;
+}
+
+const char *__json_error_message(void)
+{
+    static char buf[256] = {0};
+    switch (__json_status) {
+    case 0: break;
+    case JSON_FILE_NOT_FOUND:
+        sprintf(buf, "File not found: %s.", __json_file);
+        return buf;
+    default:
+        sprintf(buf, "Error near the line %d.", __json_line);
+        return buf;
+    }
+    return "No errors.";
+}
+
+int __json_get_type(__json_object_t *j)
+{
+    return j ? j->type : JSON_UNKNWON;
+}
+
+__json_object_t *__json_get_property(__json_object_t *j, const char *key)
+{
+    if (j && j->type == JSON_OBJECT) {
+        json_object_t *n = j->prop;
+        if (j->count >= JSON_INDEX_MIN) {
+            if (!j->index) {
+                __json_index_properties(j);
+            }
+            unsigned int h = __json_hash(key);
+            unsigned int mask = j->icap - 1;
+            for (unsigned int i = h & mask; (n = j->index[i]) != NULL; i = (i + 1) & mask) {
+                if (n->hash == h && strcmp(n->key.cstr, key) == 0) {
+                    return n;
+                }
+            }
+            return NULL;
+        }
+        while (n) {
+            if (strcmp(n->key.cstr, key) == 0) {
+                return n;
+            }
+            n = n->prop;
+        }
+    }
+    return NULL;
+}
+
+int __json_get_property_count(__json_object_t *j)
+{
+    if (j && j->type == JSON_OBJECT) {
+        return j->count;
+    }
+    return 0;
+}
+
+__json_object_t *__json_get_element(__json_object_t *j, int index)
+{
+    if (j && j->type == JSON_ARRAY && 0 <= index && index < j->count) {
+        if (j->count >= JSON_INDEX_MIN) {
+            if (!j->index) {
+                __json_index_elements(j);
+            }
+            return j->index[index];
+        }
+        json_object_t *n = j->next;
+        for (int i = 0; i < index; ++i) {
+            n = n->next;
+        }
+        return n;
+    }
+    return NULL;
+}
+
+int __json_get_element_count(__json_object_t *j)
+{
+    if (j && j->type == JSON_ARRAY) {
+        return j->count;
+    }
+    return 0;
+}
+
+int __json_get_boolean(__json_object_t *j)
+{
+    if (j && j->type == JSON_BOOLEAN) {
+        return j->value.b;
+    }
+    return 0;
+}
+
+int64_t __json_get_integer(__json_object_t *j)
+{
+    if (j && j->type == JSON_INTEGER) {
+        return j->value.i;
+    }
+    return 0;
+}
+
+double __json_get_real(__json_object_t *j)
+{
+    if (j && j->type == JSON_REAL) {
+        return j->value.d;
+    }
+    return 0;
+}
+
+string_t* __json_get_key(__json_object_t *j)
+{
+    if (j && j->type == JSON_PAIR) {
+        return &j->key;
+    }
+    return 0;
+}
+
+string_t* __json_get_string(__json_object_t *j)
+{
+    if (j) {
+        if (j->type == JSON_TEXT) {
+            return &j->value.t;
+        }
+        if (j->type == JSON_PAIR) {
+            return __json_get_string(j->value.o);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include <kcs/jsonx.h>
+#include <string.h>
+
+#if defined(__KCC_FFI__)
+
+typedef void *(*jsonx_open_t)(const char *);
+
+jsonx_reader_t *jsonx_reader_open(const char *filename)
+{
+    static void *f = NULL;
+    return (jsonx_reader_t *)kcc_extcall(jsonx_open_t, kcc_extfunc(f, "jsonx_reader_open_typed"), "p", filename);
+}
+
+jsonx_reader_t *jsonx_reader_open_string(const char *str)
+{
+    static void *f = NULL;
+    return (jsonx_reader_t *)kcc_extcall(jsonx_open_t, kcc_extfunc(f, "jsonx_reader_open_string_typed"), "p", str);
+}
+
+int jsonx_reader_next(jsonx_reader_t *r)
+{
+    static void *f = NULL;
+    typedef int (*next_t)(jsonx_reader_t *);
+    return (int)kcc_extcall(next_t, kcc_extfunc(f, "jsonx_reader_next_typed"), "p", r);
+}
+
+void jsonx_reader_close(jsonx_reader_t *r)
+{
+    static void *f = NULL;
+    typedef void (*close_t)(jsonx_reader_t *);
+    kcc_extcall(close_t, kcc_extfunc(f, "jsonx_reader_close_typed"), "p", r);
+}
+
+jsonx_doc_t *jsonx_parse(const char *text)
+{
+    static void *f = NULL;
+    return (jsonx_doc_t *)kcc_extcall(jsonx_open_t, kcc_extfunc(f, "jsonx_parse_typed"), "p", text);
+}
+
+jsonx_doc_t *jsonx_parse_file(const char *filename)
+{
+    static void *f = NULL;
+    return (jsonx_doc_t *)kcc_extcall(jsonx_open_t, kcc_extfunc(f, "jsonx_parse_file_typed"), "p", filename);
+}
+
+jsonx_doc_t *jsonx_open_lines(const char *filename)
+{
+    static void *f = NULL;
+    return (jsonx_doc_t *)kcc_extcall(jsonx_open_t, kcc_extfunc(f, "jsonx_open_lines_typed"), "p", filename);
+}
+
+int jsonx_next_line(jsonx_doc_t *doc)
+{
+    static void *f = NULL;
+    typedef int (*next_line_t)(jsonx_doc_t *);
+    return (int)kcc_extcall(next_line_t, kcc_extfunc(f, "jsonx_next_line_typed"), "p", doc);
+}
+
+void jsonx_free(jsonx_doc_t *doc)
+{
+    static void *f = NULL;
+    typedef void (*free_t)(jsonx_doc_t *);
+    kcc_extcall(free_t, kcc_extfunc(f, "jsonx_free_typed"), "p", doc);
+}
+
+jsonx_value_t *jsonx_get(jsonx_value_t *v, const char *key)
+{
+    static void *f = NULL;
+    typedef jsonx_value_t *(*get_t)(jsonx_value_t *, const char *);
+    return (jsonx_value_t *)kcc_extcall(get_t, kcc_extfunc(f, "jsonx_get_typed"), "pp", v, key);
+}
+
+void jsonx_set_string(jsonx_doc_t *doc, jsonx_value_t *v, const char *str)
+{
+    static void *f = NULL;
+    typedef void (*set_string_t)(jsonx_doc_t *, jsonx_value_t *, const char *);
+    kcc_extcall(set_string_t, kcc_extfunc(f, "jsonx_set_string_typed"), "ppp", doc, v, str);
+}
+
+#else
+
+jsonx_reader_t *jsonx_reader_open(const char *filename)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_s(filename);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "jsonx_reader_open"));
+}
+
+jsonx_reader_t *jsonx_reader_open_string(const char *str)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_s(str);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "jsonx_reader_open_string"));
+}
+
+int jsonx_reader_next(jsonx_reader_t *r)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(r);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "jsonx_reader_next"));
+}
+
+void jsonx_reader_close(jsonx_reader_t *r)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(r);
+    __kcc_builtin_invoke(kcc_extfunc(f, "jsonx_reader_close"));
+}
+
+jsonx_doc_t *jsonx_parse(const char *text)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_s(text);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "jsonx_parse"));
+}
+
+jsonx_doc_t *jsonx_parse_file(const char *filename)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_s(filename);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "jsonx_parse_file"));
+}
+
+jsonx_doc_t *jsonx_open_lines(const char *filename)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_s(filename);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "jsonx_open_lines"));
+}
+
+int jsonx_next_line(jsonx_doc_t *doc)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(doc);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "jsonx_next_line"));
+}
+
+void jsonx_free(jsonx_doc_t *doc)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(doc);
+    __kcc_builtin_invoke(kcc_extfunc(f, "jsonx_free"));
+}
+
+jsonx_value_t *jsonx_get(jsonx_value_t *v, const char *key)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(v);
+    __kcc_builtin_add_arg_s(key);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "jsonx_get"));
+}
+
+void jsonx_set_string(jsonx_doc_t *doc, jsonx_value_t *v, const char *str)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(doc);
+    __kcc_builtin_add_arg_p(v);
+    __kcc_builtin_add_arg_s(str);
+    __kcc_builtin_invoke(kcc_extfunc(f, "jsonx_set_string"));
+}
+
+#endif
+
+/*
+ * Call handler for each event of r until it returns non-zero, which is
+ * then returned. Return 0 at the end of input, or -1 after handler has
+ * seen a JSONX_ERROR event.
+ */
+int jsonx_stream(jsonx_reader_t *r, jsonx_handler_t handler, void *user)
+{
+    int type, rc;
+    while ((type = jsonx_reader_next(r)) != JSONX_END) {
+        if ((rc = handler(r, user)) != 0) {
+            return rc;
+        }
+        if (type == JSONX_ERROR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int jsonx_stream_file(const char *filename, jsonx_handler_t handler, void *user)
+{
+    jsonx_reader_t *r = jsonx_reader_open(filename);
+    if (!r) {
+        return -1;
+    }
+    int rc = jsonx_stream(r, handler, user);
+    jsonx_reader_close(r);
+    return rc;
+}
+
+jsonx_value_t *jsonx_at(jsonx_value_t *v, int index)
+{
+    if (v && (v->type == JSONX_ARRAY || v->type == JSONX_OBJECT) && 0 <= index && index < v->len) {
+        return v->u.a + index;
+    }
+    return NULL;
+}
+
+int jsonx_size(jsonx_value_t *v)
+{
+    if (v && (v->type == JSONX_ARRAY || v->type == JSONX_OBJECT)) {
+        return v->len;
+    }
+    return 0;
+}
+
+const char *jsonx_string(jsonx_value_t *v)
+{
+    return v && v->type == JSONX_STRING ? v->u.s : NULL;
+}
+
+int64_t jsonx_integer(jsonx_value_t *v)
+{
+    if (v) {
+        if (v->type == JSONX_INTEGER) {
+            return v->u.i;
+        }
+        if (v->type == JSONX_REAL) {
+            return (int64_t)v->u.d;
+        }
+    }
+    return 0;
+}
+
+double jsonx_real(jsonx_value_t *v)
+{
+    if (v) {
+        if (v->type == JSONX_REAL) {
+            return v->u.d;
+        }
+        if (v->type == JSONX_INTEGER) {
+            return (double)v->u.i;
+        }
+    }
+    return 0.0;
+}
+
+int jsonx_boolean(jsonx_value_t *v)
+{
+    return v && v->type == JSONX_TRUE;
+}
+
+void jsonx_set_integer(jsonx_value_t *v, int64_t i)
+{
+    v->type = JSONX_INTEGER;
+    v->len = 0;
+    v->u.i = i;
+}
+
+void jsonx_set_real(jsonx_value_t *v, double d)
+{
+    v->type = JSONX_REAL;
+    v->len = 0;
+    v->u.d = d;
+}
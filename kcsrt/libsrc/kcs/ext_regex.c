@@ -2,30 +2,33 @@
 
 regex_t *regex_compile(const char *pattern)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     regex_t *regex = calloc(1, sizeof(regex_t));
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_s(pattern);
-    regex->h = __kcc_builtin_call_p(h, "regex_compile");
+    regex->h = __kcc_builtin_invoke_p(kcc_extfunc(f, "regex_compile"));
     regex->num_regs = 0;
     return regex;
 }
 
 int regex_search_from(regex_t *regex, const char *str, int start)
 {
-    void *h = kcc_extlib();
+    static void *f_search = NULL;
+    static void *f_region_num_regs = NULL;
+    static void *f_region_beg = NULL;
+    static void *f_region_end = NULL;
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(regex->h);
     __kcc_builtin_add_arg_s(str);
     __kcc_builtin_add_arg_i(start);
-    int r = __kcc_builtin_call_i(h, "regex_search");
+    int r = __kcc_builtin_invoke_i(kcc_extfunc(f_search, "regex_search"));
     if (!r) {
         return 0;
     }
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(regex->h);
-    int num_regs = __kcc_builtin_call_i(h, "regex_region_num_regs");
+    int num_regs = __kcc_builtin_invoke_i(kcc_extfunc(f_region_num_regs, "regex_region_num_regs"));
     if (num_regs > 10) {
         num_regs = 10;
     }
@@ -35,8 +38,8 @@ int regex_search_from(regex_t *regex, const char *str, int start)
         __kcc_builtin_reset_args();
         __kcc_builtin_add_arg_p(regex->h);
         __kcc_builtin_add_arg_i(i);
-        regex->beg[i] = __kcc_builtin_call_i(h, "regex_region_beg");
-        regex->end[i] = __kcc_builtin_call_i(h, "regex_region_end");
+        regex->beg[i] = __kcc_builtin_invoke_i(kcc_extfunc(f_region_beg, "regex_region_beg"));
+        regex->end[i] = __kcc_builtin_invoke_i(kcc_extfunc(f_region_end, "regex_region_end"));
     }
 
     return 1;
@@ -49,9 +52,9 @@ int regex_search(regex_t *regex, const char *str)
 
 void regex_free(regex_t *regex)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(regex->h);
-    __kcc_builtin_call(h, "regex_free");
+    __kcc_builtin_invoke(kcc_extfunc(f, "regex_free"));
     free(regex);
 }
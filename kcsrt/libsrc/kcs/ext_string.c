@@ -1,4 +1,5 @@
 #include <kcs/ext.h>
+#include <stdarg.h>
 #include <string.h>
 
 string_t string_init(const char *s)
@@ -36,3 +37,110 @@ string_t string_substr(const string_t str, int start, int len)
         .cstr = buf,
     };
 }
+
+void string_reserve(string_t *str, unsigned int len)
+{
+    unsigned int cap;
+
+    if (!str->cstr) {
+        str->len = 0;
+        str->cap = 0;
+    } else if (len < str->cap) {
+        return;
+    }
+
+    cap = str->cap * 2;
+    if (cap <= len) {
+        cap = KCC_CAPACITY(len);
+    }
+    str->cstr = (char *)realloc(str->cstr, cap * sizeof(char));
+    str->cstr[str->len] = 0;
+    str->cap = cap;
+}
+
+void string_builder_init(string_builder_t *sb)
+{
+    sb->buf = sb->small;
+    sb->cap = KCC_STRING_BUILDER_INLINE;
+    sb->len = 0;
+    sb->small[0] = 0;
+}
+
+void string_builder_reserve(string_builder_t *sb, unsigned int len)
+{
+    unsigned int cap;
+
+    if (len < sb->cap) {
+        return;
+    }
+
+    cap = sb->cap * 2;
+    if (cap <= len) {
+        cap = KCC_CAPACITY(len);
+    }
+    if (sb->buf == sb->small) {
+        sb->buf = (char *)malloc(cap * sizeof(char));
+        memcpy(sb->buf, sb->small, sb->len + 1);
+    } else {
+        sb->buf = (char *)realloc(sb->buf, cap * sizeof(char));
+    }
+    sb->cap = cap;
+}
+
+void string_builder_append_cstr_with_len(string_builder_t *sb, const char *s, unsigned int len)
+{
+    if (sb->len + len >= sb->cap) {
+        string_builder_reserve(sb, sb->len + len);
+    }
+    memcpy(sb->buf + sb->len, s, len);
+    sb->len += len;
+    sb->buf[sb->len] = 0;
+}
+
+/*
+ * The format builtin does not advance the argument list, so the same
+ * list is formatted again once the buffer has grown, as in vfprintf.
+ */
+int string_builder_appendf(string_builder_t *sb, const char *fmt, ...)
+{
+    int n;
+    va_list ap;
+
+    va_start(ap, fmt);
+    n = __kcc_builtin_vformat(sb->buf + sb->len, sb->cap - sb->len, fmt, ap);
+    if (n > 0 && sb->len + n >= sb->cap) {
+        string_builder_reserve(sb, sb->len + n);
+        __kcc_builtin_vformat(sb->buf + sb->len, sb->cap - sb->len, fmt, ap);
+    }
+    va_end(ap);
+    if (n > 0) {
+        sb->len += n;
+    }
+    sb->buf[sb->len] = 0;
+    return n;
+}
+
+string_t string_builder_detach(string_builder_t *sb)
+{
+    string_t str;
+
+    if (sb->buf == sb->small) {
+        str.cap = KCC_CAPACITY(sb->len);
+        str.cstr = (char *)malloc(str.cap * sizeof(char));
+        memcpy(str.cstr, sb->small, sb->len + 1);
+    } else {
+        str.cap = sb->cap;
+        str.cstr = sb->buf;
+    }
+    str.len = sb->len;
+    string_builder_init(sb);
+    return str;
+}
+
+void string_builder_free(string_builder_t *sb)
+{
+    if (sb->buf != sb->small) {
+        free(sb->buf);
+    }
+    string_builder_init(sb);
+}
@@ -13,9 +13,7 @@ void vec_grow(void **vector, size_t more, size_t type_size)
 
     if (*vector) {
         count = 2 * meta->allocated + more;
-        data = malloc(type_size * count + sizeof(*meta));
-        memcpy(data, meta, type_size * count + sizeof(*meta));
-        free(meta);
+        data = realloc(meta, type_size * count + sizeof(*meta));
     } else {
         count = more + 1;
         data = malloc(type_size * count + sizeof(*meta));
@@ -3,7 +3,8 @@
 
 zip_t *zip_open(const char *zipname, char mode)
 {
-    void *h = kcc_extlib();
+    static void *f_open = NULL;
+    static void *f_total_entries = NULL;
     zip_t *zip = calloc(1, sizeof(zip_t));
     zip->mode = mode;
     zip->level = 6; // by default.
@@ -11,11 +12,11 @@ zip_t *zip_open(const char *zipname, char mode)
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_s(zipname);
     __kcc_builtin_add_arg_i(mode);
-    zip->h = __kcc_builtin_call_p(h, "ziplib_open");
+    zip->h = __kcc_builtin_invoke_p(kcc_extfunc(f_open, "ziplib_open"));
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(zip->h);
-    zip->total_entries = __kcc_builtin_call_i(h, "ziplib_total_entries");
+    zip->total_entries = __kcc_builtin_invoke_i(kcc_extfunc(f_total_entries, "ziplib_total_entries"));
 
     return zip;
 }
@@ -30,21 +31,29 @@ zip_t *zip_compression_level(zip_t *zip, int level)
 
 void zip_close(zip_t *zip)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(zip->h);
-    __kcc_builtin_call(h, "ziplib_close");
+    __kcc_builtin_invoke(kcc_extfunc(f, "ziplib_close"));
     free(zip);
 }
 
 zip_entry_t *zip_entry_open(zip_t *zip, const char *entryname)
 {
-    void *h = kcc_extlib();
+    static void *f_entry_open = NULL;
+    static void *f_entry_name = NULL;
+    static void *f_entry_time = NULL;
+    static void *f_entry_index = NULL;
+    static void *f_entry_isdir = NULL;
+    static void *f_entry_isenc = NULL;
+    static void *f_entry_size = NULL;
+    static void *f_entry_compsize = NULL;
+    static void *f_entry_crc32 = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(zip->h);
     __kcc_builtin_add_arg_s(entryname);
-    void *e = __kcc_builtin_call_p(h, "ziplib_entry_open");
+    void *e = __kcc_builtin_invoke_p(kcc_extfunc(f_entry_open, "ziplib_entry_open"));
     if (!e) {
         return NULL;
     }
@@ -54,14 +63,14 @@ zip_entry_t *zip_entry_open(zip_t *zip, const char *entryname)
     if (zip->mode == 'r' || zip->mode == 'a') {
         __kcc_builtin_reset_args();
         __kcc_builtin_add_arg_p(ent->h);
-        ent->name = __kcc_builtin_call_p(h, "ziplib_entry_name");
-        ent->time = __kcc_builtin_call_i(h, "ziplib_entry_time");
-        ent->index = __kcc_builtin_call_i(h, "ziplib_entry_index");
-        ent->isdir = __kcc_builtin_call_i(h, "ziplib_entry_isdir");
-        ent->isenc = __kcc_builtin_call_i(h, "ziplib_entry_isenc");
-        ent->size = __kcc_builtin_call_i(h, "ziplib_entry_size");
-        ent->compsize = __kcc_builtin_call_i(h, "ziplib_entry_compsize");
-        ent->crc32 = __kcc_builtin_call_i(h, "ziplib_entry_crc32");
+        ent->name = __kcc_builtin_invoke_p(kcc_extfunc(f_entry_name, "ziplib_entry_name"));
+        ent->time = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_time, "ziplib_entry_time"));
+        ent->index = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_index, "ziplib_entry_index"));
+        ent->isdir = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_isdir, "ziplib_entry_isdir"));
+        ent->isenc = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_isenc, "ziplib_entry_isenc"));
+        ent->size = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_size, "ziplib_entry_size"));
+        ent->compsize = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_compsize, "ziplib_entry_compsize"));
+        ent->crc32 = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_crc32, "ziplib_entry_crc32"));
         if (!ent->name) {
             ent->name = "(noname)";
         }
@@ -71,12 +80,20 @@ zip_entry_t *zip_entry_open(zip_t *zip, const char *entryname)
 
 zip_entry_t *zip_entry_openbyindex(zip_t *zip, int index)
 {
-    void *h = kcc_extlib();
+    static void *f_entry_openbyindex = NULL;
+    static void *f_entry_name = NULL;
+    static void *f_entry_time = NULL;
+    static void *f_entry_index = NULL;
+    static void *f_entry_isdir = NULL;
+    static void *f_entry_isenc = NULL;
+    static void *f_entry_size = NULL;
+    static void *f_entry_compsize = NULL;
+    static void *f_entry_crc32 = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(zip->h);
     __kcc_builtin_add_arg_i(index);
-    void *e = __kcc_builtin_call_p(h, "ziplib_entry_openbyindex");
+    void *e = __kcc_builtin_invoke_p(kcc_extfunc(f_entry_openbyindex, "ziplib_entry_openbyindex"));
     if (!e) {
         return NULL;
     }
@@ -86,14 +103,14 @@ zip_entry_t *zip_entry_openbyindex(zip_t *zip, int index)
     if (zip->mode == 'r' || zip->mode == 'a') {
         __kcc_builtin_reset_args();
         __kcc_builtin_add_arg_p(e);
-        ent->name = __kcc_builtin_call_p(h, "ziplib_entry_name");
-        ent->time = __kcc_builtin_call_i(h, "ziplib_entry_time");
-        ent->index = __kcc_builtin_call_i(h, "ziplib_entry_index");
-        ent->isdir = __kcc_builtin_call_i(h, "ziplib_entry_isdir");
-        ent->isenc = __kcc_builtin_call_i(h, "ziplib_entry_isenc");
-        ent->size = __kcc_builtin_call_i(h, "ziplib_entry_size");
-        ent->compsize = __kcc_builtin_call_i(h, "ziplib_entry_compsize");
-        ent->crc32 = __kcc_builtin_call_i(h, "ziplib_entry_crc32");
+        ent->name = __kcc_builtin_invoke_p(kcc_extfunc(f_entry_name, "ziplib_entry_name"));
+        ent->time = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_time, "ziplib_entry_time"));
+        ent->index = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_index, "ziplib_entry_index"));
+        ent->isdir = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_isdir, "ziplib_entry_isdir"));
+        ent->isenc = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_isenc, "ziplib_entry_isenc"));
+        ent->size = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_size, "ziplib_entry_size"));
+        ent->compsize = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_compsize, "ziplib_entry_compsize"));
+        ent->crc32 = __kcc_builtin_invoke_i(kcc_extfunc(f_entry_crc32, "ziplib_entry_crc32"));
         if (!ent->name) {
             ent->name = "(noname)";
         }
@@ -104,17 +121,17 @@ zip_entry_t *zip_entry_openbyindex(zip_t *zip, int index)
 
 void zip_entry_close(zip_entry_t *ent)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(ent->h);
-    __kcc_builtin_call(h, "ziplib_entry_close");
+    __kcc_builtin_invoke(kcc_extfunc(f, "ziplib_entry_close"));
     free(ent);
 }
 
 int zip_entry_write(zip_t *zip, const char *name, const void *buf, size_t bufsize)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(zip->h);
@@ -122,7 +139,7 @@ int zip_entry_write(zip_t *zip, const char *name, const void *buf, size_t bufsiz
     __kcc_builtin_add_arg_p(buf);
     __kcc_builtin_add_arg_i(bufsize);
     __kcc_builtin_add_arg_i(zip->level);
-    int r = __kcc_builtin_call_i(h, "ziplib_entry_write");
+    int r = __kcc_builtin_invoke_i(kcc_extfunc(f, "ziplib_entry_write"));
     if (r) {
         zip->total_entries++;
     }
@@ -131,14 +148,14 @@ int zip_entry_write(zip_t *zip, const char *name, const void *buf, size_t bufsiz
 
 int zip_entry_write_from_file(zip_t *zip, const char *filename)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(zip->h);
     __kcc_builtin_add_arg_s(filename);
     __kcc_builtin_add_arg_s(filename);
     __kcc_builtin_add_arg_i(zip->level);
-    int r = __kcc_builtin_call_i(h, "ziplib_entry_write_from_file");
+    int r = __kcc_builtin_invoke_i(kcc_extfunc(f, "ziplib_entry_write_from_file"));
     if (r) {
         zip->total_entries++;
     }
@@ -147,28 +164,28 @@ int zip_entry_write_from_file(zip_t *zip, const char *filename)
 
 int zip_entry_read(zip_entry_t *ent, void *buf, size_t bufsize)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(ent->h);
     __kcc_builtin_add_arg_p(buf);
     __kcc_builtin_add_arg_i(bufsize);
-    return __kcc_builtin_call_i(h, "ziplib_entry_read");
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "ziplib_entry_read"));
 }
 
 int zip_entry_read_to_file(zip_entry_t *ent, const char *filename)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_p(ent->h);
     __kcc_builtin_add_arg_s(filename);
-    return __kcc_builtin_call_i(h, "ziplib_entry_read_to_file");
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "ziplib_entry_read_to_file"));
 }
 
 int zip_create(const char *zipname, int level, const char *filenames[], size_t len)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
 
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_s(zipname);
@@ -176,5 +193,5 @@ int zip_create(const char *zipname, int level, const char *filenames[], size_t l
     for (int i = 0; i < len; ++i) {
         __kcc_builtin_add_arg_s(filenames[i]);
     }
-    return __kcc_builtin_call_i(h, "ziplib_create");
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "ziplib_create"));
 }
@@ -166,6 +166,12 @@ JsonFactor
 
 %%
 
+/* The parser returns 0 on success, and a negative value on errors. */
+#define JSON_FILE_NOT_FOUND     (1)
+
+/* Objects and arrays with at least this many members are indexed on the first lookup. */
+#define JSON_INDEX_MIN          (8)
+
 static int __g_json_parser_ch = 0;
 static string_t __json_string_alloc(const char *s);
 static void __json_string_free(string_t *s);
@@ -582,6 +588,10 @@ static void __json_free_one(__json_object_t *j)
     }
 
     switch (j->type) {
+    case JSON_OBJECT:
+    case JSON_ARRAY:
+        free(j->index);
+        break;
     case JSON_TEXT:
         __json_string_free(&j->value.t);
         break;
@@ -614,6 +624,65 @@ void __json_free_all(__json_object_t *j)
     __json_mgr = NULL;
 }
 
+static void __json_drop_index(__json_object_t *j)
+{
+    if (j->index) {
+        free(j->index);
+        j->index = NULL;
+        j->icap = 0;
+    }
+}
+
+static unsigned int __json_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Hash the properties of j with open addressing, keeping the table at most
+ * half full. Only the first of duplicate keys goes in, as a walk of the list
+ * would find that one.
+ */
+static void __json_index_properties(__json_object_t *j)
+{
+    unsigned int i, mask, cap = 16;
+    __json_object_t *n, *e;
+
+    while (cap < j->count * 2) {
+        cap *= 2;
+    }
+    j->index = (__json_object_t **)calloc(cap, sizeof(__json_object_t *));
+    j->icap = cap;
+    mask = cap - 1;
+    for (n = j->prop; n; n = n->prop) {
+        n->hash = __json_hash(n->key.cstr);
+        for (i = n->hash & mask; (e = j->index[i]) != NULL; i = (i + 1) & mask) {
+            if (e->hash == n->hash && strcmp(e->key.cstr, n->key.cstr) == 0) {
+                break;
+            }
+        }
+        if (!e) {
+            j->index[i] = n;
+        }
+    }
+}
+
+static void __json_index_elements(__json_object_t *j)
+{
+    int i = 0;
+    __json_object_t *n;
+
+    j->index = (__json_object_t **)malloc(j->count * sizeof(__json_object_t *));
+    j->icap = j->count;
+    for (n = j->next; n; n = n->next) {
+        j->index[i++] = n;
+    }
+}
+
 static void __json_print_indent(int indent)
 {
     if (indent > 0) {
@@ -729,6 +798,8 @@ __json_object_t *__json_append_pair(__json_object_t *j1, __json_object_t *j2)
     } else {
         j1->prop = j1->lobj = j2;
     }
+    __json_drop_index(j1);
+    ++j1->count;
     return j1;
 }
 
@@ -760,6 +831,8 @@ __json_object_t *__json_append_value(__json_object_t *j1, __json_object_t *j2)
     } else {
         j1->next = j1->lary = j2;
     }
+    __json_drop_index(j1);
+    ++j1->count;
     return j1;
 }
 
@@ -1050,6 +1123,12 @@ __json_object_t *__json_parse_file(const char *filename)
     return NULL;
 }
 
+int __json_yyerror(const char *msg)
+{
+    /* The position is reported by __json_error_message(). */
+    return 0;
+}
+
 const char *__json_error_message(void)
 {
     static char buf[256] = {0};
@@ -1074,6 +1153,19 @@ __json_object_t *__json_get_property(__json_object_t *j, const char *key)
 {
     if (j && j->type == JSON_OBJECT) {
         json_object_t *n = j->prop;
+        if (j->count >= JSON_INDEX_MIN) {
+            if (!j->index) {
+                __json_index_properties(j);
+            }
+            unsigned int h = __json_hash(key);
+            unsigned int mask = j->icap - 1;
+            for (unsigned int i = h & mask; (n = j->index[i]) != NULL; i = (i + 1) & mask) {
+                if (n->hash == h && strcmp(n->key.cstr, key) == 0) {
+                    return n;
+                }
+            }
+            return NULL;
+        }
         while (n) {
             if (strcmp(n->key.cstr, key) == 0) {
                 return n;
@@ -1086,42 +1178,36 @@ __json_object_t *__json_get_property(__json_object_t *j, const char *key)
 
 int __json_get_property_count(__json_object_t *j)
 {
-    int count = 0;
     if (j && j->type == JSON_OBJECT) {
-        json_object_t *n = j->prop;
-        while (n) {
-            ++count;
-            n = n->prop;
-        }
+        return j->count;
     }
-    return count;
+    return 0;
 }
 
 __json_object_t *__json_get_element(__json_object_t *j, int index)
 {
-    if (j && j->type == JSON_ARRAY) {
-        json_object_t *n = j->next;
-        for (int i = 0; n; ++i) {
-            if (i == index) {
-                return n;
+    if (j && j->type == JSON_ARRAY && 0 <= index && index < j->count) {
+        if (j->count >= JSON_INDEX_MIN) {
+            if (!j->index) {
+                __json_index_elements(j);
             }
+            return j->index[index];
+        }
+        json_object_t *n = j->next;
+        for (int i = 0; i < index; ++i) {
             n = n->next;
         }
+        return n;
     }
     return NULL;
 }
 
 int __json_get_element_count(__json_object_t *j)
 {
-    int count = 0;
     if (j && j->type == JSON_ARRAY) {
-        json_object_t *n = j->next;
-        while (n) {
-            ++count;
-            n = n->next;
-        }
+        return j->count;
     }
-    return count;
+    return 0;
 }
 
 int __json_get_boolean(__json_object_t *j)
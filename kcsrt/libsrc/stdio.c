@@ -6,293 +6,569 @@
 #include <stdarg.h>
 #undef KCC_NO_IMPORT
 
+#include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-FILE* _kcc_iobuf[3] = {0};
+/* Streams of the extension library, used by the buffered FILE below. */
 
-void *get_std_filep(int type)
+#if defined(__KCC_FFI__)
+
+typedef int (*kcc_fileio_i_t)(void *);
+typedef int (*kcc_fileio_ip_t)(void *, int64_t *);
+typedef size_t (*kcc_fileio_rw_t)(void *, size_t, size_t, void *);
+
+static void *__kcc_fio_get_iobuf(int type)
+{
+    static void *f = NULL;
+    return (void *)kcc_extcall(void *(*)(int), kcc_extfunc(f, "fileio_get_iobuf_typed"), "i", type);
+}
+
+static void *__kcc_fio_fopen(const char *filename, const char *mode)
+{
+    static void *f = NULL;
+    typedef void *(*fopen_t)(const char *, const char *);
+    return (void *)kcc_extcall(fopen_t, kcc_extfunc(f, "fileio_fopen_typed"), "pp", filename, mode);
+}
+
+static int __kcc_fio_fclose(void *h)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_i_t, kcc_extfunc(f, "fileio_fclose_typed"), "p", h);
+}
+
+static int __kcc_fio_fgetpos(void *h, int64_t *pos)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_ip_t, kcc_extfunc(f, "fileio_fgetpos_typed"), "pp", h, pos);
+}
+
+static int __kcc_fio_fsetpos(void *h, int64_t *pos)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_ip_t, kcc_extfunc(f, "fileio_fsetpos_typed"), "pp", h, pos);
+}
+
+static int __kcc_fio_fflush(void *h)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_i_t, kcc_extfunc(f, "fileio_fflush_typed"), "p", h);
+}
+
+static int __kcc_fio_feof(void *h)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_i_t, kcc_extfunc(f, "fileio_feof_typed"), "p", h);
+}
+
+static int __kcc_fio_fgetc(void *h)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_i_t, kcc_extfunc(f, "fileio_fgetc_typed"), "p", h);
+}
+
+static char *__kcc_fio_fgets(char *s, int n, void *h)
+{
+    static void *f = NULL;
+    typedef char *(*fgets_t)(char *, int, void *);
+    return (char *)kcc_extcall(fgets_t, kcc_extfunc(f, "fileio_fgets_typed"), "pip", s, n, h);
+}
+
+static size_t __kcc_fio_fread(void *ptr, size_t size, size_t nmemb, void *h)
+{
+    static void *f = NULL;
+    return (size_t)kcc_extcall(kcc_fileio_rw_t, kcc_extfunc(f, "fileio_fread_typed"), "piip", ptr, size, nmemb, h);
+}
+
+static size_t __kcc_fio_fwrite(const void *ptr, size_t size, size_t nmemb, void *h)
+{
+    static void *f = NULL;
+    return (size_t)kcc_extcall(kcc_fileio_rw_t, kcc_extfunc(f, "fileio_fwrite_typed"), "piip", (void *)ptr, size, nmemb, h);
+}
+
+static int __kcc_fio_fseek(void *h, long offset, int whence)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
+    typedef int (*fseek_t)(void *, long, int);
+    return (int)kcc_extcall(fseek_t, kcc_extfunc(f, "fileio_fseek_typed"), "pii", h, offset, whence);
+}
+
+static int64_t __kcc_fio_ftell(void *h)
+{
+    static void *f = NULL;
+    typedef int64_t (*ftell_t)(void *);
+    return (int64_t)kcc_extcall(ftell_t, kcc_extfunc(f, "fileio_ftell_typed"), "p", h);
+}
+
+static void __kcc_fio_rewind(void *h)
+{
+    static void *f = NULL;
+    typedef void (*rewind_t)(void *);
+    kcc_extcall(rewind_t, kcc_extfunc(f, "fileio_rewind_typed"), "p", h);
+}
+
+static int __kcc_fio_ungetc(int c, void *h)
+{
+    static void *f = NULL;
+    typedef int (*ungetc_t)(int, void *);
+    return (int)kcc_extcall(ungetc_t, kcc_extfunc(f, "fileio_ungetc_typed"), "ip", c, h);
+}
+
+static int __kcc_fio_isatty(void *h)
+{
+    static void *f = NULL;
+    return (int)kcc_extcall(kcc_fileio_i_t, kcc_extfunc(f, "fileio_isatty_typed"), "p", h);
+}
+
+#else
+
+static void *__kcc_fio_get_iobuf(int type)
+{
+    static void *f = NULL;
     __kcc_builtin_reset_args();
     __kcc_builtin_add_arg_i(type);
-    return __kcc_builtin_call_p(h, "fileio_get_iobuf");
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "fileio_get_iobuf"));
 }
 
-int puts(const char *ss)
+static void *__kcc_fio_fopen(const char *filename, const char *mode)
 {
-    char *base = __kcc_builtin_acpdup(ss);
-    char *s = base;
-    while (*s) {
-        if (putchar(*s++) == EOF) {
-            goto ERROR;
-        }
-    }
-    if (putchar('\n') == EOF) {
-        goto ERROR;
-    }
-    __kcc_builtin_acpfree(base);
-    return s - base + 1;
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_s(filename);
+    __kcc_builtin_add_arg_s(mode);
+    return __kcc_builtin_invoke_p(kcc_extfunc(f, "fileio_fopen"));
+}
+
+static int __kcc_fio_fclose(void *h)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fclose"));
+}
 
-ERROR:
-    __kcc_builtin_acpfree(base);
-    return EOF;
+static int __kcc_fio_fgetpos(void *h, int64_t *pos)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(h);
+    __kcc_builtin_add_arg_p(pos);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fgetpos"));
 }
 
-static int ext_printf_ld(FILE *stream, const char *fmt, long v)
+static int __kcc_fio_fsetpos(void *h, int64_t *pos)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_s(fmt);
-    __kcc_builtin_add_arg_i(v);
-    return __kcc_builtin_call_i(h, "fileio_printf_ld");
+    __kcc_builtin_add_arg_p(h);
+    __kcc_builtin_add_arg_p(pos);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fsetpos"));
 }
 
-static int ext_printf_d(FILE *stream, const char *fmt, int v)
+static int __kcc_fio_fflush(void *h)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_s(fmt);
-    __kcc_builtin_add_arg_i(v);
-    return __kcc_builtin_call_i(h, "fileio_printf_d");
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fflush"));
 }
 
-static int ext_printf_lf(FILE *stream, const char *fmt, long double v)
+static int __kcc_fio_feof(void *h)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_s(fmt);
-    __kcc_builtin_add_arg_d(v);
-    return __kcc_builtin_call_i(h, "fileio_printf_lf");
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_feof"));
 }
 
-static int ext_printf_f(FILE *stream, const char *fmt, double v)
+static int __kcc_fio_fgetc(void *h)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_s(fmt);
-    __kcc_builtin_add_arg_d(v);
-    return __kcc_builtin_call_i(h, "fileio_printf_f");
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fgetc"));
 }
 
-static int ext_printf_p(FILE *stream, const char *fmt, void *v)
+static char *__kcc_fio_fgets(char *s, int n, void *h)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_s(fmt);
-    __kcc_builtin_add_arg_p(v);
-    return __kcc_builtin_call_i(h, "fileio_printf_p");
+    __kcc_builtin_add_arg_s(s);
+    __kcc_builtin_add_arg_i(n);
+    __kcc_builtin_add_arg_p(h);
+    return (char *)__kcc_builtin_invoke_p(kcc_extfunc(f, "fileio_fgets"));
 }
 
-static int ext_printf_s(FILE *stream, const char *fmt, char *v)
+static size_t __kcc_fio_fread(void *ptr, size_t size, size_t nmemb, void *h)
 {
-    void *h = kcc_extlib();
+    static void *f = NULL;
     __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_s(fmt);
-    __kcc_builtin_add_arg_s(v);
-    return __kcc_builtin_call_i(h, "fileio_printf_s");
-}
-
-#define __KCC_PRINTF_BUFFER_SIZE (128)
-
-int vfprintf(FILE *fp, const char *f, va_list ap)
-{
-    int conv = (!fp || fp == stdout || fp == stderr) ? 1 : 0;
-    const char *base = conv ? (const char *)__kcc_builtin_acpdup(f) : f;
-    const char *fmt = base;
-    int oc = 0;
-    char b[__KCC_PRINTF_BUFFER_SIZE] = {0};
-    while (1) {
-        LOOPTOP:
-        if (!*fmt) break;
-        if (*fmt != '%') {
-            if (fp) {
-                fputc(*fmt++, fp);
-            } else {
-                __kcc_builtin_putc(*fmt++);
-            }
-            ++oc;
-            continue;
+    __kcc_builtin_add_arg_p(ptr);
+    __kcc_builtin_add_arg_i(size);
+    __kcc_builtin_add_arg_i(nmemb);
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fread"));
+}
+
+static size_t __kcc_fio_fwrite(const void *ptr, size_t size, size_t nmemb, void *h)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(ptr);
+    __kcc_builtin_add_arg_i(size);
+    __kcc_builtin_add_arg_i(nmemb);
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fwrite"));
+}
+
+static int __kcc_fio_fseek(void *h, long offset, int whence)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(h);
+    __kcc_builtin_add_arg_i(offset);
+    __kcc_builtin_add_arg_i(whence);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_fseek"));
+}
+
+static int64_t __kcc_fio_ftell(void *h)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_ftell"));
+}
+
+static void __kcc_fio_rewind(void *h)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(h);
+    __kcc_builtin_invoke(kcc_extfunc(f, "fileio_rewind"));
+}
+
+static int __kcc_fio_ungetc(int c, void *h)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_i(c);
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_ungetc"));
+}
+
+static int __kcc_fio_isatty(void *h)
+{
+    static void *f = NULL;
+    __kcc_builtin_reset_args();
+    __kcc_builtin_add_arg_p(h);
+    return __kcc_builtin_invoke_i(kcc_extfunc(f, "fileio_isatty"));
+}
+
+#endif
+
+/*
+ * Output is collected in the buffer of each FILE, and handed to the
+ * extension library by one write when the buffer is full, or earlier
+ * depending on the buffering mode. Open streams are kept in a list to
+ * be flushed on exit.
+ */
+
+#define _KCC_FILE_CONV      (0x01)  /* convert UTF-8 to the ANSI code page */
+#define _KCC_FILE_USERBUF   (0x02)  /* buffer is owned by the caller */
+
+#define _KCC_FILE_HANDLE(fp)    ((fp) ? (fp)->handle : NULL)
+
+FILE* _kcc_iobuf[3] = {0};
+static FILE *__kcc_open_files = NULL;
+
+/* Length of buffer without a UTF-8 sequence cut off at the end. */
+static int __kcc_utf8_complete(const char *buf, int len)
+{
+    int i, n;
+    for (i = len - 1; i >= 0 && len - i <= 4; --i) {
+        unsigned char c = buf[i];
+        if ((c & 0xc0) != 0x80) {
+            n = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+            return (len - i < n) ? i : len;
         }
+    }
+    return len;
+}
 
-        ++fmt;
-        if (*fmt == '%') {
-            if (fp) {
-                fputc('%', fp);
-            } else {
-                __kcc_builtin_putc('%');
+/*
+ * Write buffered output to the stream of the extension library. When
+ * partial is set, keep a trailing incomplete UTF-8 sequence for later
+ * so that code page conversion sees whole characters.
+ */
+static int __kcc_file_flush(FILE *fp, int partial)
+{
+    int n = fp->len, w;
+    char *out;
+
+    if (n == 0) {
+        return 0;
+    }
+    if (fp->flags & _KCC_FILE_CONV) {
+        if (partial) {
+            n = __kcc_utf8_complete(fp->buf, fp->len);
+            if (n == 0) {
+                n = fp->len;
             }
-            ++oc;
-            ++fmt;
-            continue;
         }
+        char save = fp->buf[n];
+        fp->buf[n] = '\0';
+        out = __kcc_builtin_acpdup(fp->buf);
+        fp->buf[n] = save;
+        if (out == fp->buf) {
+            w = (__kcc_fio_fwrite(out, 1, n, fp->handle) == n);
+        } else {
+            int m = strlen(out);
+            w = (__kcc_fio_fwrite(out, 1, m, fp->handle) == m);
+            __kcc_builtin_acpfree(out);
+        }
+    } else {
+        w = (__kcc_fio_fwrite(fp->buf, 1, n, fp->handle) == n);
+    }
+    if (n < fp->len) {
+        memmove(fp->buf, fp->buf + n, fp->len - n);
+    }
+    fp->len -= n;
+    return w ? 0 : EOF;
+}
+
+/* Make room in the buffer, allocating it on first use. */
+static int __kcc_file_full(FILE *fp)
+{
+    if (!fp->buf) {
+        fp->buf = (char *)malloc(BUFSIZ + 1);
+        if (!fp->buf) {
+            return EOF;
+        }
+        fp->size = BUFSIZ;
+        return 0;
+    }
+    return __kcc_file_flush(fp, 1);
+}
 
-        b[0] = '%';
-        for (int i = 1; i < __KCC_PRINTF_BUFFER_SIZE; ++i) {
-            char prev = b[i-1];
-            b[i] = *fmt;
-            switch (*fmt++) {
-            case 'c': case 'x': case 'X': case 'u': case 'o': case 'd': case 'i': {
-                b[i+1] = 0;
-                if (prev == 'l') oc += (fp ? ext_printf_ld(fp, b, va_arg(ap, long)) : __kcc_builtin_printf_ld(b, va_arg(ap, long)));
-                else             oc += (fp ? ext_printf_d(fp, b, va_arg(ap, int)) : __kcc_builtin_printf_d(b, va_arg(ap, int)));
-                goto LOOPTOP;
-            }
-            case 'A': case 'a': case 'E': case 'e': case 'G': case 'g': case 'F': case 'f': {
-                b[i+1] = 0;
-                if (prev == 'l') oc += (fp ? ext_printf_lf(fp, b, va_arg(ap, long double)) : __kcc_builtin_printf_lf(b, va_arg(ap, long double)));
-                else             oc += (fp ? ext_printf_f(fp, b, va_arg(ap, double)) : __kcc_builtin_printf_f(b, va_arg(ap, double)));
-                goto LOOPTOP;
-            }
-            case 'p': {
-                b[i+1] = 0;
-                oc += (fp ? ext_printf_p(fp, b, va_arg(ap, void*)) : __kcc_builtin_printf_p(b, va_arg(ap, void*)));
-                goto LOOPTOP;
-            }
-            case 's': {
-                b[i+1] = 0;
-                oc += (fp ? ext_printf_s(fp, b, va_arg(ap, char*)) : __kcc_builtin_printf_s(b, va_arg(ap, char*)));
-                goto LOOPTOP;
-            }
-            case '*': {
-                i += sprintf(b+i, "%d", va_arg(ap, int)) - 1;
-                break;
-            }
-            default:
-                break;
+/* Whether a line buffered stream must be flushed after writing p. */
+static int __kcc_file_newline(FILE *fp, const char *p, int n)
+{
+    int k;
+
+    if (fp->mode == _IOLBF) {
+        for (k = 0; k < n; ++k) {
+            if (p[k] == '\n') {
+                return 1;
             }
         }
     }
-    if (conv) {
-        __kcc_builtin_acpfree(base);
-    }
-    return oc;
+    return 0;
 }
 
-int fprintf(FILE* stream, const char *f, ...)
+/* Append n bytes, and return whether they contain a newline. */
+static int __kcc_file_write(FILE *fp, const char *p, int n)
 {
-    va_list ap;
-    va_start(ap, f);
-    int oc = vfprintf(stream, f, ap);
-    va_end(ap);
-    return oc;
+    int k, nl = __kcc_file_newline(fp, p, n);
+
+    while (n > 0) {
+        if (fp->len == fp->size && __kcc_file_full(fp)) {
+            return EOF;
+        }
+        k = fp->size - fp->len;
+        if (k > n) {
+            k = n;
+        }
+        memcpy(fp->buf + fp->len, p, k);
+        fp->len += k;
+        p += k;
+        n -= k;
+    }
+    return nl;
 }
 
-int vprintf(const char *f, va_list ap)
+/* Flush after a write as required by the buffering mode. */
+static int __kcc_file_done(FILE *fp, int nl)
 {
-    return vfprintf(0, f, ap);
+    if (fp->mode == _IONBF || (nl && fp->mode == _IOLBF)) {
+        return __kcc_file_flush(fp, 0);
+    }
+    return 0;
 }
 
-int printf(const char *f, ...)
+/*
+ * Flush pending output before reading or positioning the stream. Input
+ * from stdin also flushes stdout, so a prompt shows before waiting.
+ */
+static void __kcc_file_sync(FILE *fp)
 {
-    va_list ap;
-    va_start(ap, f);
-    int oc = vprintf(f, ap);
-    va_end(ap);
-    return oc;
+    if (fp->len) {
+        __kcc_file_flush(fp, 0);
+    }
+    if (fp == _kcc_iobuf[0] && _kcc_iobuf[1] && _kcc_iobuf[1]->len) {
+        __kcc_file_flush(_kcc_iobuf[1], 0);
+        __kcc_fio_fflush(_kcc_iobuf[1]->handle);
+    }
 }
 
-static int __kcc_copy_buf(char* b, int start, const char* s, size_t limit)
+static void __kcc_flush_all(void)
 {
-    int c = 0;
-    b += start;
-    if (limit == 0) {
-        while (*s) {
-            *b++ = *s++;
-            ++c;
+    FILE *fp;
+    for (fp = __kcc_open_files; fp; fp = fp->next) {
+        if (fp->len) {
+            __kcc_file_flush(fp, 0);
         }
     }
-    else {
-        for (int i = start; i < limit && *s; ++i) {
-            *b++ = *s++;
-            ++c;
-        }
+}
+
+static FILE *__kcc_file_new(void *handle, int mode, int flags)
+{
+    FILE *fp;
+    if (!handle) {
+        return NULL;
+    }
+    fp = (FILE *)calloc(1, sizeof(FILE));
+    if (!fp) {
+        return NULL;
     }
-    return c;
+    fp->handle = handle;
+    fp->mode = mode;
+    fp->flags = flags;
+    fp->next = __kcc_open_files;
+    __kcc_open_files = fp;
+    __kcc_stdio_cleanup = __kcc_flush_all;
+    return fp;
 }
 
-int vsnprintf(char* buf, int size, const char* f, va_list ap)
+static void __kcc_file_free(FILE *fp)
 {
-    const char *base = f;
-    const char *fmt = base;
-    int oc = 0;
-    char s[__KCC_PRINTF_BUFFER_SIZE] = {0};
-    char b[__KCC_PRINTF_BUFFER_SIZE] = {0};
-    while (1) {
-        LOOPTOP:
-        if (!*fmt) break;
-        if (size > 0 && (size-1) <= oc) {
-            *(buf+oc) = '\0';
-            return oc;
+    FILE **pp;
+    for (pp = &__kcc_open_files; *pp; pp = &(*pp)->next) {
+        if (*pp == fp) {
+            *pp = fp->next;
+            break;
         }
-        if (*fmt != '%') {
-            *(buf+oc) = (*fmt++);
-            ++oc;
-            continue;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (_kcc_iobuf[i] == fp) {
+            _kcc_iobuf[i] = NULL;
         }
+    }
+    if (!(fp->flags & _KCC_FILE_USERBUF)) {
+        free(fp->buf);
+    }
+    free(fp);
+}
 
-        ++fmt;
-        if (*fmt == '%') {
-            *(buf+oc) = '%';
-            ++oc;
-            ++fmt;
-            continue;
+void *get_std_filep(int type)
+{
+    void *h = __kcc_fio_get_iobuf(type);
+    int mode = type == 2 ? _IONBF : type == 1 && __kcc_fio_isatty(h) ? _IOLBF : _IOFBF;
+    return __kcc_file_new(h, mode, type ? _KCC_FILE_CONV : 0);
+}
+
+int __kcc_putchar(int c)
+{
+    return fputc(c, stdout);
+}
+
+int puts(const char *s)
+{
+    FILE *fp = stdout;
+    int n = strlen(s);
+    if (!fp || __kcc_file_write(fp, s, n) < 0 || fputc('\n', fp) == EOF) {
+        return EOF;
+    }
+    return n + 1;
+}
+
+#define _KCC_FILE_PUTC(fp, c) \
+    ((fp)->len < (fp)->size || !__kcc_file_full(fp) ? ((fp)->buf[(fp)->len++] = (c), 0) : EOF)
+
+/*
+ * The whole format is handled by the host in one call, writing into the
+ * free space of the stream buffer. The builtin leaves the argument list
+ * as is, so when the output does not fit, the buffer is flushed and the
+ * call repeated. Output larger than the buffer goes through a temporary.
+ */
+int vfprintf(FILE *fp, const char *fmt, va_list ap)
+{
+    int n, nl;
+    char *tmp;
+
+    if (!fp) {
+        fp = stdout;
+        if (!fp) {
+            return EOF;
         }
+    }
+    if (!fp->buf && __kcc_file_full(fp)) {
+        return EOF;
+    }
 
-        b[0] = '%';
-        for (int i = 1; i < __KCC_PRINTF_BUFFER_SIZE; ++i) {
-            char prev = b[i-1];
-            b[i] = *fmt;
-            switch (*fmt++) {
-            case 'c': case 'x': case 'X': case 'u': case 'o': case 'd': case 'i': {
-                b[i+1] = 0;
-                if (prev == 'l') __kcc_builtin_sprintf_ld(b, va_arg(ap, long), s);
-                else             __kcc_builtin_sprintf_d(b, va_arg(ap, int), s);
-                oc += __kcc_copy_buf(buf, oc, s, size);
-                goto LOOPTOP;
-            }
-            case 'A': case 'a': case 'E': case 'e': case 'G': case 'g': case 'F': case 'f': {
-                b[i+1] = 0;
-                if (prev == 'l') __kcc_builtin_sprintf_lf(b, va_arg(ap, long double), s);
-                else             __kcc_builtin_sprintf_f(b, va_arg(ap, double), s);
-                oc += __kcc_copy_buf(buf, oc, s, size);
-                goto LOOPTOP;
-            }
-            case 'p': {
-                b[i+1] = 0;
-                __kcc_builtin_sprintf_p(b, va_arg(ap, void*), s);
-                oc += __kcc_copy_buf(buf, oc, s, size);
-                goto LOOPTOP;
-            }
-            case 's': {
-                b[i+1] = 0;
-                __kcc_builtin_sprintf_s(b, va_arg(ap, char*), s);
-                oc += __kcc_copy_buf(buf, oc, s, size);
-                goto LOOPTOP;
-            }
-            case '*': {
-                i += sprintf(b+i, "%d", va_arg(ap, int)) - 1;
-                break;
+    n = __kcc_builtin_vformat(fp->buf + fp->len, fp->size - fp->len + 1, fmt, ap);
+    if (n < 0) {
+        return EOF;
+    }
+    if (n > fp->size - fp->len) {
+        if (__kcc_file_flush(fp, 1)) {
+            return EOF;
+        }
+        if (n > fp->size - fp->len) {
+            tmp = (char *)malloc(n + 1);
+            if (!tmp) {
+                return EOF;
             }
-            default:
-                break;
+            __kcc_builtin_vformat(tmp, n + 1, fmt, ap);
+            nl = __kcc_file_write(fp, tmp, n);
+            free(tmp);
+            if (nl < 0 || __kcc_file_done(fp, nl)) {
+                return EOF;
             }
+            return n;
         }
+        __kcc_builtin_vformat(fp->buf + fp->len, n + 1, fmt, ap);
+    }
+
+    nl = __kcc_file_newline(fp, fp->buf + fp->len, n);
+    fp->len += n;
+    if (__kcc_file_done(fp, nl)) {
+        return EOF;
     }
-    *(buf+oc) = '\0';
+    return n;
+}
+
+int fprintf(FILE* stream, const char *f, ...)
+{
+    va_list ap;
+    va_start(ap, f);
+    int oc = vfprintf(stream, f, ap);
+    va_end(ap);
     return oc;
 }
 
+int vprintf(const char *f, va_list ap)
+{
+    return vfprintf(stdout, f, ap);
+}
+
+int printf(const char *f, ...)
+{
+    va_list ap;
+    va_start(ap, f);
+    int oc = vprintf(f, ap);
+    va_end(ap);
+    return oc;
+}
+
+int vsnprintf(char* buf, int size, const char* fmt, va_list ap)
+{
+    return __kcc_builtin_vformat(buf, size > 0 ? size : 0, fmt, ap);
+}
+
 int vsprintf(char* buf, const char* fmt, va_list ap)
 {
-    return vsnprintf(buf, 0, fmt, ap);
+    return __kcc_builtin_vformat(buf, INT_MAX, fmt, ap);
 }
 
 int snprintf(char* buf, int size, const char* fmt, ...)
@@ -431,6 +707,8 @@ int sprintf(char* buf, const char* fmt, ...)
 #define KCC_SSCANF_MODE_FOUND       0x01
 #define KCC_SSCANF_MODE_NOT         0x02
 
+#define __KCC_SCANF_BUFFER_SIZE (128)
+
 int scanf_core(FILE *stream, const char *src, const char *fmt, va_list ap)
 {
     if (!stream && !src) {
@@ -440,7 +718,7 @@ int scanf_core(FILE *stream, const char *src, const char *fmt, va_list ap)
     int ungetch = 0, ungetchd = 0;
     int conv = 0, chsetmode = 0, assign, width, type;
     const char *fp, *sp = src;
-    char buf[__KCC_PRINTF_BUFFER_SIZE] = {'\0'};
+    char buf[__KCC_SCANF_BUFFER_SIZE] = {'\0'};
     char chset[256] = {0};
 
     for (const char *fp = fmt; *fp != '\0'; fp++) {
@@ -650,146 +928,171 @@ int scanf(const char *fmt, ...)
 
 FILE *fopen(const char *filename, const char *mode)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_s(filename);
-    __kcc_builtin_add_arg_s(mode);
-    return (FILE *)__kcc_builtin_call_p(h, "fileio_fopen");
+    return __kcc_file_new(__kcc_fio_fopen(filename, mode), _IOFBF, 0);
 }
 
 int fclose(FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fclose");
+    int r;
+    if (!stream) {
+        return EOF;
+    }
+    r = __kcc_file_flush(stream, 0);
+    if (__kcc_fio_fclose(stream->handle)) {
+        r = EOF;
+    }
+    __kcc_file_free(stream);
+    return r;
+}
+
+int setvbuf(FILE *stream, char *buf, int mode, size_t size)
+{
+    if (!stream || mode < _IOFBF || mode > _IONBF) {
+        return EOF;
+    }
+    __kcc_file_flush(stream, 0);
+    if (buf && size > 1) {
+        if (!(stream->flags & _KCC_FILE_USERBUF)) {
+            free(stream->buf);
+        }
+        stream->buf = buf;
+        stream->size = size - 1;
+        stream->flags |= _KCC_FILE_USERBUF;
+    }
+    stream->mode = mode;
+    return 0;
+}
+
+void setbuf(FILE *stream, char *buf)
+{
+    setvbuf(stream, buf, buf ? _IOFBF : _IONBF, BUFSIZ);
 }
 
 int fgetpos(FILE *stream, int64_t *pos)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_p(pos);
-    return __kcc_builtin_call_i(h, "fileio_fgetpos");
+    if (stream) __kcc_file_sync(stream);
+    return __kcc_fio_fgetpos(_KCC_FILE_HANDLE(stream), pos);
 }
 
 int fsetpos(FILE *stream, int64_t *pos)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_p(pos);
-    return __kcc_builtin_call_i(h, "fileio_fsetpos");
+    if (stream) __kcc_file_sync(stream);
+    return __kcc_fio_fsetpos(_KCC_FILE_HANDLE(stream), pos);
 }
 
 int fflush(FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fflush");
+    FILE *fp;
+    int r = 0;
+    if (!stream) {
+        for (fp = __kcc_open_files; fp; fp = fp->next) {
+            if (fflush(fp)) {
+                r = EOF;
+            }
+        }
+        return r;
+    }
+    if (__kcc_file_flush(stream, 0)) {
+        r = EOF;
+    }
+    if (__kcc_fio_fflush(stream->handle)) {
+        r = EOF;
+    }
+    return r;
 }
 
 int feof(FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_feof");
+    return __kcc_fio_feof(_KCC_FILE_HANDLE(stream));
 }
 
 int fgetc(FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fgetc");
+    if (stream && (stream->len || (stream == _kcc_iobuf[0] && _kcc_iobuf[1] && _kcc_iobuf[1]->len))) {
+        __kcc_file_sync(stream);
+    }
+    return __kcc_fio_fgetc(_KCC_FILE_HANDLE(stream));
 }
 
 char *fgets(char *s, int n, FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_s(s);
-    __kcc_builtin_add_arg_i(n);
-    __kcc_builtin_add_arg_p(stream);
-    return (char *)__kcc_builtin_call_p(h, "fileio_fgets");
+    if (stream) __kcc_file_sync(stream);
+    return __kcc_fio_fgets(s, n, _KCC_FILE_HANDLE(stream));
 }
 
 int fputc(int c, FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_i(c);
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fputc");
+    if (!stream) {
+        return 0;
+    }
+    if (_KCC_FILE_PUTC(stream, c) || __kcc_file_done(stream, c == '\n')) {
+        return EOF;
+    }
+    return (unsigned char)c;
 }
 
 int fputs(const char *s, FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_s(s);
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fputs");
+    int nl;
+    if (!stream) {
+        return 0;
+    }
+    if ((nl = __kcc_file_write(stream, s, strlen(s))) < 0 || __kcc_file_done(stream, nl)) {
+        return EOF;
+    }
+    return 1;
 }
 
 size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(ptr);
-    __kcc_builtin_add_arg_i(size);
-    __kcc_builtin_add_arg_i(nmemb);
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fread");
+    if (stream) __kcc_file_sync(stream);
+    return __kcc_fio_fread(ptr, size, nmemb, _KCC_FILE_HANDLE(stream));
 }
 
+/*
+ * Large blocks are written through after flushing what is buffered, so
+ * they are not copied.
+ */
 size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(ptr);
-    __kcc_builtin_add_arg_i(size);
-    __kcc_builtin_add_arg_i(nmemb);
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_fwrite");
+    int nl;
+    size_t n = size * nmemb;
+    if (!stream || n == 0) {
+        return 0;
+    }
+    if (n >= BUFSIZ && !(stream->flags & _KCC_FILE_CONV)) {
+        if (__kcc_file_flush(stream, 0)) {
+            return 0;
+        }
+        return __kcc_fio_fwrite(ptr, size, nmemb, stream->handle);
+    }
+    if ((nl = __kcc_file_write(stream, ptr, n)) < 0 || __kcc_file_done(stream, nl)) {
+        return 0;
+    }
+    return nmemb;
 }
 
 int fseek(FILE *stream, long offset, int whence)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_add_arg_i(offset);
-    __kcc_builtin_add_arg_i(whence);
-    return __kcc_builtin_call_i(h, "fileio_fseek");
+    if (stream) __kcc_file_sync(stream);
+    return __kcc_fio_fseek(_KCC_FILE_HANDLE(stream), offset, whence);
 }
 
 int64_t ftell(FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_ftell");
+    if (stream) __kcc_file_sync(stream);
+    return __kcc_fio_ftell(_KCC_FILE_HANDLE(stream));
 }
 
 void rewind(FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_p(stream);
-    __kcc_builtin_call(h, "fileio_rewind");
+    if (stream) __kcc_file_sync(stream);
+    __kcc_fio_rewind(_KCC_FILE_HANDLE(stream));
 }
 
 int ungetc(int c, FILE *stream)
 {
-    void *h = kcc_extlib();
-    __kcc_builtin_reset_args();
-    __kcc_builtin_add_arg_i(c);
-    __kcc_builtin_add_arg_p(stream);
-    return __kcc_builtin_call_i(h, "fileio_ungetc");
+    return __kcc_fio_ungetc(c, _KCC_FILE_HANDLE(stream));
 }
 
 #endif
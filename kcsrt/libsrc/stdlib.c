@@ -18,42 +18,195 @@ int rand(void)
     return (unsigned)(__kcc_rand_seed / 65536L) % (RAND_MAX+1);
 }
 
-#define SWAP(x, y, size)            \
-    do {                            \
-        size_t s = (size);          \
-        char *a = (x), *b = (y);    \
-        do {                        \
-            char t = *a;            \
-            *a++ = *b;              \
-            *b++ = t;               \
-        } while (--s > 0);          \
-    } while (0)                     \
+/* Partitions at most this long are finished by insertion sort. */
+#define __KCC_QSORT_INSERTION_MAX   (16)
+
+/* Partitions at least this long take the pivot from a ninther. */
+#define __KCC_QSORT_NINTHER_MIN     (128)
+
+typedef int (*__kcc_qsort_comp_t)(const void *, const void *);
+
+/*
+ * Element size, width of the chunks to swap elements in, and comparator.
+ * Helpers copy comp to a local first, since the VM cannot call through a
+ * member directly.
+ */
+struct __kcc_qsort_ctx {
+    size_t size;
+    int width;
+    __kcc_qsort_comp_t comp;
+};
+
+/* Swap two elements in the widest chunks that size and alignment allow. */
+static void __kcc_qsort_swap(char *a, char *b, const struct __kcc_qsort_ctx *q)
+{
+    size_t n = q->size;
+
+    if (q->width == 8) {
+        long long t, *x = (long long *)a, *y = (long long *)b;
+        for ( ; n >= 16; n -= 16) {
+            t = x[0]; x[0] = y[0]; y[0] = t;
+            t = x[1]; x[1] = y[1]; y[1] = t;
+            x += 2;
+            y += 2;
+        }
+        if (n) {
+            t = *x; *x = *y; *y = t;
+        }
+    } else if (q->width == 4) {
+        int t, *x = (int *)a, *y = (int *)b;
+        do {
+            t = *x; *x++ = *y; *y++ = t;
+        } while ((n -= 4) > 0);
+    } else {
+        char t;
+        do {
+            t = *a; *a++ = *b; *b++ = t;
+        } while (--n > 0);
+    }
+}
+
+/* Swap ints in place, the most common case, and others by calling. */
+#define __KCC_QSORT_SWAP(a, b, q)                                   \
+    do {                                                            \
+        if ((q)->size == 4 && (q)->width == 4) {                    \
+            int *x = (int *)(a), *y = (int *)(b), t = *x;           \
+            *x = *y;                                                \
+            *y = t;                                                 \
+        } else {                                                    \
+            __kcc_qsort_swap((a), (b), (q));                        \
+        }                                                           \
+    } while (0)                                                     \
     /**/
 
-#define KCCQ(a, i)    ((char *)a + (i) * size)
+static void __kcc_qsort_insertion(char *base, size_t n, const struct __kcc_qsort_ctx *q)
+{
+    __kcc_qsort_comp_t comp = q->comp;
+    size_t size = q->size;
+    char *p, *r, *end = base + n * size;
+
+    for (p = base + size; p < end; p += size) {
+        for (r = p; r > base && comp(r - size, r) > 0; r -= size) {
+            __KCC_QSORT_SWAP(r - size, r, q);
+        }
+    }
+}
+
+static void __kcc_qsort_sift(char *base, size_t i, size_t n, const struct __kcc_qsort_ctx *q)
+{
+    __kcc_qsort_comp_t comp = q->comp;
+    size_t c, size = q->size;
+
+    while ((c = 2 * i + 1) < n) {
+        if (c + 1 < n && comp(base + c * size, base + (c + 1) * size) < 0) {
+            c++;
+        }
+        if (comp(base + i * size, base + c * size) >= 0)
+            break;
+        __KCC_QSORT_SWAP(base + i * size, base + c * size, q);
+        i = c;
+    }
+}
+
+static void __kcc_qsort_heap(char *base, size_t n, const struct __kcc_qsort_ctx *q)
+{
+    size_t i;
 
-void __quicksort(int first, int last, void *base, size_t size, int (*comp)(const void *, const void *))
+    for (i = n / 2; i > 0; --i) {
+        __kcc_qsort_sift(base, i - 1, n, q);
+    }
+    for (i = n - 1; i > 0; --i) {
+        __KCC_QSORT_SWAP(base, base + i * q->size, q);
+        __kcc_qsort_sift(base, 0, i, q);
+    }
+}
+
+static char *__kcc_qsort_median(char *a, char *b, char *c, const struct __kcc_qsort_ctx *q)
 {
-    int i, j;
-    void *x = KCCQ(base, (first + last) / 2);
-    i = first;  j = last;
-    for ( ; ; ) {
-        while (comp(x, KCCQ(base, i)) > 0) i++;
-        while (comp(KCCQ(base, j), x) > 0) j--;
-        if (i >= j) break;
-        SWAP(KCCQ(base,i), KCCQ(base,j), size);
-        i++;
-        j--;
+    __kcc_qsort_comp_t comp = q->comp;
+
+    if (comp(a, b) < 0) {
+        return comp(b, c) < 0 ? b : (comp(a, c) < 0 ? c : a);
     }
-    if (first  < i - 1) __quicksort(first , i - 1, base, size, comp);
-    if (j + 1 < last) __quicksort(j + 1, last, base, size, comp);
+    return comp(a, c) < 0 ? a : (comp(b, c) < 0 ? c : b);
 }
 
-#undef KCCQ
+/*
+ * Quicksort with a median of three or ninther pivot, switching to heap
+ * sort when the recursion gets deeper than the given limit. The smaller
+ * side is sorted recursively and the larger one by looping.
+ */
+static void __kcc_introsort(char *base, size_t n, int depth, const struct __kcc_qsort_ctx *q)
+{
+    __kcc_qsort_comp_t comp = q->comp;
+    size_t j, s, size = q->size;
+    char *m, *last, *p, *r, *end;
+
+    while (n > __KCC_QSORT_INSERTION_MAX) {
+        if (depth-- == 0) {
+            __kcc_qsort_heap(base, n, q);
+            return;
+        }
+
+        m = base + (n / 2) * size;
+        last = base + (n - 1) * size;
+        if (n >= __KCC_QSORT_NINTHER_MIN) {
+            s = (n / 8) * size;
+            m = __kcc_qsort_median(
+                __kcc_qsort_median(base, base + s, base + 2 * s, q),
+                __kcc_qsort_median(m - s, m, m + s, q),
+                __kcc_qsort_median(last - 2 * s, last - s, last, q), q);
+        } else {
+            m = __kcc_qsort_median(base, m, last, q);
+        }
+
+        /* Keep the pivot at base while partitioning the rest. */
+        if (m != base) {
+            __KCC_QSORT_SWAP(base, m, q);
+        }
+        p = base;
+        r = end = base + n * size;
+        for ( ; ; ) {
+            do p += size; while (p < end && comp(p, base) < 0);
+            do r -= size; while (comp(base, r) < 0);
+            if (p >= r) break;
+            __KCC_QSORT_SWAP(p, r, q);
+        }
+        if (r != base) {
+            __KCC_QSORT_SWAP(base, r, q);
+        }
+
+        j = (r - base) / size;
+        if (j < n - j - 1) {
+            __kcc_introsort(base, j, depth, q);
+            base = r + size;
+            n -= j + 1;
+        } else {
+            __kcc_introsort(r + size, n - j - 1, depth, q);
+            n = j;
+        }
+    }
+
+    __kcc_qsort_insertion(base, n, q);
+}
 
 void qsort(void *base, size_t n, size_t size, int (*comp)(const void *, const void *))
 {
-    __quicksort(0, n - 1, base, size, comp);
+    int depth = 0;
+    size_t k;
+    struct __kcc_qsort_ctx q;
+
+    if (n < 2 || size == 0)
+        return;
+
+    q.size = size;
+    k = size | (unsigned long long)base;
+    q.width = (k & 7) == 0 ? 8 : (k & 3) == 0 ? 4 : 1;
+    q.comp = comp;
+    for (k = n; k > 1; k >>= 1) {
+        depth += 2;
+    }
+    __kcc_introsort(base, n, depth, &q);
 }
 
 #endif
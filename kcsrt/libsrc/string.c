@@ -6,121 +6,82 @@
 #include <string.h>
 #undef KCC_NO_IMPORT
 
-/* strcpy/strncpy is already difined as a built-in. */
+/*
+ * strlen/strcpy/strncpy and mem* copies are only built-ins. The others
+ * are also defined as functions, with the name in parentheses so that
+ * the macro is not expanded, and forward to the built-in.
+ */
 
-char* strcat(char* s1, const char* s2)
+char *(strcat)(char *s1, const char *s2)
 {
-    char* ss;
-    for (ss = s1; *ss != '\0'; ++ss) {
-        ;
-    }
-    for ( ; (*ss = *s2) != '\0'; ++ss, ++s2) {
-        ;
-    }
-    return s1;
+    return __kcc_builtin_strcat(s1, s2);
 }
 
-char* strncat(char* s1, const char* s2, size_t n)
+char *(strncat)(char *s1, const char *s2, size_t n)
 {
-    char* ss;
-    char* end;
-    for (ss = s1; *ss != '\0'; ss++) {
-        ;
-    }
-    for (end = ss + n; (ss != end) && ((*ss = *s2) != '\0'); ++ss, ++s2) {
-        ;
-    }
-    if (ss == end) {
-        *ss = '\0';
-    }
-    return s1;
+    return __kcc_builtin_strncat(s1, s2, n);
 }
 
-char* strdup(const char* s)
+char *strdup(const char *s)
 {
     char *p = malloc(strlen(s) * sizeof(char) + 1);
     strcpy(p, s);
     return p;
 }
 
-int strcmp(const char* s1, const char* s2)
+int (strcmp)(const char *s1, const char *s2)
 {
-    const unsigned char* ss1 = (const unsigned char*)s1;
-    const unsigned char* ss2 = (const unsigned char*)s2;
-    for ( ; *ss1 == *ss2 && *ss1 != '\0'; ++ss1, ++ss2) {
-        ;
-    }
-    return *ss1 - *ss2;
+    return __kcc_builtin_strcmp(s1, s2);
 }
 
-int strncmp(const char* s1, const char* s2, size_t n)
+int (strncmp)(const char *s1, const char *s2, size_t n)
 {
-    const unsigned char* ss1 = (const unsigned char*)s1;
-    const unsigned char* ss2 = (const unsigned char*)s2;
-    const unsigned char* t = ss1 + n;
-    int r = 0;
-    for ( ; ss1 != t && *ss1 != '\0' && ((r = *ss1 - *ss2) == 0); ++ss1, ++ss2) {
-        ;
-    }
-    return r;
+    return __kcc_builtin_strncmp(s1, s2, n);
 }
 
-char* strchr(const char* s, int c)
+char *(strchr)(const char *s, int c)
 {
-    c = (char)c;
-    do {
-        if (*s == c)
-            return (char*)s;
-    }
-    while (*s++ != '\0');
-    return NULL;
+    return __kcc_builtin_strchr(s, c);
 }
 
-size_t strcspn(const char *s1, const char *s2)
+char *(strrchr)(const char *s, int c)
 {
-    const char *p = s1;
-    for ( ; *s1; ++s1) {
-        for (const char *t = s2; *t; t++) {
-            if (*t == *s1) {
-                return s1 - p;
-            }
-        }
-    }
-    return s1 - p;
+    return __kcc_builtin_strrchr(s, c);
 }
 
-char* index(const char* s, int c)
+char *(strstr)(const char *s1, const char *s2)
 {
-    return strchr(s, c);
+    return __kcc_builtin_strstr(s1, s2);
 }
 
-char* strrchr(const char* s, int c)
+size_t (strspn)(const char *s1, const char *s2)
 {
-    char* result = NULL;
-    c = (char)c;
-    do {
-        if (*s == c)
-            result = (char*)s;
-    }
-    while (*s++ != '\0');
-    return result;
+    return __kcc_builtin_strspn(s1, s2);
+}
+
+size_t (strcspn)(const char *s1, const char *s2)
+{
+    return __kcc_builtin_strcspn(s1, s2);
+}
+
+char *index(const char *s, int c)
+{
+    return strchr(s, c);
 }
 
-char* rindex(const char* s, int c)
+char *rindex(const char *s, int c)
 {
     return strrchr(s, c);
 }
 
-int memcmp(const void *s1, const void *s2, size_t n)
+int (memcmp)(const void *s1, const void *s2, size_t n)
 {
-    const unsigned char* ss1 = (const unsigned char*)s1;
-    const unsigned char* ss2 = (const unsigned char*)s2;
-    const unsigned char* t = ss2 + n;
-    int result = 0;
-    for ( ; ss2 != t && (result = *ss1 - *ss2) == 0; ++ss1, ++ss2) {
-        ;
-    }
-    return result;
+    return __kcc_builtin_memcmp(s1, s2, n);
+}
+
+void *(memchr)(const void *s, int c, size_t n)
+{
+    return __kcc_builtin_memchr(s, c, n);
 }
 
 #if !defined(__KCC_JIT__)
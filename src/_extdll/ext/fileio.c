@@ -195,6 +195,16 @@ DLLEXPORT int fileio_ungetc(int argc, arg_type_t* argv)
     return klib_ungetc(c, fp);
 }
 
+DLLEXPORT int fileio_isatty(int argc, arg_type_t* argv)
+{
+    if (argc != 1 || argv[0].type !=  C_PTR) {
+        return 0;
+    }
+    fileio *fp = (fileio *)argv[0].value.p;
+    if (!fp) return 0;
+    return klib_isatty(fp);
+}
+
 DLLEXPORT int fileio_printf_ld(int argc, arg_type_t* argv)
 {
     if (argc != 3 || argv[0].type !=  C_PTR || argv[1].type !=  C_STR || argv[2].type !=  C_INT) {
@@ -266,3 +276,119 @@ DLLEXPORT int fileio_printf_s(int argc, arg_type_t* argv)
     char *v = (char *)argv[2].value.s;
     return klib_fprintf(fp, fmt, v);
 }
+
+/* ---------------------------------------------------------------------------------------------
+    FILE I/O - typed entry points, called directly with their C prototype
+--------------------------------------------------------------------------------------------- */
+
+DLLEXPORT void* fileio_get_iobuf_typed(int type)
+{
+    switch (type) {
+    case 0:
+        return fio_stdin;
+    case 1:
+        return fio_stdout;
+    case 2:
+        return fio_stderr;
+    }
+    return 0;
+}
+
+DLLEXPORT void* fileio_fopen_typed(const char *filename, const char *mode)
+{
+    return klib_fopen(filename, mode);
+}
+
+DLLEXPORT int fileio_fclose_typed(fileio *fp)
+{
+    if (!fp) return EOF;
+    return klib_fclose(fp);
+}
+
+DLLEXPORT int fileio_fgetpos_typed(fileio *fp, klib_fpos_t *pos)
+{
+    return klib_fgetpos(fp, pos);
+}
+
+DLLEXPORT int fileio_fsetpos_typed(fileio *fp, klib_fpos_t *pos)
+{
+    return klib_fsetpos(fp, pos);
+}
+
+DLLEXPORT int fileio_fflush_typed(fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fflush(fp);
+}
+
+DLLEXPORT int fileio_feof_typed(fileio *fp)
+{
+    if (!fp) return 1;
+    return klib_feof(fp);
+}
+
+DLLEXPORT int fileio_fgetc_typed(fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fgetc(fp);
+}
+
+DLLEXPORT char *fileio_fgets_typed(char *s, int n, fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fgets(s, n, fp);
+}
+
+DLLEXPORT int fileio_fputc_typed(int c, fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fputc(c, fp);
+}
+
+DLLEXPORT int fileio_fputs_typed(const char *s, fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fputs(s, fp);
+}
+
+DLLEXPORT size_t fileio_fread_typed(void *ptr, size_t size, size_t nmemb, fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fread(ptr, size, nmemb, fp);
+}
+
+DLLEXPORT size_t fileio_fwrite_typed(const void *ptr, size_t size, size_t nmemb, fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_fwrite(ptr, size, nmemb, fp);
+}
+
+DLLEXPORT int fileio_fseek_typed(fileio *fp, long offset, int whence)
+{
+    if (!fp) return 0;
+    return klib_fseek(fp, offset, whence);
+}
+
+DLLEXPORT int64_t fileio_ftell_typed(fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_ftell(fp);
+}
+
+DLLEXPORT void fileio_rewind_typed(fileio *fp)
+{
+    if (!fp) return;
+    klib_rewind(fp);
+}
+
+DLLEXPORT int fileio_ungetc_typed(int c, fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_ungetc(c, fp);
+}
+
+DLLEXPORT int fileio_isatty_typed(fileio *fp)
+{
+    if (!fp) return 0;
+    return klib_isatty(fp);
+}
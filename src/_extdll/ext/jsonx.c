@@ -0,0 +1,1053 @@
+#include <kcs/dll.h>
+#include <kcs/dllcore.h>
+#include "../lib/fileio.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------------------------------------------------------------------------------------
+    JSON - native streaming reader and arena DOM
+--------------------------------------------------------------------------------------------- */
+
+#define JSONX_CHUNK_SIZE    (64 * 1024)
+#define JSONX_BLOCK_SIZE    (64 * 1024)
+#define JSONX_TOKEN_SIZE    (256)
+#define JSONX_MAX_DEPTH     (1024)
+
+/* Same order as jsonx_type_t in kcsrt/include/kcs/jsonx.h. */
+enum {
+    JSONX_END,
+    JSONX_NULL,
+    JSONX_FALSE,
+    JSONX_TRUE,
+    JSONX_INTEGER,
+    JSONX_REAL,
+    JSONX_STRING,
+    JSONX_KEY,
+    JSONX_OBJECT,
+    JSONX_ARRAY,
+    JSONX_OBJECT_END,
+    JSONX_ARRAY_END,
+    JSONX_ERROR
+};
+
+/* What the reader accepts next. */
+enum {
+    EXPECT_TOP,
+    EXPECT_VALUE,
+    EXPECT_KEY,
+    EXPECT_KEY_OR_CLOSE,
+    EXPECT_VALUE_OR_CLOSE,
+    EXPECT_COMMA_OR_CLOSE
+};
+
+static int jsonx_hex4(const char *s)
+{
+    int i, c, v = 0;
+    for (i = 0; i < 4; ++i) {
+        c = (unsigned char)s[i];
+        if ('0' <= c && c <= '9') {
+            v = v * 16 + c - '0';
+        } else if ('a' <= c && c <= 'f') {
+            v = v * 16 + c - 'a' + 10;
+        } else if ('A' <= c && c <= 'F') {
+            v = v * 16 + c - 'A' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return v;
+}
+
+static int jsonx_utf8(char *w, unsigned int cp)
+{
+    if (cp < 0x80) {
+        w[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        w[0] = (char)(0xC0 | (cp >> 6));
+        w[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        w[0] = (char)(0xE0 | (cp >> 12));
+        w[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        w[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    w[0] = (char)(0xF0 | (cp >> 18));
+    w[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    w[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    w[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/*
+ * Decode the escape of s, which points after the backslash, into w.
+ * Return the number of bytes written and set *next after the escape,
+ * or return -1 if the escape is invalid.
+ */
+static int jsonx_unescape(const char *s, const char **next, char *w)
+{
+    int cp, lo;
+
+    switch (*s) {
+    case '"':  *w = '"';  break;
+    case '\\': *w = '\\'; break;
+    case '/':  *w = '/';  break;
+    case 'b':  *w = '\b'; break;
+    case 'f':  *w = '\f'; break;
+    case 'n':  *w = '\n'; break;
+    case 'r':  *w = '\r'; break;
+    case 't':  *w = '\t'; break;
+    case 'u':
+        if ((cp = jsonx_hex4(s + 1)) < 0) {
+            return -1;
+        }
+        s += 5;
+        if (0xDC00 <= cp && cp <= 0xDFFF) {
+            return -1;
+        }
+        if (0xD800 <= cp && cp <= 0xDBFF) {
+            if (s[0] != '\\' || s[1] != 'u' || (lo = jsonx_hex4(s + 2)) < 0xDC00 || lo > 0xDFFF) {
+                return -1;
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            s += 6;
+        }
+        *next = s;
+        return jsonx_utf8(w, cp);
+    default:
+        return -1;
+    }
+    *next = s + 1;
+    return 1;
+}
+
+/*
+ * Scan a number at s and set *next after it. Integers which fit in
+ * int64_t are stored to *i, and the other numbers to *d.
+ */
+static int jsonx_number(const char *s, const char **next, int64_t *i, double *d)
+{
+    const char *p = s;
+    uint64_t u = 0;
+    int neg = 0, real = 0, overflow = 0;
+
+    if (*p == '-') {
+        neg = 1;
+        ++p;
+    }
+    if (*p == '0') {
+        ++p;
+    } else if ('1' <= *p && *p <= '9') {
+        while ('0' <= *p && *p <= '9') {
+            if (u > (UINT64_MAX - (*p - '0')) / 10) {
+                overflow = 1;
+            }
+            u = u * 10 + (*p++ - '0');
+        }
+    } else {
+        return JSONX_ERROR;
+    }
+    if (*p == '.') {
+        ++p;
+        if (*p < '0' || '9' < *p) {
+            return JSONX_ERROR;
+        }
+        while ('0' <= *p && *p <= '9') {
+            ++p;
+        }
+        real = 1;
+    }
+    if (*p == 'e' || *p == 'E') {
+        ++p;
+        if (*p == '+' || *p == '-') {
+            ++p;
+        }
+        if (*p < '0' || '9' < *p) {
+            return JSONX_ERROR;
+        }
+        while ('0' <= *p && *p <= '9') {
+            ++p;
+        }
+        real = 1;
+    }
+
+    *next = p;
+    if (!real && !overflow && u <= (uint64_t)INT64_MAX + neg) {
+        *i = neg ? -(int64_t)(u - 1) - 1 : (int64_t)u;
+        return JSONX_INTEGER;
+    }
+    *d = strtod(s, NULL);
+    return JSONX_REAL;
+}
+
+/* ---------------------------------------------------------------------------------------------
+    Streaming reader
+
+    Events are read from a fixed size chunk of the file, so the memory
+    used does not depend on the size of the input, but only on the
+    longest string and the nesting depth.
+--------------------------------------------------------------------------------------------- */
+
+typedef struct jsonx_reader_ {
+    /* Public members, the same as jsonx_reader_t of a script. */
+    int         type;       /* type of the current event */
+    int         depth;      /* nesting depth after the event */
+    const char  *str;       /* key, string or error message */
+    int64_t     len;        /* length of str */
+    int64_t     i;          /* integer value */
+    double      d;          /* real value */
+    int64_t     line;       /* current line */
+
+    fileio      *fp;        /* NULL when reading from a string */
+    char        *chunk;
+    const char  *p;
+    const char  *end;
+    char        *tok;       /* decoded string or number */
+    size_t      toklen;
+    size_t      tokcap;
+    int         expect;
+    char        stack[JSONX_MAX_DEPTH];     /* '{' or '[' for each open container */
+    char        err[128];
+} jsonx_reader_t;
+
+static int reader_fill(jsonx_reader_t *r)
+{
+    size_t n;
+
+    if (!r->fp || (n = klib_fread(r->chunk, 1, JSONX_CHUNK_SIZE, r->fp)) == 0) {
+        return 0;
+    }
+    r->p = r->chunk;
+    r->end = r->chunk + n;
+    return 1;
+}
+
+static int reader_peek(jsonx_reader_t *r)
+{
+    if (r->p == r->end && !reader_fill(r)) {
+        return -1;
+    }
+    return (unsigned char)*r->p;
+}
+
+static int reader_skip_space(jsonx_reader_t *r)
+{
+    int c;
+
+    for (;;) {
+        while (r->p < r->end) {
+            c = (unsigned char)*r->p;
+            if (c == '\n') {
+                ++r->line;
+            } else if (c != ' ' && c != '\t' && c != '\r') {
+                return c;
+            }
+            ++r->p;
+        }
+        if (!reader_fill(r)) {
+            return -1;
+        }
+    }
+}
+
+static void reader_token_add(jsonx_reader_t *r, const char *s, size_t n)
+{
+    size_t cap = r->tokcap;
+
+    if (r->toklen + n + 1 > cap) {
+        while (r->toklen + n + 1 > cap) {
+            cap *= 2;
+        }
+        r->tok = (char *)realloc(r->tok, cap);
+        r->tokcap = cap;
+    }
+    memcpy(r->tok + r->toklen, s, n);
+    r->toklen += n;
+    r->tok[r->toklen] = '\0';
+}
+
+static int reader_event(jsonx_reader_t *r, int type)
+{
+    r->type = type;
+    return type;
+}
+
+static int reader_error(jsonx_reader_t *r, const char *msg)
+{
+    KLIB_SNPRINTF(r->err, sizeof(r->err), "%s at line %lld.", msg, (long long)r->line);
+    r->str = r->err;
+    r->len = strlen(r->err);
+    return reader_event(r, JSONX_ERROR);
+}
+
+static int reader_after_value(jsonx_reader_t *r, int type)
+{
+    r->expect = r->depth ? EXPECT_COMMA_OR_CLOSE : EXPECT_TOP;
+    return reader_event(r, type);
+}
+
+static int reader_open(jsonx_reader_t *r, char kind)
+{
+    if (r->depth == JSONX_MAX_DEPTH) {
+        return reader_error(r, "Too deeply nested");
+    }
+    r->stack[r->depth++] = kind;
+    r->expect = kind == '{' ? EXPECT_KEY_OR_CLOSE : EXPECT_VALUE_OR_CLOSE;
+    return reader_event(r, kind == '{' ? JSONX_OBJECT : JSONX_ARRAY);
+}
+
+static int reader_close(jsonx_reader_t *r, int type)
+{
+    --r->depth;
+    return reader_after_value(r, type);
+}
+
+/* Read a string after its opening quote into the token buffer. */
+static int reader_string(jsonx_reader_t *r)
+{
+    const char *s, *next;
+    char esc[12], buf[4];
+    int c, i, n;
+
+    r->toklen = 0;
+    reader_token_add(r, "", 0);
+    for (;;) {
+        s = r->p;
+        while (r->p < r->end && *r->p != '"' && *r->p != '\\' && (unsigned char)*r->p >= 0x20) {
+            ++r->p;
+        }
+        reader_token_add(r, s, r->p - s);
+        if ((c = reader_peek(r)) == '"') {
+            ++r->p;
+            break;
+        }
+        if (c == '\\') {
+            /* Collect the escape, which may cross the end of the chunk. */
+            ++r->p;
+            n = reader_peek(r) == 'u' ? 5 : 1;
+            for (i = 0; i < n && (c = reader_peek(r)) >= 0; ++i) {
+                esc[i] = (char)c;
+                ++r->p;
+                if (i == 4 && (esc[1] == 'd' || esc[1] == 'D') && esc[2] >= '8' && reader_peek(r) == '\\') {
+                    n = 11;     /* a surrogate pair */
+                }
+            }
+            esc[i] = '\0';
+            if ((n = jsonx_unescape(esc, &next, buf)) < 0 || next != esc + i) {
+                return reader_error(r, "Invalid escape in string");
+            }
+            reader_token_add(r, buf, n);
+        } else if (c < 0) {
+            return reader_error(r, "Unterminated string");
+        } else if (c < 0x20) {
+            return reader_error(r, "Control character in string");
+        }
+    }
+    r->str = r->tok;
+    r->len = r->toklen;
+    return JSONX_STRING;
+}
+
+static int reader_number(jsonx_reader_t *r)
+{
+    const char *s, *next;
+    int type;
+
+    r->toklen = 0;
+    do {
+        s = r->p;
+        while (r->p < r->end && (('0' <= *r->p && *r->p <= '9') || *r->p == '-' || *r->p == '+' || *r->p == '.' || *r->p == 'e' || *r->p == 'E')) {
+            ++r->p;
+        }
+        reader_token_add(r, s, r->p - s);
+    } while (r->p == r->end && reader_fill(r));
+
+    type = jsonx_number(r->tok, &next, &r->i, &r->d);
+    if (type == JSONX_ERROR || *next) {
+        return reader_error(r, "Invalid number");
+    }
+    return reader_after_value(r, type);
+}
+
+static int reader_literal(jsonx_reader_t *r, const char *word, int type)
+{
+    for ( ; *word; ++word) {
+        if (reader_peek(r) != (unsigned char)*word) {
+            return reader_error(r, "Invalid literal");
+        }
+        ++r->p;
+    }
+    return reader_after_value(r, type);
+}
+
+static int reader_value(jsonx_reader_t *r, int c)
+{
+    switch (c) {
+    case '{':
+    case '[':
+        ++r->p;
+        return reader_open(r, (char)c);
+    case '"':
+        ++r->p;
+        if (reader_string(r) == JSONX_ERROR) {
+            return JSONX_ERROR;
+        }
+        return reader_after_value(r, JSONX_STRING);
+    case 't':
+        return reader_literal(r, "true", JSONX_TRUE);
+    case 'f':
+        return reader_literal(r, "false", JSONX_FALSE);
+    case 'n':
+        return reader_literal(r, "null", JSONX_NULL);
+    case -1:
+        return reader_error(r, "Unexpected end of input");
+    }
+    if (c == '-' || ('0' <= c && c <= '9')) {
+        return reader_number(r);
+    }
+    return reader_error(r, "Unexpected character");
+}
+
+static jsonx_reader_t *reader_new(void)
+{
+    jsonx_reader_t *r = (jsonx_reader_t *)calloc(1, sizeof(jsonx_reader_t));
+    r->tokcap = JSONX_TOKEN_SIZE;
+    r->tok = (char *)malloc(r->tokcap);
+    r->str = r->tok;
+    r->line = 1;
+    r->expect = EXPECT_TOP;
+    return r;
+}
+
+DLLEXPORT void *jsonx_reader_open_typed(const char *filename)
+{
+    fileio *fp = klib_fopen(filename, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    jsonx_reader_t *r = reader_new();
+    r->fp = fp;
+    r->chunk = (char *)malloc(JSONX_CHUNK_SIZE);
+    r->p = r->end = r->chunk;
+    return r;
+}
+
+DLLEXPORT void *jsonx_reader_open_string_typed(const char *str)
+{
+    jsonx_reader_t *r = reader_new();
+    r->p = str;
+    r->end = str + strlen(str);
+    return r;
+}
+
+/*
+ * Read the next event. Values at the top level may follow one another,
+ * as in newline delimited JSON, and JSONX_END is returned after the last
+ * one. Errors are sticky.
+ */
+DLLEXPORT int jsonx_reader_next_typed(jsonx_reader_t *r)
+{
+    int c;
+
+    if (r->type == JSONX_ERROR) {
+        return JSONX_ERROR;
+    }
+
+    for (;;) {
+        c = reader_skip_space(r);
+        switch (r->expect) {
+        case EXPECT_TOP:
+            if (c < 0) {
+                return reader_event(r, JSONX_END);
+            }
+            return reader_value(r, c);
+        case EXPECT_VALUE:
+            return reader_value(r, c);
+        case EXPECT_VALUE_OR_CLOSE:
+            if (c == ']') {
+                ++r->p;
+                return reader_close(r, JSONX_ARRAY_END);
+            }
+            return reader_value(r, c);
+        case EXPECT_KEY_OR_CLOSE:
+            if (c == '}') {
+                ++r->p;
+                return reader_close(r, JSONX_OBJECT_END);
+            }
+            /* fall through */
+        case EXPECT_KEY:
+            if (c != '"') {
+                return reader_error(r, "Expected a key");
+            }
+            ++r->p;
+            if (reader_string(r) == JSONX_ERROR) {
+                return JSONX_ERROR;
+            }
+            if (reader_skip_space(r) != ':') {
+                return reader_error(r, "Expected ':'");
+            }
+            ++r->p;
+            r->expect = EXPECT_VALUE;
+            return reader_event(r, JSONX_KEY);
+        case EXPECT_COMMA_OR_CLOSE:
+            if (c == ',') {
+                ++r->p;
+                r->expect = r->stack[r->depth - 1] == '{' ? EXPECT_KEY : EXPECT_VALUE;
+                continue;
+            }
+            if (c == '}' && r->stack[r->depth - 1] == '{') {
+                ++r->p;
+                return reader_close(r, JSONX_OBJECT_END);
+            }
+            if (c == ']' && r->stack[r->depth - 1] == '[') {
+                ++r->p;
+                return reader_close(r, JSONX_ARRAY_END);
+            }
+            return reader_error(r, "Expected ',' or a closing bracket");
+        }
+    }
+}
+
+DLLEXPORT void jsonx_reader_close_typed(jsonx_reader_t *r)
+{
+    if (!r) {
+        return;
+    }
+    if (r->fp) {
+        klib_fclose(r->fp);
+    }
+    free(r->chunk);
+    free(r->tok);
+    free(r);
+}
+
+/* ---------------------------------------------------------------------------------------------
+    Arena DOM
+
+    The text is parsed in place. Strings are unescaped where they are and
+    terminated over their closing quote, so values point into the buffer
+    of the document until they are modified. All values live in blocks of
+    an arena which is reused by the next parse and freed at once.
+--------------------------------------------------------------------------------------------- */
+
+typedef struct jsonx_value_ {
+    /* Public members, the same as jsonx_value_t of a script. */
+    int         type;
+    int         len;        /* length of a string, or the number of members */
+    const char  *key;       /* key of an object member, otherwise NULL */
+    union {
+        int64_t             i;
+        double              d;
+        const char          *s;
+        struct jsonx_value_ *a;
+    } u;
+} jsonx_value_t;
+
+typedef struct jsonx_block_ {
+    struct jsonx_block_ *next;
+    size_t              size;
+    size_t              used;
+} jsonx_block_t;
+
+typedef struct jsonx_doc_ {
+    /* Public members, the same as jsonx_doc_t of a script. */
+    jsonx_value_t   *root;
+    const char      *error;     /* NULL unless the last parse failed */
+    int64_t         line;       /* line of the error, or the last line read */
+
+    char            *buf;       /* text being parsed */
+    size_t          bufcap;
+    char            *cur;
+    fileio          *fp;        /* file read by jsonx_next_line() */
+    char            *chunk;
+    char            *p;
+    char            *end;
+    int64_t         lines;
+    jsonx_block_t   *blocks;
+    jsonx_value_t   *stack;     /* members of the open containers */
+    size_t          stacklen;
+    size_t          stackcap;
+    int             depth;
+    char            err[128];
+} jsonx_doc_t;
+
+static void *dom_alloc(jsonx_doc_t *doc, size_t size)
+{
+    jsonx_block_t *b = doc->blocks;
+    void *p;
+
+    size = (size + 7) & ~(size_t)7;
+    if (!b || b->used + size > b->size) {
+        size_t bsize = size > JSONX_BLOCK_SIZE ? size : JSONX_BLOCK_SIZE;
+        b = (jsonx_block_t *)malloc(sizeof(jsonx_block_t) + bsize);
+        b->next = doc->blocks;
+        b->size = bsize;
+        b->used = 0;
+        doc->blocks = b;
+    }
+    p = (char *)(b + 1) + b->used;
+    b->used += size;
+    return p;
+}
+
+/* Release the arena but its newest block, which is kept for the next parse. */
+static void dom_reset(jsonx_doc_t *doc)
+{
+    jsonx_block_t *b = doc->blocks, *next;
+
+    if (b) {
+        for (next = b->next; next; ) {
+            jsonx_block_t *n = next->next;
+            free(next);
+            next = n;
+        }
+        b->next = NULL;
+        b->used = 0;
+    }
+    doc->root = NULL;
+    doc->error = NULL;
+    doc->stacklen = 0;
+    doc->depth = 0;
+}
+
+static void dom_reserve(jsonx_doc_t *doc, size_t size)
+{
+    size_t cap = doc->bufcap ? doc->bufcap : JSONX_CHUNK_SIZE;
+
+    if (size > doc->bufcap) {
+        while (cap < size) {
+            cap *= 2;
+        }
+        doc->buf = (char *)realloc(doc->buf, cap);
+        doc->bufcap = cap;
+    }
+}
+
+static int dom_error(jsonx_doc_t *doc, const char *msg)
+{
+    KLIB_SNPRINTF(doc->err, sizeof(doc->err), "%s at line %lld.", msg, (long long)doc->line);
+    doc->error = doc->err;
+    doc->root = NULL;
+    return 0;
+}
+
+static char *dom_skip_space(jsonx_doc_t *doc, char *p)
+{
+    for ( ; ; ++p) {
+        if (*p == '\n') {
+            ++doc->line;
+        } else if (*p != ' ' && *p != '\t' && *p != '\r') {
+            return p;
+        }
+    }
+}
+
+static void dom_push(jsonx_doc_t *doc, const jsonx_value_t *v)
+{
+    if (doc->stacklen == doc->stackcap) {
+        doc->stackcap = doc->stackcap ? doc->stackcap * 2 : 64;
+        doc->stack = (jsonx_value_t *)realloc(doc->stack, doc->stackcap * sizeof(jsonx_value_t));
+    }
+    doc->stack[doc->stacklen++] = *v;
+}
+
+/* Unescape a string in place from p, after its opening quote. */
+static int dom_string(jsonx_doc_t *doc, char *p, const char **str, int *len)
+{
+    char *s = p, *w;
+    const char *next;
+    int n;
+
+    while (*p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+        ++p;
+    }
+    w = p;
+    while (*p != '"') {
+        if (*p == '\\') {
+            if ((n = jsonx_unescape(p + 1, &next, w)) < 0) {
+                return dom_error(doc, "Invalid escape in string");
+            }
+            w += n;
+            p = (char *)next;
+        } else if ((unsigned char)*p < 0x20) {
+            return dom_error(doc, *p ? "Control character in string" : "Unterminated string");
+        } else {
+            *w++ = *p++;
+        }
+    }
+    *w = '\0';
+    *str = s;
+    *len = (int)(w - s);
+    doc->cur = p + 1;
+    return 1;
+}
+
+static int dom_value(jsonx_doc_t *doc, jsonx_value_t *v);
+
+static int dom_container(jsonx_doc_t *doc, jsonx_value_t *v, char *p, char close)
+{
+    size_t mark = doc->stacklen;
+    jsonx_value_t item;
+    int klen;
+
+    if (++doc->depth > JSONX_MAX_DEPTH) {
+        return dom_error(doc, "Too deeply nested");
+    }
+    p = dom_skip_space(doc, p);
+    if (*p == close) {
+        ++p;
+    } else {
+        for (;;) {
+            item.key = NULL;
+            if (close == '}') {
+                if (*p != '"') {
+                    return dom_error(doc, "Expected a key");
+                }
+                if (!dom_string(doc, p + 1, &item.key, &klen)) {
+                    return 0;
+                }
+                p = dom_skip_space(doc, doc->cur);
+                if (*p != ':') {
+                    return dom_error(doc, "Expected ':'");
+                }
+                ++p;
+            }
+            doc->cur = p;
+            if (!dom_value(doc, &item)) {
+                return 0;
+            }
+            dom_push(doc, &item);
+            p = dom_skip_space(doc, doc->cur);
+            if (*p == ',') {
+                p = dom_skip_space(doc, p + 1);
+                continue;
+            }
+            if (*p == close) {
+                ++p;
+                break;
+            }
+            return dom_error(doc, "Expected ',' or a closing bracket");
+        }
+    }
+
+    /* Move the members to the arena, so that they are contiguous. */
+    v->type = close == '}' ? JSONX_OBJECT : JSONX_ARRAY;
+    v->len = (int)(doc->stacklen - mark);
+    v->u.a = NULL;
+    if (v->len) {
+        v->u.a = (jsonx_value_t *)dom_alloc(doc, v->len * sizeof(jsonx_value_t));
+        memcpy(v->u.a, doc->stack + mark, v->len * sizeof(jsonx_value_t));
+    }
+    doc->stacklen = mark;
+    --doc->depth;
+    doc->cur = p;
+    return 1;
+}
+
+static int dom_literal(jsonx_doc_t *doc, jsonx_value_t *v, char *p, const char *word, int type)
+{
+    size_t n = strlen(word);
+
+    if (strncmp(p, word, n) != 0) {
+        return dom_error(doc, "Invalid literal");
+    }
+    v->type = type;
+    v->len = 0;
+    v->u.i = 0;
+    doc->cur = p + n;
+    return 1;
+}
+
+static int dom_value(jsonx_doc_t *doc, jsonx_value_t *v)
+{
+    char *p = dom_skip_space(doc, doc->cur);
+    const char *next;
+
+    switch (*p) {
+    case '{':
+        return dom_container(doc, v, p + 1, '}');
+    case '[':
+        return dom_container(doc, v, p + 1, ']');
+    case '"':
+        v->type = JSONX_STRING;
+        return dom_string(doc, p + 1, &v->u.s, &v->len);
+    case 't':
+        return dom_literal(doc, v, p, "true", JSONX_TRUE);
+    case 'f':
+        return dom_literal(doc, v, p, "false", JSONX_FALSE);
+    case 'n':
+        return dom_literal(doc, v, p, "null", JSONX_NULL);
+    case '\0':
+        return dom_error(doc, "Unexpected end of input");
+    }
+    if (*p == '-' || ('0' <= *p && *p <= '9')) {
+        v->type = jsonx_number(p, &next, &v->u.i, &v->u.d);
+        v->len = 0;
+        if (v->type == JSONX_ERROR) {
+            return dom_error(doc, "Invalid number");
+        }
+        doc->cur = (char *)next;
+        return 1;
+    }
+    return dom_error(doc, "Unexpected character");
+}
+
+/* Parse the nul terminated text, which the document may overwrite. */
+static int dom_parse(jsonx_doc_t *doc, char *text, int64_t line)
+{
+    jsonx_value_t *root;
+
+    dom_reset(doc);
+    doc->line = line;
+    doc->cur = text;
+    root = (jsonx_value_t *)dom_alloc(doc, sizeof(jsonx_value_t));
+    root->key = NULL;
+    if (!dom_value(doc, root)) {
+        return 0;
+    }
+    if (*dom_skip_space(doc, doc->cur)) {
+        return dom_error(doc, "Unexpected data after the value");
+    }
+    doc->root = root;
+    return 1;
+}
+
+DLLEXPORT void *jsonx_parse_typed(const char *text)
+{
+    jsonx_doc_t *doc = (jsonx_doc_t *)calloc(1, sizeof(jsonx_doc_t));
+    size_t len = strlen(text);
+
+    dom_reserve(doc, len + 1);
+    memcpy(doc->buf, text, len + 1);
+    dom_parse(doc, doc->buf, 1);
+    return doc;
+}
+
+DLLEXPORT void *jsonx_parse_file_typed(const char *filename)
+{
+    jsonx_doc_t *doc = (jsonx_doc_t *)calloc(1, sizeof(jsonx_doc_t));
+    fileio *fp = klib_fopen(filename, "rb");
+    size_t len = 0, n;
+
+    if (!fp) {
+        KLIB_SNPRINTF(doc->err, sizeof(doc->err), "File not found: %s.", filename);
+        doc->error = doc->err;
+        return doc;
+    }
+    do {
+        dom_reserve(doc, len + JSONX_CHUNK_SIZE + 1);
+        n = klib_fread(doc->buf + len, 1, doc->bufcap - len - 1, fp);
+        len += n;
+    } while (n);
+    klib_fclose(fp);
+    doc->buf[len] = '\0';
+    dom_parse(doc, doc->buf, 1);
+    return doc;
+}
+
+DLLEXPORT void *jsonx_open_lines_typed(const char *filename)
+{
+    fileio *fp = klib_fopen(filename, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    jsonx_doc_t *doc = (jsonx_doc_t *)calloc(1, sizeof(jsonx_doc_t));
+    doc->fp = fp;
+    doc->chunk = (char *)malloc(JSONX_CHUNK_SIZE + 1);
+    doc->p = doc->end = doc->chunk;
+    return doc;
+}
+
+static int doc_fill(jsonx_doc_t *doc)
+{
+    size_t n = klib_fread(doc->chunk, 1, JSONX_CHUNK_SIZE, doc->fp);
+    doc->p = doc->chunk;
+    doc->end = doc->chunk + n;
+    *doc->end = '\0';
+    return n > 0;
+}
+
+/*
+ * Parse the next line which is not blank. A line within the current
+ * chunk is parsed where it is, and only one which crosses the end of
+ * the chunk is gathered in the buffer of the document first. Return 1
+ * if a line was parsed, -1 if it had an error, and 0 at the end.
+ */
+DLLEXPORT int jsonx_next_line_typed(jsonx_doc_t *doc)
+{
+    char *line, *nl, *s;
+    size_t len;
+
+    dom_reset(doc);
+    if (!doc->fp) {
+        return 0;
+    }
+    for (;;) {
+        if (doc->p == doc->end && !doc_fill(doc)) {
+            return 0;
+        }
+        ++doc->lines;
+        if ((nl = (char *)memchr(doc->p, '\n', doc->end - doc->p)) != NULL) {
+            line = doc->p;
+            *nl = '\0';
+            doc->p = nl + 1;
+        } else {
+            len = 0;
+            do {
+                nl = (char *)memchr(doc->p, '\n', doc->end - doc->p);
+                s = nl ? nl : doc->end;
+                dom_reserve(doc, len + (s - doc->p) + 1);
+                memcpy(doc->buf + len, doc->p, s - doc->p);
+                len += s - doc->p;
+                doc->p = nl ? nl + 1 : doc->end;
+            } while (!nl && doc_fill(doc));
+            doc->buf[len] = '\0';
+            line = doc->buf;
+        }
+        if (*dom_skip_space(doc, line)) {
+            return dom_parse(doc, line, doc->lines) ? 1 : -1;
+        }
+    }
+}
+
+DLLEXPORT jsonx_value_t *jsonx_get_typed(jsonx_value_t *v, const char *key)
+{
+    int i;
+
+    if (v && v->type == JSONX_OBJECT) {
+        for (i = 0; i < v->len; ++i) {
+            if (strcmp(v->u.a[i].key, key) == 0) {
+                return &v->u.a[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+DLLEXPORT void jsonx_set_string_typed(jsonx_doc_t *doc, jsonx_value_t *v, const char *str)
+{
+    size_t len = strlen(str);
+    char *s = (char *)dom_alloc(doc, len + 1);
+
+    memcpy(s, str, len + 1);
+    v->type = JSONX_STRING;
+    v->len = (int)len;
+    v->u.s = s;
+}
+
+DLLEXPORT void jsonx_free_typed(jsonx_doc_t *doc)
+{
+    if (!doc) {
+        return;
+    }
+    dom_reset(doc);
+    free(doc->blocks);
+    if (doc->fp) {
+        klib_fclose(doc->fp);
+    }
+    free(doc->chunk);
+    free(doc->buf);
+    free(doc->stack);
+    free(doc);
+}
+
+/* ---------------------------------------------------------------------------------------------
+    JSON - entry points with the argument list
+--------------------------------------------------------------------------------------------- */
+
+DLLEXPORT void *jsonx_reader_open(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_STR) {
+        return NULL;
+    }
+    return jsonx_reader_open_typed(argv[0].value.s);
+}
+
+DLLEXPORT void *jsonx_reader_open_string(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_STR) {
+        return NULL;
+    }
+    return jsonx_reader_open_string_typed(argv[0].value.s);
+}
+
+DLLEXPORT int jsonx_reader_next(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_PTR || !argv[0].value.p) {
+        return JSONX_ERROR;
+    }
+    return jsonx_reader_next_typed((jsonx_reader_t *)argv[0].value.p);
+}
+
+DLLEXPORT int jsonx_reader_close(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_PTR) {
+        return 0;
+    }
+    jsonx_reader_close_typed((jsonx_reader_t *)argv[0].value.p);
+    return 0;
+}
+
+DLLEXPORT void *jsonx_parse(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_STR) {
+        return NULL;
+    }
+    return jsonx_parse_typed(argv[0].value.s);
+}
+
+DLLEXPORT void *jsonx_parse_file(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_STR) {
+        return NULL;
+    }
+    return jsonx_parse_file_typed(argv[0].value.s);
+}
+
+DLLEXPORT void *jsonx_open_lines(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_STR) {
+        return NULL;
+    }
+    return jsonx_open_lines_typed(argv[0].value.s);
+}
+
+DLLEXPORT int jsonx_next_line(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_PTR || !argv[0].value.p) {
+        return 0;
+    }
+    return jsonx_next_line_typed((jsonx_doc_t *)argv[0].value.p);
+}
+
+DLLEXPORT void *jsonx_get(int argc, arg_type_t *argv)
+{
+    if (argc != 2 || argv[0].type != C_PTR || argv[1].type != C_STR) {
+        return NULL;
+    }
+    return jsonx_get_typed((jsonx_value_t *)argv[0].value.p, argv[1].value.s);
+}
+
+DLLEXPORT int jsonx_set_string(int argc, arg_type_t *argv)
+{
+    if (argc != 3 || argv[0].type != C_PTR || argv[1].type != C_PTR || argv[2].type != C_STR) {
+        return 0;
+    }
+    jsonx_set_string_typed((jsonx_doc_t *)argv[0].value.p, (jsonx_value_t *)argv[1].value.p, argv[2].value.s);
+    return 1;
+}
+
+DLLEXPORT int jsonx_free(int argc, arg_type_t *argv)
+{
+    if (argc != 1 || argv[0].type != C_PTR) {
+        return 0;
+    }
+    jsonx_free_typed((jsonx_doc_t *)argv[0].value.p);
+    return 0;
+}
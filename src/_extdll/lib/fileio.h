@@ -9,6 +9,8 @@
 
 #if !defined(KLIB_CONFIG_FILEIO_WIN)
 
+#include <unistd.h>
+
 #ifdef _LARGEFILE_SOURCE
 typedef fpos64_t klib_fpos_t;
 #else
@@ -33,6 +35,7 @@ typedef FILE fileio;
 #define klib_ungetc         ungetc
 #define klib_vfprintf       vfprintf
 #define klib_vprintf        vprintf
+#define klib_isatty(fp)     isatty(fileno(fp))
 
 #ifdef _LARGEFILE_SOURCE
 #define klib_fgetpos        fgetpos64
@@ -94,6 +97,7 @@ extern void klib_rewind(fileio* stream);
 extern int klib_ungetc(int c, fileio* stream);
 extern int klib_vfprintf(fileio* stream, const char* format, va_list arg);
 extern int klib_vprintf(const char* format, va_list arg);
+extern int klib_isatty(fileio* stream);
 
 #define fio_stdin   fio_stdio(0)
 #define fio_stdout  fio_stdio(1)
@@ -24,6 +24,11 @@ fileio* fio_stdio(int type)
     return NULL;
 }
 
+int klib_isatty(fileio* stream)
+{
+    return GetFileType(stream->handle) == FILE_TYPE_CHAR;
+}
+
 int klib_flush_buffer(fileio* stream)
 {
     if (stream->len > 0) {
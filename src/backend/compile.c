@@ -4,6 +4,7 @@
 # define EXTERNAL extern
 #endif
 #include "compile.h"
+#include "profile.h"
 #include "graphviz/dot.h"
 #include "x86_64/abi.h"
 #include "x86_64/assemble.h"
@@ -12,6 +13,7 @@
 #include "x86_64/jit.h"
 #include "x86_64/instr.h"
 #include "vm/vm.h"
+#include "../util/report.h"
 #include <lacc/context.h>
 
 #include <kcs/assert.h>
@@ -181,6 +183,7 @@ static void emit(enum opcode opcode, enum instr_optype optype, ...)
     }
 
     va_end(args);
+    report_count(COUNT_INSTRUCTIONS, 1);
     emit_instruction(instr);
 }
 
@@ -1920,6 +1923,124 @@ static void compile__builtin_va_arg(struct var res, struct var args)
     }
 }
 
+/* Largest constant size of memcpy, memset and memcmp expanded inline. */
+#define INLINE_MEM_MAX 32
+
+/* Width of next piece to move, not using 16 bit operands. */
+static int inline_mem_width(size_t n)
+{
+    return n >= 8 ? 8 : n >= 4 ? 4 : 1;
+}
+
+/*
+ * Expand call to memcpy, memset or memcmp builtin with small constant
+ * size to straight-line moves. Comparison is done inline only to check
+ * for equality, blocks that differ are passed on to the builtin to get
+ * the ordering. Return 0 if the call is not expanded.
+ */
+static int compile_inline_mem(struct var target, struct var ptr)
+{
+    int w;
+    size_t i, n;
+    struct var size, val;
+    const struct symbol *differ, *done;
+    void *builtin;
+    enum { MEMCPY, MEMSET, MEMCMP } op;
+
+    if (ptr.kind != ADDRESS || array_len(&func_args) != 3)
+        return 0;
+
+    size = array_get(&func_args, 2);
+    if (size.kind != IMMEDIATE
+        || !is_integer(size.type)
+        || size.imm.u > INLINE_MEM_MAX)
+        return 0;
+
+    builtin = NULL;
+    if (!str_cmp(ptr.symbol->name, str_init("__kcc_builtin_memcpy"))) {
+        op = MEMCPY;
+    } else if (!str_cmp(ptr.symbol->name, str_init("__kcc_builtin_memset"))) {
+        op = MEMSET;
+    } else if (!str_cmp(ptr.symbol->name, str_init("__kcc_builtin_memcmp"))) {
+#if defined(KCC_WINDOWS)
+        /* Fallback call would need arguments moved for Microsoft ABI. */
+        return 0;
+#endif
+        op = MEMCMP;
+        builtin = jit_get_builtin_function(sym_name(ptr.symbol));
+        if (!builtin)
+            return 0;
+    } else {
+        return 0;
+    }
+
+    n = size.imm.u;
+    switch (op) {
+    case MEMCPY:
+        load(array_get(&func_args, 0), DI);
+        load(array_get(&func_args, 1), SI);
+        for (i = 0; i < n; i += w) {
+            w = inline_mem_width(n - i);
+            emit(INSTR_MOV, OPT_MEM_REG,
+                location(address(i, SI, 0, 0), w), reg(AX, w));
+            emit(INSTR_MOV, OPT_REG_MEM,
+                reg(AX, w), location(address(i, DI, 0, 0), w));
+        }
+        emit(INSTR_MOV, OPT_REG_REG, reg(DI, 8), reg(AX, 8));
+        break;
+    case MEMSET:
+        val = array_get(&func_args, 1);
+        if (val.kind == IMMEDIATE) {
+            emit(INSTR_MOV, OPT_IMM_REG,
+                constant((val.imm.u & 0xFF) * 0x0101010101010101ull, 8),
+                reg(AX, 8));
+        } else {
+            /* Repeat low byte in all of %rax. */
+            load(val, AX);
+            emit(INSTR_MOVZX, OPT_REG_REG, reg(AX, 1), reg(AX, 4));
+            emit(INSTR_MOV, OPT_IMM_REG,
+                constant(0x0101010101010101ull, 8), reg(CX, 8));
+            emit(INSTR_MUL, OPT_REG, reg(CX, 8));
+        }
+        load(array_get(&func_args, 0), DI);
+        for (i = 0; i < n; i += w) {
+            w = inline_mem_width(n - i);
+            emit(INSTR_MOV, OPT_REG_MEM,
+                reg(AX, w), location(address(i, DI, 0, 0), w));
+        }
+        emit(INSTR_MOV, OPT_REG_REG, reg(DI, 8), reg(AX, 8));
+        break;
+    case MEMCMP:
+        load(array_get(&func_args, 0), DI);
+        load(array_get(&func_args, 1), SI);
+        differ = create_label(definition);
+        done = create_label(definition);
+        for (i = 0; i < n; i += w) {
+            w = inline_mem_width(n - i);
+            emit(INSTR_MOV, OPT_MEM_REG,
+                location(address(i, DI, 0, 0), w), reg(AX, w));
+            emit(INSTR_CMP, OPT_MEM_REG,
+                location(address(i, SI, 0, 0), w), reg(AX, w));
+            emit(INSTR_JNE, OPT_IMM, addr(differ));
+        }
+        emit(INSTR_XOR, OPT_REG_REG, reg(AX, 4), reg(AX, 4));
+        emit(INSTR_JMP, OPT_IMM, addr(done));
+        enter_context(differ);
+        emit(INSTR_MOV, OPT_IMM_REG, constant(n, 8), reg(DX, 8));
+        emit(INSTR_MOV, OPT_IMM_REG, constant((uint64_t)builtin, 8), reg(R11, 8));
+        emit(INSTR_CALL, OPT_REG, reg(R11, 8));
+        enter_context(done);
+        break;
+    }
+
+    array_empty(&func_args);
+    if (!is_void(target.type)) {
+        store(AX, target);
+    }
+
+    return 1;
+}
+
 /*
  * Emit function call, optionally with assignment of the result back to
  * a variable. Return register containing the result, if applicable.
@@ -1934,6 +2055,9 @@ static enum reg compile_call(struct var target, struct var ptr)
     assert(is_pointer(ptr.type));
     assert(is_function(type_next(ptr.type)));
 
+    if (compile_inline_mem(target, ptr))
+        return AX;
+
     func = type_next(ptr.type);
     ret = type_next(func);
     pc = classify(ret);
@@ -2971,6 +3095,885 @@ static void compile_return(Type func, struct expression expr)
     assert(x87_stack == 0);
 }
 
+/*
+ * Loop vectorization.
+ *
+ * Counted loops on the form
+ *
+ *     for (i = ...; i < n; ++i)
+ *         a[i] = b[i] + c[i];
+ *
+ * where all elements are int, long, float or double of the same type,
+ * are prefixed with a packed loop processing whole vectors of elements.
+ * The original scalar loop follows, completing remaining iterations.
+ * Supported loop bodies are element-wise arithmetic, copies and fills
+ * of loop invariant values, and sum reductions into a local variable.
+ * Floating point reductions change evaluation order, and are only done
+ * with -ffast-math.
+ *
+ * Packed operations are 16 byte SSE2, or 32 byte AVX2 when enabled by
+ * -march. Only caller saved registers are used; %rax holds the index,
+ * %rcx the limit, and %rdx, %r8 and %r9 base addresses of arrays.
+ * Values are kept in %xmm0 through %xmm5.
+ */
+#define VEC_MAX_TEMPS 32
+#define VEC_MAX_BASES 3
+#define VEC_MAX_REGS 6
+#define VEC_MAX_OPS 32
+
+static const enum reg vec_base_reg[] = {DX, R8, R9};
+
+enum vec_temp_kind {
+    VEC_UNUSED,         /* Copy of index, assumed dead. */
+    VEC_INDEX,          /* (long) i */
+    VEC_OFFSET,         /* (long) i * sizeof(T) */
+    VEC_ELEMENT,        /* base + (long) i * sizeof(T) */
+    VEC_VALUE           /* Vector value in register. */
+};
+
+enum vec_op_kind {
+    VEC_LOAD,
+    VEC_STORE,
+    VEC_MOVE,
+    VEC_ARITH,
+    VEC_ACCUMULATE
+};
+
+static struct vectorizer {
+    Type type;
+    int width;
+    const struct symbol *index;
+    struct var limit;
+    int inclusive;
+    const struct symbol *sum;
+    int acc;
+    int store_base;
+
+    struct var base[VEC_MAX_BASES];
+    int bases;
+
+    struct var invariant[VEC_MAX_REGS];
+    int invariant_reg[VEC_MAX_REGS];
+    int invariants;
+
+    /* Registers holding values that can be overwritten. */
+    int fresh[VEC_MAX_REGS];
+    int regs;
+
+    struct {
+        const struct symbol *sym;
+        enum vec_temp_kind kind;
+        int n;
+    } temp[VEC_MAX_TEMPS];
+    int temps;
+
+    struct {
+        enum vec_op_kind kind;
+        enum opcode opcode;
+        int base;
+        int src, dst;
+    } op[VEC_MAX_OPS];
+    int ops;
+} vec;
+
+static int vec_is_vector_type(Type type)
+{
+    return (is_integer(type) && (size_of(type) == 4 || size_of(type) == 8))
+        || is_float(type)
+        || is_double(type);
+}
+
+static int vec_refers(struct var v, const struct symbol *sym, int kind)
+{
+    return v.symbol == sym && (kind < 0 || v.kind == kind);
+}
+
+/*
+ * Determine if symbol is referenced as a given kind of variable, or as
+ * any kind if negative, outside of block skip.
+ */
+static int vec_is_referenced(
+    const struct symbol *sym,
+    const struct block *skip,
+    int kind)
+{
+    int i, j;
+    struct block *block;
+    struct statement *st;
+
+    for (i = 0; i < array_len(&definition->nodes); ++i) {
+        block = array_get(&definition->nodes, i);
+        if (block == skip)
+            continue;
+
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            if (vec_refers(st->t, sym, kind)
+                || vec_refers(st->expr.l, sym, kind)
+                || vec_refers(st->expr.r, sym, kind))
+                return 1;
+        }
+
+        if (vec_refers(block->expr.l, sym, kind)
+            || vec_refers(block->expr.r, sym, kind))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Local variable which cannot be modified through pointers stored in
+ * the loop.
+ */
+static int vec_is_local(struct var v)
+{
+    return v.kind == DIRECT
+        && !is_field(v)
+        && v.symbol->linkage == LINK_NONE
+        && !is_temporary(v.symbol)
+        && !vec_is_referenced(v.symbol, NULL, ADDRESS);
+}
+
+static int vec_alloc_reg(void)
+{
+    if (vec.regs == VEC_MAX_REGS)
+        return -1;
+
+    vec.fresh[vec.regs] = 0;
+    return vec.regs++;
+}
+
+static int vec_push(
+    enum vec_op_kind kind,
+    enum opcode opcode,
+    int base,
+    int src,
+    int dst)
+{
+    if (vec.ops == VEC_MAX_OPS)
+        return 0;
+
+    vec.op[vec.ops].kind = kind;
+    vec.op[vec.ops].opcode = opcode;
+    vec.op[vec.ops].base = base;
+    vec.op[vec.ops].src = src;
+    vec.op[vec.ops].dst = dst;
+    vec.ops++;
+    return 1;
+}
+
+static int vec_find_temp(const struct symbol *sym)
+{
+    int i;
+
+    for (i = 0; i < vec.temps; ++i) {
+        if (vec.temp[i].sym == sym)
+            return i;
+    }
+
+    return -1;
+}
+
+static int vec_add_temp(const struct symbol *sym, enum vec_temp_kind kind, int n)
+{
+    if (vec.temps == VEC_MAX_TEMPS || vec_find_temp(sym) != -1)
+        return 0;
+
+    vec.temp[vec.temps].sym = sym;
+    vec.temp[vec.temps].kind = kind;
+    vec.temp[vec.temps].n = n;
+    vec.temps++;
+    return 1;
+}
+
+/* Find or add register holding array base address. */
+static int vec_base(struct var v)
+{
+    int i;
+
+    if (v.kind == ADDRESS) {
+        if (is_field(v))
+            return -1;
+    } else if (!vec_is_local(v)
+        || !is_pointer(v.symbol->type)
+        || size_of(v.type) != 8)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < vec.bases; ++i) {
+        if (operand_equal(vec.base[i], v))
+            return i;
+    }
+
+    if (vec.bases == VEC_MAX_BASES)
+        return -1;
+
+    vec.base[vec.bases] = v;
+    return vec.bases++;
+}
+
+static int vec_immediate_equal(struct var a, struct var b)
+{
+    if (a.kind != IMMEDIATE || b.kind != IMMEDIATE || a.symbol || b.symbol)
+        return 0;
+
+    return is_float(a.type) ? a.imm.f == b.imm.f
+        : is_double(a.type) ? a.imm.d == b.imm.d
+        : a.imm.i == b.imm.i;
+}
+
+/* Find or add register holding loop invariant value. */
+static int vec_invariant(struct var v)
+{
+    int i, r;
+
+    if (v.kind == DIRECT) {
+        if (!vec_is_local(v)
+            || v.symbol == vec.index
+            || v.symbol == vec.sum)
+            return -1;
+    } else if (v.kind != IMMEDIATE || is_string(v)) {
+        return -1;
+    }
+
+    for (i = 0; i < vec.invariants; ++i) {
+        if (operand_equal(vec.invariant[i], v)
+            || vec_immediate_equal(vec.invariant[i], v))
+            return vec.invariant_reg[i];
+    }
+
+    r = vec_alloc_reg();
+    if (r != -1) {
+        vec.invariant[vec.invariants] = v;
+        vec.invariant_reg[vec.invariants] = r;
+        vec.invariants++;
+    }
+
+    return r;
+}
+
+/*
+ * Get register holding vector operand, adding a load if the value is
+ * an array element. Return -1 if not vectorizable.
+ */
+static int vec_operand(struct var v)
+{
+    int t, r;
+
+    if (!type_equal(v.type, vec.type))
+        return -1;
+
+    if (v.kind == DEREF) {
+        t = vec_find_temp(v.symbol);
+        if (t == -1 || vec.temp[t].kind != VEC_ELEMENT || v.offset)
+            return -1;
+
+        r = vec_alloc_reg();
+        if (r == -1 || !vec_push(VEC_LOAD, 0, vec.temp[t].n, 0, r))
+            return -1;
+
+        vec.fresh[r] = 1;
+        return r;
+    }
+
+    if (v.kind == DIRECT && is_temporary(v.symbol)) {
+        t = vec_find_temp(v.symbol);
+        return (t != -1 && vec.temp[t].kind == VEC_VALUE) ? vec.temp[t].n : -1;
+    }
+
+    return vec_invariant(v);
+}
+
+static enum opcode vec_opcode(enum optype op)
+{
+    int w = size_of(vec.type);
+
+    if (is_float(vec.type) || is_double(vec.type)) {
+        switch (op) {
+        default: break;
+        case IR_OP_ADD: return is_float(vec.type) ? INSTR_ADDPS : INSTR_ADDPD;
+        case IR_OP_SUB: return is_float(vec.type) ? INSTR_SUBPS : INSTR_SUBPD;
+        case IR_OP_MUL: return is_float(vec.type) ? INSTR_MULPS : INSTR_MULPD;
+        case IR_OP_DIV: return is_float(vec.type) ? INSTR_DIVPS : INSTR_DIVPD;
+        }
+    } else {
+        switch (op) {
+        default: break;
+        case IR_OP_ADD: return w == 4 ? INSTR_PADDD : INSTR_PADDQ;
+        case IR_OP_SUB: return w == 4 ? INSTR_PSUBD : INSTR_PSUBQ;
+        case IR_OP_AND: return INSTR_PAND;
+        case IR_OP_OR: return INSTR_POR;
+        case IR_OP_XOR: return INSTR_PXOR;
+        case IR_OP_MUL:
+            if (w == 4 && context.avx2)
+                return INSTR_PMULLD;
+            break;
+        }
+    }
+
+    return INSTR_BUILTIN;
+}
+
+/*
+ * Get register holding result of evaluating expression, or -1 if not
+ * vectorizable.
+ */
+static int vec_expression(struct expression expr)
+{
+    int a, b, d;
+    enum opcode opcode;
+
+    if (!type_equal(expr.type, vec.type))
+        return -1;
+
+    if (is_identity(expr))
+        return vec_operand(expr.l);
+
+    opcode = vec_opcode(expr.op);
+    if (opcode == INSTR_BUILTIN)
+        return -1;
+
+    a = vec_operand(expr.l);
+    if (a == -1)
+        return -1;
+
+    b = vec_operand(expr.r);
+    if (b == -1)
+        return -1;
+
+    if (vec.fresh[a] && a != b) {
+        d = a;
+    } else {
+        d = vec_alloc_reg();
+        if (d == -1 || !vec_push(VEC_MOVE, 0, 0, a, d))
+            return -1;
+    }
+
+    vec.fresh[d] = 0;
+    return vec_push(VEC_ARITH, opcode, 0, b, d) ? d : -1;
+}
+
+/* Index value as long, either from cast or the index variable itself. */
+static int vec_is_index(struct var v)
+{
+    int t;
+
+    if (v.kind != DIRECT || is_field(v))
+        return 0;
+
+    if (v.symbol == vec.index)
+        return size_of(v.type) == 8;
+
+    t = vec_find_temp(v.symbol);
+    return t != -1 && vec.temp[t].kind == VEC_INDEX;
+}
+
+static int vec_is_offset(struct var v)
+{
+    int t;
+
+    if (v.kind != DIRECT || !is_temporary(v.symbol))
+        return 0;
+
+    t = vec_find_temp(v.symbol);
+    return t != -1 && vec.temp[t].kind == VEC_OFFSET;
+}
+
+/*
+ * Classify assignment to temporary, which is part of address
+ * computation or a vector value.
+ */
+static int vec_temporary(struct var t, struct expression expr)
+{
+    int r;
+    struct var l, o;
+
+    l = expr.l;
+    if (expr.op == IR_OP_CAST
+        && l.kind == DIRECT
+        && l.symbol == vec.index
+        && !is_field(l))
+    {
+        if (is_integer(expr.type) && size_of(expr.type) == 8) {
+            return vec_add_temp(t.symbol, VEC_INDEX, 0);
+        } else if (is_identity(expr)) {
+            return vec_add_temp(t.symbol, VEC_UNUSED, 0);
+        }
+        return 0;
+    }
+
+    if (expr.op == IR_OP_MUL
+        && is_integer(expr.type)
+        && size_of(expr.type) == 8)
+    {
+        o = (l.kind == IMMEDIATE) ? expr.r : l;
+        l = (l.kind == IMMEDIATE) ? l : expr.r;
+        if (l.kind == IMMEDIATE
+            && l.imm.i == size_of(vec.type)
+            && vec_is_index(o))
+            return vec_add_temp(t.symbol, VEC_OFFSET, 0);
+        return 0;
+    }
+
+    if (expr.op == IR_OP_ADD && is_pointer(expr.type)) {
+        o = vec_is_offset(expr.r) ? expr.r : l;
+        l = vec_is_offset(expr.r) ? l : expr.r;
+        if (vec_is_offset(o)) {
+            r = vec_base(l);
+            return r != -1 && vec_add_temp(t.symbol, VEC_ELEMENT, r);
+        }
+        return 0;
+    }
+
+    r = vec_expression(expr);
+    if (r == -1)
+        return 0;
+
+    vec.fresh[r] = 0;
+    return vec_add_temp(t.symbol, VEC_VALUE, r);
+}
+
+/* Store to array element. */
+static int vec_store(struct var t, struct expression expr)
+{
+    int i, r;
+
+    i = vec_find_temp(t.symbol);
+    if (vec.store_base != -1
+        || i == -1
+        || vec.temp[i].kind != VEC_ELEMENT
+        || t.offset
+        || !type_equal(t.type, vec.type))
+        return 0;
+
+    r = vec_expression(expr);
+    if (r == -1)
+        return 0;
+
+    vec.store_base = vec.temp[i].n;
+    return vec_push(VEC_STORE, 0, vec.store_base, r, 0);
+}
+
+/* Sum reduction, on the form s = s + x. */
+static int vec_reduction(struct var t, struct expression expr)
+{
+    int r;
+    struct var x;
+
+    if (expr.op != IR_OP_ADD || vec.acc != -1)
+        return 0;
+
+    if (vec_refers(expr.l, t.symbol, DIRECT)) {
+        x = expr.r;
+    } else if (vec_refers(expr.r, t.symbol, DIRECT)) {
+        x = expr.l;
+    } else {
+        return 0;
+    }
+
+    r = vec_operand(x);
+    if (r == -1)
+        return 0;
+
+    vec.acc = vec_alloc_reg();
+    return vec.acc != -1 && vec_push(VEC_ACCUMULATE, 0, 0, r, vec.acc);
+}
+
+/*
+ * Increment block can have copies of the index before the increment,
+ * from postfix i++, which are not used anywhere.
+ */
+static int vec_is_increment(struct block *block)
+{
+    int i;
+    struct statement st;
+
+    if (!array_len(&block->code))
+        return 0;
+
+    for (i = 0; i < array_len(&block->code) - 1; ++i) {
+        st = array_get(&block->code, i);
+        if (st.st != IR_ASSIGN
+            || st.t.kind != DIRECT
+            || !is_temporary(st.t.symbol)
+            || !is_identity(st.expr)
+            || !vec_refers(st.expr.l, vec.index, DIRECT)
+            || vec_is_referenced(st.t.symbol, block, -1))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Match loop shape and body. The head block jumps to the condition
+ * block, which must only compare index with limit. The body block is
+ * followed by an increment block, or has the increment as its last
+ * statement.
+ */
+static int vec_analyze(struct block *head)
+{
+    int i, n;
+    struct block *top, *body, *next;
+    struct statement st;
+    struct var t;
+
+    top = head->jump[0];
+    body = head->body;
+    if (top == body
+        || array_len(&head->code)
+        || array_len(&top->code)
+        || top->has_jump_table
+        || top->jump[1] != body
+        || (top->expr.op != IR_OP_GT && top->expr.op != IR_OP_GE)
+        || body->has_jump_table
+        || body->jump[1])
+        return 0;
+
+    memset(&vec, 0, sizeof(vec));
+    vec.acc = -1;
+    vec.store_base = -1;
+    vec.limit = top->expr.l;
+    vec.inclusive = top->expr.op == IR_OP_GE;
+    t = top->expr.r;
+    if (!vec_is_local(t)
+        || !is_signed(t.type)
+        || size_of(t.type) < 4
+        || !type_equal(vec.limit.type, t.type)
+        || (vec.limit.kind != IMMEDIATE && !vec_is_local(vec.limit))
+        || vec.limit.symbol == t.symbol)
+        return 0;
+
+    vec.index = t.symbol;
+    n = array_len(&body->code);
+    next = body->jump[0];
+    if (next == top) {
+        n -= 1;
+        next = body;
+    } else if (!next || next->jump[0] != top || next->jump[1]
+        || next->has_jump_table || !vec_is_increment(next)) {
+        return 0;
+    }
+
+    st = array_get(&next->code, array_len(&next->code) - 1);
+    if (n < 1
+        || st.st != IR_ASSIGN
+        || !vec_refers(st.t, vec.index, DIRECT)
+        || st.expr.op != IR_OP_ADD
+        || !vec_refers(st.expr.l, vec.index, DIRECT)
+        || st.expr.r.kind != IMMEDIATE
+        || st.expr.r.imm.i != 1)
+        return 0;
+
+    /* Element type and reduction variable from first assignment. */
+    for (i = 0; i < n; ++i) {
+        st = array_get(&body->code, i);
+        if (st.st != IR_ASSIGN)
+            return 0;
+        t = st.t;
+        if (t.kind == DIRECT && is_temporary(t.symbol))
+            continue;
+        if (is_void(vec.type)) {
+            vec.type = t.type;
+        }
+        if (t.kind == DIRECT) {
+            if (vec.sum || !vec_is_local(t) || t.symbol == vec.index
+                || t.symbol == vec.limit.symbol)
+                return 0;
+            vec.sum = t.symbol;
+        }
+    }
+
+    if (!vec_is_vector_type(vec.type))
+        return 0;
+
+    if (vec.sum && is_real(vec.type) && !context.fast_math)
+        return 0;
+
+    vec.width = context.avx2 ? 32 : 16;
+    for (i = 0; i < n; ++i) {
+        st = array_get(&body->code, i);
+        t = st.t;
+        switch (t.kind) {
+        case DIRECT:
+            if (is_temporary(t.symbol)) {
+                if (vec_is_referenced(t.symbol, body, -1)
+                    || !vec_temporary(t, st.expr))
+                    return 0;
+            } else if (!vec_reduction(t, st.expr)) {
+                return 0;
+            }
+            break;
+        case DEREF:
+            if (!vec_store(t, st.expr))
+                return 0;
+            break;
+        default:
+            return 0;
+        }
+    }
+
+    /* Unused copies of the index must really be unused. */
+    for (i = 0; i < vec.temps; ++i) {
+        if (vec.temp[i].kind == VEC_UNUSED) {
+            for (n = 0; n < array_len(&body->code); ++n) {
+                st = array_get(&body->code, n);
+                if (vec_refers(st.expr.l, vec.temp[i].sym, -1)
+                    || vec_refers(st.expr.r, vec.temp[i].sym, -1))
+                    return 0;
+            }
+        }
+    }
+
+    return vec.store_base != -1 || vec.acc != -1;
+}
+
+static struct registr vec_reg(int r)
+{
+    return reg(XMM0 + r, vec.width);
+}
+
+static enum opcode vec_move_opcode(void)
+{
+    return is_integer(vec.type) ? INSTR_MOVDQU : INSTR_MOVUPS;
+}
+
+static struct memory vec_element(int base)
+{
+    return location(
+        address(0, vec_base_reg[base], AX, size_of(vec.type)),
+        vec.width);
+}
+
+/* Copy scalar in low element of register to all elements. */
+static void vec_broadcast(struct var v, int r)
+{
+    int w;
+
+    w = size_of(vec.type);
+    if (is_real(vec.type)) {
+        load_sse(v, XMM0 + r, w);
+    } else {
+        load_int(v, R10, w);
+        emit(INSTR_MOVD, OPT_REG_REG, reg(R10, w), reg(XMM0 + r, 16));
+    }
+
+    emit(INSTR_PSHUFD, OPT_IMM_REG,
+        constant(w == 4 ? 0x00 : 0x44, 1),
+        reg(XMM0 + r, 16));
+    if (vec.width == 32) {
+        emit(INSTR_VINSERTI128, OPT_REG_REG,
+            reg(XMM0 + r, 16),
+            reg(XMM0 + r, 32));
+    }
+}
+
+/*
+ * Add together all elements of accumulator, and add the result to the
+ * reduction variable.
+ */
+static void vec_reduce(void)
+{
+    int w, acc, tmp;
+    enum opcode add;
+    struct var sum;
+
+    w = size_of(vec.type);
+    acc = XMM0 + vec.acc;
+    tmp = XMM0 + (vec.acc == 0 ? 1 : 0);
+    add = vec_opcode(IR_OP_ADD);
+    if (vec.width == 32) {
+        emit(INSTR_VEXTRACTI128, OPT_REG_REG, reg(acc, 32), reg(tmp, 16));
+        emit(INSTR_VZEROUPPER, OPT_NONE);
+        emit(add, OPT_REG_REG, reg(tmp, 16), reg(acc, 16));
+    }
+
+    emit(INSTR_MOVDQU, OPT_REG_REG, reg(acc, 16), reg(tmp, 16));
+    emit(INSTR_PSHUFD, OPT_IMM_REG, constant(0x4E, 1), reg(tmp, 16));
+    emit(add, OPT_REG_REG, reg(tmp, 16), reg(acc, 16));
+    if (w == 4) {
+        emit(INSTR_MOVDQU, OPT_REG_REG, reg(acc, 16), reg(tmp, 16));
+        emit(INSTR_PSHUFD, OPT_IMM_REG, constant(0xB1, 1), reg(tmp, 16));
+        emit(add, OPT_REG_REG, reg(tmp, 16), reg(acc, 16));
+    }
+
+    sum = var_direct(vec.sum);
+    if (is_real(vec.type)) {
+        load_sse(sum, tmp, w);
+        emit(is_float(vec.type) ? INSTR_ADDSS : INSTR_ADDSD,
+            OPT_REG_REG, reg(acc, w), reg(tmp, w));
+        store(tmp, sum);
+    } else {
+        emit(INSTR_MOVD, OPT_REG_REG, reg(acc, 16), reg(CX, w));
+        load_int(sum, AX, w);
+        emit(INSTR_ADD, OPT_REG_REG, reg(CX, w), reg(AX, w));
+        store(AX, sum);
+    }
+}
+
+/*
+ * Emit vector loop before entering scalar loop starting at head block.
+ * Nothing is emitted if the loop cannot be vectorized.
+ */
+static void compile_vector_loop(struct block *head)
+{
+    int i, j, lanes, slack;
+    const struct symbol *loop, *skip;
+
+    if (!vec_analyze(head))
+        return;
+
+    lanes = vec.width / size_of(vec.type);
+    loop = create_label(definition);
+    skip = create_label(definition);
+    for (i = 0; i < vec.bases; ++i) {
+        load_int(vec.base[i], vec_base_reg[i], 8);
+    }
+
+    /*
+     * Skip vector loop if store can overlap other arrays within vector
+     * distance, |dst - src| < width.
+     */
+    for (i = 0; i < vec.bases && vec.store_base != -1; ++i) {
+        j = vec.store_base;
+        if (i == j || (vec.base[i].kind == ADDRESS
+                && vec.base[j].kind == ADDRESS
+                && vec.base[i].symbol != vec.base[j].symbol))
+            continue;
+
+        emit(INSTR_MOV, OPT_REG_REG,
+            reg(vec_base_reg[j], 8), reg(AX, 8));
+        emit(INSTR_SUB, OPT_REG_REG,
+            reg(vec_base_reg[i], 8), reg(AX, 8));
+        emit(INSTR_ADD, OPT_IMM_REG, constant(vec.width - 1, 8), reg(AX, 8));
+        emit(INSTR_CMP, OPT_IMM_REG,
+            constant(2 * vec.width - 2, 8), reg(AX, 8));
+        emit(INSTR_JNA, OPT_IMM, addr(skip));
+    }
+
+    /* Need at least one full vector, i + lanes <= n. */
+    load_int(var_direct(vec.index), AX, 8);
+    load_int(vec.limit, CX, 8);
+    slack = lanes - 1 - vec.inclusive;
+    if (slack) {
+        emit(INSTR_SUB, OPT_IMM_REG, constant(slack, 8), reg(CX, 8));
+    }
+    emit(INSTR_CMP, OPT_REG_REG, reg(CX, 8), reg(AX, 8));
+    emit(INSTR_JGE, OPT_IMM, addr(skip));
+
+    for (i = 0; i < vec.invariants; ++i) {
+        vec_broadcast(vec.invariant[i], vec.invariant_reg[i]);
+    }
+
+    if (vec.acc != -1) {
+        emit(INSTR_PXOR, OPT_REG_REG, vec_reg(vec.acc), vec_reg(vec.acc));
+    }
+
+    enter_context(loop);
+    for (i = 0; i < vec.ops; ++i) {
+        switch (vec.op[i].kind) {
+        case VEC_LOAD:
+            emit(vec_move_opcode(), OPT_MEM_REG,
+                vec_element(vec.op[i].base), vec_reg(vec.op[i].dst));
+            break;
+        case VEC_STORE:
+            emit(vec_move_opcode(), OPT_REG_MEM,
+                vec_reg(vec.op[i].src), vec_element(vec.op[i].base));
+            break;
+        case VEC_MOVE:
+            emit(vec_move_opcode(), OPT_REG_REG,
+                vec_reg(vec.op[i].src), vec_reg(vec.op[i].dst));
+            break;
+        case VEC_ARITH:
+            emit(vec.op[i].opcode, OPT_REG_REG,
+                vec_reg(vec.op[i].src), vec_reg(vec.op[i].dst));
+            break;
+        case VEC_ACCUMULATE:
+            emit(vec_opcode(IR_OP_ADD), OPT_REG_REG,
+                vec_reg(vec.op[i].src), vec_reg(vec.op[i].dst));
+            break;
+        }
+    }
+
+    emit(INSTR_ADD, OPT_IMM_REG, constant(lanes, 8), reg(AX, 8));
+    emit(INSTR_CMP, OPT_REG_REG, reg(CX, 8), reg(AX, 8));
+    emit(INSTR_JNGE, OPT_IMM, addr(loop));
+    store(AX, var_direct(vec.index));
+    if (vec.acc != -1) {
+        vec_reduce();
+    } else if (vec.width == 32) {
+        emit(INSTR_VZEROUPPER, OPT_NONE);
+    }
+
+    enter_context(skip);
+}
+
+/*
+ * Block layout guided by profile input. Successors taken most often are
+ * placed to fall through, and blocks never executed are moved to the
+ * end of the function.
+ */
+static int has_profile;
+static int in_cold_section;
+static array_of(struct block *) cold_blocks;
+
+static int is_cold(const struct block *block)
+{
+    return has_profile
+        && !in_cold_section
+        && block->color == WHITE
+        && block->count == 0;
+}
+
+/* Compile block only reached by jumps, or defer it if cold. */
+static void compile_jump_target(struct block *block, Type type, int regs)
+{
+    if (is_cold(block)) {
+        array_push_back(&cold_blocks, block);
+    } else {
+        compile_block(block, type, regs);
+    }
+}
+
+/* Fall through to block, or jump to it if already placed or cold. */
+static void compile_successor(struct block *block, Type type, int regs)
+{
+    if (block->color == BLACK || is_cold(block)) {
+        emit(INSTR_JMP, OPT_IMM, addr(block->label));
+    }
+
+    compile_jump_target(block, type, regs);
+}
+
+/*
+ * Find index of jump table entry taken in most of the executions of the
+ * switch, if any, to be tested before the indirect jump.
+ */
+static int hot_switch_case(const struct block *block)
+{
+    int i, j, len;
+    struct block *target;
+
+    if (!has_profile || !block->count)
+        return -1;
+
+    len = array_len(&block->jump_table);
+    for (i = 0; i < len; ++i) {
+        target = array_get(&block->jump_table, i).label;
+        if (target->count * 2 <= block->count)
+            continue;
+        for (j = 0; j < len; ++j) {
+            if (j != i && array_get(&block->jump_table, j).label == target)
+                return -1;
+        }
+        return i;
+    }
+
+    return -1;
+}
+
 /*
  * Emit code for all statements in a block, jump to children based on
  * compare result, or return value in case of no children.
@@ -2997,6 +4000,14 @@ static void compile_block(struct block *block, Type type, int regs)
         emit(INSTR_XOR, OPT_REG_REG, reg(AX, 8), reg(AX, 8));
         ax = compile_expression(block->expr);
         assert(ax == AX);
+        i = hot_switch_case(block);
+        if (i != -1) {
+            emit(INSTR_CMP, OPT_IMM_REG,
+                constant(i, size_of(block->expr.type)),
+                reg(ax, size_of(block->expr.type)));
+            emit(INSTR_JE, OPT_IMM,
+                addr(array_get(&block->jump_table, i).label->label));
+        }
         cx = get_int_reg();
         emit(INSTR_LEA, OPT_MEM_REG, location(address_of(block->table_offset), 8), reg(cx, 8));
         emit(INSTR_JMP, OPT_MEM, location(address(0, cx, ax, 8), 8));
@@ -3009,7 +4020,7 @@ static void compile_block(struct block *block, Type type, int regs)
         }
         for (int i = 0; i < len; ++i) {
             struct jump_pair jp = array_get(&block->jump_table, i);
-            compile_block(jp.label, type, regs);
+            compile_jump_target(jp.label, type, regs);
         }
 
         /* No more use the table */
@@ -3020,8 +4031,11 @@ static void compile_block(struct block *block, Type type, int regs)
     if (block->body) {
         assert(block->jump[0]);
         assert(!block->jump[1]);
+        if (context.vectorize) {
+            compile_vector_loop(block);
+        }
         emit(INSTR_JMP, OPT_IMM, addr(block->jump[0]->label));
-        compile_block(block->body, type, regs);
+        compile_jump_target(block->body, type, regs);
     }
 
     for (i = 0; i < array_len(&block->code); ++i) {
@@ -3030,7 +4044,7 @@ static void compile_block(struct block *block, Type type, int regs)
     }
 
     if (block->body) {
-        compile_block(block->jump[0], type, regs);
+        compile_jump_target(block->jump[0], type, regs);
     } else if (!block->jump[0] && !block->jump[1]) {
         if (block->has_return_value) {
             assert(is_object(block->expr.type));
@@ -3056,17 +4070,16 @@ static void compile_block(struct block *block, Type type, int regs)
         emit(INSTR_LEAVE, OPT_NONE);
         emit(INSTR_RET, OPT_NONE);
     } else if (!block->jump[1]) {
-        if (block->jump[0]->color == BLACK) {
-            emit(INSTR_JMP, OPT_IMM, addr(block->jump[0]->label));
-        } else {
-            compile_block(block->jump[0], type, regs);
-        }
+        compile_successor(block->jump[0], type, regs);
     } else {
         assert(block->jump[0]);
         assert(block->jump[1]);
         assert(is_scalar(block->expr.type));
         int reversed = 0;
         int backjmp = block->jump[1]->color == BLACK && block->jump[0]->color == WHITE;
+        if (has_profile && block->jump[0]->color == WHITE) {
+            backjmp |= block->false_count > block->count - block->false_count;
+        }
         if (is_comparison(block->expr)) {
             cmp = compile_compare(block->expr.op, block->expr.l, block->expr.r);
             switch (cmp) {
@@ -3137,13 +4150,13 @@ static void compile_block(struct block *block, Type type, int regs)
         }
 
         relase_regs();
-        if (block->jump[1]->color == BLACK) {
-            if (!reversed) emit(INSTR_JMP, OPT_IMM, addr(block->jump[1]->label));
+        if (reversed) {
+            compile_successor(block->jump[0], type, regs);
+            compile_jump_target(block->jump[1], type, regs);
         } else {
-            compile_block(block->jump[1], type, regs);
+            compile_successor(block->jump[1], type, regs);
+            compile_jump_target(block->jump[0], type, regs);
         }
-
-        compile_block(block->jump[0], type, regs);
     }
 }
 
@@ -3308,7 +4321,7 @@ static void compile_data(struct definition *def)
 
 static void compile_function(struct definition *def)
 {
-    int regs;
+    int i, regs;
 
     assert(is_function(def->symbol->type));
     #if defined(KCC_WINDOWS)
@@ -3322,8 +4335,18 @@ static void compile_function(struct definition *def)
     /* Make sure parameters and local variables are placed on stack. */
     regs = enter(def);
 
-    /* Recursively assemble body. */
+    /* Recursively assemble body, then blocks never executed. */
+    has_profile = profile_apply(def);
     compile_block(def->body, def->symbol->type, regs);
+    in_cold_section = 1;
+    for (i = 0; i < array_len(&cold_blocks); ++i) {
+        compile_block(
+            array_get(&cold_blocks, i), def->symbol->type, regs);
+    }
+
+    array_empty(&cold_blocks);
+    in_cold_section = 0;
+    has_profile = 0;
 }
 
 INTERNAL void set_compile_target(FILE *stream, const char *file)
@@ -3442,6 +4465,7 @@ INTERNAL void flush(void)
 INTERNAL void finalize(void)
 {
     array_clear(&func_args);
+    array_clear(&cold_blocks);
     if (finalize_backend) {
         finalize_backend();
     }
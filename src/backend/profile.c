@@ -0,0 +1,203 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "profile.h"
+#include <lacc/array.h>
+#include <lacc/context.h>
+#include <lacc/hash.h>
+
+#include <kcs/assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct profile_function {
+    String name;
+    int blocks;
+    int base;
+};
+
+struct profile_entry {
+    String name;
+    int blocks;
+    uint64_t *counts;
+};
+
+static const char *output_file;
+static array_of(struct profile_function) functions;
+static uint64_t *counters;
+static int counter_count;
+
+static int has_input;
+static struct hash_table entries;
+
+static String entry_key(void *p)
+{
+    return ((struct profile_entry *) p)->name;
+}
+
+static void *entry_add(void *p)
+{
+    struct profile_entry *entry, *src;
+
+    src = p;
+    entry = calloc(1, sizeof(*entry));
+    *entry = *src;
+    return entry;
+}
+
+static void entry_del(void *p)
+{
+    struct profile_entry *entry = p;
+
+    free(entry->counts);
+    free(entry);
+}
+
+static void profile_save(void)
+{
+    int i, j;
+    FILE *fp;
+    struct profile_function *func;
+
+    if (!counters)
+        return;
+
+    fp = fopen(output_file, "w");
+    if (!fp) {
+        error("Could not open profile output file '%s'.", output_file);
+    } else {
+        for (i = 0; i < array_len(&functions); ++i) {
+            func = &array_get(&functions, i);
+            fprintf(fp, "%s %d", str_raw(func->name), func->blocks);
+            for (j = 0; j < func->blocks * 2; ++j) {
+                fprintf(fp, " %llu",
+                    (unsigned long long) counters[func->base + j]);
+            }
+            fputc('\n', fp);
+        }
+        fclose(fp);
+    }
+
+    free(counters);
+    counters = NULL;
+}
+
+INTERNAL void profile_output(const char *file)
+{
+    output_file = file;
+}
+
+INTERNAL int profile_input(const char *file)
+{
+    int i;
+    FILE *fp;
+    char name[1024];
+    unsigned long long count;
+    struct profile_entry entry;
+
+    fp = fopen(file, "r");
+    if (!fp) {
+        fprintf(stderr, "Could not open profile input file '%s'.\n", file);
+        return 1;
+    }
+
+    if (!has_input) {
+        hash_init(&entries, 256, entry_key, entry_add, entry_del);
+        has_input = 1;
+    }
+
+    while (fscanf(fp, "%1023s %d", name, &entry.blocks) == 2) {
+        if (entry.blocks < 0)
+            break;
+
+        entry.name = str_init(name);
+        entry.counts = calloc(entry.blocks * 2 + 1, sizeof(uint64_t));
+        for (i = 0; i < entry.blocks * 2; ++i) {
+            if (fscanf(fp, "%llu", &count) != 1)
+                break;
+            entry.counts[i] = count;
+        }
+
+        if (i < entry.blocks * 2) {
+            free(entry.counts);
+            break;
+        }
+
+        /* Keep the first of static functions with the same name. */
+        if (hash_lookup(&entries, entry.name)) {
+            free(entry.counts);
+        } else {
+            hash_insert(&entries, &entry);
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+INTERNAL int profile_is_recording(void)
+{
+    return output_file != NULL;
+}
+
+INTERNAL int profile_register(const struct definition *def)
+{
+    struct profile_function func;
+
+    assert(!counters);
+    func.name = def->symbol->name;
+    func.blocks = array_len(&def->nodes);
+    func.base = counter_count;
+    counter_count += func.blocks * 2;
+    array_push_back(&functions, func);
+    return func.base;
+}
+
+INTERNAL uint64_t *profile_counters(void)
+{
+    if (!counters && output_file) {
+        counters = calloc(counter_count + 1, sizeof(*counters));
+        atexit(profile_save);
+    }
+
+    return counters;
+}
+
+INTERNAL int profile_apply(struct definition *def)
+{
+    int i;
+    struct block *block;
+    struct profile_entry *entry;
+
+    if (!has_input)
+        return 0;
+
+    entry = hash_lookup(&entries, def->symbol->name);
+    if (!entry || entry->blocks != array_len(&def->nodes)) {
+        verbose("No profile for function %s.", sym_name(def->symbol));
+        return 0;
+    }
+
+    for (i = 0; i < entry->blocks; ++i) {
+        block = array_get(&def->nodes, i);
+        assert(block->index == i);
+        block->count = entry->counts[i * 2];
+        block->false_count = entry->counts[i * 2 + 1];
+    }
+
+    return entry->counts[0] != 0;
+}
+
+INTERNAL void profile_finalize(void)
+{
+    profile_save();
+    array_clear(&functions);
+    counter_count = 0;
+    output_file = NULL;
+    if (has_input) {
+        hash_destroy(&entries);
+        has_input = 0;
+    }
+}
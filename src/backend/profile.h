@@ -0,0 +1,48 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <lacc/ir.h>
+
+/*
+ * Execution profile of function definitions, recorded by running the
+ * VM with --profile-out, and used to lay out native code with
+ * --profile-use.
+ *
+ * The profile is a text file with one line for each function:
+ *
+ *     <name> <blocks> <count> <false count> <count> <false count> ...
+ *
+ * Blocks are identified by their position in the list of nodes of the
+ * definition. Each has the number of times it was entered, and for
+ * branches the number of times the false branch was taken. Functions
+ * where the number of blocks does not match are ignored.
+ */
+
+/* Record block counts while running, and write them to file at exit. */
+INTERNAL void profile_output(const char *file);
+
+/* Read profile for use in code generation. */
+INTERNAL int profile_input(const char *file);
+
+/* Non-zero if block counters are to be recorded. */
+INTERNAL int profile_is_recording(void);
+
+/*
+ * Allocate two counters for each block of function definition, and
+ * return the index of the first one.
+ */
+INTERNAL int profile_register(const struct definition *def);
+
+/* Counters to update when running, after all functions are registered. */
+INTERNAL uint64_t *profile_counters(void);
+
+/*
+ * Assign block counts from profile input to nodes of the definition.
+ * Return 0 if there is no usable profile for the function.
+ */
+INTERNAL int profile_apply(struct definition *def);
+
+/* Write pending output and free resources. */
+INTERNAL void profile_finalize(void);
+
+#endif
@@ -14,6 +14,8 @@
 #include "../vm.h"
 #include "../vminstr.h"
 #include "vmacpconv.h"
+#include "vmformat.h"
+#include "vmsort.h"
 #include <lacc/array.h>
 #include <kcs/dll.h>
 #include <math.h>
@@ -312,6 +314,150 @@ static int vm_call_builtin_memmove(uint8_t *stack, int64_t sp)
     return 8;   /* sp += 8; */
 }
 
+static int vm_call_builtin_strcat(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    char *dst = (char*)STACK_TOPI_OFFSET(-8);
+    const char *src = (const char*)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = (uint64_t)strcat(dst, src);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strncat(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    char *dst = (char*)STACK_TOPI_OFFSET(-8);
+    const char *src = (const char*)STACK_TOPI_OFFSET(-16);
+    size_t len = (size_t)STACK_TOPI_OFFSET(-24);
+    STACK_TOPI() = (uint64_t)strncat(dst, src, len);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strcmp(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s1 = (const char*)STACK_TOPI_OFFSET(-8);
+    const char *s2 = (const char*)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = (int64_t)strcmp(s1, s2);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strncmp(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s1 = (const char*)STACK_TOPI_OFFSET(-8);
+    const char *s2 = (const char*)STACK_TOPI_OFFSET(-16);
+    size_t len = (size_t)STACK_TOPI_OFFSET(-24);
+    STACK_TOPI() = (int64_t)strncmp(s1, s2, len);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strchr(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s = (const char*)STACK_TOPI_OFFSET(-8);
+    int c = (int)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = (uint64_t)strchr(s, c);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strrchr(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s = (const char*)STACK_TOPI_OFFSET(-8);
+    int c = (int)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = (uint64_t)strrchr(s, c);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strstr(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s1 = (const char*)STACK_TOPI_OFFSET(-8);
+    const char *s2 = (const char*)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = (uint64_t)strstr(s1, s2);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strspn(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s1 = (const char*)STACK_TOPI_OFFSET(-8);
+    const char *s2 = (const char*)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = strspn(s1, s2);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_strcspn(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const char *s1 = (const char*)STACK_TOPI_OFFSET(-8);
+    const char *s2 = (const char*)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = strcspn(s1, s2);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_memcmp(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const void *s1 = (const void*)STACK_TOPI_OFFSET(-8);
+    const void *s2 = (const void*)STACK_TOPI_OFFSET(-16);
+    size_t len = (size_t)STACK_TOPI_OFFSET(-24);
+    STACK_TOPI() = (int64_t)memcmp(s1, s2, len);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_memchr(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    const void *s = (const void*)STACK_TOPI_OFFSET(-8);
+    int c = (int)STACK_TOPI_OFFSET(-16);
+    size_t len = (size_t)STACK_TOPI_OFFSET(-24);
+    STACK_TOPI() = (uint64_t)memchr(s, c, len);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_qsort_int(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    int *base = (int*)STACK_TOPI_OFFSET(-8);
+    size_t n = (size_t)STACK_TOPI_OFFSET(-16);
+    sort_int(base, n);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_qsort_double(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    double *base = (double*)STACK_TOPI_OFFSET(-8);
+    size_t n = (size_t)STACK_TOPI_OFFSET(-16);
+    sort_double(base, n);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_qsort_str(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    char **base = (char**)STACK_TOPI_OFFSET(-8);
+    size_t n = (size_t)STACK_TOPI_OFFSET(-16);
+    sort_str(base, n);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
 static int vm_call_builtin_exit(uint8_t *stack, int64_t sp)
 {
     CHECK_BUILTIN_ENTER();
@@ -618,6 +764,166 @@ static int vm_call_builtin_call_p(uint8_t *stack, int64_t sp)
     return 8;   /* sp += 8; */
 }
 
+static int vm_call_builtin_getfunc(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    void *handle = (void*)STACK_TOPI_OFFSET(-8);
+    const char *funcname = (const char*)STACK_TOPI_OFFSET(-16);
+    STACK_TOPI() = (uint64_t)get_function(handle, funcname);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_invoke(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    void (*f)(int, arg_type_t*) = (void (*)(int, arg_type_t*))STACK_TOPI_OFFSET(-8);
+    if (f) {
+        f(g_lib_argc, g_lib_argv);
+    } else {
+        vm_call_builtin_abort(NULL, 0);
+    }
+    STACK_TOPI() = 0ULL;
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_invoke_i(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    int (*f)(int, arg_type_t*) = (int (*)(int, arg_type_t*))STACK_TOPI_OFFSET(-8);
+    if (f) {
+        STACK_TOPI() = (uint64_t)f(g_lib_argc, g_lib_argv);
+    } else {
+        vm_call_builtin_abort(NULL, 0);
+    }
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_invoke_d(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    double (*f)(int, arg_type_t*) = (double (*)(int, arg_type_t*))STACK_TOPI_OFFSET(-8);
+    if (f) {
+        STACK_TOPD() = f(g_lib_argc, g_lib_argv);
+    } else {
+        vm_call_builtin_abort(NULL, 0);
+    }
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_invoke_p(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    void *(*f)(int, arg_type_t*) = (void * (*)(int, arg_type_t*))STACK_TOPI_OFFSET(-8);
+    if (f) {
+        STACK_TOPI() = (uint64_t)f(g_lib_argc, g_lib_argv);
+    } else {
+        vm_call_builtin_abort(NULL, 0);
+    }
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+/*
+ * Call extension function f with its real prototype. Arguments follow
+ * the signature string on the stack, one slot each, where 'd' is a
+ * double, 'f' a float, and any other character an integer or pointer.
+ * Under System V every argument of a non-variadic function fits in a
+ * register here, and each class is assigned registers independently of
+ * the other. Passing all of them in one call with the maximum number of
+ * both therefore reaches any callee with up to that many of each.
+ */
+#if !defined(KCC_WINDOWS)
+typedef int64_t (*vm_ffi_func_i_t)(
+    int64_t, int64_t, int64_t, int64_t, int64_t, int64_t,
+    double, double, double, double, double, double, double, double);
+typedef double (*vm_ffi_func_d_t)(
+    int64_t, int64_t, int64_t, int64_t, int64_t, int64_t,
+    double, double, double, double, double, double, double, double);
+
+static void vm_ffi_call(uint8_t *stack, int64_t sp, int64_t *ri, double *rd)
+{
+    void *f = (void*)STACK_TOPI_OFFSET(-8);
+    const char *sig = (const char*)STACK_TOPI_OFFSET(-16);
+    int64_t i[FFI_MAX_INT_ARGS] = {0};
+    double d[FFI_MAX_SSE_ARGS] = {0};
+    int ni = 0, nd = 0, o = -24;
+    union { double d; float f; } fv;
+
+    if (!f || !sig) {
+        vm_call_builtin_abort(NULL, 0);
+    }
+    for (; *sig; ++sig, o -= 8) {
+        if (*sig == 'd' || *sig == 'f') {
+            if (nd == FFI_MAX_SSE_ARGS) {
+                vm_call_builtin_abort(NULL, 0);
+            }
+            if (*sig == 'f') {
+                fv.d = 0;
+                fv.f = (float)STACK_TOPD_OFFSET(o);
+                d[nd++] = fv.d;
+            } else {
+                d[nd++] = STACK_TOPD_OFFSET(o);
+            }
+        } else {
+            if (ni == FFI_MAX_INT_ARGS) {
+                vm_call_builtin_abort(NULL, 0);
+            }
+            i[ni++] = (int64_t)STACK_TOPI_OFFSET(o);
+        }
+    }
+
+    if (rd) {
+        *rd = ((vm_ffi_func_d_t)f)(i[0], i[1], i[2], i[3], i[4], i[5],
+            d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+    } else {
+        *ri = ((vm_ffi_func_i_t)f)(i[0], i[1], i[2], i[3], i[4], i[5],
+            d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+    }
+}
+#else
+static void vm_ffi_call(uint8_t *stack, int64_t sp, int64_t *ri, double *rd)
+{
+    /* Arguments are assigned by position in the Microsoft ABI. */
+    vm_call_builtin_abort(NULL, 0);
+}
+#endif
+
+static int vm_call_builtin_ffi_i(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    int64_t r;
+    vm_ffi_call(stack, sp, &r, NULL);
+    STACK_TOPI() = (uint64_t)r;
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_ffi_d(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    double r;
+    vm_ffi_call(stack, sp, NULL, &r);
+    STACK_TOPD() = r;
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
+static int vm_call_builtin_vformat(uint8_t *stack, int64_t sp)
+{
+    CHECK_BUILTIN_ENTER();
+    char *buf = (char*)STACK_TOPI_OFFSET(-8);
+    size_t size = (size_t)STACK_TOPI_OFFSET(-16);
+    const char *fmt = (const char*)STACK_TOPI_OFFSET(-24);
+    char *ap = (char*)STACK_TOPI_OFFSET(-32);
+    STACK_TOPI() = format_vm(buf, size, fmt, ap);
+    CHECK_BUILTIN_LEAVE();
+    return 8;   /* sp += 8; */
+}
+
 static int vm_call_builtin_strtol(uint8_t *stack, int64_t sp)
 {
     CHECK_BUILTIN_ENTER();
@@ -843,6 +1149,29 @@ struct vm_builtin_def_t {
     { "__kcc_builtin_time",         vm_call_builtin_time        },
     { "__kcc_builtin_gmtime_init",  vm_call_builtin_gmtime_init },
     { "__kcc_builtin_gmtime",       vm_call_builtin_gmtime      },
+
+    { "__kcc_builtin_getfunc",      vm_call_builtin_getfunc     },
+    { "__kcc_builtin_invoke",       vm_call_builtin_invoke      },
+    { "__kcc_builtin_invoke_i",     vm_call_builtin_invoke_i    },
+    { "__kcc_builtin_invoke_d",     vm_call_builtin_invoke_d    },
+    { "__kcc_builtin_invoke_p",     vm_call_builtin_invoke_p    },
+    { "__kcc_builtin_ffi_i",        vm_call_builtin_ffi_i       },
+    { "__kcc_builtin_ffi_d",        vm_call_builtin_ffi_d       },
+    { "__kcc_builtin_vformat",      vm_call_builtin_vformat     },
+    { "__kcc_builtin_strcat",       vm_call_builtin_strcat      },
+    { "__kcc_builtin_strncat",      vm_call_builtin_strncat     },
+    { "__kcc_builtin_strcmp",       vm_call_builtin_strcmp      },
+    { "__kcc_builtin_strncmp",      vm_call_builtin_strncmp     },
+    { "__kcc_builtin_strchr",       vm_call_builtin_strchr      },
+    { "__kcc_builtin_strrchr",      vm_call_builtin_strrchr     },
+    { "__kcc_builtin_strstr",       vm_call_builtin_strstr      },
+    { "__kcc_builtin_strspn",       vm_call_builtin_strspn      },
+    { "__kcc_builtin_strcspn",      vm_call_builtin_strcspn     },
+    { "__kcc_builtin_memcmp",       vm_call_builtin_memcmp      },
+    { "__kcc_builtin_memchr",       vm_call_builtin_memchr      },
+    { "__kcc_builtin_qsort_int",    vm_call_builtin_qsort_int   },
+    { "__kcc_builtin_qsort_double", vm_call_builtin_qsort_double },
+    { "__kcc_builtin_qsort_str",    vm_call_builtin_qsort_str   },
 };
 
 DLLEXPORT int vm_get_builtin_index(const char *name)
@@ -0,0 +1,512 @@
+#include <kcs.h>
+#if !defined(AMALGAMATION) || !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+
+#include "vmformat.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FORMAT_SPEC_SIZE (64)
+
+/* Register save area of a System V va_list, as built by the JIT. */
+#define SYSV_GP_LIMIT (48)
+#define SYSV_FP_LIMIT (176)
+
+struct sysv_va_list {
+    uint32_t gp_offset;
+    uint32_t fp_offset;
+    char *overflow_arg_area;
+    char *reg_save_area;
+};
+
+/*
+ * Cursor over the variable arguments. The VM passes every argument in
+ * an 8 byte slot below the previous one. The JIT has the first ones in
+ * the register save area, and the rest in the overflow area.
+ */
+struct format_args {
+    char *ap;
+    struct sysv_va_list *va;
+};
+
+static int64_t format_next_int(struct format_args *args)
+{
+    int64_t v;
+    struct sysv_va_list *va = args->va;
+
+    if (!va) {
+        args->ap -= 8;
+        memcpy(&v, args->ap, sizeof(v));
+    } else if (va->gp_offset < SYSV_GP_LIMIT) {
+        memcpy(&v, va->reg_save_area + va->gp_offset, sizeof(v));
+        va->gp_offset += 8;
+    } else {
+        memcpy(&v, va->overflow_arg_area, sizeof(v));
+        va->overflow_arg_area += 8;
+    }
+    return v;
+}
+
+static double format_next_double(struct format_args *args)
+{
+    double v;
+    struct sysv_va_list *va = args->va;
+
+    if (!va) {
+        args->ap -= 8;
+        memcpy(&v, args->ap, sizeof(v));
+    } else if (va->fp_offset < SYSV_FP_LIMIT) {
+        memcpy(&v, va->reg_save_area + va->fp_offset, sizeof(v));
+        va->fp_offset += 16;
+    } else {
+        memcpy(&v, va->overflow_arg_area, sizeof(v));
+        va->overflow_arg_area += 8;
+    }
+    return v;
+}
+
+/* Output of a formatting call, counting also what does not fit. */
+struct format_out {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+
+#define FORMAT_MINUS    (0x01)
+#define FORMAT_PLUS     (0x02)
+#define FORMAT_SPACE    (0x04)
+#define FORMAT_ALT      (0x08)
+#define FORMAT_ZERO     (0x10)
+#define FORMAT_GROUP    (0x20)
+
+/*
+ * Parsed conversion spec. The text holds the same spec for the host,
+ * up to the length modifier, with widths and precisions given by '*'
+ * filled in.
+ */
+struct format_spec {
+    int flags;
+    int width;
+    int prec;
+    char mod;
+    char text[FORMAT_SPEC_SIZE];
+    char *end;
+};
+
+/* Append n bytes, keeping room for the terminating nul. */
+static void format_put(struct format_out *out, const char *s, size_t n)
+{
+    size_t k;
+
+    if (out->len + 1 < out->size) {
+        k = out->size - 1 - out->len;
+        memcpy(out->buf + out->len, s, n < k ? n : k);
+    }
+    out->len += n;
+}
+
+static void format_fill(struct format_out *out, char c, int n)
+{
+    size_t k;
+
+    if (n <= 0) {
+        return;
+    }
+    if (out->len + 1 < out->size) {
+        k = out->size - 1 - out->len;
+        memset(out->buf + out->len, c, (size_t)n < k ? (size_t)n : k);
+    }
+    out->len += n;
+}
+
+/* Free space for snprintf of the host, which writes the nul itself. */
+static char *format_room(struct format_out *out, size_t *room)
+{
+    *room = out->len < out->size ? out->size - out->len : 0;
+    return *room ? out->buf + out->len : NULL;
+}
+
+/* Write body after prefix and leading zeros, padded to the field width. */
+static void format_pad(
+    struct format_out *out,
+    const struct format_spec *spec,
+    const char *prefix,
+    int plen,
+    int zeros,
+    const char *body,
+    int n)
+{
+    int pad = spec->width - plen - zeros - n;
+
+    if (!(spec->flags & FORMAT_MINUS)) {
+        format_fill(out, ' ', pad);
+    }
+    format_put(out, prefix, plen);
+    format_fill(out, '0', zeros);
+    format_put(out, body, n);
+    if (spec->flags & FORMAT_MINUS) {
+        format_fill(out, ' ', pad);
+    }
+}
+
+static void format_integer(
+    struct format_out *out,
+    const struct format_spec *spec,
+    char conv,
+    uint64_t v,
+    int negative)
+{
+    char digits[24], prefix[2], *p;
+    const char *set = conv == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+    unsigned base = conv == 'o' ? 8 : conv == 'x' || conv == 'X' ? 16 : 10;
+    int n, plen = 0, zeros = 0, pad, nonzero = v != 0;
+
+    p = digits + sizeof(digits);
+    while (v) {
+        *--p = set[v % base];
+        v /= base;
+    }
+    n = (int)(digits + sizeof(digits) - p);
+    if (spec->prec < 0 && n == 0) {
+        *--p = '0';
+        n = 1;
+    }
+    if (spec->prec > n) {
+        zeros = spec->prec - n;
+    }
+    if (conv == 'o' && (spec->flags & FORMAT_ALT) && !zeros && (n == 0 || *p != '0')) {
+        zeros = 1;
+    }
+
+    if (negative) {
+        prefix[plen++] = '-';
+    } else if (conv == 'd' || conv == 'i') {
+        if (spec->flags & FORMAT_PLUS) {
+            prefix[plen++] = '+';
+        } else if (spec->flags & FORMAT_SPACE) {
+            prefix[plen++] = ' ';
+        }
+    } else if ((conv == 'x' || conv == 'X') && (spec->flags & FORMAT_ALT) && nonzero) {
+        prefix[plen++] = '0';
+        prefix[plen++] = conv;
+    }
+
+    if ((spec->flags & FORMAT_ZERO) && !(spec->flags & FORMAT_MINUS) && spec->prec < 0) {
+        pad = spec->width - plen - zeros - n;
+        if (pad > 0) {
+            zeros += pad;
+        }
+    }
+    format_pad(out, spec, prefix, plen, zeros, p, n);
+}
+
+static void format_string(struct format_out *out, const struct format_spec *spec, const char *s)
+{
+    const char *end;
+    int n;
+
+    if (!s) {
+        s = spec->prec < 0 || spec->prec >= 6 ? "(null)" : "";
+    }
+    if (spec->prec >= 0) {
+        end = memchr(s, '\0', spec->prec);
+        n = end ? (int)(end - s) : spec->prec;
+    } else {
+        n = (int)strlen(s);
+    }
+    format_pad(out, spec, "", 0, 0, s, n);
+}
+
+/* Append decimal number from format string, or from the arguments on '*'. */
+static int format_number(const char **fmt, struct format_args *args)
+{
+    long n = 0;
+
+    if (**fmt == '*') {
+        (*fmt)++;
+        return (int)format_next_int(args);
+    }
+    while ('0' <= **fmt && **fmt <= '9') {
+        if (n < INT_MAX) {
+            n = n * 10 + (**fmt - '0');
+        }
+        (*fmt)++;
+    }
+    return n < INT_MAX ? (int)n : INT_MAX;
+}
+
+/* Write non-negative number in decimal, and return end of the text. */
+static char *format_decimal(char *s, int n)
+{
+    char digits[12], *p = digits + sizeof(digits);
+
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    n = (int)(digits + sizeof(digits) - p);
+    memcpy(s, p, n);
+    return s + n;
+}
+
+/* Parse spec following '%', and return pointer to the conversion. */
+static const char *format_parse(const char *fmt, struct format_args *args, struct format_spec *spec)
+{
+    char *s = spec->text;
+    const char *f;
+    int flag;
+
+    *s++ = '%';
+    spec->flags = 0;
+    for (;;) {
+        switch (*fmt) {
+        case '-':  flag = FORMAT_MINUS; break;
+        case '+':  flag = FORMAT_PLUS;  break;
+        case ' ':  flag = FORMAT_SPACE; break;
+        case '#':  flag = FORMAT_ALT;   break;
+        case '0':  flag = FORMAT_ZERO;  break;
+        case '\'': flag = FORMAT_GROUP; break;
+        default:   flag = 0;            break;
+        }
+        if (!flag) {
+            break;
+        }
+        if (!(spec->flags & flag)) {
+            spec->flags |= flag;
+            *s++ = *fmt;
+        }
+        fmt++;
+    }
+
+    spec->width = 0;
+    if (*fmt == '*' || ('0' <= *fmt && *fmt <= '9')) {
+        spec->width = format_number(&fmt, args);
+        if (spec->width < 0) {
+            /* Negative width from argument means left adjusted. */
+            spec->flags |= FORMAT_MINUS;
+            spec->width = spec->width == INT_MIN ? INT_MAX : -spec->width;
+            if (!strchr(spec->text, '-')) {
+                *s++ = '-';
+            }
+        }
+        s = format_decimal(s, spec->width);
+    }
+
+    spec->prec = -1;
+    if (*fmt == '.') {
+        fmt++;
+        spec->prec = format_number(&fmt, args);
+        if (spec->prec >= 0) {
+            *s++ = '.';
+            s = format_decimal(s, spec->prec);
+        } else {
+            /* Negative precision is taken as if omitted. */
+            spec->prec = -1;
+        }
+    }
+
+    spec->mod = 0;
+    switch (*fmt) {
+    case 'h':
+        f = fmt + 1;
+        spec->mod = *f == 'h' ? 'H' : 'h';
+        fmt += spec->mod == 'H' ? 2 : 1;
+        break;
+    case 'l':
+        f = fmt + 1;
+        spec->mod = *f == 'l' ? 'q' : 'l';
+        fmt += spec->mod == 'q' ? 2 : 1;
+        break;
+    case 'L': case 'q': case 'j': case 'z': case 't':
+        spec->mod = 'q';
+        fmt++;
+        break;
+    }
+
+    spec->end = s;
+    return fmt;
+}
+
+/*
+ * Integers, characters and strings are formatted here. Floating point,
+ * pointers, wide characters and grouped digits are left to snprintf of
+ * the host, given a spec with the length modifier matching the type of
+ * the value passed. Long double is the same as double in scripts, so
+ * 'L' is dropped for floating point.
+ */
+static int format_args(char *buf, size_t size, const char *fmt, struct format_args *args)
+{
+    struct format_out out;
+    struct format_spec spec;
+    const char *p, *start;
+    char *s, *dst, c;
+    size_t room;
+    int n, wide;
+    int64_t v = 0;
+
+    out.buf = buf;
+    out.size = size;
+    out.len = 0;
+    for (;;) {
+        p = strchr(fmt, '%');
+        if (!p) {
+            format_put(&out, fmt, strlen(fmt));
+            break;
+        }
+
+        format_put(&out, fmt, p - fmt);
+        start = p;
+        fmt = p + 1;
+        if (*fmt == '%') {
+            format_put(&out, "%", 1);
+            fmt++;
+            continue;
+        }
+
+        fmt = format_parse(fmt, args, &spec);
+        wide = spec.mod == 'l' || spec.mod == 'q';
+        s = spec.end;
+        n = -2;
+        switch (*fmt) {
+        case 'd': case 'i':
+            v = format_next_int(args);
+            if (!wide) {
+                v = spec.mod == 'H' ? (signed char)v : spec.mod == 'h' ? (short)v : (int)v;
+            }
+            if (spec.flags & FORMAT_GROUP) {
+                *s++ = 'l';
+                *s++ = 'l';
+                break;
+            }
+            format_integer(&out, &spec, *fmt, v < 0 ? -(uint64_t)v : (uint64_t)v, v < 0);
+            n = 0;
+            break;
+        case 'o': case 'u': case 'x': case 'X':
+            v = format_next_int(args);
+            if (!wide) {
+                v = spec.mod == 'H' ? (unsigned char)v
+                  : spec.mod == 'h' ? (unsigned short)v
+                  : (unsigned int)v;
+            }
+            if (spec.flags & FORMAT_GROUP) {
+                *s++ = 'l';
+                *s++ = 'l';
+                break;
+            }
+            format_integer(&out, &spec, *fmt, (uint64_t)v, 0);
+            n = 0;
+            break;
+        case 'c':
+            v = format_next_int(args);
+            if (spec.mod == 'l') {
+                *s++ = 'l';
+                break;
+            }
+            c = (char)v;
+            format_pad(&out, &spec, "", 0, 0, &c, 1);
+            n = 0;
+            break;
+        case 's':
+            v = format_next_int(args);
+            if (spec.mod == 'l') {
+                *s++ = 'l';
+                if (!v) {
+                    v = (intptr_t)L"(null)";
+                }
+                break;
+            }
+            format_string(&out, &spec, (const char *)(intptr_t)v);
+            n = 0;
+            break;
+        case 'p':
+            v = format_next_int(args);
+            break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            *s++ = *fmt;
+            *s = '\0';
+            dst = format_room(&out, &room);
+            n = snprintf(dst, room, spec.text, format_next_double(args));
+            break;
+        case 'n':
+            v = format_next_int(args);
+            switch (spec.mod) {
+            case 'H': *(signed char *)(intptr_t)v = (signed char)out.len; break;
+            case 'h': *(short *)(intptr_t)v = (short)out.len; break;
+            case 'l':
+            case 'q': *(long long *)(intptr_t)v = (long long)out.len; break;
+            default:  *(int *)(intptr_t)v = (int)out.len; break;
+            }
+            n = 0;
+            break;
+        case '%':
+            format_put(&out, "%", 1);
+            n = 0;
+            break;
+        case '\0':
+            /* Incomplete spec at the end is printed as is. */
+            format_put(&out, start, fmt - start);
+            goto done;
+        default:
+            format_put(&out, start, fmt + 1 - start);
+            n = 0;
+            break;
+        }
+
+        if (n == -2) {
+            /* Value already fetched, to be formatted by the host. */
+            *s++ = *fmt;
+            *s = '\0';
+            dst = format_room(&out, &room);
+            switch (*fmt) {
+            case 'p':
+                n = snprintf(dst, room, spec.text, (void *)(intptr_t)v);
+                break;
+            case 'c':
+                n = snprintf(dst, room, spec.text, (int)v);
+                break;
+            case 's':
+                n = snprintf(dst, room, spec.text, (void *)(intptr_t)v);
+                break;
+            default:
+                n = snprintf(dst, room, spec.text, (long long)v);
+                break;
+            }
+        }
+        if (n < 0) {
+            return -1;
+        }
+        out.len += n;
+        fmt++;
+    }
+
+done:
+    if (size > 0) {
+        buf[out.len < size ? out.len : size - 1] = '\0';
+    }
+    return out.len <= INT_MAX ? (int)out.len : -1;
+}
+
+INTERNAL int format_vm(char *buf, size_t size, const char *fmt, char *ap)
+{
+    struct format_args args;
+
+    args.ap = ap;
+    args.va = NULL;
+    return format_args(buf, size, fmt, &args);
+}
+
+INTERNAL int format_sysv(char *buf, size_t size, const char *fmt, void *ap)
+{
+    struct format_args args;
+    struct sysv_va_list va;
+
+    memcpy(&va, ap, sizeof(va));
+    args.ap = NULL;
+    args.va = &va;
+    return format_args(buf, size, fmt, &args);
+}
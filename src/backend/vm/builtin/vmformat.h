@@ -0,0 +1,21 @@
+#ifndef VMFORMAT_H
+#define VMFORMAT_H
+#if !defined(AMALGAMATION) || !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+
+#include <stddef.h>
+
+/*
+ * Format like vsnprintf, taking the arguments from a variable argument
+ * list of the script. For the VM, ap is the va_list pointing at the
+ * slot of the last named argument. For the JIT, ap points to a System V
+ * va_list. The list of the caller is not advanced, so the same call can
+ * be repeated with a larger buffer.
+ */
+INTERNAL int format_vm(char *buf, size_t size, const char *fmt, char *ap);
+
+INTERNAL int format_sysv(char *buf, size_t size, const char *fmt, void *ap);
+
+#endif
@@ -0,0 +1,144 @@
+#include <kcs.h>
+#if !defined(AMALGAMATION) || !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+
+#include "vmsort.h"
+#include <string.h>
+
+/* Partitions at most this long are finished by insertion sort. */
+#define SORT_INSERTION_MAX (16)
+
+/* Partitions at least this long take the pivot from a ninther. */
+#define SORT_NINTHER_MIN (128)
+
+/*
+ * Introsort for one element type: quicksort with a median of three or
+ * ninther pivot, falling back to heap sort when the recursion gets
+ * deeper than twice the logarithm of the length, so the worst case
+ * stays O(n log n). The smaller side is sorted recursively and the
+ * larger one by looping, which bounds the stack to O(log n).
+ */
+#define SORT_DEFINE(name, type, less)                                       \
+static void name##_insertion(type *a, size_t n)                             \
+{                                                                           \
+    size_t i, j;                                                            \
+    type v;                                                                 \
+                                                                            \
+    for (i = 1; i < n; ++i) {                                               \
+        v = a[i];                                                           \
+        for (j = i; j > 0 && less(v, a[j - 1]); --j) {                      \
+            a[j] = a[j - 1];                                                \
+        }                                                                   \
+        a[j] = v;                                                           \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static void name##_sift(type *a, size_t i, size_t n)                        \
+{                                                                           \
+    size_t c;                                                               \
+    type v = a[i];                                                          \
+                                                                            \
+    while ((c = 2 * i + 1) < n) {                                           \
+        if (c + 1 < n && less(a[c], a[c + 1])) {                            \
+            c++;                                                            \
+        }                                                                   \
+        if (!less(v, a[c]))                                                 \
+            break;                                                          \
+        a[i] = a[c];                                                        \
+        i = c;                                                              \
+    }                                                                       \
+    a[i] = v;                                                               \
+}                                                                           \
+                                                                            \
+static void name##_heap(type *a, size_t n)                                  \
+{                                                                           \
+    size_t i;                                                               \
+    type t;                                                                 \
+                                                                            \
+    for (i = n / 2; i > 0; --i) {                                           \
+        name##_sift(a, i - 1, n);                                           \
+    }                                                                       \
+    for (i = n - 1; i > 0; --i) {                                           \
+        t = a[0]; a[0] = a[i]; a[i] = t;                                    \
+        name##_sift(a, 0, i);                                               \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+static size_t name##_median(type *a, size_t i, size_t j, size_t k)          \
+{                                                                           \
+    if (less(a[i], a[j])) {                                                 \
+        return less(a[j], a[k]) ? j : (less(a[i], a[k]) ? k : i);           \
+    }                                                                       \
+    return less(a[i], a[k]) ? i : (less(a[j], a[k]) ? k : j);               \
+}                                                                           \
+                                                                            \
+static void name##_intro(type *a, size_t n, int depth)                      \
+{                                                                           \
+    size_t i, j, m, s;                                                      \
+    type p, t;                                                              \
+                                                                            \
+    while (n > SORT_INSERTION_MAX) {                                        \
+        if (depth-- == 0) {                                                 \
+            name##_heap(a, n);                                              \
+            return;                                                         \
+        }                                                                   \
+        m = n / 2;                                                          \
+        if (n >= SORT_NINTHER_MIN) {                                        \
+            s = n / 8;                                                      \
+            m = name##_median(a,                                            \
+                name##_median(a, 0, s, 2 * s),                              \
+                name##_median(a, m - s, m, m + s),                          \
+                name##_median(a, n - 1 - 2 * s, n - 1 - s, n - 1));         \
+        } else {                                                            \
+            m = name##_median(a, 0, m, n - 1);                              \
+        }                                                                   \
+        p = a[m];                                                           \
+        i = 0;                                                              \
+        j = n - 1;                                                          \
+        for (;;) {                                                          \
+            while (less(a[i], p)) i++;                                      \
+            while (less(p, a[j])) j--;                                      \
+            if (i >= j)                                                     \
+                break;                                                      \
+            t = a[i]; a[i] = a[j]; a[j] = t;                                \
+            i++;                                                            \
+            j--;                                                            \
+        }                                                                   \
+        /* Meeting on one element means it equals the pivot, so skip it. */ \
+        m = i == j ? j : j + 1;                                             \
+        i = j + 1;                                                          \
+        if (m < n - i) {                                                    \
+            name##_intro(a, m, depth);                                      \
+            a += i;                                                         \
+            n -= i;                                                         \
+        } else {                                                            \
+            name##_intro(a + i, n - i, depth);                              \
+            n = m;                                                          \
+        }                                                                   \
+    }                                                                       \
+    name##_insertion(a, n);                                                 \
+}                                                                           \
+                                                                            \
+INTERNAL void name(type *base, size_t n)                                    \
+{                                                                           \
+    int depth = 0;                                                          \
+    size_t k;                                                               \
+                                                                            \
+    for (k = n; k > 1; k >>= 1) {                                           \
+        depth += 2;                                                         \
+    }                                                                       \
+    name##_intro(base, n, depth);                                           \
+}                                                                           \
+/**/
+
+#define SORT_LESS(a, b)         ((a) < (b))
+#define SORT_LESS_DOUBLE(a, b)  ((a) < (b) || ((b) != (b) && (a) == (a)))
+#define SORT_LESS_STR(a, b)     (strcmp((a), (b)) < 0)
+
+typedef char *string_ptr;
+
+SORT_DEFINE(sort_int, int, SORT_LESS)
+SORT_DEFINE(sort_double, double, SORT_LESS_DOUBLE)
+SORT_DEFINE(sort_str, string_ptr, SORT_LESS_STR)
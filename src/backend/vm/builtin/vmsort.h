@@ -0,0 +1,21 @@
+#ifndef VMSORT_H
+#define VMSORT_H
+#if !defined(AMALGAMATION) || !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+
+#include <stddef.h>
+
+/*
+ * Sort arrays of a known element type in ascending order, comparing
+ * the elements directly instead of calling back into the script. Doubles
+ * order NaN after every number, and strings are compared by strcmp.
+ */
+INTERNAL void sort_int(int *base, size_t n);
+
+INTERNAL void sort_double(double *base, size_t n);
+
+INTERNAL void sort_str(char **base, size_t n);
+
+#endif
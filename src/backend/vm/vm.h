@@ -9,6 +9,13 @@ INTERNAL void add_import_module(const char *name);
 
 INTERNAL void add_ref_module(const char *name);
 
+/*
+ * Set up the table of builtin functions ahead of vm_init, letting the
+ * compile server share it with every request. Return 0 if the builtin
+ * library is not available.
+ */
+INTERNAL int vm_load_builtin(void);
+
 /* Set up virtual machine. */
 INTERNAL void vm_init(FILE *stream, const char *file);
 
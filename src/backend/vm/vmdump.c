@@ -356,6 +356,7 @@ INTERNAL void print_vm_instruction(struct vm_program *prog, struct vm_code *code
     case VM_SAVE_RETVAL: printf(IDT4 "%-24s\n", "save_retval");                 break;
     case VM_SETJMP: printf(IDT4 "%-24s\n", "setjmp");                           break;
     case VM_LONGJMP: printf(IDT4 "%-24s\n", "longjmp");                         break;
+    case VM_PROF:   printf(IDT4 "%-24s#%d\n", "prof", code->d.lindex);          break;
     }
 }
 
@@ -4,8 +4,10 @@
 # define EXTERNAL extern
 #endif
 #include "../x86_64/abi.h"
+#include "../profile.h"
 #include "vm.h"
 #include "vminstr.h"
+#include "../../util/report.h"
 #include <lacc/context.h>
 
 #include <kcs/assert.h>
@@ -21,6 +23,9 @@ static struct vm_context vm_ctx = {0};
 static struct vm_func_args_info vm_func_args = {0};
 static void *vm_builtin_library = NULL;
 
+/* First profile counter of current function, or -1 if not recording. */
+static int vm_prof_base = -1;
+
 typedef const char *(*vm_builtin_get_name_t)(int index);
 typedef vm_builtin_t (*vm_builtin_get_func_t)(int index);
 static vm_builtin_get_func_t builtin_get_func = NULL;
@@ -217,6 +222,16 @@ static void emit_vm_jmp(enum vm_opcode opcode, const char *label, int size)
     }));
 }
 
+static void emit_vm_prof(int counter)
+{
+    if (vm_prof_base >= 0) {
+        emit_vm_code(((struct vm_code){
+            .opcode = VM_PROF,
+            .d.lindex = vm_prof_base + counter,
+        }));
+    }
+}
+
 static void emit_vm_label(const char *name)
 {
     int index = array_len(&vm_ctx.labels);
@@ -310,7 +325,7 @@ static void emit_vm_load(struct var var)
                 (type != VMOP_VARFL || last->type == VMOP_FLT || last->type == VMOP_DBL) &&
                 last->d.addr.is_global == is_global_var && last->d.addr.size == size &&
                 last->d.addr.base == base && last->d.addr.offset == var.offset) {
-            if (is_temporary_var(var)) {
+            if (is_temporary_var(var) && var.symbol->reads < 2) {
                 array_pop_back(&vm_prog.code);  /* temporary var is not global. */
             }
             else {
@@ -811,6 +826,56 @@ static void vm_gen_string_array(struct var var, struct expression expr)
     }
 }
 
+static void count_temporary_read(struct var var)
+{
+    struct symbol *sym;
+
+    if ((var.kind == DIRECT || var.kind == DEREF) && var.symbol && is_temporary_var(var)) {
+        sym = (struct symbol *) var.symbol;
+        if (sym->reads < 2) {
+            sym->reads++;
+        }
+    }
+}
+
+static void count_expression_reads(struct expression expr)
+{
+    count_temporary_read(expr.l);
+    if (expr.op >= IR_OP_ADD) {
+        count_temporary_read(expr.r);
+    }
+}
+
+/*
+ * Count reads of each temporary. The value of a temporary read only
+ * once can be left on the stack instead of being stored, but common
+ * subexpression elimination can make a temporary read several times.
+ */
+static void count_temporary_reads(struct definition *def)
+{
+    int i, j;
+    struct block *node;
+    struct statement *s;
+
+    for (i = 0; i < array_len(&def->locals); ++i) {
+        array_get(&def->locals, i)->reads = 0;
+    }
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        node = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&node->code); ++j) {
+            s = &array_get(&node->code, j);
+            count_expression_reads(s->expr);
+            if (s->t.kind == DEREF) {
+                count_temporary_read(s->t);
+            }
+        }
+        if (node->jump[1] || node->has_return_value || node->has_jump_table) {
+            count_expression_reads(node->expr);
+        }
+    }
+}
+
 static void vm_gen_node(struct block *node)
 {
     int i;
@@ -821,6 +886,7 @@ static void vm_gen_node(struct block *node)
 
     node->color = BLACK;
     emit_vm_label(sym_name(node->label));
+    emit_vm_prof(node->index * 2);
     if (node->has_jump_table) {
         vm_gen_expr(node->expr);
         int len = array_len(&node->jump_table);
@@ -919,6 +985,7 @@ static void vm_gen_node(struct block *node)
         assert(node->jump[0]);
         vm_gen_expr(node->expr);
         emit_vm_jmp(VM_JNZ, sym_name(node->jump[1]->label), size_of(node->expr.type));
+        emit_vm_prof(node->index * 2 + 1);
         NEXT_BLOCK(0);
         NEXT_BLOCK(1);
     } else {
@@ -1155,11 +1222,14 @@ static void reassign_label_index()
 static void vm_fix_lir(void)
 {
     // array_len(&vm_ctx.imports) might be changed dynamically by VM_REFLIB.
+    phase_begin(PHASE_VM_IMPORT);
     for (int i = 0; i < array_len(&vm_ctx.imports); ++i) {
         String module = array_get(&vm_ctx.imports, i);
         vm_import_module(&vm_ctx, &vm_prog, &vm_glbl, module);
     }
 
+    phase_end(PHASE_VM_IMPORT);
+
     is_global_mode = 1;
     emit_vm_code(((struct vm_code){
         .opcode = VM_CALL,
@@ -1199,6 +1269,18 @@ static void vm_fix_lir(void)
         },
     }));
     emit_vm_code(((struct vm_code){ .opcode = VM_HALT }));
+
+    /* entry run on a runtime error, to flush the streams of the program. */
+    int flush = array_len(&vm_prog.code) + array_len(&vm_glbl.code);
+    emit_vm_code(((struct vm_code){
+        .opcode = VM_CALL,
+        .type = VMOP_FUNCNAME,
+        .d.addr = (struct vm_address){
+            .name = str_init("__kcc_flush_on_abort"),
+            .index = -1,
+        },
+    }));
+    emit_vm_code(((struct vm_code){ .opcode = VM_HALT }));
     is_global_mode = 0;
 
     /* update global variable size. */
@@ -1208,6 +1290,7 @@ static void vm_fix_lir(void)
 
     array_concat(&vm_prog.code, &vm_glbl.code);
     reassign_label_index();
+    vm_prog.flush_entry = array_get(&vm_prog.code, flush).index;
 }
 
 static void vm_setup_builtin(int index, const char *name)
@@ -1240,25 +1323,34 @@ INTERNAL void add_ref_module(const char *name)
     emit_vm_code(((struct vm_code){ .opcode = VM_REFLIB, .d.name = str_init(name) }));
 }
 
-INTERNAL void vm_init(FILE *stream, const char *file)
+INTERNAL int vm_load_builtin(void)
 {
-    int is_save = (file != NULL);
-    vm_ctx.stream = stream;
-    vm_ctx.file = file;
-
-    assert(!vm_prog.global);
+    if (builtin_get_func) return 1;
     vm_builtin_library = load_library("kcsbltin", 0);
-    if (!vm_builtin_library) return;
-    builtin_get_func = (vm_builtin_get_func_t)get_function(vm_builtin_library, "vm_get_builtin_by_index");
-    if (!builtin_get_func) return;
+    if (!vm_builtin_library) return 0;
+    vm_builtin_get_func_t get_func =
+        (vm_builtin_get_func_t)get_function(vm_builtin_library, "vm_get_builtin_by_index");
+    if (!get_func) return 0;
     vm_builtin_get_name_t builtin_get_name =
         (vm_builtin_get_name_t)get_function(vm_builtin_library, "vm_get_builtin_name_by_index");
-    if (!builtin_get_name) return;
+    if (!builtin_get_name) return 0;
     for (int i = 1; ; ++i) {
         const char *name = builtin_get_name(i);
         if (!name) break;
         vm_setup_builtin(-i, name);
     }
+    builtin_get_func = get_func;
+    return 1;
+}
+
+INTERNAL void vm_init(FILE *stream, const char *file)
+{
+    int is_save = (file != NULL);
+    vm_ctx.stream = stream;
+    vm_ctx.file = file;
+
+    assert(!vm_prog.global);
+    if (!vm_load_builtin()) return;
 
     vm_prog.global = calloc(1, VM_GLOBAL_MEM_SIZE);
     if (!is_save) {
@@ -1275,8 +1367,12 @@ INTERNAL void vm_init(FILE *stream, const char *file)
 
 INTERNAL void vm_gen_lir(struct definition *def)
 {
+    int n = array_len(&vm_prog.code);
     if (is_function(def->symbol->type)) {
+        vm_prof_base = (profile_is_recording() && context.target == TARGET_IR_RUN)
+            ? profile_register(def) : -1;
         vm_func_enter(def);
+        count_temporary_reads(def);
         vm_gen_node(def->body);
         struct vm_code* last = &array_back(&vm_prog.code);
         if (last->opcode != VM_RET) {
@@ -1286,12 +1382,16 @@ INTERNAL void vm_gen_lir(struct definition *def)
     else {
         vm_gen_data(def);
     }
+    report_count(COUNT_INSTRUCTIONS, array_len(&vm_prog.code) - n);
 }
 
 INTERNAL int vm_run_lir(void)
 {
     vm_fix_lir();
+    vm_prog.profile = profile_counters();
+    phase_begin(PHASE_EXECUTE);
     vm_run_lir_impl(&vm_prog, 0, vm_prog.global, vm_ctx.global_index);
+    phase_end(PHASE_EXECUTE);
     return 0;
 }
 
@@ -1328,5 +1428,7 @@ INTERNAL int vm_finalize_lir(void)
     array_clear(&vm_glbl.exec);
     free(vm_prog.global);
     if (vm_builtin_library) unload_library(vm_builtin_library);
+    vm_builtin_library = NULL;
+    builtin_get_func = NULL;
     return 0;
 }
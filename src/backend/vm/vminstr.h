@@ -53,6 +53,7 @@ enum vm_opcode {
     VM_SAVE_RETVAL,
     VM_SETJMP,
     VM_LONGJMP,
+    VM_PROF,
 };
 
 #if defined(__GNUC__)
@@ -104,6 +105,7 @@ enum vm_opcode {
         &&LABEL_VM_SAVE_RETVAL, \
         &&LABEL_VM_SETJMP, \
         &&LABEL_VM_LONGJMP, \
+        &&LABEL_VM_PROF, \
     };\
     /**/
 #define VM_START()      struct vm_code *code = base[ip];\
@@ -172,6 +174,7 @@ enum vm_opcode {
     VM_GOTO_L(VM_SAVE_RETVAL); \
     VM_GOTO_L(VM_SETJMP); \
     VM_GOTO_L(VM_LONGJMP); \
+    VM_GOTO_L(VM_PROF); \
     VM_GOTO_E();\
     /**/
 
@@ -263,6 +266,8 @@ struct vm_program {
     uint8_t *global;
     array_of(struct vm_code) code;
     array_of(struct vm_code*) exec;
+    uint64_t *profile;
+    int64_t flush_entry;    /* code flushing the streams on a runtime error, or 0 */
 };
 
 struct vm_context {
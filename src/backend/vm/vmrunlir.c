@@ -24,6 +24,7 @@ static int vm_return_value = 0;
 
 #define NULLCHK(addr) {\
     if ((void*)addr < (void*)0x1000 && (void*)0 <= (void*)addr) {\
+        flush_program(prog, stack, start, sp);\
         print_stack(stack, start, sp);\
         print_register(stack, sp, bp, gp);\
         error("Oops, null-pointer access.\n");\
@@ -171,12 +172,26 @@ static void check_point(struct vm_program *prog, struct vm_code *code, int64_t s
     #endif
 }
 
-static int run_vm_by_lir(struct vm_program *prog, int64_t ip, uint8_t *stack, int64_t bp)
+static int run_vm_by_lir(struct vm_program *prog, int64_t ip, uint8_t *stack, int64_t bp, int64_t sp);
+
+/*
+ * Write out the output buffered by the program before a runtime error
+ * is reported, running its flush code in a frame above the stack.
+ */
+static void flush_program(struct vm_program *prog, uint8_t *stack, int64_t start, int64_t sp)
+{
+    static int flushing = 0;
+    if (prog->flush_entry > 0 && !flushing) {
+        flushing = 1;
+        run_vm_by_lir(prog, prog->flush_entry, stack, start, sp);
+    }
+}
+
+static int run_vm_by_lir(struct vm_program *prog, int64_t ip, uint8_t *stack, int64_t bp, int64_t sp)
 {
     int64_t retval = 0;
     int32_t retsize;
     int64_t start = bp;
-    int64_t sp = bp;
     int64_t gp = bp + 8;
 
     KCCVM_DEFINE_DISPATCH_TABLE();
@@ -242,6 +257,7 @@ static int run_vm_by_lir(struct vm_program *prog, int64_t ip, uint8_t *stack, in
         case VMOP_BUILTIN: {
             vm_builtin_t func = code->d.addr.func;
             if (!func) {
+                flush_program(prog, stack, start, sp);
                 error("Oops, function(%s) is not available.\n", str_raw(code->d.addr.name));
                 exit(1);
             }
@@ -251,6 +267,7 @@ static int run_vm_by_lir(struct vm_program *prog, int64_t ip, uint8_t *stack, in
             break;
         }
         case VMOP_FUNCNAME:
+            flush_program(prog, stack, start, sp);
             error("Oops, function(%s) is not available.\n", str_raw(code->d.addr.name));
             exit(1);
             break;
@@ -856,6 +873,11 @@ static int run_vm_by_lir(struct vm_program *prog, int64_t ip, uint8_t *stack, in
         PUSHI(r);
         NEXT();
     }
+    VM_CASE_(VM_PROF): {
+        ++prog->profile[code->d.lindex];
+        ++ip;
+        NEXT();
+    }
     VM_CASE_DEFAULT:
         assert(0);
     }
@@ -877,7 +899,7 @@ INTERNAL int vm_run_lir_impl(struct vm_program *prog, int entry, uint8_t *global
     memcpy(stack, global, gsize);   /* global address is started from 0. */
     int stack_base = gsize + 1;
     stack_base = PAD_N(stack_base, 16);
-    vm_return_value = run_vm_by_lir(prog, entry, stack, stack_base);
+    vm_return_value = run_vm_by_lir(prog, entry, stack, stack_base, stack_base);
     free(stack);
     return 0;
 }
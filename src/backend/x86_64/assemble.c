@@ -22,6 +22,15 @@
 #define X1(instr, w, a)     out("\t%s%c\t%s\n", instr, X87SFX(w), a);
 #define Y1(instr, w, a)     out("\t%s%c\t%s\n", instr, X87IFX(w), a);
 
+/*
+ * Packed instructions on %ymm registers are VEX encoded, with 'v'
+ * prefix and destination repeated as first source operand.
+ */
+#define P2(instr, w, a, b) \
+    ((w) == 32 ? out("\tv%s\t%s, %s, %s\n", instr, a, b, b) : I2(instr, a, b))
+#define M2(instr, w, a, b) \
+    ((w) == 32 ? out("\tv%s\t%s, %s\n", instr, a, b) : I2(instr, a, b))
+
 #define MAX_OPERAND_TEXT_LENGTH 256
 
 static FILE *asm_output;
@@ -54,6 +63,13 @@ static const char *xmm_name[] = {
     "%xmm12", "%xmm13", "%xmm14", "%xmm15"
 };
 
+static const char *ymm_name[] = {
+    "%ymm0",  "%ymm1",  "%ymm2",  "%ymm3",
+    "%ymm4",  "%ymm5",  "%ymm6",  "%ymm7",
+    "%ymm8",  "%ymm9",  "%ymm10", "%ymm11",
+    "%ymm12", "%ymm13", "%ymm14", "%ymm15"
+};
+
 static const char *x87_name[] = {
     "%st(0)", "%st(1)", "%st(2)", "%st(3)",
     "%st(4)", "%st(5)", "%st(6)", "%st(7)"
@@ -84,7 +100,7 @@ static const char *mnemonic(struct registr reg)
 
         return reg_name[i + j];
     } else if (reg.r < ST0) {
-        return xmm_name[reg.r - XMM0];
+        return (reg.w == 32 ? ymm_name : xmm_name)[reg.r - XMM0];
     } else {
         i = x87_stack_pos(reg.r);
         return x87_name[i];
@@ -423,7 +439,7 @@ INTERNAL int asm_text(struct instruction instr)
     case INSTR_LEA:      U2("lea", wd, source, destin); break;
     case INSTR_PUSH:     U1("push", ws, source); break;
     case INSTR_POP:      U1("pop", ws, source); break;
-    case INSTR_PXOR:     I2("pxor", source, destin); break;
+    case INSTR_PXOR:     P2("pxor", wd, source, destin); break;
     case INSTR_JMP:      I1("jmp", source); break;
     case INSTR_JE:       I1("je", source); break;
     case INSTR_JA:       I1("ja", source); break;
@@ -465,6 +481,34 @@ INTERNAL int asm_text(struct instruction instr)
     case INSTR_FSUBRP:   I1("fsubrp", source); break;
     case INSTR_FMULP:    I1("fmulp", source); break;
     case INSTR_FDIVRP:   I1("fdivrp", source); break;
+    case INSTR_MOVD:     I2(ws == 8 || wd == 8 ? "movq" : "movd", source, destin); break;
+    case INSTR_MOVDQU:   M2("movdqu", ws | wd, source, destin); break;
+    case INSTR_MOVUPS:   M2("movups", ws | wd, source, destin); break;
+    case INSTR_PADDD:    P2("paddd", wd, source, destin); break;
+    case INSTR_PADDQ:    P2("paddq", wd, source, destin); break;
+    case INSTR_PSUBD:    P2("psubd", wd, source, destin); break;
+    case INSTR_PSUBQ:    P2("psubq", wd, source, destin); break;
+    case INSTR_PMULLD:   P2("pmulld", wd, source, destin); break;
+    case INSTR_PAND:     P2("pand", wd, source, destin); break;
+    case INSTR_POR:      P2("por", wd, source, destin); break;
+    case INSTR_PSHUFD:
+        out("\tpshufd\t%s, %s, %s\n", source, destin, destin);
+        break;
+    case INSTR_ADDPS:    P2("addps", wd, source, destin); break;
+    case INSTR_ADDPD:    P2("addpd", wd, source, destin); break;
+    case INSTR_SUBPS:    P2("subps", wd, source, destin); break;
+    case INSTR_SUBPD:    P2("subpd", wd, source, destin); break;
+    case INSTR_MULPS:    P2("mulps", wd, source, destin); break;
+    case INSTR_MULPD:    P2("mulpd", wd, source, destin); break;
+    case INSTR_DIVPS:    P2("divps", wd, source, destin); break;
+    case INSTR_DIVPD:    P2("divpd", wd, source, destin); break;
+    case INSTR_VEXTRACTI128:
+        out("\tvextracti128\t$1, %s, %s\n", source, destin);
+        break;
+    case INSTR_VINSERTI128:
+        out("\tvinserti128\t$1, %s, %s, %s\n", source, destin, destin);
+        break;
+    case INSTR_VZEROUPPER: I0("vzeroupper"); break;
 
     case INSTR_BUILTIN:  I0("(builtin)");
     }
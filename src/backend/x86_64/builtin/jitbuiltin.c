@@ -13,9 +13,12 @@
 
 #include "../jit.h"
 #include "../../vm/builtin/vmacpconv.h"
+#include "../../vm/builtin/vmformat.h"
+#include "../../vm/builtin/vmsort.h"
 #include <lacc/array.h>
 #include <kcs/dll.h>
 #include <math.h>
+#include <stdarg.h>
 #include <time.h>
 
 /* #define DEBUG_BUILTIN */
@@ -174,7 +177,7 @@ static int jit_call_builtin_sprintf_s(const char *fmt, char *v, char *dst)
     #endif
 }
 
-static int jit_call_builtin_strlen(const char *str)
+static size_t jit_call_builtin_strlen(const char *str)
 {
     return strlen(str);
 }
@@ -204,6 +207,76 @@ static void *jit_call_builtin_memmove(void *dst, void *src, size_t size)
     return memmove(dst, src, size);
 }
 
+static char *jit_call_builtin_strcat(char *dst, const char *src)
+{
+    return strcat(dst, src);
+}
+
+static char *jit_call_builtin_strncat(char *dst, const char *src, size_t len)
+{
+    return strncat(dst, src, len);
+}
+
+static int jit_call_builtin_strcmp(const char *s1, const char *s2)
+{
+    return strcmp(s1, s2);
+}
+
+static int jit_call_builtin_strncmp(const char *s1, const char *s2, size_t len)
+{
+    return strncmp(s1, s2, len);
+}
+
+static char *jit_call_builtin_strchr(const char *s, int c)
+{
+    return (char *)strchr(s, c);
+}
+
+static char *jit_call_builtin_strrchr(const char *s, int c)
+{
+    return (char *)strrchr(s, c);
+}
+
+static char *jit_call_builtin_strstr(const char *s1, const char *s2)
+{
+    return (char *)strstr(s1, s2);
+}
+
+static size_t jit_call_builtin_strspn(const char *s1, const char *s2)
+{
+    return strspn(s1, s2);
+}
+
+static size_t jit_call_builtin_strcspn(const char *s1, const char *s2)
+{
+    return strcspn(s1, s2);
+}
+
+static int jit_call_builtin_memcmp(const void *s1, const void *s2, size_t len)
+{
+    return memcmp(s1, s2, len);
+}
+
+static void *jit_call_builtin_memchr(const void *s, int c, size_t len)
+{
+    return (void *)memchr(s, c, len);
+}
+
+static void jit_call_builtin_qsort_int(int *base, size_t n)
+{
+    sort_int(base, n);
+}
+
+static void jit_call_builtin_qsort_double(double *base, size_t n)
+{
+    sort_double(base, n);
+}
+
+static void jit_call_builtin_qsort_str(char **base, size_t n)
+{
+    sort_str(base, n);
+}
+
 static void jit_call_builtin_exit(int status)
 {
     exit(status);
@@ -346,6 +419,136 @@ static void *jit_call_builtin_call_p(void *handle, const char *funcname)
     return NULL;
 }
 
+static void *jit_call_builtin_getfunc(void *handle, const char *funcname)
+{
+    return get_function(handle, funcname);
+}
+
+static void jit_call_builtin_invoke(void *func)
+{
+    void (*f)(int, arg_type_t*) = (void (*)(int, arg_type_t*))func;
+    if (f) {
+        f(g_lib_argc, g_lib_argv);
+    } else {
+        jit_call_builtin_abort();
+    }
+}
+
+static int jit_call_builtin_invoke_i(void *func)
+{
+    int (*f)(int, arg_type_t*) = (int (*)(int, arg_type_t*))func;
+    if (f) {
+        return f(g_lib_argc, g_lib_argv);
+    } else {
+        jit_call_builtin_abort();
+    }
+    return 0;
+}
+
+static double jit_call_builtin_invoke_d(void *func)
+{
+    double (*f)(int, arg_type_t*) = (double (*)(int, arg_type_t*))func;
+    if (f) {
+        return f(g_lib_argc, g_lib_argv);
+    } else {
+        jit_call_builtin_abort();
+    }
+    return 0.0;
+}
+
+static void *jit_call_builtin_invoke_p(void *func)
+{
+    void *(*f)(int, arg_type_t*) = (void *(*)(int, arg_type_t*))func;
+    if (f) {
+        return f(g_lib_argc, g_lib_argv);
+    } else {
+        jit_call_builtin_abort();
+    }
+    return NULL;
+}
+
+/*
+ * Same as the VM builtin, for scripts calling it directly. Code compiled
+ * by the JIT can call typed extension functions through a pointer.
+ */
+#if !defined(KCC_WINDOWS)
+typedef int64_t (*jit_ffi_func_i_t)(
+    int64_t, int64_t, int64_t, int64_t, int64_t, int64_t,
+    double, double, double, double, double, double, double, double);
+typedef double (*jit_ffi_func_d_t)(
+    int64_t, int64_t, int64_t, int64_t, int64_t, int64_t,
+    double, double, double, double, double, double, double, double);
+
+static void jit_ffi_call(void *f, const char *sig, va_list ap, int64_t *ri, double *rd)
+{
+    int64_t i[FFI_MAX_INT_ARGS] = {0};
+    double d[FFI_MAX_SSE_ARGS] = {0};
+    int ni = 0, nd = 0;
+    union { double d; float f; } fv;
+
+    if (!f || !sig) {
+        jit_call_builtin_abort();
+    }
+    for (; *sig; ++sig) {
+        if (*sig == 'd' || *sig == 'f') {
+            if (nd == FFI_MAX_SSE_ARGS) {
+                jit_call_builtin_abort();
+            }
+            if (*sig == 'f') {
+                fv.d = 0;
+                fv.f = (float)va_arg(ap, double);
+                d[nd++] = fv.d;
+            } else {
+                d[nd++] = va_arg(ap, double);
+            }
+        } else {
+            if (ni == FFI_MAX_INT_ARGS) {
+                jit_call_builtin_abort();
+            }
+            i[ni++] = va_arg(ap, int64_t);
+        }
+    }
+
+    if (rd) {
+        *rd = ((jit_ffi_func_d_t)f)(i[0], i[1], i[2], i[3], i[4], i[5],
+            d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+    } else {
+        *ri = ((jit_ffi_func_i_t)f)(i[0], i[1], i[2], i[3], i[4], i[5],
+            d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7]);
+    }
+}
+#else
+static void jit_ffi_call(void *f, const char *sig, va_list ap, int64_t *ri, double *rd)
+{
+    jit_call_builtin_abort();
+}
+#endif
+
+static int64_t jit_call_builtin_ffi_i(void *f, const char *sig, ...)
+{
+    int64_t r;
+    va_list ap;
+    va_start(ap, sig);
+    jit_ffi_call(f, sig, ap, &r, NULL);
+    va_end(ap);
+    return r;
+}
+
+static double jit_call_builtin_ffi_d(void *f, const char *sig, ...)
+{
+    double r;
+    va_list ap;
+    va_start(ap, sig);
+    jit_ffi_call(f, sig, ap, NULL, &r);
+    va_end(ap);
+    return r;
+}
+
+static int jit_call_builtin_vformat(char *buf, size_t size, const char *fmt, void *ap)
+{
+    return format_sysv(buf, size, fmt, ap);
+}
+
 static uint64_t jit_call_builtin_time(uint64_t *timer)
 {
     if (timer) {
@@ -484,6 +687,29 @@ struct jit_builtin_def_t {
     { "__kcc_builtin_time",         time,                               1,  0x00    },
     { "__kcc_builtin_gmtime_init",  jit_call_builtin_gmtime_init,       2,  0x00    },
     { "__kcc_builtin_gmtime",       jit_call_builtin_gmtime,            2,  0x00    },
+
+    { "__kcc_builtin_getfunc",      jit_call_builtin_getfunc,           2,  0x00    },
+    { "__kcc_builtin_invoke",       jit_call_builtin_invoke,            1,  0x00    },
+    { "__kcc_builtin_invoke_i",     jit_call_builtin_invoke_i,          1,  0x00    },
+    { "__kcc_builtin_invoke_d",     jit_call_builtin_invoke_d,          1,  0x00    },
+    { "__kcc_builtin_invoke_p",     jit_call_builtin_invoke_p,          1,  0x00    },
+    { "__kcc_builtin_ffi_i",        jit_call_builtin_ffi_i,             2,  0x00    },
+    { "__kcc_builtin_ffi_d",        jit_call_builtin_ffi_d,             2,  0x00    },
+    { "__kcc_builtin_vformat",      jit_call_builtin_vformat,           4,  0x00    },
+    { "__kcc_builtin_strcat",       jit_call_builtin_strcat,            2,  0x00    },
+    { "__kcc_builtin_strncat",      jit_call_builtin_strncat,           3,  0x00    },
+    { "__kcc_builtin_strcmp",       jit_call_builtin_strcmp,            2,  0x00    },
+    { "__kcc_builtin_strncmp",      jit_call_builtin_strncmp,           3,  0x00    },
+    { "__kcc_builtin_strchr",       jit_call_builtin_strchr,            2,  0x00    },
+    { "__kcc_builtin_strrchr",      jit_call_builtin_strrchr,           2,  0x00    },
+    { "__kcc_builtin_strstr",       jit_call_builtin_strstr,            2,  0x00    },
+    { "__kcc_builtin_strspn",       jit_call_builtin_strspn,            2,  0x00    },
+    { "__kcc_builtin_strcspn",      jit_call_builtin_strcspn,           2,  0x00    },
+    { "__kcc_builtin_memcmp",       jit_call_builtin_memcmp,            3,  0x00    },
+    { "__kcc_builtin_memchr",       jit_call_builtin_memchr,            3,  0x00    },
+    { "__kcc_builtin_qsort_int",    jit_call_builtin_qsort_int,         2,  0x00    },
+    { "__kcc_builtin_qsort_double", jit_call_builtin_qsort_double,      2,  0x00    },
+    { "__kcc_builtin_qsort_str",    jit_call_builtin_qsort_str,         2,  0x00    },
 };
 
 DLLEXPORT int jit_get_builtin_index(const char *name)
@@ -6,6 +6,7 @@
 #include "abi.h"
 #include "elf.h"
 #include "dwarf.h"
+#include "../../util/report.h"
 #include <lacc/array.h>
 #include <lacc/context.h>
 
@@ -648,6 +649,7 @@ INTERNAL int elf_text(struct instruction instr)
     if (c.val[0] != 0x90) {
         elf_section_write(shid_text, &c.val, c.len);
         current_function_entry->st_size += c.len;
+        report_count(COUNT_BYTES, c.len);
     }
 
     return 0;
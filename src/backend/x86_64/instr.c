@@ -158,8 +158,12 @@ static void encode_addr(
 
         /* SIB */
         if (addr.offset) {
-            assert(!is_64_bit_reg(addr.base));
-            c->val[c->len++] = ((addr.offset - 1) << 3) | (addr.base - 1);
+            assert(!is_64_bit_reg(addr.offset));
+            c->val[c->len++] =
+                  (addr.mult == 8 ? 0xC0 : addr.mult == 4 ? 0x80
+                    : addr.mult == 2 ? 0x40 : 0x00)
+                | ((addr.offset - 1) << 3)
+                | ((addr.base - 1) % 8);
         }
 
         /* Displacement */
@@ -1061,6 +1065,212 @@ static struct code pxor(
     return c;
 }
 
+/*
+ * Opcode maps for packed instructions, selected by escape bytes 0F,
+ * 0F 38 and 0F 3A in legacy encoding, or the m-mmmm field of VEX.
+ */
+enum opcode_map {
+    MAP_0F = 1,
+    MAP_0F38 = 2,
+    MAP_0F3A = 3
+};
+
+/*
+ * VEX prefix, replacing legacy prefix, REX and escape bytes. The two
+ * byte form is used when possible. Only registers below %xmm8 are
+ * supported, so R and X extensions are never set.
+ *
+ *  C5 [ ~R, ~vvvv, L, pp ]
+ *  C4 [ ~R, ~X, ~B, mmmmm ] [ W, ~vvvv, L, pp ]
+ */
+static void vex(
+    struct code *c,
+    uint8_t prefix,
+    enum opcode_map map,
+    int b,
+    int vvvv,
+    int l)
+{
+    int pp;
+
+    pp = (prefix == 0x66) ? 1 : (prefix == 0xF3) ? 2 : (prefix == 0xF2) ? 3 : 0;
+    if (map == MAP_0F && !b) {
+        c->val[c->len++] = 0xC5;
+        c->val[c->len++] = 0x80 | (~vvvv & 0xF) << 3 | l << 2 | pp;
+    } else {
+        c->val[c->len++] = 0xC4;
+        c->val[c->len++] = 0xC0 | (!b) << 5 | map;
+        c->val[c->len++] = (~vvvv & 0xF) << 3 | l << 2 | pp;
+    }
+}
+
+/*
+ * Encode packed operation on xmm or ymm registers, where the width of
+ * the register operands select between SSE and VEX encoding.
+ *
+ * Register or memory source a, register destination b. Stores have
+ * register source a and memory destination b. With VEX encoding the
+ * destination is also the first source operand, unless the instruction
+ * is a plain move (nds = 0).
+ */
+static struct code sse_packed(
+    enum instr_optype optype,
+    uint8_t prefix,
+    enum opcode_map map,
+    uint8_t opcode,
+    int nds,
+    union operand a,
+    union operand b)
+{
+    struct code c = {0};
+    struct registr r;
+    struct address addr = {0};
+    int is_mem;
+
+    is_mem = optype != OPT_REG_REG;
+    switch (optype) {
+    default: assert(0);
+    case OPT_REG_REG:
+        r = b.reg;
+        assert(a.reg.w == b.reg.w);
+        break;
+    case OPT_MEM_REG:
+        r = b.reg;
+        addr = a.mem.addr;
+        break;
+    case OPT_REG_MEM:
+        r = a.reg;
+        addr = b.mem.addr;
+        break;
+    }
+
+    assert(r.w == 16 || r.w == 32);
+    assert(r.r >= XMM0 && r.r <= XMM7);
+    if (r.w == 32) {
+        vex(&c, prefix, map, is_mem && mrex(addr), nds ? regi(r) : 0, 1);
+    } else {
+        if (prefix) {
+            c.val[c.len++] = prefix;
+        }
+        if (is_mem && mrex(addr)) {
+            c.val[c.len++] = REX | mrex(addr);
+        }
+        c.val[c.len++] = PREFIX_SSE;
+        if (map == MAP_0F38) {
+            c.val[c.len++] = 0x38;
+        } else if (map == MAP_0F3A) {
+            c.val[c.len++] = 0x3A;
+        }
+    }
+
+    c.val[c.len++] = opcode;
+    if (is_mem) {
+        encode_addr(&c, regi(r), addr, 0, 0);
+    } else {
+        c.val[c.len++] = 0xC0 | (regi(b.reg) << 3) | regi(a.reg);
+    }
+
+    return c;
+}
+
+/* Unaligned packed load, store or register move. */
+static struct code sse_packed_mov(
+    enum instr_optype optype,
+    uint8_t prefix,
+    uint8_t load,
+    uint8_t store,
+    union operand a,
+    union operand b)
+{
+    uint8_t opcode = (optype == OPT_REG_MEM) ? store : load;
+    return sse_packed(optype, prefix, MAP_0F, opcode, 0, a, b);
+}
+
+/*
+ * Move doubleword or quadword between general purpose register and the
+ * low element of xmm register, 66 [REX.W] 0F 6E/7E.
+ */
+static struct code movd(
+    enum instr_optype optype,
+    union operand a,
+    union operand b)
+{
+    struct code c = {0};
+    struct registr gp, xmm;
+    int to_xmm;
+
+    assert(optype == OPT_REG_REG);
+    to_xmm = is_sse_reg(b.reg);
+    gp = to_xmm ? a.reg : b.reg;
+    xmm = to_xmm ? b.reg : a.reg;
+    assert(gp.w == 4 || gp.w == 8);
+    assert(xmm.r >= XMM0 && xmm.r <= XMM7);
+
+    c.val[c.len++] = 0x66;
+    if (is_64_bit(gp) || is_64_bit_reg(gp.r)) {
+        c.val[c.len++] = REX | W(gp) | B(gp);
+    }
+    c.val[c.len++] = PREFIX_SSE;
+    c.val[c.len++] = to_xmm ? 0x6E : 0x7E;
+    c.val[c.len++] = 0xC0 | (regi(xmm) << 3) | regi(gp);
+    return c;
+}
+
+/* Shuffle packed doublewords in place, 66 0F 70 /r ib. */
+static struct code pshufd(
+    enum instr_optype optype,
+    union operand a,
+    union operand b)
+{
+    struct code c;
+
+    assert(optype == OPT_IMM_REG);
+    assert(a.imm.type == IMM_INT);
+    assert(b.reg.w == 16);
+    c = sse_packed(OPT_REG_REG, 0x66, MAP_0F, 0x70, 0, b, b);
+    c.val[c.len++] = a.imm.d.byte;
+    return c;
+}
+
+/*
+ * Move upper 128 bits of %ymm in a to %xmm in b, or insert %xmm in a as
+ * upper 128 bits of %ymm in b. Selector immediate is always 1.
+ */
+static struct code avx_lane(
+    enum instr_optype optype,
+    uint8_t opcode,
+    union operand a,
+    union operand b)
+{
+    struct code c = {0};
+    struct registr r, rm;
+
+    assert(optype == OPT_REG_REG);
+    if (opcode == 0x39) {
+        assert(a.reg.w == 32 && b.reg.w == 16);
+        r = a.reg;
+        rm = b.reg;
+        vex(&c, 0x66, MAP_0F3A, 0, 0, 1);
+    } else {
+        assert(opcode == 0x38);
+        assert(a.reg.w == 16 && b.reg.w == 32);
+        r = b.reg;
+        rm = a.reg;
+        vex(&c, 0x66, MAP_0F3A, 0, regi(b.reg), 1);
+    }
+
+    c.val[c.len++] = opcode;
+    c.val[c.len++] = 0xC0 | (regi(r) << 3) | regi(rm);
+    c.val[c.len++] = 1;
+    return c;
+}
+
+static struct code vzeroupper(void)
+{
+    struct code c = {{0xC5, 0xF8, 0x77}, 3};
+    return c;
+}
+
 static struct code fucomip(union operand op)
 {
     struct code c = {0};
@@ -1269,6 +1479,10 @@ INTERNAL struct code encode(struct instruction instr)
     case INSTR_POP:
         return encode_pop(instr.optype, instr.source);
     case INSTR_PXOR:
+        if (instr.optype == OPT_REG_REG && instr.source.reg.w >= 16) {
+            return sse_packed(instr.optype, 0x66, MAP_0F, 0xEF, 1,
+                instr.source, instr.dest);
+        }
         return pxor(instr.optype, instr.source, instr.dest);
     case INSTR_SUB:
         return encode_sub(instr.optype, instr.source, instr.dest);
@@ -1372,5 +1586,66 @@ INTERNAL struct code encode(struct instruction instr)
         return x87_encode_arithmetic(0xC8, instr.source);
     case INSTR_FDIVRP:
         return x87_encode_arithmetic(0xF8, instr.source);
+    case INSTR_MOVD:
+        return movd(instr.optype, instr.source, instr.dest);
+    case INSTR_MOVDQU:
+        return sse_packed_mov(instr.optype, 0xF3, 0x6F, 0x7F,
+            instr.source, instr.dest);
+    case INSTR_MOVUPS:
+        return sse_packed_mov(instr.optype, 0x00, 0x10, 0x11,
+            instr.source, instr.dest);
+    case INSTR_PADDD:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0xFE, 1,
+            instr.source, instr.dest);
+    case INSTR_PADDQ:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0xD4, 1,
+            instr.source, instr.dest);
+    case INSTR_PSUBD:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0xFA, 1,
+            instr.source, instr.dest);
+    case INSTR_PSUBQ:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0xFB, 1,
+            instr.source, instr.dest);
+    case INSTR_PMULLD:
+        return sse_packed(instr.optype, 0x66, MAP_0F38, 0x40, 1,
+            instr.source, instr.dest);
+    case INSTR_PAND:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0xDB, 1,
+            instr.source, instr.dest);
+    case INSTR_POR:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0xEB, 1,
+            instr.source, instr.dest);
+    case INSTR_PSHUFD:
+        return pshufd(instr.optype, instr.source, instr.dest);
+    case INSTR_ADDPS:
+        return sse_packed(instr.optype, 0x00, MAP_0F, 0x58, 1,
+            instr.source, instr.dest);
+    case INSTR_ADDPD:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0x58, 1,
+            instr.source, instr.dest);
+    case INSTR_SUBPS:
+        return sse_packed(instr.optype, 0x00, MAP_0F, 0x5C, 1,
+            instr.source, instr.dest);
+    case INSTR_SUBPD:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0x5C, 1,
+            instr.source, instr.dest);
+    case INSTR_MULPS:
+        return sse_packed(instr.optype, 0x00, MAP_0F, 0x59, 1,
+            instr.source, instr.dest);
+    case INSTR_MULPD:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0x59, 1,
+            instr.source, instr.dest);
+    case INSTR_DIVPS:
+        return sse_packed(instr.optype, 0x00, MAP_0F, 0x5E, 1,
+            instr.source, instr.dest);
+    case INSTR_DIVPD:
+        return sse_packed(instr.optype, 0x66, MAP_0F, 0x5E, 1,
+            instr.source, instr.dest);
+    case INSTR_VEXTRACTI128:
+        return avx_lane(instr.optype, 0x39, instr.source, instr.dest);
+    case INSTR_VINSERTI128:
+        return avx_lane(instr.optype, 0x38, instr.source, instr.dest);
+    case INSTR_VZEROUPPER:
+        return vzeroupper();
     }
 }
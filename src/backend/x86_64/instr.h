@@ -206,6 +206,34 @@ enum opcode {
     INSTR_FDIVRP,       /* Divide and pop. */
     INSTR_INC,
     INSTR_DEC,
+
+    /*
+     * Packed instructions used by the loop vectorizer. Register operands
+     * have width 16 for SSE2 encoding on %xmm, or width 32 for VEX (AVX2)
+     * encoding on %ymm.
+     */
+    INSTR_MOVD,         /* Move between general purpose and xmm register. */
+    INSTR_MOVDQU,       /* Move unaligned packed integers. */
+    INSTR_MOVUPS,       /* Move unaligned packed single-precision. */
+    INSTR_PADDD,
+    INSTR_PADDQ,
+    INSTR_PSUBD,
+    INSTR_PSUBQ,
+    INSTR_PMULLD,       /* Multiply packed dword, low result (SSE4.1). */
+    INSTR_PAND,
+    INSTR_POR,
+    INSTR_PSHUFD,       /* Shuffle dwords in place, immediate selector. */
+    INSTR_ADDPS,
+    INSTR_ADDPD,
+    INSTR_SUBPS,
+    INSTR_SUBPD,
+    INSTR_MULPS,
+    INSTR_MULPD,
+    INSTR_DIVPS,
+    INSTR_DIVPD,
+    INSTR_VEXTRACTI128, /* Extract upper half of %ymm to %xmm. */
+    INSTR_VINSERTI128,  /* Insert %xmm as upper half of %ymm. */
+    INSTR_VZEROUPPER,
     INSTR_BUILTIN,
 };
 
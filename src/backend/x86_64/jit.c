@@ -9,6 +9,7 @@
 #include "assemble.h"
 #include "jit_util.h"
 #include "jit.h"
+#include "../../util/report.h"
 #include <lacc/array.h>
 #include <lacc/context.h>
 #include <kcs/assert.h>
@@ -130,6 +131,7 @@ static jit_builtin_get_func_t builtin_get_func = NULL;
 
 static void jit_setup_builtin(void)
 {
+    if (jit_builtin_library) return;
     jit_builtin_library = load_library("kcsjit", 0);
     if (!jit_builtin_library) return;
     builtin_get_func = (jit_builtin_get_func_t)get_function(jit_builtin_library, "jit_get_builtin_by_index");
@@ -196,7 +198,7 @@ static void jit_update_jump(int len)
                 } else {
                     // src.
                     n = jc->code.len - 4;
-                    if (jc->instr.optype == OPT_MEM_REG) {
+                    if (jc->instr.optype == OPT_MEM_REG || jc->instr.optype == OPT_MEM) {
                         if (jc->instr.source.mem.addr.disp) {
                             d += jc->instr.source.mem.addr.disp;
                         }
@@ -802,6 +804,11 @@ static void jit_gen_builtin_startup()
     jit_addr = base;
 }
 
+INTERNAL void jit_load_builtin(void)
+{
+    jit_setup_builtin();
+}
+
 INTERNAL void jit_init(void)
 {
     jit_setup_builtin();
@@ -893,6 +900,7 @@ INTERNAL int jit_text(struct instruction instr)
 {
     struct code c = encode(instr);
     int base = jit_addr + c.len;
+    report_count(COUNT_BYTES, c.len);
     array_push_back(&jit.jcode, ((struct jit_code){
         .addr = jit_addr,
         .base = base,
@@ -1076,10 +1084,15 @@ DEF_GET_REGISTER(r15, 0x4c, 0x89, 0xf8, 0xC3);
 
 INTERNAL int jit_run(void)
 {
-    int main_found = jit_fix_code();
+    int main_found;
+
+    phase_begin(PHASE_JIT_RELOCATE);
+    main_found = jit_fix_code();
+    phase_end(PHASE_JIT_RELOCATE);
     // jit_print_code();
     // printf("%08p\n", jit.buffer);
     if (main_found) {
+        phase_begin(PHASE_EXECUTE);
         // initialize
         void (*onstart)(void) = (void (*)(void))jit_get_builtin_function("__kcc_builtin_onstart");
         if (onstart) {
@@ -1098,13 +1111,16 @@ INTERNAL int jit_run(void)
         if (onexit) {
             onexit();
         }
+        phase_end(PHASE_EXECUTE);
     }
     return 0;
 }
 
 INTERNAL int jit_print(void)
 {
+    phase_begin(PHASE_JIT_RELOCATE);
     jit_fix_code();
+    phase_end(PHASE_JIT_RELOCATE);
     jit_print_code();
     return 0;
 }
@@ -1116,6 +1132,7 @@ INTERNAL int jit_finalize(void)
     array_clear(&jit.labels);
     array_clear(&jit.jcode);
     if (jit_builtin_library) unload_library(jit_builtin_library);
+    jit_builtin_library = NULL;
     return 0;
 }
 
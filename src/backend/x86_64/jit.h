@@ -5,6 +5,12 @@
 
 #include <stdio.h>
 
+/*
+ * Set up the table of builtin functions ahead of jit_init, letting the
+ * compile server share it with every request.
+ */
+INTERNAL void jit_load_builtin(void);
+
 /* Call once on startup. */
 INTERNAL void jit_init(void);
 
@@ -3,9 +3,13 @@
 # define INTERNAL static
 # define EXTERNAL static
 # include "context.c"
+# include "util/arena.c"
 # include "util/argparse.c"
 # include "util/hash.c"
+# include "util/report.c"
+# include "util/server.c"
 # include "util/string.c"
+# include "util/thread.c"
 # include "backend/x86_64/instr.c"
 # include "backend/x86_64/dwarf.c"
 # include "backend/x86_64/elf.c"
@@ -15,9 +19,12 @@
 # include "backend/vm/vmrunlir.c"
 # include "backend/vm/vmbuiltin.c"
 # include "backend/vm/vmdump.c"
+# include "backend/profile.c"
 # include "backend/compile.c"
 # include "backend/graphviz/dot.c"
 # include "backend/linker.c"
+# include "optimizer/cse.c"
+# include "optimizer/ipcp.c"
 # include "optimizer/transform.c"
 # include "optimizer/liveness.c"
 # include "optimizer/optimize.c"
@@ -27,6 +34,7 @@
 # include "preprocessor/directive.c"
 # include "preprocessor/preprocess.c"
 # include "preprocessor/macro.c"
+# include "preprocessor/prelude.c"
 # include "parser/typetree.c"
 # include "parser/symtab.c"
 # include "parser/parse.c"
@@ -39,9 +47,11 @@
 # define INTERNAL
 # define EXTERNAL extern
 # include "backend/compile.h"
+# include "backend/profile.h"
 # include "backend/x86_64/jit.h"
 # include "backend/linker.h"
 # include "backend/vm/vm.h"
+# include "optimizer/ipcp.h"
 # include "optimizer/optimize.h"
 # include "parser/parse.h"
 # include "parser/symtab.h"
@@ -49,7 +59,11 @@
 # include "preprocessor/preprocess.h"
 # include "preprocessor/input.h"
 # include "preprocessor/macro.h"
+# include "preprocessor/prelude.h"
 # include "util/argparse.h"
+# include "util/report.h"
+# include "util/server.h"
+# include "util/thread.h"
 # include <lacc/context.h>
 # include <lacc/ir.h>
 #endif
@@ -57,6 +71,10 @@
 #include <kcs/assert.h>
 #include <ctype.h>
 #include <stdio.h>
+#if !defined(KCC_WINDOWS)
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 #include <xunistd.h>
 
 /*
@@ -82,6 +100,9 @@
 
 #define KCC_END_OF_PARSE (2)
 
+/* Maximum number of definitions optimized in parallel. */
+#define MAX_BATCH (64)
+
 struct input_file {
     const char *name;
     const char *output_name;
@@ -91,7 +112,11 @@ struct input_file {
 
 static const char *program, *output_name;
 static int optimization_level;
+static int parallel_jobs;
+static int parallel_units = 1;
 static int dump_symbols, dump_types;
+static int prelude_snapshot = 1;
+static int time_report, memory_report;
 
 static int object_file_count;
 static array_of(struct input_file) input_files;
@@ -171,7 +196,15 @@ static int option(const char *arg)
         if (!strcmp("PIC", arg)) {
             context.pic = !disable;
         } else if (!strcmp("fast-math", arg)) {
-            /* Always slow... */
+            context.fast_math = !disable;
+        } else if (!strcmp("vectorize", arg)) {
+            context.vectorize = !disable;
+        } else if (!strcmp("prelude-snapshot", arg)) {
+            prelude_snapshot = !disable;
+        } else if (!strcmp("time-report", arg)) {
+            time_report = !disable;
+        } else if (!strcmp("mem-report", arg)) {
+            memory_report = !disable;
         } else if (!strcmp("strict-aliasing", arg)) {
             /* We don't consider aliasing. */
         } else assert(0);
@@ -182,9 +215,34 @@ static int option(const char *arg)
     return 0;
 }
 
-/* Accept anything for -march. */
+/*
+ * Accept anything for -march, but enable AVX2 code generation for CPU
+ * names known to support it. With -march=native, ask the host.
+ */
 static int set_cpu(const char *arg)
 {
+    static const char *avx2_cpus[] = {
+        "haswell", "broadwell", "skylake", "skylake-avx512", "cascadelake",
+        "icelake-client", "icelake-server", "tigerlake", "alderlake",
+        "raptorlake", "sapphirerapids", "znver1", "znver2", "znver3",
+        "znver4", "x86-64-v3", "x86-64-v4", NULL
+    };
+    int i;
+
+    context.avx2 = 0;
+    if (!strcmp("native", arg)) {
+#if defined(__GNUC__) && !defined(KCC_WINDOWS)
+        context.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    } else {
+        for (i = 0; avx2_cpus[i]; ++i) {
+            if (!strcmp(avx2_cpus[i], arg)) {
+                context.avx2 = 1;
+                break;
+            }
+        }
+    }
+
     return 0;
 }
 
@@ -325,6 +383,55 @@ static int set_optimization_level(const char *level)
     return 0;
 }
 
+/*
+ * Number of threads used to optimize function definitions. Default is
+ * one for each processor.
+ */
+static int set_parallel_jobs(const char *arg)
+{
+    char *end;
+
+    parallel_jobs = strtol(arg, &end, 10);
+    if (*end != '\0' || parallel_jobs < 1) {
+        fprintf(stderr, "Invalid number of jobs '%s'.\n", arg);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Number of translation units compiled concurrently, each in a child
+ * process of its own. Default is one at a time.
+ */
+static int set_parallel_units(const char *arg)
+{
+    char *end;
+
+    parallel_units = strtol(arg, &end, 10);
+    if (*end != '\0' || parallel_units < 1) {
+        fprintf(stderr, "Invalid number of units '%s'.\n", arg);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Record execution profile when running in the VM, or use recorded
+ * profile to lay out native code.
+ */
+static int set_profile_output(const char *file)
+{
+    profile_output(file);
+    return 0;
+}
+
+static int set_profile_input(const char *file)
+{
+    return profile_input(file);
+}
+
 static int long_option(const char *arg)
 {
     if (!strcmp("--dump-symbols", arg)) {
@@ -436,16 +543,24 @@ static int parse_program_arguments(int argc, char *argv[])
         {"-f[no-]PIC", &option},
         {"-f[no-]fast-math", &option},
         {"-f[no-]strict-aliasing", &option},
+        {"-f[no-]vectorize", &option},
+        {"-f[no-]prelude-snapshot", &option},
+        {"-f[no-]time-report", &option},
+        {"-f[no-]mem-report", &option},
         {"-dot", &option},
         {"--help", &help},
         {"-march=", &set_cpu},
         {"-o:", &set_output_name},
         {"-I:", &add_include_search_path},
         {"-O{0|1|2|3}", &set_optimization_level},
+        {"-fparallel-jobs=", &set_parallel_jobs},
+        {"-fparallel-units=", &set_parallel_units},
         {"-std=", &set_c_std},
         {"-D:", &define_macro},
         {"--dump-symbols", &long_option},
         {"--dump-types", &long_option},
+        {"--profile-out=", &set_profile_output},
+        {"--profile-use=", &set_profile_input},
         {"-pipe", &option},
         {"-Wl,", &add_linker_flag},
         {"-rdynamic", &add_linker_flag},
@@ -458,6 +573,8 @@ static int parse_program_arguments(int argc, char *argv[])
     program = argv[0];
     context.standard = STD_C99;
     context.target = TARGET_IR_RUN;
+    context.vectorize = 1;
+    parallel_jobs = cpu_count();
 
     /* OpenBSD defaults to -fPIC unless explicitly turned off.  */
 #ifdef __OpenBSD__
@@ -465,6 +582,10 @@ static int parse_program_arguments(int argc, char *argv[])
 #endif
 
     define_macro("__KCC__");
+#if !defined(KCC_WINDOWS)
+    /* Extension functions can be called with their C prototype. */
+    define_macro("__KCC_FFI__");
+#endif
     if ((i = parse_args(optv, argc, argv)) != 0) {
         return i;
     }
@@ -520,6 +641,33 @@ static void register_argument_definitions(void)
     }
 }
 
+/*
+ * Include runtime headers, from snapshot unless disabled. Macros from
+ * the command line are processed first, and part of the snapshot key.
+ */
+static void include_runtime_headers(void)
+{
+    int i;
+    char *line;
+    array_of(char) config = {0};
+
+    if (!prelude_snapshot) {
+        include_prelude(NULL, NULL);
+        return;
+    }
+
+    for (i = 0; i < array_len(&predefined_macros); ++i) {
+        for (line = array_get(&predefined_macros, i); *line; ++line) {
+            array_push_back(&config, *line);
+        }
+        array_push_back(&config, '\n');
+    }
+
+    array_push_back(&config, '\0');
+    include_prelude(get_exe_path(), config.data);
+    array_clear(&config);
+}
+
 /*
  * Register compiler internal builtin symbols, that are assumed to
  * exists by standard library headers.
@@ -540,8 +688,7 @@ static void register_builtin_declarations(void)
         "   void *overflow_arg_area;"
         "   void *reg_save_area;"
         "} __builtin_va_list[1];");
-    inject_line("#include <_ext.h>");
-    inject_line("#include <_builtin.h>");
+    include_runtime_headers();
 }
 
 /*
@@ -562,10 +709,43 @@ static void add_include_search_paths(void)
 #endif
 }
 
+/*
+ * Optimize and generate code for definitions, unless there are errors
+ * from parsing. Return non-zero to stop.
+ */
+static int compile_batch(struct definition **defs, int n)
+{
+    int i, j;
+
+    if (context.errors) {
+        error("Aborting because of previous %s.",
+            (context.errors > 1) ? "errors" : "error");
+        return 1;
+    }
+
+    phase_begin(PHASE_OPTIMIZE);
+    optimize_batch(defs, n);
+    phase_end(PHASE_OPTIMIZE);
+    phase_begin(PHASE_COMPILE);
+    for (i = 0; i < n; ++i) {
+        for (j = 0; j < array_len(&defs[i]->nodes); ++j) {
+            report_count(COUNT_STATEMENTS,
+                array_len(&array_get(&defs[i]->nodes, j)->code));
+        }
+        compile(defs[i]);
+    }
+
+    phase_end(PHASE_COMPILE);
+    report_count(COUNT_DEFINITIONS, n);
+
+    return 0;
+}
+
 static int process_file(struct input_file file)
 {
+    int n, max;
     FILE *output;
-    struct definition *def;
+    struct definition *batch[MAX_BATCH], **defs;
     const struct symbol *sym;
 
     preprocess_reset();
@@ -585,35 +765,65 @@ static int process_file(struct input_file file)
     }
 
     if (context.target == TARGET_PREPROCESS) {
+        phase_begin(PHASE_PREPROCESS);
         preprocess(output);
+        phase_end(PHASE_PREPROCESS);
     } else {
         set_compile_target(output, file.name);
         push_scope(&ns_ident);
         push_scope(&ns_tag);
         register_builtin_declarations();
-        push_optimization(optimization_level);
-
-        while ((def = parse()) != NULL) {
-            if (context.errors) {
-                error("Aborting because of previous %s.",
-                    (context.errors > 1) ? "errors" : "error");
-                break;
+        push_optimization(optimization_level, parallel_jobs);
+
+        if (optimization_level > 1) {
+            /*
+             * Parse the whole translation unit before generating code,
+             * letting constant arguments propagate between functions.
+             */
+            phase_begin(PHASE_PARSE);
+            defs = parse_all(&n);
+            phase_end(PHASE_PARSE);
+            if (n && !context.errors) {
+                phase_begin(PHASE_OPTIMIZE);
+                defs = propagate_constant_arguments(defs, &n);
+                phase_end(PHASE_OPTIMIZE);
+            }
+            if (n) {
+                compile_batch(defs, n);
+            }
+        } else {
+            /*
+             * Definitions are optimized in parallel in batches, while
+             * code is generated in order on this thread. Batch only
+             * when there is work to share.
+             */
+            max = (optimization_level && parallel_jobs > 1)
+                ? MAX_BATCH : 1;
+            for (;;) {
+                phase_begin(PHASE_PARSE);
+                n = parse_batch(batch, max);
+                phase_end(PHASE_PARSE);
+                if (n <= 0 || compile_batch(batch, n))
+                    break;
             }
-
-            optimize(def);
-            compile(def);
         }
 
+        phase_begin(PHASE_COMPILE);
         while ((sym = yield_declaration(&ns_ident)) != NULL) {
             declare(sym);
         }
 
+        phase_end(PHASE_COMPILE);
+
         if (dump_symbols) {
             output_symbols(stdout, &ns_ident);
             output_symbols(stdout, &ns_tag);
         }
 
+        phase_begin(PHASE_FLUSH);
         flush();
+        phase_end(PHASE_FLUSH);
+        discard_specializations();
         pop_optimization();
         clear_types(dump_types ? stdout : NULL);
         pop_scope(&ns_tag);
@@ -624,9 +834,96 @@ static int process_file(struct input_file file)
         fclose(output);
     }
 
+    report_file(file.name);
     return context.errors;
 }
 
+/*
+ * Translation units written to output files of their own share nothing
+ * once compiled, and can be processed by concurrent child processes,
+ * each starting from a copy of the compiler state. Output from VM and
+ * JIT targets is accumulated in this process, and is never split.
+ * Windows has no fork(), and always processes files in sequence.
+ */
+static int can_process_concurrently(void)
+{
+#if defined(KCC_WINDOWS)
+    return 0;
+#else
+    int i;
+
+    if (parallel_units < 2 || array_len(&input_files) < 2)
+        return 0;
+
+    for (i = 0; i < array_len(&input_files); ++i) {
+        if (!array_get(&input_files, i).output_name)
+            return 0;
+    }
+
+    return 1;
+#endif
+}
+
+/*
+ * Process input files in at most parallel_units child processes, with
+ * threads for optimization shared between them. Stop starting new work
+ * after the first failure, like when processing files in sequence.
+ */
+static int process_files_concurrently(void)
+{
+#if !defined(KCC_WINDOWS)
+    int i, n, status, running, ret;
+    pid_t pid;
+
+    n = array_len(&input_files);
+    if (parallel_units > n) {
+        parallel_units = n;
+    }
+
+    parallel_jobs = parallel_jobs / parallel_units;
+    if (parallel_jobs < 1) {
+        parallel_jobs = 1;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    for (i = 0, running = 0, ret = 0; running || (i < n && !ret);) {
+        if (i < n && !ret && running < parallel_units) {
+            switch ((pid = fork())) {
+            case 0:
+                status = process_file(array_get(&input_files, i));
+                fflush(NULL);
+                _exit(status != 0);
+            case -1:
+                ret = process_file(array_get(&input_files, i));
+                break;
+            default:
+                running++;
+                break;
+            }
+            i++;
+        } else {
+            if (wait(&status) == -1)
+                break;
+            running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+                ret = 1;
+            }
+        }
+    }
+
+    return ret;
+#else
+    int i, ret;
+
+    for (i = 0, ret = 0; i < array_len(&input_files) && !ret; ++i) {
+        ret = process_file(array_get(&input_files, i));
+    }
+
+    return ret;
+#endif
+}
+
 static void setup_args(int argc, char **argv)
 {
     kcc_argc = argc;
@@ -644,6 +941,45 @@ static void clear_args(int argc)
     free(kcc_argv);
 }
 
+DLLEXPORT int kcsmain(int argc, char *argv[]);
+
+/*
+ * Handle --server=<socket> and --client=<socket>, which must come first
+ * on the command line. The server keeps runtime libraries loaded, with
+ * the tables of builtin functions of the VM and the JIT set up, and runs
+ * each request from a fresh copy of this process, before anything else
+ * is initialized. The client forwards the rest of its command line
+ * to the server, or runs it locally if no server is listening. Return
+ * -1 if neither option is given.
+ */
+static int server_mode(int argc, char *argv[])
+{
+    int ret;
+    const char *path;
+
+    if (argc < 2 || strncmp(argv[1], "--", 2))
+        return -1;
+
+    if (!strncmp(argv[1], "--server=", 9)) {
+        vm_load_builtin();
+        jit_load_builtin();
+        load_library("kcsext", 0);
+        return serve(argv[1] + 9, &kcsmain);
+    }
+
+    if (!strncmp(argv[1], "--client=", 9)) {
+        path = argv[1] + 9;
+        argv[1] = argv[0];
+        ret = request(path, argc - 1, argv + 1);
+        if (ret == -1) {
+            ret = kcsmain(argc - 1, argv + 1);
+        }
+        return ret;
+    }
+
+    return -1;
+}
+
 DLLEXPORT int kcsmain(int argc, char *argv[])
 {
     int i, ret;
@@ -658,17 +994,28 @@ DLLEXPORT int kcsmain(int argc, char *argv[])
     _CrtSetReportFile(_CRT_ASSERT, _CRTDBG_FILE_STDOUT);
     #endif
 
+    if ((ret = server_mode(argc, argv)) != -1) {
+        return ret;
+    }
+
     setup_args(argc, argv);
     if ((ret = parse_program_arguments(argc, argv)) == 1) {
         goto end;
     }
 
+    report_enable(time_report, memory_report);
     add_include_search_paths();
-    for (i = 0, ret = 0; i < array_len(&input_files); ++i) {
-        file = array_get(&input_files, i);
-        if ((ret = process_file(file)) != 0) {
+    if (can_process_concurrently()) {
+        if ((ret = process_files_concurrently()) != 0) {
             goto end;
         }
+    } else {
+        for (i = 0, ret = 0; i < array_len(&input_files); ++i) {
+            file = array_get(&input_files, i);
+            if ((ret = process_file(file)) != 0) {
+                goto end;
+            }
+        }
     }
 
     if (context.target == TARGET_x86_64_EXE) {
@@ -679,8 +1026,11 @@ DLLEXPORT int kcsmain(int argc, char *argv[])
         ret = jit_get_return_value();
     }
 
+    report_finalize();
+
 end:
     finalize();
+    profile_finalize();
     parse_finalize();
     preprocess_finalize();
     clear_predefined_macros();
@@ -0,0 +1,380 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "cse.h"
+
+#include <kcs/assert.h>
+#include <lacc/type.h>
+
+#include <string.h>
+
+/*
+ * Upper limit on number of expressions remembered at once. The oldest
+ * entry is dropped when full, keeping each pass linear in the number of
+ * statements.
+ */
+#define CSE_MAX_ENTRIES 64
+
+/*
+ * Temporary that can hold a remembered value. Only whole scalar values
+ * are considered, temporaries never have their address taken.
+ */
+static int is_holder(struct var v)
+{
+    return v.kind == DIRECT
+        && is_temporary(v.symbol)
+        && !is_field(v)
+        && v.offset == 0
+        && is_scalar(v.symbol->type)
+        && type_equal(v.type, v.symbol->type);
+}
+
+static int is_copy(struct expression expr)
+{
+    return is_identity(expr) && is_holder(expr.l);
+}
+
+static int is_binary(enum optype op)
+{
+    return op >= IR_OP_ADD;
+}
+
+static int immediate_equal(struct var a, struct var b)
+{
+    if (is_integer(a.type) || is_pointer(a.type)) {
+        return a.imm.u == b.imm.u;
+    } else if (is_float(a.type)) {
+        return !memcmp(&a.imm.f, &b.imm.f, sizeof(a.imm.f));
+    } else if (is_double(a.type)) {
+        return !memcmp(&a.imm.d, &b.imm.d, sizeof(a.imm.d));
+    }
+
+    return 0;
+}
+
+static int operand_equal(struct var a, struct var b)
+{
+    return a.kind == b.kind
+        && a.symbol == b.symbol
+        && a.offset == b.offset
+        && a.field_width == b.field_width
+        && a.field_offset == b.field_offset
+        && type_equal(a.type, b.type)
+        && (a.kind != IMMEDIATE || a.symbol || immediate_equal(a, b));
+}
+
+static int expression_equal(struct expression a, struct expression b)
+{
+    return a.op == b.op
+        && type_equal(a.type, b.type)
+        && operand_equal(a.l, b.l)
+        && (!is_binary(a.op) || operand_equal(a.r, b.r));
+}
+
+/*
+ * Operand which may be changed by writing through a pointer, or by a
+ * function call. Only temporaries are known to be safe.
+ */
+static int is_memory(struct var v)
+{
+    return v.kind == DEREF || (v.kind == DIRECT && !is_temporary(v.symbol));
+}
+
+static int refers(struct var v, const struct symbol *sym)
+{
+    return (v.kind == DIRECT || v.kind == DEREF) && v.symbol == sym;
+}
+
+static int expression_refers(struct expression expr, const struct symbol *sym)
+{
+    return refers(expr.l, sym) || (is_binary(expr.op) && refers(expr.r, sym));
+}
+
+static int expression_reads_memory(struct expression expr)
+{
+    return is_memory(expr.l) || (is_binary(expr.op) && is_memory(expr.r));
+}
+
+/*
+ * Expression that is worth remembering, producing the same value each
+ * time it is evaluated with the same operands.
+ */
+static int is_candidate(struct expression expr)
+{
+    if (has_side_effects(expr) || is_immediate(expr) || is_copy(expr))
+        return 0;
+
+    if (is_volatile(expr.l.type))
+        return 0;
+
+    return !is_binary(expr.op) || !is_volatile(expr.r.type);
+}
+
+/* Forget everything computed from, or held in, the symbol. */
+static void kill(struct optimizer *opt, int base, const struct symbol *sym)
+{
+    int i;
+    struct cse_entry *entry;
+
+    for (i = base; i < array_len(&opt->available); ++i) {
+        entry = &array_get(&opt->available, i);
+        if (entry->holder == sym || expression_refers(entry->expr, sym)) {
+            array_erase(&opt->available, i);
+            i -= 1;
+        }
+    }
+}
+
+/* Forget everything read from memory that may have been written. */
+static void clobber(struct optimizer *opt, int base)
+{
+    int i;
+    struct cse_entry *entry;
+
+    for (i = base; i < array_len(&opt->available); ++i) {
+        entry = &array_get(&opt->available, i);
+        if (expression_reads_memory(entry->expr)) {
+            array_erase(&opt->available, i);
+            i -= 1;
+        }
+    }
+}
+
+static const struct symbol *find_expression(
+    struct optimizer *opt,
+    int base,
+    struct expression expr)
+{
+    int i;
+    struct cse_entry *entry;
+
+    for (i = array_len(&opt->available) - 1; i >= base; --i) {
+        entry = &array_get(&opt->available, i);
+        if (expression_equal(entry->expr, expr))
+            return entry->holder;
+    }
+
+    return NULL;
+}
+
+static void remember(
+    struct optimizer *opt,
+    int base,
+    const struct symbol *holder,
+    struct expression expr)
+{
+    struct cse_entry entry;
+
+    if (array_len(&opt->available) - base == CSE_MAX_ENTRIES) {
+        array_erase(&opt->available, base);
+    }
+
+    entry.holder = holder;
+    entry.expr = expr;
+    array_push_back(&opt->available, entry);
+}
+
+/*
+ * Replace reference to temporary which is a copy of another temporary
+ * with the original.
+ */
+static int propagate_copy(struct optimizer *opt, int base, struct var *v)
+{
+    int i;
+    struct cse_entry *entry;
+
+    if (v->kind == DIRECT) {
+        if (is_field(*v) || v->offset || !is_temporary(v->symbol))
+            return 0;
+    } else if (v->kind != DEREF || !v->symbol || !is_temporary(v->symbol)) {
+        return 0;
+    }
+
+    for (i = array_len(&opt->available) - 1; i >= base; --i) {
+        entry = &array_get(&opt->available, i);
+        if (entry->holder == v->symbol) {
+            if (!is_copy(entry->expr))
+                break;
+            v->symbol = entry->expr.l.symbol;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int propagate_expression(
+    struct optimizer *opt,
+    int base,
+    struct expression *expr)
+{
+    int n;
+
+    n = propagate_copy(opt, base, &expr->l);
+    if (is_binary(expr->op)) {
+        n += propagate_copy(opt, base, &expr->r);
+    }
+
+    return n;
+}
+
+static int eliminate_statement(
+    struct optimizer *opt,
+    int base,
+    struct statement *st)
+{
+    int n;
+    const struct symbol *holder;
+
+    n = propagate_expression(opt, base, &st->expr);
+    if (st->t.kind == DEREF) {
+        n += propagate_copy(opt, base, &st->t);
+    }
+
+    if (st->st == IR_ASSIGN
+        && is_holder(st->t)
+        && type_equal(st->t.type, st->expr.type)
+        && is_candidate(st->expr))
+    {
+        holder = find_expression(opt, base, st->expr);
+        if (holder && holder != st->t.symbol) {
+            st->expr = as_expr(var_direct(holder));
+            n += 1;
+        }
+    }
+
+    if (has_side_effects(st->expr)
+        || st->st == IR_VA_START
+        || st->st == IR_VLA_ALLOC)
+    {
+        clobber(opt, base);
+    }
+
+    if (st->st == IR_ASSIGN || st->st == IR_VLA_ALLOC) {
+        if (st->t.kind == DEREF) {
+            clobber(opt, base);
+        } else if (st->t.kind == DIRECT) {
+            kill(opt, base, st->t.symbol);
+            if (!is_temporary(st->t.symbol)) {
+                clobber(opt, base);
+            }
+        }
+    }
+
+    if (st->st == IR_ASSIGN
+        && is_holder(st->t)
+        && type_equal(st->t.type, st->expr.type)
+        && (is_candidate(st->expr) || is_copy(st->expr))
+        && !expression_refers(st->expr, st->t.symbol))
+    {
+        remember(opt, base, st->t.symbol, st->expr);
+    }
+
+    return n;
+}
+
+/*
+ * Block only reached from a single predecessor, which can inherit
+ * expressions available at the end of that block.
+ */
+static int has_single_predecessor(
+    struct optimizer *opt,
+    struct definition *def,
+    struct block *block)
+{
+    return block != def->body && array_get(&opt->preds, block->index) == 1;
+}
+
+static int eliminate_block(
+    struct optimizer *opt,
+    struct definition *def,
+    struct block *block,
+    int base)
+{
+    int i, j, n, top;
+    struct block *next;
+    struct cse_entry entry;
+
+    for (i = 0, n = 0; i < array_len(&block->code); ++i) {
+        n += eliminate_statement(opt, base, &array_get(&block->code, i));
+    }
+
+    if (block->jump[1] || block->has_return_value || block->has_jump_table) {
+        n += propagate_expression(opt, base, &block->expr);
+        if (has_side_effects(block->expr)) {
+            clobber(opt, base);
+        }
+    }
+
+    for (i = 0; i < 2 && block->jump[i]; ++i) {
+        next = block->jump[i];
+        if (has_single_predecessor(opt, def, next)) {
+            top = array_len(&opt->available);
+            for (j = base; j < top; ++j) {
+                entry = array_get(&opt->available, j);
+                array_push_back(&opt->available, entry);
+            }
+
+            n += eliminate_block(opt, def, next, top);
+            while (array_len(&opt->available) > top) {
+                (void) array_pop_back(&opt->available);
+            }
+        }
+    }
+
+    return n;
+}
+
+static void add_predecessor(struct optimizer *opt, struct block *block, int n)
+{
+    while (array_len(&opt->preds) <= block->index) {
+        array_push_back(&opt->preds, 0);
+    }
+
+    array_get(&opt->preds, block->index) += n;
+}
+
+/*
+ * Count incoming edges of each block. Jump table targets are counted
+ * twice, as the table is not part of the serialized graph.
+ */
+static void count_predecessors(struct optimizer *opt)
+{
+    int i, j;
+    struct block *block;
+
+    array_empty(&opt->preds);
+    for (i = 0; i < array_len(&opt->blocklist); ++i) {
+        block = array_get(&opt->blocklist, i);
+        add_predecessor(opt, block, 0);
+        for (j = 0; j < 2 && block->jump[j]; ++j) {
+            add_predecessor(opt, block->jump[j], 1);
+        }
+
+        for (j = 0; j < array_len(&block->jump_table); ++j) {
+            add_predecessor(opt, array_get(&block->jump_table, j).label, 2);
+        }
+    }
+}
+
+INTERNAL int eliminate_common_subexpressions(
+    struct optimizer *opt,
+    struct definition *def)
+{
+    int i, n;
+    struct block *block;
+
+    count_predecessors(opt);
+    for (i = 0, n = 0; i < array_len(&opt->blocklist); ++i) {
+        block = array_get(&opt->blocklist, i);
+        if (!has_single_predecessor(opt, def, block)) {
+            array_empty(&opt->available);
+            n += eliminate_block(opt, def, block, 0);
+        }
+    }
+
+    array_empty(&opt->available);
+    return n;
+}
@@ -0,0 +1,34 @@
+#ifndef CSE_H
+#define CSE_H
+
+#include "optimize.h"
+
+#include <lacc/ir.h>
+
+/*
+ * Common subexpression elimination. Expressions assigned to temporaries
+ * are remembered, and later computations of the same expression are
+ * replaced by the temporary holding the value.
+ *
+ *   .t1 = *(p + 16)
+ *   .t2 = *(.t1 + 4)
+ *   .t3 = *(p + 16)
+ *   .t4 = *(.t3 + 8)
+ *
+ * is replaced by:
+ *
+ *   .t1 = *(p + 16)
+ *   .t2 = *(.t1 + 4)
+ *   .t3 = .t1
+ *   .t4 = *(.t1 + 8)
+ *
+ * Copies left behind are removed by dead store elimination. Available
+ * expressions flow from a block to successors having no other
+ * predecessor. Writes through pointers and function calls are assumed
+ * to modify any variable that is not a temporary.
+ */
+INTERNAL int eliminate_common_subexpressions(
+    struct optimizer *opt,
+    struct definition *def);
+
+#endif
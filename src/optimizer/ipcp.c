@@ -0,0 +1,973 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "ipcp.h"
+#include "../parser/parse.h"
+#include "../parser/symtab.h"
+#include "../parser/typetree.h"
+#include "../preprocessor/strtab.h"
+
+#include <lacc/array.h>
+#include <lacc/context.h>
+#include <kcs/assert.h>
+
+#include <string.h>
+
+/*
+ * Number of calls agreeing on a constant needed to create a clone,
+ * unless the function can be specialized in place.
+ */
+#define IPCP_MIN_SITES 2
+
+/* Limit number of clones of each function. */
+#define IPCP_MAX_CLONES 4
+
+/* Do not clone functions with more statements than this. */
+#define IPCP_MAX_STATEMENTS 512
+
+/* Skip functions with more calls, keeping the search quadratic. */
+#define IPCP_MAX_SITES 256
+
+/* Call with arguments passed in the preceding param statements. */
+struct call_site {
+    struct statement *params;
+    struct var *callee;
+    int taken;
+};
+
+struct function {
+    const struct symbol *symbol;
+    struct definition *def;
+    int escapes;
+    int statements;
+
+    /* Integer parameters that are read, and never written. */
+    uint64_t foldable;
+
+    array_of(struct call_site) sites;
+};
+
+/* Value assigned to parameter or temporary. */
+struct constant {
+    const struct symbol *symbol;
+    int writes;
+    int known;
+    union value value;
+};
+
+/* Open addressing table from symbol to index in some list. */
+struct slot {
+    const struct symbol *symbol;
+    int index;
+};
+
+struct table {
+    unsigned capacity;
+    struct slot *slot;
+};
+
+static array_of(struct function) functions;
+static array_of(struct constant) constants;
+static array_of(struct symbol *) copies;
+static array_of(struct definition *) result;
+static array_of(struct definition *) clones;
+
+static struct table function_table;
+static struct table constant_table;
+static struct table copy_table;
+
+static int clone_count;
+
+static void table_reset(struct table *table, int n)
+{
+    unsigned cap;
+
+    cap = 16;
+    while (cap < 2 * (unsigned) n) {
+        cap *= 2;
+    }
+
+    if (cap > table->capacity) {
+        table->capacity = cap;
+        table->slot = realloc(table->slot, cap * sizeof(*table->slot));
+    }
+
+    memset(table->slot, 0, table->capacity * sizeof(*table->slot));
+}
+
+static unsigned table_hash(const struct table *table, const struct symbol *sym)
+{
+    uint64_t h = (uint64_t) (uintptr_t) sym;
+
+    h = (h >> 3) * 0x9E3779B97F4A7C15ull;
+    return (unsigned) (h >> 32) & (table->capacity - 1);
+}
+
+static void table_insert(struct table *table, const struct symbol *sym, int i)
+{
+    unsigned h;
+
+    h = table_hash(table, sym);
+    while (table->slot[h].symbol) {
+        assert(table->slot[h].symbol != sym);
+        h = (h + 1) & (table->capacity - 1);
+    }
+
+    table->slot[h].symbol = sym;
+    table->slot[h].index = i;
+}
+
+static int table_lookup(const struct table *table, const struct symbol *sym)
+{
+    unsigned h;
+
+    if (!sym || !table->capacity)
+        return -1;
+
+    h = table_hash(table, sym);
+    while (table->slot[h].symbol) {
+        if (table->slot[h].symbol == sym)
+            return table->slot[h].index;
+        h = (h + 1) & (table->capacity - 1);
+    }
+
+    return -1;
+}
+
+static struct function *find_function(const struct symbol *sym)
+{
+    int i;
+
+    i = table_lookup(&function_table, sym);
+    return i < 0 ? NULL : &array_get(&functions, i);
+}
+
+static int has_right_operand(enum optype op)
+{
+    return op >= IR_OP_ADD;
+}
+
+/* Direct reference to the whole value of a scalar variable. */
+static int is_whole(struct var v)
+{
+    return v.kind == DIRECT && !is_field(v) && v.offset == 0;
+}
+
+/* Integer immediate, possibly an enumeration constant. */
+static int is_integer_constant(struct expression expr)
+{
+    return is_immediate(expr)
+        && is_integer(expr.type)
+        && (!expr.l.symbol || expr.l.symbol->symtype == SYM_CONSTANT);
+}
+
+/*
+ * Function definitions that can be specialized. Variably modified
+ * types refer to symbols of the original definition, and cannot be
+ * copied.
+ */
+static int can_specialize(const struct definition *def)
+{
+    int i;
+    Type type;
+
+    type = def->symbol->type;
+    if (!is_function(type)
+        || is_vararg(type)
+        || !nmembers(type)
+        || nmembers(type) != array_len(&def->params))
+        return 0;
+
+    for (i = 0; i < array_len(&def->params); ++i) {
+        if (is_variably_modified(array_get(&def->params, i)->type))
+            return 0;
+    }
+
+    for (i = 0; i < array_len(&def->locals); ++i) {
+        if (is_variably_modified(array_get(&def->locals, i)->type))
+            return 0;
+    }
+
+    return 1;
+}
+
+static int param_index(const struct definition *def, const struct symbol *sym)
+{
+    int i;
+
+    for (i = 0; i < array_len(&def->params) && i < 64; ++i) {
+        if (array_get(&def->params, i) == sym)
+            return i;
+    }
+
+    return -1;
+}
+
+/* Parameters can not be folded if assigned or having address taken. */
+static void scan_param(struct function *f, struct var v, int write)
+{
+    int i;
+
+    if (v.kind == ADDRESS || (write && v.kind == DIRECT)) {
+        i = param_index(f->def, v.symbol);
+        if (i >= 0) {
+            f->foldable &= ~(1ull << i);
+        }
+    }
+}
+
+static uint64_t param_read(struct function *f, struct var v)
+{
+    int i;
+
+    if (!is_whole(v))
+        return 0;
+
+    i = param_index(f->def, v.symbol);
+    return i < 0 ? 0 : 1ull << i;
+}
+
+static uint64_t scan_expression_params(
+    struct function *f,
+    struct expression expr)
+{
+    uint64_t read;
+
+    scan_param(f, expr.l, 0);
+    read = param_read(f, expr.l);
+    if (has_right_operand(expr.op)) {
+        scan_param(f, expr.r, 0);
+        read |= param_read(f, expr.r);
+    }
+
+    return read;
+}
+
+static int has_expression(const struct block *block)
+{
+    return block->jump[1] || block->has_return_value || block->has_jump_table;
+}
+
+/*
+ * Find parameters that can be replaced by a constant, and count the
+ * size of the function.
+ */
+static void analyze_function(struct function *f)
+{
+    int i, j;
+    uint64_t read;
+    struct block *block;
+    struct statement *st;
+    const struct symbol *sym;
+
+    for (i = 0; i < array_len(&f->def->params) && i < 64; ++i) {
+        sym = array_get(&f->def->params, i);
+        if (is_integer(sym->type)) {
+            f->foldable |= 1ull << i;
+        }
+    }
+
+    for (i = 0, read = 0; i < array_len(&f->def->nodes); ++i) {
+        block = array_get(&f->def->nodes, i);
+        f->statements += array_len(&block->code);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            if (st->st == IR_VLA_ALLOC) {
+                f->foldable = 0;
+                return;
+            }
+
+            read |= scan_expression_params(f, st->expr);
+            scan_param(f, st->t, st->st == IR_ASSIGN);
+        }
+
+        if (has_expression(block)) {
+            read |= scan_expression_params(f, block->expr);
+        }
+    }
+
+    f->foldable &= read;
+}
+
+/* Any reference to a function, other than calling it, lets it escape. */
+static void scan_reference(struct var v)
+{
+    struct function *f;
+
+    if (v.kind != IMMEDIATE && (f = find_function(v.symbol)) != NULL) {
+        f->escapes = 1;
+    }
+}
+
+static void scan_call(struct block *block, int i, struct var *callee)
+{
+    int j, n;
+    struct function *f;
+    struct call_site site;
+
+    f = find_function(callee->symbol);
+    if (!f)
+        return;
+
+    n = nmembers(f->symbol->type);
+    if (callee->kind != ADDRESS || callee->offset || i < n) {
+        f->escapes = 1;
+        return;
+    }
+
+    for (j = i - n; j < i; ++j) {
+        if (array_get(&block->code, j).st != IR_PARAM) {
+            f->escapes = 1;
+            return;
+        }
+    }
+
+    site.params = &array_get(&block->code, i - n);
+    site.callee = callee;
+    site.taken = 0;
+    array_push_back(&f->sites, site);
+}
+
+static void scan_expression(
+    struct block *block,
+    int i,
+    struct expression *expr)
+{
+    if (expr->op == IR_OP_CALL) {
+        scan_call(block, i, &expr->l);
+    } else {
+        scan_reference(expr->l);
+        if (has_right_operand(expr->op)) {
+            scan_reference(expr->r);
+        }
+    }
+}
+
+/* Collect calls to functions defined in this translation unit. */
+static void scan_definition(struct definition *def)
+{
+    int i, j;
+    struct block *block;
+    struct statement *st;
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            scan_expression(block, j, &st->expr);
+            scan_reference(st->t);
+        }
+
+        if (has_expression(block)) {
+            scan_expression(block, j, &block->expr);
+        }
+    }
+}
+
+/* Constant passed for parameter at call site, or NULL. */
+static const union value *site_argument(
+    const struct function *f,
+    const struct call_site *site,
+    int i)
+{
+    const struct statement *st;
+
+    st = site->params + i;
+    if (is_integer_constant(st->expr)
+        && type_equal(st->expr.type, array_get(&f->def->params, i)->type))
+    {
+        return &st->expr.l.imm;
+    }
+
+    return NULL;
+}
+
+static int value_equal(const union value *a, const union value *b)
+{
+    return a && b && a->u == b->u;
+}
+
+/*
+ * Clone function definition, creating new blocks, labels, parameters
+ * and local variables. The clone has internal linkage.
+ */
+static struct definition *clone_definition(const struct function *f)
+{
+    int i, j;
+    struct definition *def;
+    struct block *block, *copy;
+    struct statement st;
+    struct jump_pair jp;
+    struct symbol *sym;
+    const struct symbol *base;
+
+#define remap_block(b) ((b) ? array_get(&def->nodes, (b)->index) : NULL)
+#define remap_var(v) \
+    do { \
+        int k_ = table_lookup(&copy_table, (v).symbol); \
+        if (k_ >= 0 && (v).kind != IMMEDIATE) \
+            (v).symbol = array_get(&copies, k_); \
+    } while (0)
+
+    def = cfg_init();
+    sym = sym_create_copy(f->symbol);
+    sym->linkage = LINK_INTERN;
+    sym->name = str_cat(f->symbol->name, str_init(".constprop"));
+    sym->n = ++clone_count;
+    def->symbol = sym;
+
+    array_empty(&copies);
+    table_reset(&copy_table,
+        array_len(&f->def->params) + array_len(&f->def->locals));
+
+    for (i = 0; i < array_len(&f->def->params); ++i) {
+        base = array_get(&f->def->params, i);
+        sym = sym_create_copy(base);
+        table_insert(&copy_table, base, array_len(&copies));
+        array_push_back(&copies, sym);
+        array_push_back(&def->params, sym);
+    }
+
+    for (i = 0; i < array_len(&f->def->locals); ++i) {
+        base = array_get(&f->def->locals, i);
+        sym = is_temporary(base)
+            ? sym_create_temporary(base->type)
+            : sym_create_copy(base);
+        table_insert(&copy_table, base, array_len(&copies));
+        array_push_back(&copies, sym);
+        array_push_back(&def->locals, sym);
+    }
+
+    assert(f->def->body == array_get(&f->def->nodes, 0));
+    for (i = 1; i < array_len(&f->def->nodes); ++i) {
+        cfg_block_init(def);
+    }
+
+    for (i = 0; i < array_len(&f->def->nodes); ++i) {
+        block = array_get(&f->def->nodes, i);
+        copy = array_get(&def->nodes, i);
+        assert(block->index == i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = array_get(&block->code, j);
+            remap_var(st.t);
+            remap_var(st.expr.l);
+            remap_var(st.expr.r);
+            array_push_back(&copy->code, st);
+        }
+
+        copy->expr = block->expr;
+        remap_var(copy->expr.l);
+        remap_var(copy->expr.r);
+        copy->jump[0] = remap_block(block->jump[0]);
+        copy->jump[1] = remap_block(block->jump[1]);
+        copy->body = remap_block(block->body);
+        copy->has_return_value = block->has_return_value;
+        copy->has_init_value = block->has_init_value;
+        if (block->has_jump_table) {
+            copy->has_jump_table = 1;
+            copy->table_offset = var_direct(sym_create_table());
+            for (j = 0; j < array_len(&block->jump_table); ++j) {
+                jp = array_get(&block->jump_table, j);
+                jp.label = remap_block(jp.label);
+                jp.symbol = sym_create_table_entry(jp.label->label);
+                array_push_back(&copy->jump_table, jp);
+            }
+        }
+    }
+
+#undef remap_var
+#undef remap_block
+
+    array_push_back(&clones, def);
+    return def;
+}
+
+static struct constant *find_constant(const struct symbol *sym)
+{
+    int i;
+
+    i = table_lookup(&constant_table, sym);
+    return i < 0 ? NULL : &array_get(&constants, i);
+}
+
+static void add_constant(const struct symbol *sym, int writes, union value v)
+{
+    struct constant c;
+
+    c.symbol = sym;
+    c.writes = writes;
+    c.known = writes;
+    c.value = v;
+    table_insert(&constant_table, sym, array_len(&constants));
+    array_push_back(&constants, c);
+}
+
+static void count_address(struct var v)
+{
+    struct constant *c;
+
+    if (v.kind == ADDRESS && (c = find_constant(v.symbol)) != NULL) {
+        c->writes = 2;
+        c->known = 0;
+    }
+}
+
+static void count_write(const struct statement *st)
+{
+    struct constant *c;
+
+    if (st->t.kind != DIRECT || (c = find_constant(st->t.symbol)) == NULL)
+        return;
+
+    c->writes += 1;
+    if (c->writes == 1
+        && st->st == IR_ASSIGN
+        && is_whole(st->t)
+        && type_equal(st->t.type, c->symbol->type)
+        && type_equal(st->expr.type, c->symbol->type)
+        && is_integer_constant(st->expr))
+    {
+        c->known = 1;
+        c->value = st->expr.l.imm;
+    } else {
+        c->known = 0;
+    }
+}
+
+/*
+ * Find parameters and temporaries holding a known constant. Temporaries
+ * are assigned before being read, and a single assignment of constant
+ * value holds for all reads.
+ */
+static void find_constants(
+    struct definition *def,
+    uint64_t mask,
+    const union value *values)
+{
+    int i, j;
+    struct block *block;
+    struct statement *st;
+    struct symbol *sym;
+    union value zero = {0};
+
+    array_empty(&constants);
+    table_reset(&constant_table,
+        array_len(&def->params) + array_len(&def->locals));
+
+    for (i = 0; i < array_len(&def->params) && i < 64; ++i) {
+        if (mask & (1ull << i)) {
+            add_constant(array_get(&def->params, i), 1, values[i]);
+        }
+    }
+
+    for (i = 0; i < array_len(&def->locals); ++i) {
+        sym = array_get(&def->locals, i);
+        if (is_temporary(sym) && is_integer(sym->type)) {
+            add_constant(sym, 0, zero);
+        }
+    }
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            count_address(st->expr.l);
+            count_address(st->expr.r);
+            if (st->st == IR_ASSIGN || st->st == IR_VLA_ALLOC) {
+                count_write(st);
+            }
+        }
+
+        count_address(block->expr.l);
+        count_address(block->expr.r);
+    }
+}
+
+static int substitute_operand(struct var *v)
+{
+    struct constant *c;
+
+    if (!is_whole(*v) || (c = find_constant(v->symbol)) == NULL)
+        return 0;
+
+    if (c->writes != 1 || !c->known || !type_equal(v->type, c->symbol->type))
+        return 0;
+
+    *v = var_numeric(v->type, c->value);
+    return 1;
+}
+
+static int substitute_expression(struct expression *expr)
+{
+    int n;
+
+    if (has_side_effects(*expr))
+        return 0;
+
+    n = substitute_operand(&expr->l);
+    if (has_right_operand(expr->op)) {
+        n += substitute_operand(&expr->r);
+    }
+
+    return n;
+}
+
+/*
+ * Evaluate integer operation on constant operands. Values are computed
+ * with 64 bit precision, and truncated to the result type. Operations
+ * with undefined behavior are left for run time.
+ */
+static int fold_expression(struct expression *expr)
+{
+    int sign;
+    uint64_t a, b, c;
+    union value val = {0};
+
+    if (is_immediate(*expr) || has_side_effects(*expr))
+        return 0;
+
+    if (!is_integer_constant(as_expr(expr->l)) || !is_integer(expr->type))
+        return 0;
+
+    if (has_right_operand(expr->op) && !is_integer_constant(as_expr(expr->r)))
+        return 0;
+
+    sign = is_signed(expr->l.type);
+    a = expr->l.imm.u;
+    b = expr->r.imm.u;
+    switch (expr->op) {
+    case IR_OP_CAST:
+        val = convert(expr->l.imm, expr->l.type, expr->type);
+        *expr = as_expr(var_numeric(expr->type, val));
+        return 1;
+    case IR_OP_NOT:
+        c = ~a;
+        break;
+    case IR_OP_NEG:
+        c = 0 - a;
+        break;
+    case IR_OP_ADD:
+        c = a + b;
+        break;
+    case IR_OP_SUB:
+        c = a - b;
+        break;
+    case IR_OP_MUL:
+        c = a * b;
+        break;
+    case IR_OP_DIV:
+    case IR_OP_MOD:
+        if (b == 0 || (sign && expr->r.imm.i == -1))
+            return 0;
+        if (expr->op == IR_OP_DIV) {
+            c = sign ? (uint64_t) (expr->l.imm.i / expr->r.imm.i) : a / b;
+        } else {
+            c = sign ? (uint64_t) (expr->l.imm.i % expr->r.imm.i) : a % b;
+        }
+        break;
+    case IR_OP_AND:
+        c = a & b;
+        break;
+    case IR_OP_OR:
+        c = a | b;
+        break;
+    case IR_OP_XOR:
+        c = a ^ b;
+        break;
+    case IR_OP_SHL:
+    case IR_OP_SHR:
+        if ((is_signed(expr->r.type) && expr->r.imm.i < 0)
+            || b >= (uint64_t) size_of(expr->l.type) * 8)
+            return 0;
+        if (expr->op == IR_OP_SHL) {
+            c = a << b;
+        } else {
+            c = sign ? (uint64_t) (expr->l.imm.i >> b) : a >> b;
+        }
+        break;
+    case IR_OP_EQ:
+        c = a == b;
+        break;
+    case IR_OP_NE:
+        c = a != b;
+        break;
+    case IR_OP_GE:
+        c = sign ? expr->l.imm.i >= expr->r.imm.i : a >= b;
+        break;
+    case IR_OP_GT:
+        c = sign ? expr->l.imm.i > expr->r.imm.i : a > b;
+        break;
+    default:
+        return 0;
+    }
+
+    val.u = c;
+    if (is_comparison(*expr)) {
+        sign = 1;
+    }
+
+    val = convert(val,
+        sign ? basic_type__long : basic_type__unsigned_long,
+        expr->type);
+    *expr = as_expr(var_numeric(expr->type, val));
+    return 1;
+}
+
+/* Replace branch on constant condition by unconditional jump. */
+static int fold_branch(struct block *block)
+{
+    int i;
+    struct expression expr = {0};
+    struct jump_pair jp;
+
+    if (!is_integer_constant(block->expr))
+        return 0;
+
+    if (block->jump[1]) {
+        block->jump[0] = block->jump[block->expr.l.imm.u != 0];
+        block->jump[1] = NULL;
+        block->expr = expr;
+        return 1;
+    }
+
+    if (block->has_jump_table) {
+        for (i = 0; i < array_len(&block->jump_table); ++i) {
+            jp = array_get(&block->jump_table, i);
+            if (jp.value == block->expr.l.imm.i) {
+                block->jump[0] = jp.label;
+                block->has_jump_table = 0;
+                block->expr = expr;
+                array_empty(&block->jump_table);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Propagate constant parameters through the function body, folding
+ * expressions and branches until nothing more changes. Dead assignments
+ * and unreachable blocks are cleaned up by later optimization.
+ */
+static void specialize_definition(
+    struct definition *def,
+    uint64_t mask,
+    const union value *values)
+{
+    int i, j, n;
+    struct block *block;
+    struct statement *st;
+
+    do {
+        n = 0;
+        find_constants(def, mask, values);
+        for (i = 0; i < array_len(&def->nodes); ++i) {
+            block = array_get(&def->nodes, i);
+            for (j = 0; j < array_len(&block->code); ++j) {
+                st = &array_get(&block->code, j);
+                n += substitute_expression(&st->expr);
+                n += fold_expression(&st->expr);
+            }
+
+            if (has_expression(block)) {
+                n += substitute_expression(&block->expr);
+                n += fold_expression(&block->expr);
+                n += fold_branch(block);
+            }
+        }
+    } while (n);
+
+    verbose("Specialized %s with constant arguments.", sym_name(def->symbol));
+}
+
+/*
+ * Choose the most common constant argument among remaining call sites,
+ * and add any other constants all the matching sites agree on. Return
+ * number of sites matched.
+ */
+static int choose_arguments(
+    const struct function *f,
+    uint64_t *mask,
+    union value *values)
+{
+    int i, j, k, count, best, param;
+    const union value *v, *w;
+    struct call_site *site;
+
+    best = 0;
+    param = -1;
+    for (i = 0; i < 64 && i < array_len(&f->def->params); ++i) {
+        if (!(f->foldable & (1ull << i)))
+            continue;
+
+        for (j = 0; j < array_len(&f->sites); ++j) {
+            site = &array_get(&f->sites, j);
+            v = site_argument(f, site, i);
+            if (site->taken || !v)
+                continue;
+
+            for (k = j, count = 0; k < array_len(&f->sites); ++k) {
+                site = &array_get(&f->sites, k);
+                if (!site->taken
+                    && value_equal(v, site_argument(f, site, i)))
+                {
+                    count++;
+                }
+            }
+
+            if (count > best) {
+                best = count;
+                param = i;
+                values[i] = *v;
+            }
+        }
+    }
+
+    if (!best)
+        return 0;
+
+    *mask = 1ull << param;
+    for (i = 0; i < 64 && i < array_len(&f->def->params); ++i) {
+        if (i == param || !(f->foldable & (1ull << i)))
+            continue;
+
+        v = NULL;
+        for (j = 0; j < array_len(&f->sites); ++j) {
+            site = &array_get(&f->sites, j);
+            if (site->taken
+                || !value_equal(&values[param], site_argument(f, site, param)))
+                continue;
+
+            w = site_argument(f, site, i);
+            if (!w || (v && !value_equal(v, w))) {
+                v = NULL;
+                break;
+            }
+
+            v = w;
+        }
+
+        if (v) {
+            *mask |= 1ull << i;
+            values[i] = *v;
+        }
+    }
+
+    return best;
+}
+
+static int site_matches(
+    const struct function *f,
+    const struct call_site *site,
+    uint64_t mask,
+    const union value *values)
+{
+    int i;
+
+    for (i = 0; i < 64 && i < array_len(&f->def->params); ++i) {
+        if ((mask & (1ull << i))
+            && !value_equal(&values[i], site_argument(f, site, i)))
+            return 0;
+    }
+
+    return 1;
+}
+
+static void specialize_function(struct function *f)
+{
+    int i, n, cloned;
+    uint64_t mask;
+    union value values[64];
+    struct definition *def;
+    struct call_site *site;
+
+    if (!f->foldable
+        || !array_len(&f->sites)
+        || array_len(&f->sites) > IPCP_MAX_SITES)
+        return;
+
+    for (cloned = 0; cloned < IPCP_MAX_CLONES; ++cloned) {
+        n = choose_arguments(f, &mask, values);
+        if (!n)
+            break;
+
+        if (!cloned
+            && n == array_len(&f->sites)
+            && !f->escapes
+            && f->symbol->linkage == LINK_INTERN)
+        {
+            specialize_definition(f->def, mask, values);
+            break;
+        }
+
+        if (n < IPCP_MIN_SITES || f->statements > IPCP_MAX_STATEMENTS)
+            break;
+
+        def = clone_definition(f);
+        for (i = 0; i < array_len(&f->sites); ++i) {
+            site = &array_get(&f->sites, i);
+            if (!site->taken && site_matches(f, site, mask, values)) {
+                site->taken = 1;
+                site->callee->symbol = def->symbol;
+            }
+        }
+
+        specialize_definition(def, mask, values);
+    }
+}
+
+INTERNAL struct definition **propagate_constant_arguments(
+    struct definition **defs,
+    int *n)
+{
+    int i;
+    struct function f = {0};
+
+    array_empty(&result);
+    array_empty(&functions);
+    for (i = 0; i < *n; ++i) {
+        array_push_back(&result, defs[i]);
+        if (can_specialize(defs[i])) {
+            f.symbol = defs[i]->symbol;
+            f.def = defs[i];
+            array_push_back(&functions, f);
+        }
+    }
+
+    table_reset(&function_table, array_len(&functions));
+    for (i = 0; i < array_len(&functions); ++i) {
+        table_insert(&function_table, array_get(&functions, i).symbol, i);
+        analyze_function(&array_get(&functions, i));
+    }
+
+    for (i = 0; i < *n; ++i) {
+        scan_definition(defs[i]);
+    }
+
+    for (i = 0; i < array_len(&functions); ++i) {
+        specialize_function(&array_get(&functions, i));
+        array_clear(&array_get(&functions, i).sites);
+    }
+
+    for (i = 0; i < array_len(&clones); ++i) {
+        array_push_back(&result, array_get(&clones, i));
+    }
+
+    *n = array_len(&result);
+    return result.data;
+}
+
+INTERNAL void discard_specializations(void)
+{
+    int i;
+
+    for (i = 0; i < array_len(&clones); ++i) {
+        cfg_discard(array_get(&clones, i));
+    }
+
+    array_empty(&clones);
+}
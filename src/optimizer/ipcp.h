@@ -0,0 +1,36 @@
+#ifndef IPCP_H
+#define IPCP_H
+
+#include <lacc/ir.h>
+
+/*
+ * Interprocedural constant propagation. Calls passing the same integer
+ * constant for a parameter are directed to a specialized clone of the
+ * function, where the parameter is replaced by the constant.
+ *
+ *   static int process(const char *buf, int len, int mode);
+ *
+ *   process(a, n, MODE_FAST);
+ *   process(b, m, MODE_FAST);
+ *
+ * Both calls are redirected to process.constprop.1, with mode folded to
+ * MODE_FAST. Constants are propagated through temporaries, folding
+ * branches and switch jump tables that no longer depend on the
+ * parameter. A static function where all calls agree, and which has
+ * its address never taken, is specialized in place.
+ *
+ * Clones keep the original signature, and callers still pass all
+ * arguments.
+ *
+ * Takes all definitions of the translation unit, and returns them in
+ * the same order followed by any clones created. The list is valid
+ * until the next call.
+ */
+INTERNAL struct definition **propagate_constant_arguments(
+    struct definition **defs,
+    int *n);
+
+/* Release clones created, after code is generated. */
+INTERNAL void discard_specializations(void);
+
+#endif
@@ -18,12 +18,15 @@
  * Pointers can point to anything, so we cannot say for sure what is
  * written.
  */
-static uint64_t set_def_bit(struct var var)
+static uint64_t set_def_bit(const struct optimizer *opt, struct var var)
 {
+    int index;
+
     switch (var.kind) {
     case DIRECT:
-        if (is_scalar(var.symbol->type) && var.symbol->index) {
-            return 1ul << (var.symbol->index - 1);
+        index = symbol_index(opt, var.symbol);
+        if (is_scalar(var.symbol->type) && index) {
+            return 1ul << (index - 1);
         }
     default:
         return 0;
@@ -34,26 +37,32 @@ static uint64_t set_def_bit(struct var var)
  * Set bit for symbol possibly read through operation. This set must be
  * part of in-liveness.
  *
- * Pointers can point to anything, so assume everything is touched.
+ * Pointers can point to anything except temporaries, so assume every
+ * other symbol is touched.
  */
-static uint64_t set_use_bit(struct var var)
+static uint64_t set_use_bit(const struct optimizer *opt, struct var var)
 {
+    int index;
+
     switch (var.kind) {
     case DEREF:
-        return 0xFFFFFFFFFFFFFFFFul;
+        index = var.symbol ? symbol_index(opt, var.symbol) : 0;
+        return index ? opt->aliased | (1ul << (index - 1)) : opt->aliased;
     case DIRECT:
     case ADDRESS:
         if (is_object(var.symbol->type)) {
-            assert(var.symbol->index);
-            return 1ul << (var.symbol->index - 1);
+            index = symbol_index(opt, var.symbol);
+            assert(index);
+            return 1ul << (index - 1);
         }
         break;
     case IMMEDIATE:
         if (var.symbol) {
             assert(var.symbol->symtype == SYM_STRING_VALUE
                 || var.symbol->symtype == SYM_CONSTANT);
-            assert(var.symbol->index);
-            return 1ul << (var.symbol->index - 1);
+            index = symbol_index(opt, var.symbol);
+            assert(index);
+            return 1ul << (index - 1);
         }
         break;
     }
@@ -61,19 +70,21 @@ static uint64_t set_use_bit(struct var var)
     return 0;
 }
 
-static uint64_t use(const struct expression *expr)
+static uint64_t use(
+    const struct optimizer *opt,
+    const struct expression *expr)
 {
     uint64_t r = 0ul;
 
     switch (expr->op) {
     default:
-        r |= set_use_bit(expr->r);
+        r |= set_use_bit(opt, expr->r);
     case IR_OP_CAST:
     case IR_OP_NOT:
     case IR_OP_NEG:
     case IR_OP_CALL:
     case IR_OP_VA_ARG:
-        r |= set_use_bit(expr->l);
+        r |= set_use_bit(opt, expr->l);
         break;
     }
 
@@ -105,21 +116,23 @@ static int is_or_has_pointer(Type type)
  * Consider special case of sending a pointer into a function. Assume
  * then that anything can be used.
  */
-static uint64_t uses(const struct statement *s)
+static uint64_t uses(
+    const struct optimizer *opt,
+    const struct statement *s)
 {
     struct var t;
-    uint64_t r = use(&s->expr);
+    uint64_t r = use(opt, &s->expr);
     switch (s->st) {
     case IR_ASSIGN:
         if (s->t.kind == DEREF && s->t.symbol) {
             t = s->t;
             t.kind = DIRECT;
-            r |= set_use_bit(t);
+            r |= set_use_bit(opt, t);
         }
         break;
     case IR_PARAM:
         if (is_or_has_pointer(s->expr.type)) {
-            r |= 0xFFFFFFFFFFFFFFFFul;
+            r |= opt->aliased;
         }
     default:
         break;
@@ -128,17 +141,21 @@ static uint64_t uses(const struct statement *s)
     return r;
 }
 
-static uint64_t def(const struct statement *s)
+static uint64_t def(
+    const struct optimizer *opt,
+    const struct statement *s)
 {
     switch (s->st) {
     case IR_ASSIGN:
-        return set_def_bit(s->t);
+        return set_def_bit(opt, s->t);
     default:
         return 0ul;
     }
 }
 
-INTERNAL int live_variable_analysis(struct block *block)
+INTERNAL int live_variable_analysis(
+    struct optimizer *opt,
+    struct block *block)
 {
     int i;
     uint64_t top;
@@ -161,20 +178,20 @@ INTERNAL int live_variable_analysis(struct block *block)
         prev = &array_back(&block->code);
         prev->out = block->out;
         if (block->jump[1] || block->has_return_value) {
-            prev->out |= use(&block->expr);
+            prev->out |= use(opt, &block->expr);
         }
 
         for (i = array_len(&block->code) - 2; i >= 0; --i) {
             next = prev;
             prev = &array_get(&block->code, i);
-            prev->out = (next->out & ~def(next)) | uses(next);
+            prev->out = (next->out & ~def(opt, next)) | uses(opt, next);
         }
 
-        block->in = (prev->out & ~def(prev)) | uses(prev);
+        block->in = (prev->out & ~def(opt, prev)) | uses(opt, prev);
     } else {
         block->in = block->out;
         if (block->jump[1] || block->has_return_value) {
-            block->in |= use(&block->expr);
+            block->in |= use(opt, &block->expr);
         }
     }
 
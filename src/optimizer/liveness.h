@@ -1,19 +1,24 @@
 #ifndef LIVENESS_H
 #define LIVENESS_H
 
+#include "optimize.h"
+
 #include <lacc/ir.h>
 
 /*
  * Compute liveness of each variable on every edge, before and after
  * every ir operation.
  */
-INTERNAL int live_variable_analysis(struct block *block);
+INTERNAL int live_variable_analysis(
+	struct optimizer *opt,
+	struct block *block);
 
 /*
  * Determine whether a variable may be read after a given statement.
  * Return zero iff it is definitely not accessed after this point.
  */
 INTERNAL int is_live_after(
+	const struct optimizer *opt,
 	const struct symbol *sym,
 	const struct statement *st);
 
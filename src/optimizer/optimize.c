@@ -4,8 +4,10 @@
 # define EXTERNAL extern
 #endif
 #include "optimize.h"
+#include "cse.h"
 #include "liveness.h"
 #include "transform.h"
+#include "../util/thread.h"
 
 #include <lacc/array.h>
 #include <lacc/context.h>
@@ -14,31 +16,29 @@
 static int optimization_level;
 
 /*
- * Serialized control flow graph. Topologically sorted if non-cyclical.
+ * Number of threads used by optimize_batch, each with its own state.
  */
-static array_of(struct block *) blocklist;
-
-/*
- * List of symbols used in the control flow graph.
- */
-static array_of(struct symbol *) symbols;
+static int jobs;
+static struct optimizer *workers;
 
 /*
  * Serialize basic blocks by recursively visiting each node and
  * appending to list. Assign number to each symbol in use. Return
  * number of edges in the flow graph.
  */
-static int serialize_basic_blocks(struct block *block)
+static int serialize_basic_blocks(
+    struct optimizer *opt,
+    struct block *block)
 {
     if (block->color == BLACK)
         return 0;
 
     block->color = BLACK;
-    array_push_back(&blocklist, block);
+    array_push_back(&opt->blocklist, block);
     if (block->jump[0]) {
-        serialize_basic_blocks(block->jump[0]);
+        serialize_basic_blocks(opt, block->jump[0]);
         if (block->jump[1]) {
-            serialize_basic_blocks(block->jump[1]);
+            serialize_basic_blocks(opt, block->jump[1]);
         }
     }
 
@@ -46,14 +46,14 @@ static int serialize_basic_blocks(struct block *block)
 }
 
 /* Initialize liveness information in each block. */
-static void initialize_dataflow(void)
+static void initialize_dataflow(struct optimizer *opt)
 {
     struct block *block;
     struct statement *st;
     int i, j;
 
-    for (i = 0; i < array_len(&blocklist); ++i) {
-        block = array_get(&blocklist, i);
+    for (i = 0; i < array_len(&opt->blocklist); ++i) {
+        block = array_get(&opt->blocklist, i);
         block->in = 0;
         block->out = 0;
         for (j = 0; j < array_len(&block->code); ++j) {
@@ -63,44 +63,84 @@ static void initialize_dataflow(void)
     }
 }
 
-static int count_symbol(struct symbol *sym)
+static unsigned symbol_slot(const struct symbol *sym)
 {
+    uint64_t h = (uint64_t) (uintptr_t) sym;
+
+    h = (h >> 3) * 0x9E3779B97F4A7C15ull;
+    return (unsigned) (h >> 57) & (OPT_SYMBOL_SLOTS - 1);
+}
+
+INTERNAL int symbol_index(
+    const struct optimizer *opt,
+    const struct symbol *sym)
+{
+    unsigned i;
+
+    i = symbol_slot(sym);
+    while (opt->slot[i]) {
+        if (opt->slot[i] == sym)
+            return opt->index[i];
+        i = (i + 1) & (OPT_SYMBOL_SLOTS - 1);
+    }
+
+    return 0;
+}
+
+/*
+ * Assign number to symbol referenced by operand, unless already done.
+ * Remember symbols that can be accessed through pointers.
+ */
+static int count_symbol(struct optimizer *opt, struct var var)
+{
+    int len;
+    unsigned i;
+    const struct symbol *sym = var.symbol;
+
     if (!sym)
         return 0;
 
     if (is_object(sym->type)) {
-        if (!sym->index) {
-            int len = array_len(&symbols);
-            if (len < 64) {
-                array_push_back(&symbols, sym);
-                sym->index = len + 1;
-                return 1;
+        len = array_len(&opt->symbols);
+        i = symbol_slot(sym);
+        while (opt->slot[i]) {
+            if (opt->slot[i] == sym) {
+                if (var.kind == ADDRESS) {
+                    opt->aliased |= 1ul << (opt->index[i] - 1);
+                }
+                return 0;
             }
+            i = (i + 1) & (OPT_SYMBOL_SLOTS - 1);
+        }
+
+        if (len < 64) {
+            array_push_back(&opt->symbols, sym);
+            opt->slot[i] = sym;
+            opt->index[i] = len + 1;
+            if (var.kind == ADDRESS || !is_temporary(sym)) {
+                opt->aliased |= 1ul << len;
+            }
+            return 1;
         }
-    } else {
-        assert(!sym->index);
     }
 
     return 0;
 }
 
-static void reset_symbol_indexes(void)
+static void reset_symbol_indexes(struct optimizer *opt)
 {
-    int i;
-    struct symbol *sym;
-
-    for (i = 0; i < array_len(&symbols); ++i) {
-        sym = array_get(&symbols, i);
-        assert(sym->index);
-        sym->index = 0;
-    }
+    array_empty(&opt->symbols);
+    memset(opt->slot, 0, sizeof(opt->slot));
+    opt->aliased = 0;
 }
 
 /*
  * Assign numbers from [1 .. N] to all symbols referenced by operations
  * in the basic block.
  */
-static int enumerate_used_symbols(struct block *block)
+static int enumerate_used_symbols(
+    struct optimizer *opt,
+    struct block *block)
 {
     int i, n;
     struct statement *s;
@@ -109,31 +149,31 @@ static int enumerate_used_symbols(struct block *block)
         s = &array_get(&block->code, i);
         switch (s->expr.op) {
         default:
-            n += count_symbol((struct symbol *) s->expr.r.symbol);
+            n += count_symbol(opt, s->expr.r);
         case IR_OP_CAST:
         case IR_OP_NOT:
         case IR_OP_NEG:
         case IR_OP_CALL:
         case IR_OP_VA_ARG:
-            n += count_symbol((struct symbol *) s->expr.l.symbol);
+            n += count_symbol(opt, s->expr.l);
             break;
         }
 
         if (s->st == IR_ASSIGN) {
-            n += count_symbol((struct symbol *) s->t.symbol);
+            n += count_symbol(opt, s->t);
         }
     }
 
     if (block->has_return_value || block->jump[1]) {
         switch (block->expr.op) {
         default:
-            n += count_symbol((struct symbol *) block->expr.r.symbol);
+            n += count_symbol(opt, block->expr.r);
         case IR_OP_CAST:
         case IR_OP_NOT:
         case IR_OP_NEG:
         case IR_OP_CALL:
         case IR_OP_VA_ARG:
-            n += count_symbol((struct symbol *) block->expr.l.symbol);
+            n += count_symbol(opt, block->expr.l);
             break;
         }
     }
@@ -141,14 +181,16 @@ static int enumerate_used_symbols(struct block *block)
     return n;
 }
 
-static int color_white(struct block *block)
+static int color_white(struct optimizer *opt, struct block *block)
 {
     block->color = WHITE;
     return 0;
 }
 
 /* Forward jumps through blocks with no instructions. */
-static int skip_empty_blocks(struct block *block)
+static int skip_empty_blocks(
+    struct optimizer *opt,
+    struct block *block)
 {
     int i;
     struct block *next;
@@ -169,14 +211,16 @@ static int skip_empty_blocks(struct block *block)
  * Traverse all reachable nodes in a graph, invoking callback on each
  * basic block.
  */
-static int traverse(int (*callback)(struct block *))
+static int traverse(
+    struct optimizer *opt,
+    int (*callback)(struct optimizer *, struct block *))
 {
     int i, n;
     struct block *block;
 
-    for (i = 0, n = 0; i < array_len(&blocklist); ++i) {
-        block = array_get(&blocklist, i);
-        n += callback(block);
+    for (i = 0, n = 0; i < array_len(&opt->blocklist); ++i) {
+        block = array_get(&opt->blocklist, i);
+        n += callback(opt, block);
     }
 
     return n;
@@ -186,25 +230,29 @@ static int traverse(int (*callback)(struct block *))
  * Solve generic dataflow problem iteratively, going through each basic
  * block until visit function returns 0 for all nodes.
  */
-static void execute_iterative_dataflow(int (*callback)(struct block *))
+static void execute_iterative_dataflow(
+    struct optimizer *opt,
+    int (*callback)(struct optimizer *, struct block *))
 {
     int changes;
 
     do {
-        changes = traverse(callback);
+        changes = traverse(opt, callback);
     } while (changes);
 }
 
 #if !NDEBUG
-static void print_liveness_statement(uint64_t live)
+static void print_liveness_statement(
+    const struct optimizer *opt,
+    uint64_t live)
 {
     int j, k;
     const struct symbol *sym;
 
     printf("--- {");
-    for (j = 0, k = 0; j < array_len(&symbols); ++j) {
-        sym = array_get(&symbols, j);
-        if (live & (1ul << (sym->index - 1))) {
+    for (j = 0, k = 0; j < array_len(&opt->symbols); ++j) {
+        sym = array_get(&opt->symbols, j);
+        if (live & (1ul << (symbol_index(opt, sym) - 1))) {
             if (k) {
                 printf(", ");
             }
@@ -215,73 +263,110 @@ static void print_liveness_statement(uint64_t live)
     printf("}\n");
 }
 
-int print_liveness(struct block *block)
+int print_liveness(struct optimizer *opt, struct block *block)
 {
     int i;
     struct statement *st;
 
     printf("%s:\n", sym_name(block->label));
-    print_liveness_statement(block->in);
+    print_liveness_statement(opt, block->in);
     for (i = 0; i < array_len(&block->code); ++i) {
         st = &array_get(&block->code, i);
-        print_liveness_statement(st->out);
+        print_liveness_statement(opt, st->out);
     }
 
     if (block->jump[1] || block->has_return_value) {
-        print_liveness_statement(block->out);
+        print_liveness_statement(opt, block->out);
     }
 
     return 0;
 }
 #endif
 
-INTERNAL int is_live_after(const struct symbol *sym, const struct statement *st)
+INTERNAL int is_live_after(
+    const struct optimizer *opt,
+    const struct symbol *sym,
+    const struct statement *st)
 {
+    int index;
+
     if (optimization_level && is_object(sym->type)) {
-        assert(sym->index);
-        return (st->out & (1ul << (sym->index - 1))) != 0;
+        index = symbol_index(opt, sym);
+        assert(index);
+        return (st->out & (1ul << (index - 1))) != 0;
     }
 
     return 1;
 }
 
-INTERNAL void push_optimization(int level)
+INTERNAL void push_optimization(int level, int n)
 {
     optimization_level = level;
+    jobs = n < 1 ? 1 : n;
+    workers = calloc(jobs, sizeof(*workers));
 }
 
-INTERNAL void optimize(struct definition *def)
+static void optimize_definition(struct optimizer *opt, struct definition *def)
 {
     int syms, n;
 
     if (!optimization_level || !is_function(def->symbol->type))
         return;
 
-    array_empty(&blocklist);
-    array_empty(&symbols);
-    serialize_basic_blocks(def->body);
-    traverse(&skip_empty_blocks);
-    syms = traverse(&enumerate_used_symbols);
+    array_empty(&opt->blocklist);
+    serialize_basic_blocks(opt, def->body);
+    traverse(opt, &skip_empty_blocks);
+    syms = traverse(opt, &enumerate_used_symbols);
+    eliminate_common_subexpressions(opt, def);
 
     if (syms < 64) {
-        initialize_dataflow();
+        initialize_dataflow(opt);
         do {
             n = 0;
-            execute_iterative_dataflow(&live_variable_analysis);
+            execute_iterative_dataflow(opt, &live_variable_analysis);
 
-            /*traverse(&print_liveness);*/
-            n += traverse(&dead_store_elimination);
-            n += traverse(&merge_chained_assignment);
+            /*traverse(opt, &print_liveness);*/
+            n += traverse(opt, &dead_store_elimination);
+            n += traverse(opt, &merge_chained_assignment);
             /*if (n) printf("Did %d changes!\n", n);*/
         } while (n);
     }
 
-    reset_symbol_indexes();
-    traverse(&color_white);
+    reset_symbol_indexes(opt);
+    traverse(opt, &color_white);
+}
+
+INTERNAL void optimize(struct definition *def)
+{
+    optimize_definition(&workers[0], def);
+}
+
+static void optimize_worker(void *arg, int worker, int i)
+{
+    struct definition **defs = arg;
+    optimize_definition(&workers[worker], defs[i]);
+}
+
+INTERNAL void optimize_batch(struct definition **defs, int n)
+{
+    if (!optimization_level)
+        return;
+
+    parallel_for(jobs, n, &optimize_worker, defs);
 }
 
 INTERNAL void pop_optimization(void)
 {
-    array_clear(&blocklist);
-    array_clear(&symbols);
+    int i;
+
+    for (i = 0; i < jobs; ++i) {
+        array_clear(&workers[i].blocklist);
+        array_clear(&workers[i].symbols);
+        array_clear(&workers[i].preds);
+        array_clear(&workers[i].available);
+    }
+
+    free(workers);
+    workers = NULL;
+    jobs = 0;
 }
@@ -1,12 +1,59 @@
 #ifndef OPTIMIZE_H
 #define OPTIMIZE_H
 
-#include "liveness.h"
-
+#include <lacc/array.h>
 #include <lacc/ir.h>
 
-/* Set to non-zero to enable optimization. */
-INTERNAL void push_optimization(int level);
+#define OPT_SYMBOL_SLOTS 128
+
+/* Expression whose value is held in a temporary. */
+struct cse_entry {
+    const struct symbol *holder;
+    struct expression expr;
+};
+
+/*
+ * Optimizer state, one for each worker thread. Definitions can be
+ * optimized in parallel as long as each one is owned by a single
+ * worker, and nothing else modifies symbols or types meanwhile.
+ */
+struct optimizer {
+    /* Serialized control flow graph. Topologically sorted if
+     * non-cyclical. */
+    array_of(struct block *) blocklist;
+
+    /* List of symbols used in the control flow graph. */
+    array_of(const struct symbol *) symbols;
+
+    /*
+     * Open addressing table from symbol to enumeration [1 .. 64] used
+     * as bit position in liveness sets. Zero if not enumerated.
+     */
+    const struct symbol *slot[OPT_SYMBOL_SLOTS];
+    unsigned char index[OPT_SYMBOL_SLOTS];
+
+    /* Set of enumerated symbols that are not temporaries, and can be
+     * accessed through pointers. */
+    uint64_t aliased;
+
+    /* Number of incoming edges to each block, by block index. */
+    array_of(int) preds;
+
+    /* Stack of available expressions in common subexpression
+     * elimination. */
+    array_of(struct cse_entry) available;
+};
+
+/* Enumeration of symbol in current definition, or 0 if not counted. */
+INTERNAL int symbol_index(
+    const struct optimizer *opt,
+    const struct symbol *sym);
+
+/*
+ * Set to non-zero to enable optimization, using up to the given number
+ * of threads for optimize_batch.
+ */
+INTERNAL void push_optimization(int level, int jobs);
 
 /*
  * Do data flow analysis and perform optimizations on the intermediate
@@ -15,6 +62,12 @@ INTERNAL void push_optimization(int level);
  */
 INTERNAL void optimize(struct definition *def);
 
+/*
+ * Optimize a list of definitions in parallel. Parsing and code
+ * generation must not run concurrently with this.
+ */
+INTERNAL void optimize_batch(struct definition **defs, int n);
+
 /* Disable previously set optimization, cleaning up resources. */
 INTERNAL void pop_optimization(void);
 
@@ -33,6 +33,7 @@ static int var_equal(struct var a, struct var b)
  *
  */
 static int can_merge(
+    const struct optimizer *opt,
     const struct block *block,
     const struct statement s1,
     const struct statement s2)
@@ -44,10 +45,12 @@ static int can_merge(
         && type_equal(s1.t.type, s2.t.type)
         && s1.t.kind == DIRECT
         && s1.t.symbol->linkage == LINK_NONE
-        && !is_live_after(s1.t.symbol, &s2);
+        && !is_live_after(opt, s1.t.symbol, &s2);
 }
 
-INTERNAL int merge_chained_assignment(struct block *block)
+INTERNAL int merge_chained_assignment(
+    struct optimizer *opt,
+    struct block *block)
 {
     int i = 1;
     struct statement s1, s2;
@@ -56,7 +59,7 @@ INTERNAL int merge_chained_assignment(struct block *block)
         s1 = array_get(&block->code, 0);
         while (i < array_len(&block->code)) {
             s2 = array_get(&block->code, i);
-            if (can_merge(block, s1, s2)) {
+            if (can_merge(opt, block, s1, s2)) {
                 s1.t = s2.t;
                 array_get(&block->code, i - 1) = s1;
                 array_erase(&block->code, i);
@@ -71,7 +74,9 @@ INTERNAL int merge_chained_assignment(struct block *block)
     return 0;
 }
 
-INTERNAL int dead_store_elimination(struct block *block)
+INTERNAL int dead_store_elimination(
+    struct optimizer *opt,
+    struct block *block)
 {
     int i, c;
     struct statement *st;
@@ -80,7 +85,7 @@ INTERNAL int dead_store_elimination(struct block *block)
         st = &array_get(&block->code, i);
         if (st->st == IR_ASSIGN
             && st->t.kind == DIRECT
-            && !is_live_after(st->t.symbol, st)
+            && !is_live_after(opt, st->t.symbol, st)
             && st->t.symbol->linkage == LINK_NONE)
         {
             c += 1;
@@ -1,6 +1,8 @@
 #ifndef TRANSFORM_H
 #define TRANSFORM_H
 
+#include "optimize.h"
+
 #include <lacc/ir.h>
 
 /*
@@ -16,12 +18,16 @@
  *   b = a + 1
  *
  */
-INTERNAL int merge_chained_assignment(struct block *block);
+INTERNAL int merge_chained_assignment(
+    struct optimizer *opt,
+    struct block *block);
 
 /*
  * Remove assignments to variables that are never read, as determined by
  * liveness analysis.
  */
-INTERNAL int dead_store_elimination(struct block *block);
+INTERNAL int dead_store_elimination(
+    struct optimizer *opt,
+    struct block *block);
 
 #endif
@@ -48,6 +48,11 @@ static void release_initializer_block(struct block *block)
     array_push_back(&inititializer_blocks, block);
 }
 
+INTERNAL void initializer_reset(void)
+{
+    array_empty(&inititializer_blocks);
+}
+
 INTERNAL void initializer_finalize(void)
 {
     array_clear(&inititializer_blocks);
@@ -21,6 +21,12 @@ INTERNAL struct block *initializer(
     struct block *block,
     const struct symbol *sym);
 
+/*
+ * Forget blocks kept for reuse, which are recycled by the parser at the
+ * end of each translation unit.
+ */
+INTERNAL void initializer_reset(void);
+
 /* Free memory used for internal structures. */
 INTERNAL void initializer_finalize(void);
 
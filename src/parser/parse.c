@@ -74,6 +74,9 @@ static void recycle_block(struct block *block)
     block->jump[0] = block->jump[1] = NULL;
     block->body = NULL;
     block->color = WHITE;
+    block->index = 0;
+    block->count = 0;
+    block->false_count = 0;
     array_push_back(&blocks, block);
 }
 
@@ -102,6 +105,23 @@ static void cfg_empty(struct definition *def)
     array_empty(&def->nodes);
 }
 
+/*
+ * Recycle blocks not belonging to any definition at end of input. The
+ * initializer keeps some of them for reuse, which must be forgotten so
+ * that they are not handed out twice in the next translation unit.
+ */
+static void recycle_expressions(void)
+{
+    int i;
+
+    for (i = 0; i < array_len(&expressions); ++i) {
+        recycle_block(array_get(&expressions, i));
+    }
+
+    array_empty(&expressions);
+    initializer_reset();
+}
+
 INTERNAL struct block *cfg_block_init(struct definition *def)
 {
     struct block *block;
@@ -114,6 +134,7 @@ INTERNAL struct block *cfg_block_init(struct definition *def)
 
     if (def) {
         block->label = create_label(def);
+        block->index = array_len(&def->nodes);
         array_push_back(&def->nodes, block);
     } else {
         array_push_back(&expressions, block);
@@ -162,46 +183,79 @@ INTERNAL void cfg_define(struct definition *def, const struct symbol *sym)
     deque_push_back(&definitions, def);
 }
 
-INTERNAL struct definition *parse(void)
+/*
+ * Definitions returned from previous call to parse_batch, which are
+ * recycled on the next call.
+ */
+static array_of(struct definition *) batch;
+
+INTERNAL int parse_batch(struct definition **defs, int max)
 {
-    int i;
-    struct block *block;
-    static struct definition *def;
+    int i, n;
 
     /*
      * Recycle memory allocated for previous result. Parse is called
      * until no more input can be consumed.
      */
-    if (def) {
-        cfg_discard(def);
+    for (i = 0; i < array_len(&batch); ++i) {
+        cfg_discard(array_get(&batch, i));
     }
 
+    array_empty(&batch);
+
     /*
-     * Parse a declaration, which can include definitions that will fill
+     * Parse declarations, which can include definitions that will fill
      * up the buffer. Tentative declarations will only affect the symbol
      * table.
      */
-    while (!deque_len(&definitions) && peek().token != END) {
+    while (deque_len(&definitions) < max && peek().token != END) {
         declaration(NULL, NULL);
     }
 
     /*
-     * The next definition is taken from queue. Free memory in case we
+     * The next definitions are taken from queue. Free memory in case we
      * reach end of input.
      */
     if (!deque_len(&definitions)) {
         assert(peek().token == END);
-        for (i = 0; i < array_len(&expressions); ++i) {
-            block = array_get(&expressions, i);
-            recycle_block(block);
+        recycle_expressions();
+        return 0;
+    }
+
+    for (n = 0; n < max && deque_len(&definitions); ++n) {
+        defs[n] = deque_pop_front(&definitions);
+        array_push_back(&batch, defs[n]);
+    }
+
+    return n;
+}
+
+INTERNAL struct definition **parse_all(int *n)
+{
+    int i;
+
+    for (i = 0; i < array_len(&batch); ++i) {
+        cfg_discard(array_get(&batch, i));
+    }
+
+    array_empty(&batch);
+    while (peek().token != END) {
+        declaration(NULL, NULL);
+        while (deque_len(&definitions)) {
+            array_push_back(&batch, deque_pop_front(&definitions));
         }
-        array_empty(&expressions);
-        def = NULL;
-    } else {
-        def = deque_pop_front(&definitions);
     }
 
-    return def;
+    recycle_expressions();
+    *n = array_len(&batch);
+    return batch.data;
+}
+
+INTERNAL struct definition *parse(void)
+{
+    struct definition *def;
+
+    return parse_batch(&def, 1) ? def : NULL;
 }
 
 INTERNAL void parse_finalize(void)
@@ -210,6 +264,7 @@ INTERNAL void parse_finalize(void)
     struct definition *def;
     struct block *block;
 
+    array_clear(&batch);
     for (i = 0; i < array_len(&expressions); ++i) {
         block = array_get(&expressions, i);
         array_clear(&block->code);
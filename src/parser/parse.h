@@ -9,6 +9,20 @@
  */
 INTERNAL struct definition *parse(void);
 
+/*
+ * Parse input for up to max function or object definitions, storing
+ * them in defs. Return the number of definitions, or 0 on end of input.
+ * Results are valid until the next call to parse or parse_batch.
+ */
+INTERNAL int parse_batch(struct definition **defs, int max);
+
+/*
+ * Parse the rest of input, returning all function and object
+ * definitions in order. Results are valid until the next call to parse
+ * or parse_batch.
+ */
+INTERNAL struct definition **parse_all(int *n);
+
 /* Create an empty control flow graph.
  *
  * This is done in declaration parsing, which needs an empty graph while
@@ -5,6 +5,7 @@
 #endif
 #include "symtab.h"
 #include "typetree.h"
+#include <lacc/arena.h>
 #include <lacc/context.h>
 
 #include <kcs/assert.h>
@@ -33,6 +34,19 @@ INTERNAL struct namespace
  */
 static array_of(struct symbol *) temporaries;
 
+/*
+ * Symbols are allocated in arenas, released in bulk when the owning
+ * namespace pops its last scope. Labels are released at the end of
+ * each function body, and other named symbols at the end of the
+ * translation unit. Temporaries can outlive both, being owned by
+ * definitions still waiting to be compiled, and are only released on
+ * exit.
+ */
+static struct arena
+    unit_symbols,
+    function_symbols,
+    temporary_symbols;
+
 static int global_offset = 0;
 
 INTERNAL int get_global_variable_size(void)
@@ -47,7 +61,21 @@ INTERNAL void add_global_variable_size(int size)
     }
 }
 
-static struct symbol *alloc_sym(void)
+static struct symbol *alloc_sym(struct namespace *ns)
+{
+    struct symbol *sym;
+
+    if (ns == &ns_label) {
+        sym = arena_calloc(&function_symbols, sizeof(*sym));
+    } else {
+        sym = arena_calloc(&unit_symbols, sizeof(*sym));
+    }
+
+    sym->global_offset = -1;
+    return sym;
+}
+
+static struct symbol *alloc_temporary_sym(void)
 {
     struct symbol *sym;
 
@@ -55,10 +83,10 @@ static struct symbol *alloc_sym(void)
         sym = array_pop_back(&temporaries);
         memset(sym, 0, sizeof(*sym));
     } else {
-        sym = calloc(1, sizeof(*sym));
+        sym = arena_calloc(&temporary_symbols, sizeof(*sym));
     }
-    sym->global_offset = -1;
 
+    sym->global_offset = -1;
     return sym;
 }
 
@@ -141,15 +169,10 @@ static void symtab_reset_buffers(void)
 
 INTERNAL void symtab_finalize(void)
 {
-    int i;
-    struct symbol *sym;
-
-    for (i = 0; i < array_len(&temporaries); ++i) {
-        sym = array_get(&temporaries, i);
-        free(sym);
-    }
-
     array_clear(&temporaries);
+    arena_free(&temporary_symbols);
+    arena_free(&function_symbols);
+    arena_free(&unit_symbols);
     array_clear(&string_types);
     if (functions_init) {
         hash_destroy(&functions);
@@ -205,7 +228,8 @@ INTERNAL void pop_scope(struct namespace *ns)
     /*
      * Popping last scope frees the whole symbol table, including the
      * symbols themselves. For label scope, which is per function, make
-     * sure there are no tentative definitions.
+     * sure there are no tentative definitions. Identifiers and tags
+     * share the same arena, released once both are popped.
      */
     assert(array_len(&ns->scope) > 0);
     if (array_len(&ns->scope) == 1) {
@@ -218,17 +242,24 @@ INTERNAL void pop_scope(struct namespace *ns)
 
         ns->max_scope_depth = 0;
         array_clear(&ns->scope);
-        for (i = 0; i < array_len(&ns->symbol); ++i) {
-            sym = array_get(&ns->symbol, i);
-            if (ns == &ns_label && sym->symtype == SYM_TENTATIVE) {
-                error("Undefined label '%s'.", sym_name(sym));
+        if (ns == &ns_label) {
+            for (i = 0; i < array_len(&ns->symbol); ++i) {
+                sym = array_get(&ns->symbol, i);
+                if (sym->symtype == SYM_TENTATIVE) {
+                    error("Undefined label '%s'.", sym_name(sym));
+                }
             }
-            free(sym);
-        }
 
-        array_clear(&ns->symbol);
-        if (ns == &ns_ident) {
-            symtab_reset_buffers();
+            array_clear(&ns->symbol);
+            arena_reset(&function_symbols);
+        } else {
+            array_clear(&ns->symbol);
+            if (ns == &ns_ident) {
+                symtab_reset_buffers();
+            }
+            if (!array_len(&ns_ident.scope) && !array_len(&ns_tag.scope)) {
+                arena_reset(&unit_symbols);
+            }
         }
     } else {
         array_len(&ns->scope) -= 1;
@@ -467,7 +498,7 @@ INTERNAL struct symbol *sym_add(
         return sym_redeclare(sym, ns, type, symtype, linkage, decltype);
     }
 
-    sym = alloc_sym();
+    sym = alloc_sym(ns);
     sym->depth = depth;
     sym->name = name;
     sym->type = type;
@@ -515,7 +546,7 @@ INTERNAL struct symbol *sym_create_temporary(Type type)
     static int n;
     struct symbol *sym;
 
-    sym = alloc_sym();
+    sym = alloc_temporary_sym();
     sym->symtype = SYM_DEFINITION;
     sym->linkage = LINK_NONE;
     sym->name = str_init(PREFIX_TEMPORARY);
@@ -529,7 +560,7 @@ INTERNAL struct symbol *sym_create_unnamed(Type type)
     static int n;
     struct symbol *sym;
 
-    sym = alloc_sym();
+    sym = alloc_sym(&ns_ident);
     if (current_scope_depth(&ns_ident) == 0) {
         sym->linkage = LINK_INTERN;
     } else {
@@ -549,7 +580,7 @@ INTERNAL struct symbol *sym_create_label(void)
     static int n;
     struct symbol *sym;
 
-    sym = alloc_sym();
+    sym = alloc_temporary_sym();
     sym->type = basic_type__void;
     sym->symtype = SYM_LABEL;
     sym->linkage = LINK_INTERN;
@@ -563,7 +594,7 @@ INTERNAL struct symbol *sym_create_constant(Type type, union value val)
     static int n;
     struct symbol *sym;
 
-    sym = alloc_sym();
+    sym = alloc_sym(&ns_ident);
     sym->type = type;
     sym->value.constant = val;
     sym->symtype = SYM_CONSTANT;
@@ -584,7 +615,7 @@ INTERNAL struct symbol *sym_create_string(String str)
     static int n;
     struct symbol *sym;
 
-    sym = alloc_sym();
+    sym = alloc_sym(&ns_ident);
     sym->type = get_string_type(str.len + 1);
     sym->value.string = str;
     sym->symtype = SYM_STRING_VALUE;
@@ -600,7 +631,7 @@ INTERNAL struct symbol *sym_create_table(void)
     static int n;
     struct symbol *sym;
 
-    sym = alloc_sym();
+    sym = alloc_sym(&ns_ident);
     sym->symtype = SYM_TABLE;
     sym->linkage = LINK_INTERN;
     sym->name = str_init(PREFIX_TABLE);
@@ -611,7 +642,7 @@ INTERNAL struct symbol *sym_create_table(void)
 
 INTERNAL struct symbol *sym_create_table_entry(const struct symbol* base)
 {
-    struct symbol *sym = alloc_sym();
+    struct symbol *sym = alloc_sym(&ns_ident);
     assert(base->symtype == SYM_LABEL);
 
     sym->type = basic_type__void;
@@ -623,6 +654,15 @@ INTERNAL struct symbol *sym_create_table_entry(const struct symbol* base)
     return sym;
 }
 
+INTERNAL struct symbol *sym_create_copy(const struct symbol *base)
+{
+    struct symbol *sym = alloc_sym(&ns_ident);
+
+    *sym = *base;
+    array_push_back(&ns_ident.symbol, sym);
+    return sym;
+}
+
 INTERNAL void sym_discard(struct symbol *sym)
 {
     array_push_back(&temporaries, sym);
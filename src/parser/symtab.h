@@ -113,6 +113,12 @@ INTERNAL struct symbol *sym_create_table(void);
 /* Create a symbol of table entry of address. */
 INTERNAL struct symbol *sym_create_table_entry(const struct symbol* base);
 
+/*
+ * Create a copy of a local variable or function symbol, used when
+ * cloning a function definition.
+ */
+INTERNAL struct symbol *sym_create_copy(const struct symbol *base);
+
 /*
  * Release memory used for a temporary symbol, allowing it to be reused
  * in a different function.
@@ -5,19 +5,94 @@
 #endif
 #include "directive.h"
 #include "input.h"
+#include "macro.h"
+#include "prelude.h"
 #include "strtab.h"
 #include <lacc/array.h>
 #include <lacc/context.h>
+#include <lacc/hash.h>
 
 #include <kcs/assert.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <xunistd.h>
+#if !defined(KCC_WINDOWS)
+# include <dirent.h>
+# include <errno.h>
+# include <sys/mman.h>
+#endif
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 #define FILE_BUFFER_SIZE 4096
 
+/*
+ * Scan input a block at a time to find characters needing attention in
+ * initial preprocessing, skipping plain text between them.
+ */
+#if defined(__AVX2__)
+# define SCAN_WIDTH 32
+# define scan_load(p) _mm256_load_si256((const __m256i *) (p))
+# define scan_loadu(p) _mm256_loadu_si256((const __m256i *) (p))
+# define scan_eq(v, c) \
+    (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)))
+typedef __m256i scan_block;
+#elif defined(__SSE2__)
+# define SCAN_WIDTH 16
+# define scan_load(p) _mm_load_si128((const __m128i *) (p))
+# define scan_loadu(p) _mm_loadu_si128((const __m128i *) (p))
+# define scan_eq(v, c) \
+    (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)))
+typedef __m128i scan_block;
+#endif
+
+/*
+ * Aligned loads can read past the terminating zero of a buffer, but
+ * never into another page.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+# define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+# define NO_SANITIZE_ADDRESS
+#endif
+
+/*
+ * Multiple include optimization. A file where everything is wrapped in
+ * a conditional on the guard macro not being defined has no effect
+ * when included again with the macro defined.
+ *
+ *     #ifndef FOO_H
+ *     #define FOO_H
+ *     ...
+ *     #endif
+ *
+ * Lines are classified as they are read, before preprocessing. Only
+ * whitespace and comments can appear outside the conditional, and it
+ * must not have an #else or #elif branch.
+ */
+enum guard_state {
+    GUARD_START,
+    GUARD_OPEN,
+    GUARD_CLOSED,
+    GUARD_NONE
+};
+
+/*
+ * Include file seen earlier in the translation unit, which can be
+ * skipped if the guard macro is defined, or #pragma once was given.
+ */
+struct include_guard {
+    String path;
+    String macro;
+    int once;
+};
+
 struct source {
     FILE *file;
 
@@ -47,6 +122,18 @@ struct source {
 
     /* Is string stream flag. */
     int is_string_stream;
+
+    /*
+     * Whole file is in buffer, either read at once or memory mapped,
+     * and there is nothing more to read from file.
+     */
+    int is_whole_file;
+    int is_mapped;
+
+    /* Guard macro detection, and depth of conditional directives. */
+    enum guard_state guard;
+    String guard_macro;
+    int guard_depth;
 };
 
 /* Temporary buffer used to construct search paths. */
@@ -59,12 +146,68 @@ static size_t rlen;
 /* List of directories to search on resolving include directives. */
 static array_of(const char *) search_path_list;
 
+/*
+ * Names found in each search directory, listed once on first use. A
+ * name not in the listing cannot be opened, and is skipped without a
+ * system call. Directories that cannot be listed are always tried.
+ */
+struct search_dir {
+    int is_read;
+    int is_listed;
+    struct hash_table names;
+};
+
+static array_of(struct search_dir) search_dirs;
+
+/*
+ * Index of search directory where each system include was last found,
+ * kept for the whole program.
+ */
+struct resolved_include {
+    String name;
+    int index;
+};
+
+static struct hash_table resolved;
+static int has_resolved;
+
+/* Number of file opens tried and avoided resolving system includes. */
+static struct {
+    int opens;
+    int skipped;
+    int cached;
+    int listed;
+} include_stats;
+
 /*
  * Keep stack of file descriptors as resolved by includes. Push and pop
  * from the end of the list.
  */
 static array_of(struct source) source_stack;
 
+/* Table of include guards, keyed on canonical path. */
+static struct hash_table guards;
+static int has_guards;
+
+/*
+ * Canonical path of each path as spelled, kept for the whole program,
+ * so that a file reached through different relative paths shares one
+ * include guard, resolved only once.
+ */
+struct canonical_path {
+    String path;
+    String real;
+};
+
+static struct hash_table canonical;
+static int has_canonical;
+
+/*
+ * Stack depth where getprepline signals end of input once, after the
+ * files included above it are read.
+ */
+static int barrier;
+
 /* Expose for diagnostics. */
 INTERNAL String current_file_path;
 INTERNAL int current_file_line;
@@ -75,6 +218,48 @@ static struct source *current_file(void)
     return &array_get(&source_stack, array_len(&source_stack) - 1);
 }
 
+/*
+ * Get whole content of regular file in one buffer, terminated by zero.
+ * The file is memory mapped unless the size is a multiple of page size,
+ * where the terminator would fall outside the mapping.
+ */
+static int read_whole_file(struct source *source)
+{
+    size_t n;
+    struct stat st;
+
+    if (source->file == stdin
+        || source->is_string_stream
+        || fstat(fileno(source->file), &st)
+        || !S_ISREG(st.st_mode))
+        return 0;
+
+#if !defined(KCC_WINDOWS)
+    if (st.st_size > 0 && st.st_size % sysconf(_SC_PAGESIZE) != 0) {
+        source->buffer = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+            fileno(source->file), 0);
+        if (source->buffer != MAP_FAILED) {
+            source->size = st.st_size;
+            source->read = st.st_size;
+            source->is_mapped = 1;
+            goto done;
+        }
+    }
+#endif
+
+    source->size = st.st_size + 1;
+    source->buffer = malloc(source->size);
+    n = fread(source->buffer, sizeof(char), st.st_size, source->file);
+    source->buffer[n] = '\0';
+    source->read = n;
+
+done:
+    fclose(source->file);
+    source->file = NULL;
+    source->is_whole_file = 1;
+    return 1;
+}
+
 static void push_file(struct source source)
 {
     assert(source.file);
@@ -82,22 +267,151 @@ static void push_file(struct source source)
 
     current_file_line = 0;
     current_file_path = source.path;
-    source.buffer = malloc(FILE_BUFFER_SIZE);
-    source.size = FILE_BUFFER_SIZE;
+    if (!read_whole_file(&source)) {
+        source.buffer = malloc(FILE_BUFFER_SIZE);
+        source.size = FILE_BUFFER_SIZE;
+    }
+
     array_push_back(&source_stack, source);
+    prelude_add_file(source.path);
+}
+
+static String guard_key(void *p)
+{
+    return ((struct include_guard *) p)->path;
+}
+
+static void *guard_add(void *p)
+{
+    struct include_guard *guard;
+
+    guard = malloc(sizeof(*guard));
+    *guard = *(struct include_guard *) p;
+    return guard;
+}
+
+static void guard_del(void *p)
+{
+    free(p);
+}
+
+static String canonical_key(void *p)
+{
+    return ((struct canonical_path *) p)->path;
+}
+
+static void *canonical_add(void *p)
+{
+    struct canonical_path *entry;
+
+    entry = malloc(sizeof(*entry));
+    *entry = *(struct canonical_path *) p;
+    return entry;
+}
+
+/*
+ * Resolve path to an absolute path without symbolic links, and dot or
+ * dot-dot components. Paths which do not name an existing file are used
+ * as they are spelled, and not remembered. Path needs not be registered
+ * in the string table.
+ */
+static String canonical_path(String path)
+{
+    char *real;
+    struct canonical_path entry, *found;
+
+    if (!has_canonical) {
+        hash_init(&canonical, 64, canonical_key, canonical_add, guard_del);
+        has_canonical = 1;
+    }
+
+    found = hash_lookup(&canonical, path);
+    if (found)
+        return found->real;
+
+#if defined(KCC_WINDOWS)
+    real = _fullpath(NULL, str_raw(path), 0);
+#else
+    real = realpath(str_raw(path), NULL);
+#endif
+    if (!real)
+        return path;
+
+    entry.path = str_register(str_raw(path), path.len);
+    entry.real = str_register(real, strlen(real));
+    free(real);
+    found = hash_insert(&canonical, &entry);
+    return found->real;
+}
+
+static struct include_guard *add_include_guard(String path)
+{
+    struct include_guard guard = {0};
+
+    if (!has_guards) {
+        hash_init(&guards, 64, guard_key, guard_add, guard_del);
+        has_guards = 1;
+    }
+
+    guard.path = path;
+    return hash_insert(&guards, &guard);
+}
+
+/*
+ * Check if file at path was included before, and is protected by a
+ * guard macro which is now defined. This touches the file system only
+ * the first time path is seen.
+ */
+static int is_include_guarded(const char *path)
+{
+    String key = {0};
+    struct include_guard *guard;
+
+    if (!has_guards)
+        return 0;
+
+    key.len = strlen(path);
+    if (key.len < SHORT_STRING_LEN) {
+        memcpy(key.a.str, path, key.len);
+    } else {
+        key.p.str = path;
+    }
+
+    key = canonical_path(key);
+    guard = hash_lookup(&guards, key);
+    if (guard
+        && (guard->once
+            || (guard->macro.len && macro_definition(guard->macro))))
+    {
+        verbose("Skipping include of %s.", path);
+        return 1;
+    }
+
+    return 0;
 }
 
 static int pop_file(void)
 {
     unsigned len;
     struct source source;
+    struct include_guard *guard;
 
     len = array_len(&source_stack);
     if (len) {
         source = array_pop_back(&source_stack);
-        if (source.file != stdin) {
+        if (source.guard == GUARD_CLOSED) {
+            guard = add_include_guard(canonical_path(source.path));
+            guard->macro = source.guard_macro;
+            prelude_add_guard(guard->path, source.guard_macro, 0);
+        }
+        if (source.file && source.file != stdin) {
             fclose(source.file);
         }
+#if !defined(KCC_WINDOWS)
+        if (source.is_mapped) {
+            munmap(source.buffer, source.size);
+        } else
+#endif
         free(source.buffer);
         if (len - 1) {
             return 1;
@@ -107,16 +421,54 @@ static int pop_file(void)
     return EOF;
 }
 
+static void clear_search_dirs(void)
+{
+    int i;
+    struct search_dir *dir;
+
+    for (i = 0; i < array_len(&search_dirs); ++i) {
+        dir = &array_get(&search_dirs, i);
+        if (dir->is_listed) {
+            hash_destroy(&dir->names);
+        }
+    }
+
+    array_clear(&search_dirs);
+    if (has_resolved) {
+        hash_destroy(&resolved);
+        has_resolved = 0;
+    }
+}
+
 INTERNAL void input_finalize(void)
 {
     while (pop_file() != EOF)
         ;
 
+    if (include_stats.opens || include_stats.skipped) {
+        verbose("System includes: %d opens, %d avoided by listing %d "
+            "directories, %d by cached resolution.",
+            include_stats.opens,
+            include_stats.skipped,
+            include_stats.listed,
+            include_stats.cached);
+    }
+
+    clear_search_dirs();
     assert(!array_len(&source_stack));
     array_clear(&source_stack);
     array_clear(&search_path_list);
     free(path_buffer);
     free(rline);
+    if (has_guards) {
+        hash_destroy(&guards);
+        has_guards = 0;
+    }
+
+    if (has_canonical) {
+        hash_destroy(&canonical);
+        has_canonical = 0;
+    }
 }
 
 static size_t path_dirlen(const char *path)
@@ -164,6 +516,9 @@ INTERNAL void include_file(const char *name)
         path = name;
     }
 
+    if (is_include_guarded(path))
+        return;
+
     source.file = fopen(path, "r");
     if (source.file) {
         source.path = str_register(path, strlen(path));
@@ -174,25 +529,186 @@ INTERNAL void include_file(const char *name)
     }
 }
 
+/*
+ * Entries are allocated together with a copy of long names, as in the
+ * string table, to stay valid between translation units.
+ */
+static void *name_entry_add(void *ref)
+{
+    size_t len;
+    char *buffer;
+    struct resolved_include *entry;
+
+    entry = (struct resolved_include *) ref;
+    len = entry->name.len;
+    buffer = malloc(sizeof(*entry) + len + 1);
+    memcpy(buffer, entry, sizeof(*entry));
+    entry = (struct resolved_include *) buffer;
+    if (len >= SHORT_STRING_LEN) {
+        memcpy(buffer + sizeof(*entry), entry->name.p.str, len);
+        buffer[sizeof(*entry) + len] = '\0';
+        entry->name.p.str = buffer + sizeof(*entry);
+    }
+
+    return entry;
+}
+
+static String name_entry_key(void *ref)
+{
+    return ((struct resolved_include *) ref)->name;
+}
+
+static void name_entry_del(void *ref)
+{
+    free(ref);
+}
+
+static String name_key(const char *name, size_t len)
+{
+    String key = {0};
+
+    key.len = len;
+    if (len < SHORT_STRING_LEN) {
+        memcpy(key.a.str, name, len);
+    } else {
+        key.p.str = name;
+    }
+
+    return key;
+}
+
+static void add_name(struct hash_table *tab, const char *name, int index)
+{
+    struct resolved_include entry;
+
+    entry.name = name_key(name, strlen(name));
+    entry.index = index;
+    ((struct resolved_include *) hash_insert(tab, &entry))->index = index;
+}
+
+#if !defined(KCC_WINDOWS)
+static void list_search_dir(struct search_dir *dir, const char *path)
+{
+    DIR *d;
+    struct dirent *ent;
+
+    d = opendir(path);
+    if (!d) {
+        dir->is_listed = errno == ENOENT || errno == ENOTDIR;
+        if (dir->is_listed) {
+            hash_init(&dir->names, 1, name_entry_key, name_entry_add,
+                name_entry_del);
+        }
+        return;
+    }
+
+    hash_init(&dir->names, 256, name_entry_key, name_entry_add,
+        name_entry_del);
+    while ((ent = readdir(d)) != NULL) {
+        add_name(&dir->names, ent->d_name, 0);
+    }
+
+    closedir(d);
+    dir->is_listed = 1;
+    include_stats.listed++;
+}
+#endif
+
+/*
+ * Check listing of search directory for the first component of include
+ * name, returning zero if the file certainly does not exist there.
+ */
+static int may_exist(int i, const char *name)
+{
+    size_t len;
+    const char *sep;
+    struct search_dir *dir;
+    struct search_dir empty = {0};
+
+    while (array_len(&search_dirs) <= i) {
+        array_push_back(&search_dirs, empty);
+    }
+
+    dir = &array_get(&search_dirs, i);
+#if !defined(KCC_WINDOWS)
+    if (!dir->is_read) {
+        list_search_dir(dir, array_get(&search_path_list, i));
+        dir->is_read = 1;
+    }
+#endif
+    if (!dir->is_listed)
+        return 1;
+
+    sep = strchr(name, '/');
+    len = sep ? (size_t) (sep - name) : strlen(name);
+    return hash_lookup(&dir->names, name_key(name, len)) != NULL;
+}
+
+static const char *search_path(int i, const char *name)
+{
+    size_t dirlen;
+    const char *path;
+
+    path = array_get(&search_path_list, i);
+    dirlen = strlen(path);
+    while (path[dirlen - 1] == '/') {
+        dirlen--;
+        assert(dirlen);
+    }
+
+    return create_path(path, dirlen, name);
+}
+
+static void remember_include(const char *name, int index)
+{
+    if (!has_resolved) {
+        hash_init(&resolved, 64, name_entry_key, name_entry_add,
+            name_entry_del);
+        has_resolved = 1;
+    }
+
+    add_name(&resolved, name, index);
+}
+
+/*
+ * Resolve include by trying each search directory in order. Start at
+ * the directory where the same name was found before, as directories
+ * before it did not have the file.
+ */
 INTERNAL void include_system_file(const char *name)
 {
     struct source source = {0};
+    struct resolved_include *entry;
     const char *path;
-    size_t dirlen;
-    int i;
+    int i, start;
 
-    for (i = 0; i < array_len(&search_path_list); ++i) {
-        path = array_get(&search_path_list, i);
-        dirlen = strlen(path);
-        while (path[dirlen - 1] == '/') {
-            dirlen--;
-            assert(dirlen);
+    start = 0;
+    if (has_resolved) {
+        entry = hash_lookup(&resolved, name_key(name, strlen(name)));
+        if (entry) {
+            start = entry->index;
+            include_stats.cached += start;
         }
-        path = create_path(path, dirlen, name);
+    }
+
+    for (i = start; i < array_len(&search_path_list); ++i) {
+        if (!may_exist(i, name)) {
+            include_stats.skipped++;
+            continue;
+        }
+
+        path = search_path(i, name);
+        if (is_include_guarded(path)) {
+            remember_include(name, i);
+            return;
+        }
+
+        include_stats.opens++;
         source.file = fopen(path, "r");
         if (source.file) {
             source.path = str_register(path, strlen(path));
             source.dirlen = path_dirlen(path);
+            remember_include(name, i);
             break;
         }
     }
@@ -205,12 +721,42 @@ INTERNAL void include_system_file(const char *name)
     }
 }
 
+INTERNAL void include_once(void)
+{
+    struct include_guard *guard;
+
+    guard = add_include_guard(canonical_path(current_file()->path));
+    guard->once = 1;
+    prelude_add_guard(guard->path, guard->macro, 1);
+}
+
+INTERNAL void define_include_guard(String path, String macro, int once)
+{
+    struct include_guard *guard;
+
+    guard = add_include_guard(path);
+    guard->macro = macro;
+    guard->once = once;
+}
+
+INTERNAL void set_include_barrier(void)
+{
+    barrier = array_len(&source_stack);
+}
+
 INTERNAL int add_include_search_path(const char *path)
 {
     array_push_back(&search_path_list, path);
     return 0;
 }
 
+INTERNAL const char *get_include_search_path(int i)
+{
+    return i < array_len(&search_path_list)
+        ? array_get(&search_path_list, i)
+        : NULL;
+}
+
 INTERNAL void set_input_file(const char *path, int is_string_stream)
 {
     const char *sep;
@@ -219,6 +765,11 @@ INTERNAL void set_input_file(const char *path, int is_string_stream)
     while (pop_file() != EOF)
         ;
 
+    barrier = 0;
+    if (has_guards) {
+        hash_clear(&guards);
+    }
+
     if (!rline) {
         rlen = FILE_BUFFER_SIZE;
         rline = calloc(rlen, sizeof(*rline));
@@ -253,6 +804,50 @@ INTERNAL void set_input_file(const char *path, int is_string_stream)
     push_file(source);
 }
 
+/*
+ * Find first occurrence of either character, or the terminating zero.
+ * Count newlines skipped on the way if requested.
+ */
+NO_SANITIZE_ADDRESS
+static const char *scan_until(const char *ptr, char a, char b, int *lines)
+{
+#if defined(SCAN_WIDTH)
+    int k;
+    const char *base;
+    scan_block v;
+    uint32_t stop, nl, head;
+
+    base = (const char *) ((uintptr_t) ptr & ~(uintptr_t) (SCAN_WIDTH - 1));
+    head = ~(uint32_t) 0 << (ptr - base);
+    for (;;) {
+        v = scan_load(base);
+        stop = (scan_eq(v, a) | scan_eq(v, b) | scan_eq(v, '\0')) & head;
+        nl = lines ? scan_eq(v, '\n') & head : 0;
+        if (stop) {
+            k = __builtin_ctz(stop);
+            if (lines) {
+                *lines += __builtin_popcount(nl & ~(~(uint32_t) 0 << k));
+            }
+            return base + k;
+        }
+        if (lines) {
+            *lines += __builtin_popcount(nl);
+        }
+        base += SCAN_WIDTH;
+        head = ~(uint32_t) 0;
+    }
+#else
+    while (*ptr != a && *ptr != b && *ptr != '\0') {
+        if (lines && *ptr == '\n') {
+            *lines += 1;
+        }
+        ptr++;
+    }
+
+    return ptr;
+#endif
+}
+
 /*
  * Consume input until encountering end of comment. Return number of
  * characters read, or 0 if end of input reached.
@@ -262,25 +857,22 @@ INTERNAL void set_input_file(const char *path, int is_string_stream)
  */
 static size_t read_comment(const char *line, int *linecount)
 {
-    char c;
     const char *ptr;
 
     ptr = line;
-    do {
-        c = *ptr++;
-        if (c == '*') {
-            while (*ptr == '\\' && ptr[1] == '\n') {
-                *linecount += 1;
-                ptr += 2;
-            }
-            if (*ptr == '/') {
-                return ptr + 1 - line;
-            }
-        } else if (c == '\n') {
+    for (;;) {
+        ptr = scan_until(ptr, '*', '*', linecount);
+        if (*ptr++ == '\0')
+            return 0;
+
+        while (*ptr == '\\' && ptr[1] == '\n') {
             *linecount += 1;
+            ptr += 2;
         }
-    } while (c != '\0');
-    return 0;
+        if (*ptr == '/') {
+            return ptr + 1 - line;
+        }
+    }
 }
 
 /*
@@ -293,16 +885,18 @@ static size_t read_line_comment(const char *line, int *linecount)
     const char *ptr;
 
     ptr = line;
-    do {
+    for (;;) {
+        ptr = scan_until(ptr, '\\', '\n', NULL);
         c = *ptr++;
-        if (c == '\\' && *ptr == '\n') {
-            *linecount += 1;
-            ptr++;
+        if (c == '\0') {
+            return 0;
         } else if (c == '\n') {
             return ptr - line;
+        } else if (*ptr == '\n') {
+            *linecount += 1;
+            ptr++;
         }
-    } while (c != '\0');
-    return 0;
+    }
 }
 
 /*
@@ -393,6 +987,51 @@ static size_t read_literal(const char *line, char **buf, int *lines)
     return 0;
 }
 
+static int is_plain(char c)
+{
+    switch (c) {
+    case '\n':
+    case '\\':
+    case '?':
+    case '\'':
+    case '"':
+    case '/':
+    case '*':
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+/*
+ * Count characters which are copied unchanged by read_line, stopping
+ * at anything that can start a comment, literal, trigraph or line
+ * continuation.
+ */
+static size_t span_plain(const char *ptr, size_t len)
+{
+    size_t i = 0;
+#if defined(SCAN_WIDTH)
+    scan_block v;
+    uint32_t stop;
+
+    for (; i + SCAN_WIDTH <= len; i += SCAN_WIDTH) {
+        v = scan_loadu(ptr + i);
+        stop = scan_eq(v, '\n') | scan_eq(v, '\\') | scan_eq(v, '?')
+            | scan_eq(v, '\'') | scan_eq(v, '"') | scan_eq(v, '/')
+            | scan_eq(v, '*');
+        if (stop) {
+            return i + __builtin_ctz(stop);
+        }
+    }
+#endif
+    while (i < len && is_plain(ptr[i])) {
+        i++;
+    }
+
+    return i;
+}
+
 /*
  * Read initial part of line, until forming a complete source line ready
  * for tokenization. Store the result in rline, with the following
@@ -424,6 +1063,15 @@ static size_t read_line(const char *line, size_t len, int *linecount)
     assert(ptr[-1] == '\0');
     end = line;
     do {
+        count = span_plain(end, len - (end - line));
+        if (count) {
+            memcpy(ptr, end, count);
+            ptr += count;
+            end += count;
+            if (end - line == len)
+                break;
+        }
+
         switch (*end) {
         case '\n':
             *linecount += lines + 1;
@@ -495,6 +1143,27 @@ static char *initial_preprocess_line(struct source *fn)
     size_t added;
     assert(fn->buffer);
     assert(fn->processed <= fn->read);
+    if (fn->is_whole_file) {
+        if (fn->processed == fn->read) {
+            return NULL;
+        }
+
+        added = read_line(
+            fn->buffer + fn->processed,
+            fn->read - fn->processed,
+            &fn->line);
+        if (!added) {
+            if (fn->buffer[fn->read - 1] != '\n') {
+                error("Missing newline at end of file.");
+            }
+            error("Unable to process the whole input.");
+            exit(1);
+        }
+
+        fn->processed += added;
+        return rline + 1;
+    }
+
     assert(fn->read < fn->size);
     do {
         if (fn->processed == fn->read || !fn->processed) {
@@ -560,6 +1229,140 @@ static char *initial_preprocess_line(struct source *fn)
     return rline + 1;
 }
 
+static const char *skip_space(const char *line)
+{
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+
+    return line;
+}
+
+/* Match identifier at start of line, returning the end of it. */
+static const char *skip_identifier(const char *line)
+{
+    if (isalpha((unsigned char) *line) || *line == '_') {
+        do {
+            line++;
+        } while (isalnum((unsigned char) *line) || *line == '_');
+    }
+
+    return line;
+}
+
+static int is_word(const char *start, const char *end, const char *word)
+{
+    return (size_t) (end - start) == strlen(word)
+        && !strncmp(start, word, end - start);
+}
+
+/*
+ * Read macro name controlling conditional directive, which is one of
+ * the following forms:
+ *
+ *     #ifndef FOO_H
+ *     #if !defined FOO_H
+ *     #if !defined(FOO_H)
+ *
+ */
+static int read_guard_macro(
+    const char *line,
+    const char *end,
+    int is_ifndef,
+    String *macro)
+{
+    int paren = 0;
+
+    line = skip_space(end);
+    if (!is_ifndef) {
+        if (*line != '!')
+            return 0;
+        line = skip_space(line + 1);
+        end = skip_identifier(line);
+        if (!is_word(line, end, "defined"))
+            return 0;
+        line = skip_space(end);
+        if (*line == '(') {
+            paren = 1;
+            line = skip_space(line + 1);
+        }
+    }
+
+    end = skip_identifier(line);
+    if (end == line)
+        return 0;
+
+    *macro = str_register(line, end - line);
+    line = skip_space(end);
+    if (paren) {
+        if (*line != ')')
+            return 0;
+        line = skip_space(line + 1);
+    }
+
+    return *line == '\0';
+}
+
+/*
+ * Update guard detection state of source file with the next line,
+ * before it is preprocessed.
+ */
+static void track_include_guard(struct source *source, const char *line)
+{
+    const char *end;
+
+    if (source->guard == GUARD_NONE)
+        return;
+
+    line = skip_space(line);
+    if (*line == '\0')
+        return;
+
+    if (*line != '#') {
+        if (source->guard != GUARD_OPEN) {
+            source->guard = GUARD_NONE;
+        }
+        return;
+    }
+
+    line = skip_space(line + 1);
+    end = skip_identifier(line);
+    switch (source->guard) {
+    case GUARD_START:
+        if ((is_word(line, end, "ifndef") || is_word(line, end, "if"))
+            && read_guard_macro(line, end, is_word(line, end, "ifndef"),
+                &source->guard_macro))
+        {
+            source->guard = GUARD_OPEN;
+            source->guard_depth = 1;
+        } else if (*skip_space(line) != '\0') {
+            source->guard = GUARD_NONE;
+        }
+        break;
+    case GUARD_OPEN:
+        if (is_word(line, end, "if")
+            || is_word(line, end, "ifdef")
+            || is_word(line, end, "ifndef"))
+        {
+            source->guard_depth++;
+        } else if (is_word(line, end, "endif")) {
+            if (--source->guard_depth == 0) {
+                source->guard = GUARD_CLOSED;
+            }
+        } else if (source->guard_depth == 1
+            && (is_word(line, end, "else") || is_word(line, end, "elif")))
+        {
+            source->guard = GUARD_NONE;
+        }
+        break;
+    default:
+        if (*skip_space(line) != '\0') {
+            source->guard = GUARD_NONE;
+        }
+        break;
+    }
+}
+
 static int is_directive(const char *line)
 {
     while (*line == ' ' || *line == '\t') {
@@ -590,11 +1393,17 @@ INTERNAL char *getprepline(void)
         }
         line = initial_preprocess_line(source);
         current_file_line += source->line - loc;
-        if (!line) {
+        if (line) {
+            track_include_guard(source, line);
+        } else {
             stale = 1;
             if (pop_file() == EOF) {
                 return NULL;
             }
+            if (array_len(&source_stack) == barrier) {
+                barrier = 0;
+                return NULL;
+            }
         }
         if (!in_active_block() && !is_directive(line)) {
             line = NULL;
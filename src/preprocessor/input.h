@@ -18,10 +18,28 @@ INTERNAL void input_finalize(void);
  */
 INTERNAL int add_include_search_path(const char *);
 
+/* Get search path at index, or NULL past the end of the list. */
+INTERNAL const char *get_include_search_path(int i);
+
 /* Push new include file. */
 INTERNAL void include_file(const char *);
 INTERNAL void include_system_file(const char *);
 
+/*
+ * Mark current file as included once, from #pragma once. Later includes
+ * resolving to the same path are skipped.
+ */
+INTERNAL void include_once(void);
+
+/* Restore include guard of file, as if read before. */
+INTERNAL void define_include_guard(String path, String macro, int once);
+
+/*
+ * Signal end of input once when files included after this call are
+ * read, returning to the current file.
+ */
+INTERNAL void set_include_barrier(void);
+
 /*
  * Yield next line ready for further preprocessing. Joins continuations,
  * and replaces comments with a single space. Line implicitly ends with
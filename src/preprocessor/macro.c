@@ -5,8 +5,10 @@
 #endif
 #include "input.h"
 #include "macro.h"
+#include "prelude.h"
 #include "strtab.h"
 #include "tokenize.h"
+#include <lacc/arena.h>
 #include <lacc/context.h>
 #include <lacc/hash.h>
 
@@ -22,23 +24,36 @@
 #define HASH_TABLE_BUCKETS 1024
 
 static struct hash_table macro_hash_table;
-static int new_macro_added;
 
-typedef array_of(String) ExpandStack;
+/*
+ * Definitions are stored in arena for the current translation unit,
+ * together with a copy of the replacement list sized to fit.
+ */
+static struct arena macros;
+
+/*
+ * Each call to expand starts a new context, where macros being expanded
+ * in enclosing contexts are visible again. Macros being expanded in the
+ * active context are marked by storing the context number, making the
+ * check for recursion constant time.
+ */
+static unsigned active_context, contexts;
+
+/* Number of macros being expanded in active context. */
+static unsigned active_depth;
 
 /* Keep track of arrays being recycled. */
 static array_of(TokenArray) arrays;
-static array_of(ExpandStack) stacks;
 
-static int is_expanded(const ExpandStack *scope, String name)
+static int is_expanded(String name)
 {
-    int i;
-    for (i = 0; i < array_len(scope); ++i) {
-        if (!str_cmp(array_get(scope, i), name)) {
-            return 1;
-        }
-    }
-    return 0;
+    const struct macro *def;
+
+    if (!active_depth)
+        return 0;
+
+    def = hash_lookup(&macro_hash_table, name);
+    return def && def->context == active_context;
 }
 
 INTERNAL TokenArray get_token_array(void)
@@ -46,7 +61,6 @@ INTERNAL TokenArray get_token_array(void)
     TokenArray list = {0};
     if (array_len(&arrays)) {
         list = array_pop_back(&arrays);
-        array_zero(&list);
         array_empty(&list);
     }
 
@@ -58,23 +72,6 @@ INTERNAL void release_token_array(TokenArray list)
     array_push_back(&arrays, list);
 }
 
-static ExpandStack get_expand_stack(void)
-{
-    ExpandStack stack = {0};
-    if (array_len(&stacks)) {
-        stack = array_pop_back(&stacks);
-        array_zero(&stack);
-        array_empty(&stack);
-    }
-
-    return stack;
-}
-
-static void release_expand_stack(ExpandStack stack)
-{
-    array_push_back(&stacks, stack);
-}
-
 static int macrocmp(const struct macro *a, const struct macro *b)
 {
     int i;
@@ -103,25 +100,28 @@ static String macro_hash_key(void *ref)
     return ((struct macro *) ref)->name;
 }
 
-static void macro_hash_del(void *ref)
-{
-    struct macro *macro = (struct macro *) ref;
-    release_token_array(macro->replacement);
-    free(macro);
-}
-
 static void *macro_hash_add(void *ref)
 {
+    size_t size;
     struct macro *macro, *arg;
 
     arg = (struct macro *) ref;
-    macro = calloc(1, sizeof(*macro));
+    macro = arena_alloc(&macros, sizeof(*macro));
     *macro = *arg;
+
     /*
-     * Signal that the hash table has ownership now, and it will not be
-     * freed in define().
+     * Replacement list is never modified after definition, except for
+     * the single token of __FILE__ and __LINE__. The buffer passed in
+     * is released back for reuse in define().
      */
-    new_macro_added = 1;
+    size = array_len(&arg->replacement) * sizeof(struct token);
+    macro->replacement.capacity = array_len(&arg->replacement);
+    macro->replacement.data = NULL;
+    if (size) {
+        macro->replacement.data = arena_alloc(&macros, size);
+        memcpy(macro->replacement.data, arg->replacement.data, size);
+    }
+
     return macro;
 }
 
@@ -135,10 +135,11 @@ INTERNAL void macro_reset(void)
             HASH_TABLE_BUCKETS,
             macro_hash_key,
             macro_hash_add,
-            macro_hash_del);
+            NULL);
         initialized = 1;
     } else {
         hash_clear(&macro_hash_table);
+        arena_reset(&macros);
     }
 }
 
@@ -146,21 +147,15 @@ INTERNAL void macro_finalize(void)
 {
     int i;
     TokenArray list;
-    ExpandStack stack;
 
     hash_destroy(&macro_hash_table);
+    arena_free(&macros);
     for (i = 0; i < array_len(&arrays); ++i) {
         list = array_get(&arrays, i);
         array_clear(&list);
     }
 
-    for (i = 0; i < array_len(&stacks); ++i) {
-        stack = array_get(&stacks, i);
-        array_clear(&stack);
-    }
-
     array_clear(&arrays);
-    array_clear(&stacks);
 }
 
 static struct token get__line__token(void)
@@ -185,7 +180,7 @@ static struct token get__file__token(void)
  * Replace __FILE__ with file name, and __LINE__ with line number, by
  * mutating the replacement list on the fly.
  */
-const struct macro *macro_definition(String name)
+static struct macro *find_macro(String name)
 {
     struct macro *ref;
 
@@ -201,6 +196,11 @@ const struct macro *macro_definition(String name)
     return ref;
 }
 
+const struct macro *macro_definition(String name)
+{
+    return find_macro(name);
+}
+
 INTERNAL void define(struct macro macro)
 {
     struct macro *ref;
@@ -208,7 +208,6 @@ INTERNAL void define(struct macro macro)
         builtin__file__ = SHORT_STRING_INIT("__FILE__"),
         builtin__line__ = SHORT_STRING_INIT("__LINE__");
 
-    new_macro_added = 0;
     ref = hash_insert(&macro_hash_table, &macro);
     if (macrocmp(ref, &macro)) {
         error("Redefinition of macro '%s' with different substitution.",
@@ -217,15 +216,15 @@ INTERNAL void define(struct macro macro)
     } else {
         ref->is__file__ = !str_cmp(builtin__file__, ref->name);
         ref->is__line__ = !str_cmp(builtin__line__, ref->name);
-        if (!new_macro_added) {
-            release_token_array(macro.replacement);
-        }
+        release_token_array(macro.replacement);
+        prelude_add_macro(ref);
     }
 }
 
 INTERNAL void undef(String name)
 {
     hash_remove(&macro_hash_table, name);
+    prelude_remove_macro(name);
 }
 
 #if !NDEBUG
@@ -299,40 +298,27 @@ static enum token_type peek_token(const TokenArray *list, int i)
 }
 
 /*
- * Replace content of list in segment [start, start + gaplength] with
- * contents of slice. The gap is from reading arguments from list, and
- * the slice is result of expanding it. Slice might be smaller or larger
- * than the gap.
+ * Append tokens to end of list, growing capacity geometrically such
+ * that building a list from many small pieces takes linear time.
  */
-static void array_replace_slice(
+static void append_tokens(
     TokenArray *list,
-    unsigned start,
-    unsigned gaplength,
-    TokenArray *slice)
+    const struct token *tokens,
+    unsigned n)
 {
     unsigned length;
-    assert(start + gaplength <= array_len(list));
-
-    length = array_len(list) - gaplength + array_len(slice);
-    array_realloc(list, length);
 
-    /*
-     * Move trailing data out of the way, or move closer to prefix, to
-     * align exactly where slice is inserted.
-     */
-    if (array_len(slice) != gaplength) {
-        memmove(
-            list->data + start + array_len(slice),
-            list->data + start + gaplength,
-            (array_len(list) - (start + gaplength)) * sizeof(*list->data));
+    length = array_len(list) + n;
+    if (length > list->capacity) {
+        list->capacity *= 2;
+        if (list->capacity < length) {
+            list->capacity = length;
+        }
+        list->data = realloc(list->data, list->capacity * sizeof(*tokens));
     }
 
-    /* Copy slice directly into now vacant space in list. */
-    if (array_len(slice)) {
-        memcpy(
-            list->data + start,
-            slice->data,
-            array_len(slice) * sizeof(*list->data));
+    if (n) {
+        memcpy(list->data + array_len(list), tokens, n * sizeof(*tokens));
     }
 
     list->length = length;
@@ -440,16 +426,21 @@ static TokenArray expand_stringify_and_paste(
     return list;
 }
 
-static int expand_line(ExpandStack *scope, TokenArray *list);
+static int expand_line(TokenArray *list);
 
+/*
+ * Expand macro invocation, with arguments already read. The result is
+ * built by appending to a new list, substituting each parameter with
+ * the expanded argument, and then rescanned for more macros.
+ */
 static TokenArray expand_macro(
-    ExpandStack *scope,
-    const struct macro *def,
+    struct macro *def,
     TokenArray *args)
 {
-    int i, j;
+    int i;
+    unsigned context;
     struct token t;
-    TokenArray list;
+    TokenArray list, subst;
 
     list = expand_stringify_and_paste(def, args);
     if (def->params > 0) {
@@ -463,25 +454,36 @@ static TokenArray expand_macro(
             }
         }
 
+        subst = get_token_array();
         for (i = 0; i < array_len(&list); ++i) {
             t = array_get(&list, i);
             if (t.token == PARAM) {
-                j = t.d.val.i;
-                if (!array_len(&args[j])) {
-                    array_erase(&list, i);
-                    i--;
-                } else {
-                    array_replace_slice(&list, i, 1, &args[j]);
-                }
+                append_tokens(
+                    &subst,
+                    args[t.d.val.i].data,
+                    array_len(&args[t.d.val.i]));
+            } else {
+                array_push_back(&subst, t);
             }
         }
 
+        release_token_array(list);
+        list = subst;
         for (i = 0; i < def->params; ++i)
             release_token_array(args[i]);
         free(args);
     }
 
-    expand_line(scope, &list);
+    /*
+     * Rescan with the macro itself hidden. It might already be hidden
+     * in an enclosing context, which is restored after.
+     */
+    context = def->context;
+    def->context = active_context;
+    active_depth++;
+    expand_line(&list);
+    active_depth--;
+    def->context = context;
     return list;
 }
 
@@ -494,7 +496,6 @@ static TokenArray expand_macro(
  * first ')'.
  */
 static TokenArray read_arg(
-    ExpandStack *scope,
     int is_va_arg,
     const struct token *list,
     const struct token **endptr)
@@ -520,7 +521,7 @@ static TokenArray read_arg(
             }
         }
         t = *list++;
-        if (t.is_expandable && is_expanded(scope, t.d.string)) {
+        if (t.is_expandable && is_expanded(t.d.string)) {
             t.disable_expand = 1;
         }
         array_push_back(&arg, t);
@@ -531,7 +532,6 @@ static TokenArray read_arg(
 }
 
 static TokenArray *read_args(
-    ExpandStack *scope,
     const struct macro *def,
     const struct token *list,
     const struct token **endptr)
@@ -549,7 +549,7 @@ static TokenArray *read_args(
         if (def->params) {
             args = calloc(def->params, sizeof(*args));
             for (i = 0; i < def->params - def->is_vararg; ++i) {
-                args[i] = read_arg(scope, 0, list, &list);
+                args[i] = read_arg(0, list, &list);
                 if (list->token != ',') {
                     if (i == def->params - 1)
                         break;
@@ -566,7 +566,7 @@ static TokenArray *read_args(
             /* Last parameter can be optional for vararg macros. */
             if (def->is_vararg && i != -1) {
                 assert(i == def->params - 1);
-                args[i] = read_arg(scope, 1, list, &list);
+                args[i] = read_arg(1, list, &list);
             }
         }
 
@@ -582,65 +582,86 @@ static TokenArray *read_args(
     return args;
 }
 
-static int expand_line(ExpandStack *scope, TokenArray *list)
+/*
+ * Expand all macros in list, in a single pass from left to right.
+ * Tokens are copied to a new list on the first expansion, with results
+ * appended as they are produced. Return number of macros expanded.
+ */
+static int expand_line(TokenArray *list)
 {
-    int size, i, n;
+    int i, n;
     struct token t;
-    const struct macro *def;
+    struct macro *def;
     const struct token *endptr;
-    TokenArray *args, expn;
+    TokenArray *args, expn, out = {0};
 
     for (n = 0, i = 0; i < array_len(list); ++i) {
         t = array_get(list, i);
-        if (!t.is_expandable || t.disable_expand) {
-            continue;
-        }
-
-        def = macro_definition(t.d.string);
-        if (!def)
-            continue;
-
-        if (is_expanded(scope, t.d.string)) {
-            array_get(list, i).disable_expand = 1;
-            continue;
+        def = NULL;
+        if (t.is_expandable && !t.disable_expand) {
+            def = find_macro(t.d.string);
+            if (def && def->context == active_context) {
+                t.disable_expand = 1;
+                array_get(list, i).disable_expand = 1;
+                def = NULL;
+            }
         }
 
         /* Only expand if next token is '(' */
-        if (def->type == FUNCTION_LIKE
+        if (def
+            && def->type == FUNCTION_LIKE
             && (i == array_len(list) - 1
                 || array_get(list, i + 1).token != '('))
         {
+            def = NULL;
+        }
+
+        if (!def) {
+            if (n) {
+                array_push_back(&out, t);
+            }
             continue;
         }
 
-        args = read_args(scope, def, list->data + i + 1, &endptr);
-        array_push_back(scope, def->name);
-        expn = expand_macro(scope, def, args);
-        size = (endptr - list->data) - i;
-        (void) array_pop_back(scope);
+        if (!n) {
+            out = get_token_array();
+            append_tokens(&out, list->data, i);
+        }
+
+        args = read_args(def, list->data + i + 1, &endptr);
+        expn = expand_macro(def, args);
 
         /* Fix leading whitespace after expansion. */
         if (array_len(&expn)) {
             expn.data[0].leading_whitespace = t.leading_whitespace;
         }
 
-        /* Squeeze in expansion in list. */
-        array_replace_slice(list, i, size, &expn);
-        i += array_len(&expn) - 1;
+        append_tokens(&out, expn.data, array_len(&expn));
         release_token_array(expn);
+        i = (endptr - list->data) - 1;
         n += 1;
     }
 
+    if (n) {
+        release_token_array(*list);
+        *list = out;
+    }
+
     return n;
 }
 
 INTERNAL int expand(TokenArray *list)
 {
     int n;
-    ExpandStack stack = get_expand_stack();
-
-    n = expand_line(&stack, list);
-    release_expand_stack(stack);
+    unsigned context, depth;
+
+    context = active_context;
+    depth = active_depth;
+    active_context = ++contexts;
+    active_depth = 0;
+    n = expand_line(list);
+    active_context = context;
+    active_depth = depth;
     return n;
 }
 
@@ -28,6 +28,13 @@ struct macro {
     uint32_t is__file__ : 1;
     uint32_t is_vararg : 1;
 
+    /*
+     * Expansion context where the macro is currently being expanded,
+     * such that occurrences of its name in the result are not expanded
+     * again. Zero when not being expanded.
+     */
+    unsigned context;
+
     /*
      * A substitution is either a token or a parameter, and parameters
      * are represented by PARAM tokens with an integer index between
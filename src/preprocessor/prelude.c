@@ -0,0 +1,755 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "input.h"
+#include "prelude.h"
+#include "preprocess.h"
+#include "strtab.h"
+#include "../util/report.h"
+#include <lacc/context.h>
+#include <lacc/hash.h>
+
+#include <kcs/assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <xunistd.h>
+#if !defined(KCC_WINDOWS)
+# include <fcntl.h>
+# include <sys/mman.h>
+#endif
+
+/*
+ * Bump when the snapshot layout changes. Token numbering is part of the
+ * key as well, covering changes to the set of keywords.
+ */
+#define PRELUDE_VERSION 3
+
+/* Magic, version, body size and checksum. */
+#define PRELUDE_HEADER_SIZE 24
+
+/*
+ * Snapshot file layout, following the header.
+ *
+ *     key
+ *     files read, each with path, size and modification time
+ *     strings, each stored once and referenced by index below
+ *     events in order, being macro definitions, include guards and
+ *         pragmas
+ *     tokens for the parser
+ *
+ * Integers are stored in host byte order, as the snapshot is only used
+ * on the machine where it was created.
+ */
+enum prelude_event {
+    EVENT_DEFINE,
+    EVENT_UNDEF,
+    EVENT_GUARD,
+    EVENT_PRAGMA
+};
+
+typedef array_of(char) ByteArray;
+
+struct snapshot_reader {
+    const char *ptr;
+    const char *end;
+    String *strings;
+    uint32_t count;
+};
+
+/* Index of string in the snapshot, assigned on first use. */
+struct snapshot_string {
+    String str;
+    uint32_t index;
+};
+
+/*
+ * Snapshot being captured while the prelude is read from source. Most
+ * tokens repeat a few names, which are registered once when loading.
+ */
+static struct {
+    int active;
+    int is_valid;
+    unsigned files;
+    unsigned events;
+    ByteArray deps;
+    ByteArray body;
+    ByteArray strings;
+    unsigned count;
+    struct hash_table index;
+} capture;
+
+static const char prelude_magic[8] = "KCSPREL";
+
+static void put_bytes(ByteArray *buf, const void *data, size_t len)
+{
+    if (buf->length + len > buf->capacity) {
+        array_realloc(buf, (buf->length + len) * 2);
+    }
+
+    memcpy(buf->data + buf->length, data, len);
+    buf->length += len;
+}
+
+static void put_u32(ByteArray *buf, uint32_t value)
+{
+    put_bytes(buf, &value, sizeof(value));
+}
+
+static void put_i64(ByteArray *buf, int64_t value)
+{
+    put_bytes(buf, &value, sizeof(value));
+}
+
+static void put_raw(ByteArray *buf, const char *str, size_t len)
+{
+    put_u32(buf, len);
+    put_bytes(buf, str, len);
+}
+
+static String string_key(void *p)
+{
+    return ((struct snapshot_string *) p)->str;
+}
+
+static void *string_add(void *p)
+{
+    struct snapshot_string *entry;
+
+    entry = malloc(sizeof(*entry));
+    *entry = *(struct snapshot_string *) p;
+    return entry;
+}
+
+static void string_del(void *p)
+{
+    free(p);
+}
+
+static void put_string(ByteArray *buf, String str)
+{
+    struct snapshot_string entry, *found;
+
+    entry.str = str;
+    entry.index = capture.count;
+    found = hash_insert(&capture.index, &entry);
+    if (found->index == capture.count) {
+        put_raw(&capture.strings, str_raw(str), str.len);
+        capture.count++;
+    }
+
+    put_u32(buf, found->index);
+}
+
+static void put_token(ByteArray *buf, struct token t)
+{
+    put_u32(buf, t.token);
+    put_u32(buf, t.leading_whitespace
+        | (t.is_expandable << 16)
+        | (t.disable_expand << 17));
+    put_bytes(buf, &t.type, sizeof(t.type));
+    if (t.token == NUMBER || t.token == PARAM) {
+        put_bytes(buf, &t.d.val, sizeof(t.d.val));
+    } else {
+        put_string(buf, t.d.string);
+    }
+}
+
+static void put_tokens(ByteArray *buf, const TokenArray *list)
+{
+    int i;
+
+    put_u32(buf, array_len(list));
+    for (i = 0; i < array_len(list); ++i) {
+        put_token(buf, array_get(list, i));
+    }
+}
+
+static int get_bytes(struct snapshot_reader *r, void *data, size_t len)
+{
+    if ((size_t) (r->end - r->ptr) < len)
+        return 0;
+
+    memcpy(data, r->ptr, len);
+    r->ptr += len;
+    return 1;
+}
+
+static int get_u32(struct snapshot_reader *r, uint32_t *value)
+{
+    return get_bytes(r, value, sizeof(*value));
+}
+
+static int get_i64(struct snapshot_reader *r, int64_t *value)
+{
+    return get_bytes(r, value, sizeof(*value));
+}
+
+/* Read string pointing into the snapshot, which is not terminated. */
+static int get_raw(struct snapshot_reader *r, const char **str, uint32_t *len)
+{
+    if (!get_u32(r, len) || (size_t) (r->end - r->ptr) < *len)
+        return 0;
+
+    *str = r->ptr;
+    r->ptr += *len;
+    return 1;
+}
+
+static int get_string(struct snapshot_reader *r, String *str)
+{
+    uint32_t index;
+
+    if (!get_u32(r, &index) || index >= r->count)
+        return 0;
+
+    *str = r->strings[index];
+    return 1;
+}
+
+/* Register each string of the snapshot once. */
+static int get_strings(struct snapshot_reader *r)
+{
+    uint32_t i, len;
+    const char *ptr;
+
+    if (!get_u32(r, &r->count)
+        || (size_t) (r->end - r->ptr) / sizeof(uint32_t) < r->count)
+        return 0;
+
+    r->strings = malloc(r->count * sizeof(*r->strings));
+    for (i = 0; i < r->count; ++i) {
+        if (!get_raw(r, &ptr, &len) || len > UINT16_MAX)
+            return 0;
+        r->strings[i] = str_register(ptr, len);
+    }
+
+    return 1;
+}
+
+static int get_token(struct snapshot_reader *r, struct token *t)
+{
+    uint32_t token, flags;
+
+    memset(t, 0, sizeof(*t));
+    if (!get_u32(r, &token)
+        || !get_u32(r, &flags)
+        || !get_bytes(r, &t->type, sizeof(t->type)))
+        return 0;
+
+    t->token = token;
+    t->leading_whitespace = flags & 0xFFFF;
+    t->is_expandable = (flags >> 16) & 1;
+    t->disable_expand = (flags >> 17) & 1;
+    if (t->token == NUMBER || t->token == PARAM) {
+        return get_bytes(r, &t->d.val, sizeof(t->d.val));
+    }
+
+    return get_string(r, &t->d.string);
+}
+
+static int get_tokens(struct snapshot_reader *r, TokenArray *list)
+{
+    uint32_t i, n, len;
+    struct token t;
+
+    /* Each token takes at least twelve bytes, bounding the count. */
+    if (!get_u32(r, &n) || (size_t) (r->end - r->ptr) / 12 < n)
+        return 0;
+
+    len = array_len(list) + n;
+    array_realloc(list, len);
+    for (i = 0; i < n; ++i) {
+        if (!get_token(r, &t))
+            return 0;
+        array_push_back(list, t);
+    }
+
+    return 1;
+}
+
+/*
+ * FNV-1a taking eight bytes at a time, used both for naming snapshots
+ * and to detect corruption.
+ */
+static uint64_t snapshot_checksum(const char *data, size_t len)
+{
+    size_t i;
+    uint64_t word, hash = 0xcbf29ce484222325ull;
+
+    for (i = 0; i + sizeof(word) <= len; i += sizeof(word)) {
+        memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 0x100000001b3ull;
+    }
+
+    for (; i < len; ++i) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static int is_absolute_path(const char *path)
+{
+    return path[0] == '/'
+        || path[0] == '\\'
+        || (isalpha((unsigned char) path[0]) && path[1] == ':');
+}
+
+static int stat_file(const char *path, int64_t *size, int64_t *mtime)
+{
+    struct stat st;
+
+    if (stat(path, &st))
+        return 0;
+
+    *size = st.st_size;
+    *mtime = st.st_mtime;
+#if defined(KCC_LINUX)
+    *mtime = *mtime * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return 1;
+}
+
+/*
+ * Everything except the files read which determines the result of
+ * preprocessing the prelude. Snapshots are named by hash of the part
+ * before configuration, letting each target and set of search paths
+ * have its own. Changing macros on the command line replaces it.
+ */
+static char *prelude_key(const char *config, uint64_t *hash)
+{
+    int i;
+    char buf[4096];
+    const char *path;
+    ByteArray key = {0};
+
+    sprintf(buf, "kcs prelude %d %d %d std=%d target=%d\n",
+        PRELUDE_VERSION, PREP_STRING, (int) sizeof(struct token),
+        context.standard, context.target);
+    put_bytes(&key, buf, strlen(buf));
+    for (i = 0; (path = get_include_search_path(i)) != NULL; ++i) {
+        put_bytes(&key, "-I", 2);
+        if (!is_absolute_path(path) && getcwd(buf, sizeof(buf))) {
+            put_bytes(&key, buf, strlen(buf));
+            put_bytes(&key, "/", 1);
+        }
+        put_bytes(&key, path, strlen(path));
+        put_bytes(&key, "\n", 1);
+    }
+
+    *hash = snapshot_checksum(key.data, key.length);
+    if (config) {
+        put_bytes(&key, config, strlen(config));
+    }
+
+    put_bytes(&key, "", 1);
+    return key.data;
+}
+
+static char *map_snapshot(const char *path, size_t *size)
+{
+    char *data;
+#if defined(KCC_WINDOWS)
+    FILE *f;
+    long len;
+
+    f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    data = NULL;
+    if (!fseek(f, 0, SEEK_END) && (len = ftell(f)) > 0) {
+        rewind(f);
+        data = malloc(len);
+        if (fread(data, 1, len, f) != (size_t) len) {
+            free(data);
+            data = NULL;
+        }
+        *size = len;
+    }
+
+    fclose(f);
+#else
+    int fd;
+    struct stat st;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    data = NULL;
+    if (!fstat(fd, &st) && st.st_size > 0) {
+        *size = st.st_size;
+        data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+
+    close(fd);
+#endif
+    return data;
+}
+
+static void unmap_snapshot(char *data, size_t size)
+{
+#if defined(KCC_WINDOWS)
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+/*
+ * Check that snapshot is intact, was created with the same key, and
+ * that none of the files read have changed since.
+ */
+static int is_snapshot_current(
+    struct snapshot_reader *r,
+    const char *data,
+    size_t size,
+    const char *key)
+{
+    uint32_t i, n, len, version, body;
+    uint64_t sum;
+    int64_t fsize, ftime, size_now, time_now;
+    const char *str;
+    char path[4096];
+
+    r->ptr = data;
+    r->end = data + size;
+    if (size < PRELUDE_HEADER_SIZE
+        || memcmp(data, prelude_magic, sizeof(prelude_magic)))
+        return 0;
+
+    r->ptr += sizeof(prelude_magic);
+    if (!get_u32(r, &version)
+        || !get_u32(r, &body)
+        || !get_bytes(r, &sum, sizeof(sum))
+        || version != PRELUDE_VERSION
+        || body != size - PRELUDE_HEADER_SIZE
+        || sum != snapshot_checksum(r->ptr, body))
+        return 0;
+
+    if (!get_raw(r, &str, &len)
+        || len != strlen(key)
+        || memcmp(str, key, len))
+        return 0;
+
+    if (!get_u32(r, &n))
+        return 0;
+
+    for (i = 0; i < n; ++i) {
+        if (!get_raw(r, &str, &len)
+            || len >= sizeof(path)
+            || !get_i64(r, &fsize)
+            || !get_i64(r, &ftime))
+            return 0;
+
+        memcpy(path, str, len);
+        path[len] = '\0';
+        if (!stat_file(path, &size_now, &time_now)
+            || size_now != fsize
+            || time_now != ftime)
+        {
+            verbose("Prelude snapshot is stale, %s changed.", path);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int apply_event(struct snapshot_reader *r)
+{
+    uint32_t event, type, params, is_vararg, once;
+    String path, name;
+    struct macro macro = {0};
+    TokenArray line;
+
+    if (!get_u32(r, &event))
+        return 0;
+
+    switch (event) {
+    case EVENT_DEFINE:
+        if (!get_string(r, &macro.name)
+            || !get_u32(r, &type)
+            || !get_u32(r, &params)
+            || !get_u32(r, &is_vararg))
+            return 0;
+        macro.type = type;
+        macro.params = params;
+        macro.is_vararg = is_vararg;
+        macro.replacement = get_token_array();
+        if (!get_tokens(r, &macro.replacement)) {
+            release_token_array(macro.replacement);
+            return 0;
+        }
+        define(macro);
+        break;
+    case EVENT_UNDEF:
+        if (!get_string(r, &name))
+            return 0;
+        undef(name);
+        break;
+    case EVENT_GUARD:
+        if (!get_string(r, &path)
+            || !get_string(r, &name)
+            || !get_u32(r, &once))
+            return 0;
+        define_include_guard(path, name, once);
+        break;
+    case EVENT_PRAGMA:
+        line = get_token_array();
+        if (get_tokens(r, &line)) {
+            inject_pragma(&line);
+        }
+        release_token_array(line);
+        break;
+    default:
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Read prelude from snapshot file, returning zero if it does not exist
+ * or is not current.
+ */
+static int load_snapshot(const char *path, const char *key)
+{
+    uint32_t i, n;
+    size_t size;
+    char *data;
+    TokenArray tokens = {0};
+    struct snapshot_reader r = {0};
+
+    data = map_snapshot(path, &size);
+    if (!data)
+        return 0;
+
+    if (!is_snapshot_current(&r, data, size, key)) {
+        unmap_snapshot(data, size);
+        return 0;
+    }
+
+    if (!get_strings(&r) || !get_u32(&r, &n))
+        goto corrupt;
+
+    for (i = 0; i < n; ++i) {
+        if (!apply_event(&r))
+            goto corrupt;
+    }
+
+    if (!get_tokens(&r, &tokens) || r.ptr != r.end)
+        goto corrupt;
+
+    report_count(COUNT_TOKENS, array_len(&tokens));
+    inject_tokens(&tokens);
+    array_clear(&tokens);
+    free(r.strings);
+    unmap_snapshot(data, size);
+    verbose("Loaded prelude snapshot %s.", path);
+    return 1;
+
+corrupt:
+    error("Corrupt prelude snapshot %s.", path);
+    exit(1);
+}
+
+/*
+ * Write snapshot to temporary file first, and rename it in place. Other
+ * processes see either the old snapshot or the complete new one.
+ */
+static void write_snapshot(
+    const char *path,
+    const char *key,
+    const TokenArray *tokens)
+{
+    int ok;
+    FILE *f;
+    char *tmp;
+    uint64_t sum;
+    ByteArray body = {0}, head = {0}, list = {0};
+
+    /* Tokens add to the strings, which must be written first. */
+    put_tokens(&list, tokens);
+    put_raw(&body, key, strlen(key));
+    put_u32(&body, capture.files);
+    put_bytes(&body, capture.deps.data, capture.deps.length);
+    put_u32(&body, capture.count);
+    put_bytes(&body, capture.strings.data, capture.strings.length);
+    put_u32(&body, capture.events);
+    put_bytes(&body, capture.body.data, capture.body.length);
+    put_bytes(&body, list.data, list.length);
+
+    sum = snapshot_checksum(body.data, body.length);
+    put_bytes(&head, prelude_magic, sizeof(prelude_magic));
+    put_u32(&head, PRELUDE_VERSION);
+    put_u32(&head, body.length);
+    put_bytes(&head, &sum, sizeof(sum));
+    assert(head.length == PRELUDE_HEADER_SIZE);
+
+    tmp = malloc(strlen(path) + 16);
+    sprintf(tmp, "%s.%d", path, (int) getpid());
+    f = fopen(tmp, "wb");
+    if (f) {
+        ok = fwrite(head.data, 1, head.length, f) == head.length
+            && fwrite(body.data, 1, body.length, f) == body.length;
+        ok = !fclose(f) && ok;
+        if (!ok || rename(tmp, path)) {
+            remove(tmp);
+        } else {
+            verbose("Wrote prelude snapshot %s.", path);
+        }
+    }
+
+    free(tmp);
+    array_clear(&head);
+    array_clear(&body);
+    array_clear(&list);
+}
+
+static void include_headers(void)
+{
+    inject_line("#include <_ext.h>");
+    inject_line("#include <_builtin.h>");
+}
+
+/*
+ * Read prelude from source, preprocessing it eagerly to capture the
+ * tokens produced. Files are read in the same order as without
+ * snapshot.
+ */
+static void capture_snapshot(const char *path, const char *key)
+{
+    TokenArray tokens = {0};
+
+    capture.active = 1;
+    capture.is_valid = 1;
+    capture.files = 0;
+    capture.events = 0;
+    capture.count = 0;
+    array_empty(&capture.deps);
+    array_empty(&capture.body);
+    array_empty(&capture.strings);
+    hash_init(&capture.index, 1024, string_key, string_add, string_del);
+
+    set_include_barrier();
+    include_headers();
+    preprocess_included(&tokens);
+    capture.active = 0;
+    if (capture.is_valid && !context.errors) {
+        write_snapshot(path, key, &tokens);
+    }
+
+    array_clear(&tokens);
+    array_clear(&capture.deps);
+    array_clear(&capture.body);
+    array_clear(&capture.strings);
+    hash_destroy(&capture.index);
+}
+
+INTERNAL void include_prelude(const char *dir, const char *config)
+{
+    char *key, *path;
+    uint64_t hash;
+
+    if (!dir) {
+        include_headers();
+        return;
+    }
+
+    /*
+     * Time spent preprocessing while capturing the snapshot is still
+     * booked as preprocessing, being the innermost phase.
+     */
+    phase_begin(PHASE_PRELUDE);
+    key = prelude_key(config, &hash);
+    path = malloc(strlen(dir) + 32);
+    sprintf(path, "%s/prelude-%016llx.pch", dir, (unsigned long long) hash);
+    if (!load_snapshot(path, key)) {
+        capture_snapshot(path, key);
+    }
+
+    free(path);
+    free(key);
+    phase_end(PHASE_PRELUDE);
+}
+
+/*
+ * Files must be found at the same path regardless of working directory
+ * for the snapshot to be usable.
+ */
+INTERNAL void prelude_add_file(String path)
+{
+    int64_t size, mtime;
+    const char *str;
+
+    if (!capture.active)
+        return;
+
+    str = str_raw(path);
+    if (!is_absolute_path(str) || !stat_file(str, &size, &mtime)) {
+        capture.is_valid = 0;
+    } else {
+        put_raw(&capture.deps, str, path.len);
+        put_i64(&capture.deps, size);
+        put_i64(&capture.deps, mtime);
+        capture.files++;
+    }
+}
+
+INTERNAL void prelude_add_guard(String path, String macro, int once)
+{
+    if (!capture.active)
+        return;
+
+    put_u32(&capture.body, EVENT_GUARD);
+    put_string(&capture.body, path);
+    put_string(&capture.body, macro);
+    put_u32(&capture.body, once);
+    capture.events++;
+}
+
+INTERNAL void prelude_add_macro(const struct macro *macro)
+{
+    if (!capture.active)
+        return;
+
+    put_u32(&capture.body, EVENT_DEFINE);
+    put_string(&capture.body, macro->name);
+    put_u32(&capture.body, macro->type);
+    put_u32(&capture.body, macro->params);
+    put_u32(&capture.body, macro->is_vararg);
+    put_tokens(&capture.body, &macro->replacement);
+    capture.events++;
+}
+
+INTERNAL void prelude_remove_macro(String name)
+{
+    if (!capture.active)
+        return;
+
+    put_u32(&capture.body, EVENT_UNDEF);
+    put_string(&capture.body, name);
+    capture.events++;
+}
+
+INTERNAL void prelude_add_pragma(const TokenArray *line)
+{
+    if (!capture.active)
+        return;
+
+    put_u32(&capture.body, EVENT_PRAGMA);
+    put_tokens(&capture.body, line);
+    capture.events++;
+}
@@ -0,0 +1,32 @@
+#ifndef PRELUDE_H
+#define PRELUDE_H
+
+#include "macro.h"
+
+/*
+ * Include runtime headers read implicitly before every translation
+ * unit, <_ext.h> and <_builtin.h>, together called the prelude.
+ *
+ * Output of preprocessing the prelude is stored in a snapshot file in
+ * the given directory: Tokens handed to the parser, macro definitions,
+ * include guards and pragmas. Later runs with the same configuration
+ * map the snapshot instead of reading and preprocessing the headers
+ * again, as long as none of the files read have changed.
+ *
+ * Configuration is a string of anything else affecting the result, such
+ * as macros defined on the command line. Passing NULL directory reads
+ * the headers without snapshot.
+ */
+INTERNAL void include_prelude(const char *dir, const char *config);
+
+/*
+ * Record effects while the prelude is read. These are no-ops except
+ * when capturing a new snapshot.
+ */
+INTERNAL void prelude_add_file(String path);
+INTERNAL void prelude_add_guard(String path, String macro, int once);
+INTERNAL void prelude_add_macro(const struct macro *macro);
+INTERNAL void prelude_remove_macro(String name);
+INTERNAL void prelude_add_pragma(const TokenArray *line);
+
+#endif
@@ -6,10 +6,12 @@
 #include "directive.h"
 #include "input.h"
 #include "macro.h"
+#include "prelude.h"
 #include "preprocess.h"
 #include "strtab.h"
 #include "tokenize.h"
 #include "../backend/vm/vm.h"
+#include "../util/report.h"
 #include <lacc/context.h>
 #include <lacc/deque.h>
 
@@ -393,6 +395,7 @@ static void add_to_lookahead(struct token t)
 {
     struct token prev;
 
+    report_count(COUNT_TOKENS, 1);
     if (!output_preprocessed) {
         switch (t.token) {
         case PREP_CHAR:
@@ -459,6 +462,14 @@ static void preprocess_pragma(TokenArray *line)
 
     assert(array_len(line) > 0);
     assert(!tok_cmp(ident__pragma, array_get(line, 0)));
+    if (array_len(line) > 1) {
+        t = array_get(line, 1);
+        if (t.token == IDENTIFIER && !strcmp(str_raw(t.d.string), "once")) {
+            include_once();
+            return;
+        }
+    }
+
     if (output_preprocessed) {
         add_to_lookahead(basic_token[NEWLINE]);
         add_to_lookahead(basic_token['#']);
@@ -471,6 +482,7 @@ static void preprocess_pragma(TokenArray *line)
             add_to_lookahead(basic_token[NEWLINE]);
         }
     } else {
+        prelude_add_pragma(line);
         for (i = 0; i < array_len(line); ++i) {
             t = array_get(line, i);
             if (t.token == IDENTIFIER) {
@@ -585,6 +597,7 @@ static void preprocess_line(int n)
     int i;
     struct token t;
 
+    phase_begin(PHASE_PREPROCESS);
     do {
         t = get_token();
         if (t.token == END) {
@@ -634,6 +647,8 @@ static void preprocess_line(int n)
     while (deque_len(&lookahead) < n) {
         add_to_lookahead(basic_token[END]);
     }
+
+    phase_end(PHASE_PREPROCESS);
 }
 
 INTERNAL void inject_line(char *line)
@@ -648,6 +663,61 @@ INTERNAL void inject_line(char *line)
     line_buffer = NULL;
 }
 
+INTERNAL void preprocess_included(TokenArray *tokens)
+{
+    int i, start;
+
+    start = deque_len(&lookahead);
+    do {
+        preprocess_line(deque_len(&lookahead) + 1);
+    } while (deque_back(&lookahead).token != END);
+
+    while (deque_len(&lookahead) && deque_back(&lookahead).token == END) {
+        (void) deque_pop_back(&lookahead);
+    }
+
+    for (i = start; i < deque_len(&lookahead); ++i) {
+        array_push_back(tokens, deque_get(&lookahead, i));
+    }
+}
+
+/*
+ * Tokens already buffered are few compared to a prelude, and are moved
+ * in front of the list instead of copying the list.
+ */
+INTERNAL void inject_tokens(TokenArray *tokens)
+{
+    unsigned n, len;
+
+    n = deque_len(&lookahead);
+    if (n) {
+        len = array_len(tokens) + n;
+        array_realloc(tokens, len);
+        memmove(
+            tokens->data + n,
+            tokens->data,
+            array_len(tokens) * sizeof(*tokens->data));
+        memcpy(
+            tokens->data,
+            &deque_get(&lookahead, 0),
+            n * sizeof(*tokens->data));
+        tokens->length += n;
+    }
+
+    array_clear(&lookahead.array);
+    lookahead.cursor = 0;
+    lookahead.array.data = tokens->data;
+    lookahead.array.length = tokens->length;
+    lookahead.array.capacity = tokens->capacity;
+    tokens->data = NULL;
+    tokens->length = tokens->capacity = 0;
+}
+
+INTERNAL void inject_pragma(TokenArray *line)
+{
+    preprocess_pragma(line);
+}
+
 INTERNAL struct token next(void)
 {
     if (deque_len(&lookahead) < 1) {
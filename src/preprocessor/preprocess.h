@@ -1,6 +1,8 @@
 #ifndef PREPROCESS_H
 #define PREPROCESS_H
 
+#include "macro.h"
+
 #include <stdio.h>
 
 /*
@@ -18,6 +20,22 @@ INTERNAL void preprocess(FILE *output);
  */
 INTERNAL void inject_line(char *line);
 
+/*
+ * Preprocess until the files included since set_include_barrier are
+ * read. Tokens produced are left for the parser, and also appended to
+ * the list.
+ */
+INTERNAL void preprocess_included(TokenArray *tokens);
+
+/*
+ * Move already preprocessed tokens to the end of the lookahead buffer,
+ * taking over the list and leaving it empty.
+ */
+INTERNAL void inject_tokens(TokenArray *tokens);
+
+/* Apply effects of a #pragma directive, starting with 'pragma'. */
+INTERNAL void inject_pragma(TokenArray *line);
+
 /* Initialize data structures used for preprocessing. */
 INTERNAL void preprocess_reset(void);
 
@@ -4,6 +4,7 @@
 # define EXTERNAL extern
 #endif
 #include "strtab.h"
+#include <lacc/arena.h>
 #include <lacc/hash.h>
 
 #include <kcs/assert.h>
@@ -15,6 +16,9 @@
 
 static struct hash_table strtab;
 
+/* Memory for strings in the table, released together. */
+static struct arena strings;
+
 /* Buffer used to concatenate strings before registering them. */
 static char *catbuf;
 static size_t catlen;
@@ -23,8 +27,9 @@ static int initialized;
 
 /*
  * Every unique string encountered, being identifiers or literals, is
- * kept for the lifetime of the program. To save allocations, store the
- * raw string buffer in the same allocation as the struct.
+ * kept for the lifetime of the translation unit. To save allocations,
+ * store the raw string buffer in the same allocation as the struct,
+ * placed in the string arena.
  *
  *  _________ String ________    ________ const char [] ________
  * |                          | |                               |
@@ -38,7 +43,7 @@ static void *str_hash_add(void *ref)
 
     s = (String *) ref;
     l = s->p.len;
-    buffer = malloc(sizeof(String) + l + 1);
+    buffer = arena_alloc(&strings, sizeof(String) + l + 1);
     buffer[sizeof(String) + l] = '\0';
     memcpy(buffer + sizeof(String), s->p.str, l);
     s = (String *) buffer;
@@ -57,6 +62,7 @@ INTERNAL void strtab_reset(void)
 {
     if (initialized) {
         hash_destroy(&strtab);
+        arena_free(&strings);
         initialized = 0;
     }
 
@@ -81,7 +87,7 @@ INTERNAL String str_register(const char *str, size_t len)
                 STRTAB_SIZE,
                 str_hash_key,
                 str_hash_add,
-                free);
+                NULL);
             initialized = 1;
         }
         data.p.str = str;
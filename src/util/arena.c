@@ -0,0 +1,121 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include <lacc/arena.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_INITIAL 0x400
+#define ARENA_BLOCK_SIZE 0x10000
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(n) \
+    (((n) + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1))
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+};
+
+/* Objects start after the block header, keeping alignment. */
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(struct arena_block))
+#define block_data(b) ((char *) (b) + ARENA_HEADER_SIZE)
+
+static struct arena_block *arena_new_block(size_t size)
+{
+    struct arena_block *block;
+
+    block = malloc(ARENA_HEADER_SIZE + size);
+    block->next = NULL;
+    block->size = size;
+    return block;
+}
+
+static void arena_use_block(struct arena *arena, struct arena_block *block)
+{
+    arena->current = block;
+    arena->next = block_data(block);
+    arena->end = arena->next + block->size;
+}
+
+/*
+ * Move on to the next block kept from before the last reset, or insert
+ * a new one after the current block. Block size starts small, to not
+ * waste memory on arenas holding only a few objects, and doubles up to
+ * a fixed limit. Objects larger than that get a block of their own.
+ */
+static void arena_grow(struct arena *arena, size_t size)
+{
+    size_t cap;
+    struct arena_block *block;
+
+    if (arena->current
+        && arena->current->next
+        && arena->current->next->size >= size)
+    {
+        arena_use_block(arena, arena->current->next);
+        return;
+    }
+
+    cap = ARENA_BLOCK_INITIAL;
+    if (arena->current) {
+        cap = arena->current->size * 2;
+        if (cap > ARENA_BLOCK_SIZE) {
+            cap = ARENA_BLOCK_SIZE;
+        }
+    }
+
+    block = arena_new_block(size > cap ? size : cap);
+    if (!arena->head) {
+        arena->head = block;
+    } else {
+        block->next = arena->current->next;
+        arena->current->next = block;
+    }
+
+    arena_use_block(arena, block);
+}
+
+INTERNAL void *arena_alloc(struct arena *arena, size_t size)
+{
+    char *ptr;
+
+    size = ARENA_ALIGN(size);
+    if ((size_t) (arena->end - arena->next) < size) {
+        arena_grow(arena, size);
+    }
+
+    ptr = arena->next;
+    arena->next += size;
+    return ptr;
+}
+
+INTERNAL void *arena_calloc(struct arena *arena, size_t size)
+{
+    void *ptr;
+
+    ptr = arena_alloc(arena, size);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+INTERNAL void arena_reset(struct arena *arena)
+{
+    if (arena->head) {
+        arena_use_block(arena, arena->head);
+    }
+}
+
+INTERNAL void arena_free(struct arena *arena)
+{
+    struct arena_block *block, *next;
+
+    for (block = arena->head; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+
+    memset(arena, 0, sizeof(*arena));
+}
@@ -9,168 +9,154 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define HASH_MIN_CAPACITY 8
+
+/* Grow when more than 3/4 of the slots are occupied. */
+#define HASH_LOAD_LIMIT(cap) ((cap) - ((cap) >> 2))
+
 struct hash_entry {
     /*
      * We don't own the data, only keep pointers to some block of memory
-     * controlled by the client.
+     * controlled by the client. Empty slots have NULL data.
      */
     void *data;
 
     uint64_t hash;
-    struct hash_entry *next;
 };
 
-enum hash_op {
-    HASH_LOOKUP,
-    HASH_INSERT,
-    HASH_REMOVE
-};
+#define HASH_K0 0x9e3779b97f4a7c15ull
+#define HASH_K1 0xff51afd7ed558ccdull
 
-/*
- * Hash algorithm is adapted from http://www.cse.yorku.ca/~oz/hash.html.
- */
-static uint64_t djb2_hash(String str)
+static uint64_t hash_read_word(const char *p)
 {
-    int c;
-    uint64_t hash = 5381;
-    const char
-        *p = str_raw(str),
-        *q = p + str.len;
-
-    while (p < q) {
-        c = *p++;
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-    }
-
-    return hash;
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
 }
 
-static struct hash_entry *hash_alloc_entry(struct hash_table *tab)
+/*
+ * Hash eight bytes at a time, mixing each word with a multiply and
+ * shift. The remaining tail is read as one partial word. Finalize with
+ * the avalanche step from MurmurHash3, such that the low bits used to
+ * pick a slot depend on all bits of the input.
+ */
+static uint64_t string_hash(String str)
 {
-    struct hash_entry *ref;
+    size_t n;
+    uint64_t h, w;
+    const char *p;
+
+    n = str.len;
+    p = str_raw(str);
+    h = n * HASH_K0;
+    while (n >= sizeof(w)) {
+        h = (h ^ hash_read_word(p)) * HASH_K0;
+        h ^= h >> 29;
+        p += sizeof(w);
+        n -= sizeof(w);
+    }
 
-    ref = tab->table[tab->capacity].next;
-    if (ref) {
-        tab->table[tab->capacity].next = ref->next;
-        memset(ref, 0, sizeof(*ref));
-    } else {
-        ref = calloc(1, sizeof(*ref));
+    if (n) {
+        w = 0;
+        memcpy(&w, p, n);
+        h = (h ^ w) * HASH_K0;
+        h ^= h >> 29;
     }
 
-    return ref;
+    h ^= h >> 33;
+    h *= HASH_K1;
+    h ^= h >> 33;
+    return h;
 }
 
-static void hash_free_entry(struct hash_table *tab, struct hash_entry *ref)
+/* Distance from the slot where an entry with given hash would start. */
+static unsigned probe_distance(
+    const struct hash_table *tab,
+    uint64_t hash,
+    unsigned slot)
 {
-    ref->next = tab->table[tab->capacity].next;
-    tab->table[tab->capacity].next = ref;
+    return (slot - (unsigned) hash) & (tab->capacity - 1);
 }
 
-static struct hash_entry *hash_walk(
-    struct hash_table *tab,
-    enum hash_op op,
-    String key)
+/*
+ * Find slot holding element with the given key, or -1 if not found.
+ * Stop early when reaching an entry closer to its home slot than the
+ * element we look for would be.
+ */
+static int hash_find(const struct hash_table *tab, String key, uint64_t hash)
 {
-    /*
-     * Sentinel to hold return value from deleted entries, as we want to
-     * have the same interface for all invocations.
-     */
-    static struct hash_entry deleted;
+    unsigned i, d, mask;
+    struct hash_entry *ref;
 
-    struct hash_entry *ref, *pre;
-    uint64_t
-        hash = djb2_hash(key),
-        pos = hash % tab->capacity;
+    mask = tab->capacity - 1;
+    for (i = hash & mask, d = 0;; i = (i + 1) & mask, d++) {
+        ref = &tab->table[i];
+        if (!ref->data || probe_distance(tab, ref->hash, i) < d)
+            return -1;
 
-    pre = NULL;
-    ref = &tab->table[pos];
-    while (ref && ref->data) {
         if (ref->hash == hash && !str_cmp(tab->key(ref->data), key))
-            break;
-
-        if (!ref->next && op == HASH_INSERT)
-            ref->next = hash_alloc_entry(tab);
-
-        pre = ref;
-        ref = ref->next;
+            return i;
     }
+}
+
+/*
+ * Place entry known to not be in the table, displacing entries that are
+ * closer to their home slot than the one being inserted.
+ */
+static void hash_place(struct hash_table *tab, struct hash_entry entry)
+{
+    unsigned i, d, e, mask;
+    struct hash_entry *ref, tmp;
 
-    if (op == HASH_INSERT) {
-        assert(!ref->data || ref->hash == hash);
-        ref->hash = hash;
-    } else if (op == HASH_REMOVE && ref) {
+    mask = tab->capacity - 1;
+    for (i = entry.hash & mask, d = 0;; i = (i + 1) & mask, d++) {
+        ref = &tab->table[i];
         if (!ref->data) {
-            assert(!pre);
-            assert(!ref->hash);
-
-            /* Delete in first slot, but no data. Nothing to do. */
-            ref = NULL;
-        } else {
-            deleted.data = ref->data;
-            deleted.hash = ref->hash;
-
-            if (!pre) {
-                /*
-                 * Delete entry in first slot, moving the next element
-                 * in if it exists, or reset to zero.
-                 */
-                if (ref->next) {
-                    pre = ref->next;
-                    *ref = *(ref->next);
-                    hash_free_entry(tab, pre);
-                } else {
-                    memset(ref, 0, sizeof(*ref));
-                }
-            } else {
-                pre->next = ref->next;
-                hash_free_entry(tab, ref);
-            }
+            *ref = entry;
+            break;
+        }
 
-            /*
-             * Entry is freed, but pointer to data as well as hash value
-             * is still valid.
-             */
-            ref = &deleted;
+        e = probe_distance(tab, ref->hash, i);
+        if (e < d) {
+            tmp = *ref;
+            *ref = entry;
+            entry = tmp;
+            d = e;
         }
     }
 
-    return ref;
+    tab->length++;
 }
 
-static void *hash_add_identity(void *elem)
+static void hash_resize(struct hash_table *tab, unsigned cap)
 {
-    return elem;
-}
+    unsigned i, n;
+    struct hash_entry *old;
 
-static void hash_del_noop(void *elem)
-{
-    return;
-}
+    old = tab->table;
+    n = tab->capacity;
+    tab->capacity = cap;
+    tab->length = 0;
+    tab->table = calloc(cap, sizeof(*tab->table));
+    if (old) {
+        for (i = 0; i < n; ++i) {
+            if (old[i].data) {
+                hash_place(tab, old[i]);
+            }
+        }
 
-static void hash_chain_free(struct hash_entry *ref, void (*del)(void *))
-{
-    if (ref->next) {
-        hash_chain_free(ref->next, del);
-        free(ref->next);
+        free(old);
     }
-
-    del(ref->data);
 }
 
-static struct hash_entry *hash_chain_clear(
-    struct hash_table *tab,
-    struct hash_entry *ref)
+static void *hash_add_identity(void *elem)
 {
-    struct hash_entry *last = ref;
-    assert(tab->table);
-    assert(ref->data);
-
-    if (ref->next) {
-        last = hash_chain_clear(tab, ref->next);
-    }
+    return elem;
+}
 
-    tab->del(ref->data);
-    return last;
+static void hash_del_noop(void *elem)
+{
+    return;
 }
 
 INTERNAL struct hash_table *hash_init(
@@ -180,93 +166,106 @@ INTERNAL struct hash_table *hash_init(
     void *(*add)(void *),
     void (*del)(void *))
 {
+    unsigned n;
     assert(cap > 0);
     assert(key);
 
-    tab->capacity = cap;
+    n = HASH_MIN_CAPACITY;
+    while (HASH_LOAD_LIMIT(n) < cap) {
+        n *= 2;
+    }
+
     tab->key = key;
     tab->add = add ? add : hash_add_identity;
     tab->del = del ? del : hash_del_noop;
-    tab->table = calloc(tab->capacity + 1, sizeof(*tab->table));
+    tab->table = NULL;
+    hash_resize(tab, n);
     return tab;
 }
 
-/*
- * Delete all values, putting hash_entry objects already allocated in
- * overflow slot at table[capacity].
- */
 INTERNAL void hash_clear(struct hash_table *tab)
 {
     unsigned i;
-    struct hash_entry *ref, *last;
     assert(tab->table);
 
-    for (i = 0; i < tab->capacity; ++i) {
-        ref = &tab->table[i];
-        if (ref->data) {
-            tab->del(ref->data);
-            if (ref->next) {
-                /*
-                 * Put chain of allocated hash_entry objects at the
-                 * beginning of overflow slot.
-                 */
-                last = hash_chain_clear(tab, ref->next);
-                last->next = tab->table[tab->capacity].next;
-                tab->table[tab->capacity].next = ref->next;
+    if (tab->length) {
+        for (i = 0; i < tab->capacity; ++i) {
+            if (tab->table[i].data) {
+                tab->del(tab->table[i].data);
             }
         }
-    }
 
-    memset(tab->table, 0, sizeof(*tab->table) * tab->capacity);
+        memset(tab->table, 0, sizeof(*tab->table) * tab->capacity);
+        tab->length = 0;
+    }
 }
 
 INTERNAL void hash_destroy(struct hash_table *tab)
 {
-    unsigned i;
-    struct hash_entry *ref;
-
-    assert(tab->table);
-    for (i = 0; i < tab->capacity; ++i) {
-        ref = &tab->table[i];
-
-        if (ref->data)
-            hash_chain_free(ref, tab->del);
-        else
-            assert(!ref->next);
-    }
-
-    hash_chain_free(&tab->table[tab->capacity], &hash_del_noop);
+    hash_clear(tab);
     free(tab->table);
     memset(tab, 0, sizeof(*tab));
 }
 
 INTERNAL void *hash_insert(struct hash_table *tab, void *val)
 {
-    struct hash_entry *ref;
+    int i;
+    String key;
+    struct hash_entry entry;
 
     assert(val);
     assert(tab->table);
 
-    ref = hash_walk(tab, HASH_INSERT, tab->key(val));
-    if (!ref->data)
-        ref->data = tab->add(val);
+    key = tab->key(val);
+    entry.hash = string_hash(key);
+    i = hash_find(tab, key, entry.hash);
+    if (i >= 0)
+        return tab->table[i].data;
+
+    entry.data = tab->add(val);
+    if (tab->length + 1 > HASH_LOAD_LIMIT(tab->capacity)) {
+        hash_resize(tab, tab->capacity * 2);
+    }
 
-    return ref->data;
+    hash_place(tab, entry);
+    return entry.data;
 }
 
 INTERNAL void *hash_lookup(struct hash_table *tab, String key)
 {
-    struct hash_entry *ref;
+    int i;
 
-    ref = hash_walk(tab, HASH_LOOKUP, key);
-    return ref ? ref->data : NULL;
+    i = hash_find(tab, key, string_hash(key));
+    return i >= 0 ? tab->table[i].data : NULL;
 }
 
+/*
+ * Remove element by shifting following entries back one slot, until
+ * reaching an empty slot or an entry already in its home slot.
+ */
 INTERNAL void hash_remove(struct hash_table *tab, String key)
 {
-    struct hash_entry *ref;
+    int i;
+    unsigned j, mask;
+    void *data;
+
+    i = hash_find(tab, key, string_hash(key));
+    if (i < 0)
+        return;
+
+    mask = tab->capacity - 1;
+    data = tab->table[i].data;
+    for (;;) {
+        j = (i + 1) & mask;
+        if (!tab->table[j].data
+            || !probe_distance(tab, tab->table[j].hash, j))
+            break;
+
+        tab->table[i] = tab->table[j];
+        i = j;
+    }
 
-    ref = hash_walk(tab, HASH_REMOVE, key);
-    if (ref)
-        tab->del(ref->data);
+    memset(&tab->table[i], 0, sizeof(tab->table[i]));
+    tab->length--;
+    tab->del(data);
 }
@@ -0,0 +1,247 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "report.h"
+
+#include <kcs/assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(KCC_WINDOWS)
+# include <windows.h>
+# include <psapi.h>
+# pragma comment(lib, "psapi.lib")
+#else
+# include <sys/resource.h>
+# include <time.h>
+#endif
+#if defined(__GLIBC__)
+# include <malloc.h>
+#endif
+
+#define MAX_PHASE_DEPTH 16
+
+struct measure {
+    double time[PHASES];
+    long long heap[PHASES];
+    long long count[COUNTERS];
+    double wall;
+};
+
+static const char *phase_names[PHASES] = {
+    "preprocess",
+    "prelude snapshot",
+    "parse",
+    "optimize",
+    "compile",
+    "flush",
+    "jit relocation",
+    "vm import",
+    "execute"
+};
+
+static int time_report, memory_report;
+static int files;
+
+static struct measure current, total;
+
+/* Phases entered, innermost last. */
+static enum phase stack[MAX_PHASE_DEPTH];
+static int depth;
+
+/* Time and heap size at last phase switch, and at start of file. */
+static double last_time, file_time;
+static long long last_heap;
+
+static double now(void)
+{
+#if defined(KCC_WINDOWS)
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double) count.QuadPart / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* Bytes currently allocated on the heap, or 0 if not known. */
+static long long heap_in_use(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return (long long) info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+    return (long long) (unsigned) info.uordblks + (unsigned) info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/* Peak resident set size of the process in kilobytes. */
+static long long peak_rss(void)
+{
+#if defined(KCC_WINDOWS)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+# if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+# else
+    return usage.ru_maxrss;
+# endif
+#endif
+}
+
+/* Attribute time and memory since last switch to innermost phase. */
+static void account(void)
+{
+    double t;
+    long long h;
+
+    t = now();
+    if (depth) {
+        current.time[stack[depth - 1]] += t - last_time;
+    }
+
+    last_time = t;
+    if (memory_report) {
+        h = heap_in_use();
+        if (depth) {
+            current.heap[stack[depth - 1]] += h - last_heap;
+        }
+        last_heap = h;
+    }
+}
+
+INTERNAL void report_enable(int time, int memory)
+{
+    time_report = time;
+    memory_report = memory;
+    if (time_report || memory_report) {
+        last_time = file_time = now();
+        last_heap = heap_in_use();
+    }
+}
+
+INTERNAL void phase_begin(enum phase phase)
+{
+    if (time_report || memory_report) {
+        assert(depth < MAX_PHASE_DEPTH);
+        account();
+        stack[depth++] = phase;
+    }
+}
+
+INTERNAL void phase_end(enum phase phase)
+{
+    if (time_report || memory_report) {
+        assert(depth > 0);
+        assert(stack[depth - 1] == phase);
+        account();
+        depth--;
+    }
+}
+
+INTERNAL void report_count(enum counter counter, long n)
+{
+    current.count[counter] += n;
+}
+
+static void print_report(const char *title, const struct measure *m)
+{
+    int i;
+    double sum;
+
+    fprintf(stderr, "%s:\n", title);
+    fprintf(stderr, "  %-16s", "phase");
+    if (time_report) {
+        fprintf(stderr, " %12s %7s", "time (ms)", "share");
+    }
+    if (memory_report) {
+        fprintf(stderr, " %12s", "heap (KB)");
+    }
+
+    fputc('\n', stderr);
+    for (i = 0, sum = 0; i < PHASES; ++i) {
+        sum += m->time[i];
+        if (!m->time[i] && !m->heap[i])
+            continue;
+
+        fprintf(stderr, "  %-16s", phase_names[i]);
+        if (time_report) {
+            fprintf(stderr, " %12.3f %6.1f%%",
+                m->time[i] * 1000,
+                m->wall > 0 ? 100 * m->time[i] / m->wall : 0.0);
+        }
+        if (memory_report) {
+            fprintf(stderr, " %+12lld", m->heap[i] / 1024);
+        }
+        fputc('\n', stderr);
+    }
+
+    if (time_report) {
+        fprintf(stderr, "  %-16s %12.3f %6.1f%%\n", "other",
+            (m->wall - sum) * 1000,
+            m->wall > 0 ? 100 * (m->wall - sum) / m->wall : 0.0);
+        fprintf(stderr, "  %-16s %12.3f\n", "total", m->wall * 1000);
+    }
+
+    fprintf(stderr,
+        "  %lld tokens, %lld definitions, %lld IR statements, "
+        "%lld instructions, %lld bytes\n",
+        m->count[COUNT_TOKENS],
+        m->count[COUNT_DEFINITIONS],
+        m->count[COUNT_STATEMENTS],
+        m->count[COUNT_INSTRUCTIONS],
+        m->count[COUNT_BYTES]);
+    if (memory_report) {
+        fprintf(stderr, "  peak RSS %lld KB\n", peak_rss());
+    }
+}
+
+INTERNAL void report_file(const char *name)
+{
+    int i;
+    char title[256];
+    double t;
+
+    if (!time_report && !memory_report)
+        return;
+
+    account();
+    t = now();
+    current.wall = t - file_time;
+    file_time = t;
+    snprintf(title, sizeof(title), "Report for '%s'", name);
+    print_report(title, &current);
+
+    for (i = 0; i < PHASES; ++i) {
+        total.time[i] += current.time[i];
+        total.heap[i] += current.heap[i];
+    }
+    for (i = 0; i < COUNTERS; ++i) {
+        total.count[i] += current.count[i];
+    }
+
+    total.wall += current.wall;
+    memset(&current, 0, sizeof(current));
+    files++;
+}
+
+INTERNAL void report_finalize(void)
+{
+    if (files > 1) {
+        print_report("Total", &total);
+    }
+}
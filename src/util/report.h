@@ -0,0 +1,48 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+/*
+ * Phases of compilation measured by -ftime-report and -fmem-report.
+ * Phases can nest, for example preprocessing happens on demand while
+ * parsing. Time is attributed to the innermost active phase only.
+ */
+enum phase {
+    PHASE_PREPROCESS,
+    PHASE_PRELUDE,
+    PHASE_PARSE,
+    PHASE_OPTIMIZE,
+    PHASE_COMPILE,
+    PHASE_FLUSH,
+    PHASE_JIT_RELOCATE,
+    PHASE_VM_IMPORT,
+    PHASE_EXECUTE,
+    PHASES
+};
+
+enum counter {
+    COUNT_TOKENS,
+    COUNT_DEFINITIONS,
+    COUNT_STATEMENTS,
+    COUNT_INSTRUCTIONS,
+    COUNT_BYTES,
+    COUNTERS
+};
+
+/* Enable measurement of time, and optionally memory. */
+INTERNAL void report_enable(int time, int memory);
+
+/* Enter and leave phase. No-op unless reporting is enabled. */
+INTERNAL void phase_begin(enum phase phase);
+INTERNAL void phase_end(enum phase phase);
+
+/* Add to counter. */
+INTERNAL void report_count(enum counter counter, long n);
+
+/*
+ * Print report for the input file just processed, and add it to total.
+ * Print total on finalize if more than one file was processed.
+ */
+INTERNAL void report_file(const char *name);
+INTERNAL void report_finalize(void);
+
+#endif
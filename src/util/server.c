@@ -0,0 +1,402 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(KCC_WINDOWS)
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <xunistd.h>
+
+#define REQUEST_MAGIC 0x3153434b
+#define REQUEST_FDS 3
+#define REQUEST_MAX_SIZE (1 << 24)
+
+extern char **environ;
+
+/*
+ * Sent together with the standard streams of the client, followed by
+ * size bytes holding working directory, arguments and environment as
+ * nul terminated strings.
+ */
+struct request_header {
+    uint32_t magic;
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t size;
+};
+
+static int send_all(int fd, const void *data, size_t len)
+{
+    ssize_t n;
+    const char *p = data;
+
+    while (len) {
+        n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int recv_all(int fd, void *data, size_t len)
+{
+    ssize_t n;
+    char *p = data;
+
+    while (len) {
+        n = recv(fd, p, len, 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int open_socket(const char *path, struct sockaddr_un *addr)
+{
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Socket path '%s' is too long.\n", path);
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+/*
+ * Point n elements of list to consecutive strings starting at p, and
+ * terminate list with NULL. Return position after the last string, or
+ * NULL if there are not enough strings before end.
+ */
+static char *split_strings(char *p, const char *end, char **list, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i) {
+        if (p >= end)
+            return NULL;
+        list[i] = p;
+        p += strlen(p) + 1;
+    }
+
+    list[n] = NULL;
+    return p;
+}
+
+/*
+ * Return 0 if the peer of conn runs as the same user as the server, which
+ * is the only one trusted to run programs through it.
+ */
+static int check_peer(int conn)
+{
+#if defined(__linux__)
+    /* Layout of struct ucred, which needs _GNU_SOURCE from glibc. */
+    struct {
+        pid_t pid;
+        uid_t uid;
+        gid_t gid;
+    } cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len)
+        || len != sizeof(cred))
+        return -1;
+
+    return cred.uid == geteuid() ? 0 : -1;
+#else
+    uid_t uid;
+    gid_t gid;
+
+    if (getpeereid(conn, &uid, &gid))
+        return -1;
+
+    return uid == geteuid() ? 0 : -1;
+#endif
+}
+
+/*
+ * Run request in a child process with the standard streams received
+ * from the client. Wait for it to finish, and reply with exit status.
+ */
+static void handle(int conn, int (*main)(int, char **))
+{
+    struct request_header header;
+    struct msghdr msg = {0};
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * REQUEST_FDS)];
+        struct cmsghdr align;
+    } control;
+    int i, nfds, status, fds[REQUEST_FDS];
+    char *p, *end, *data, **argv, **envp;
+    int32_t reply;
+    pid_t pid;
+
+    if (check_peer(conn))
+        return;
+
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    if (recvmsg(conn, &msg, MSG_WAITALL) != sizeof(header))
+        return;
+
+    nfds = 0;
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg
+        && cmsg->cmsg_level == SOL_SOCKET
+        && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (nfds > REQUEST_FDS) {
+            nfds = REQUEST_FDS;
+        }
+        memcpy(fds, CMSG_DATA(cmsg), nfds * sizeof(int));
+    }
+
+    /*
+     * Each string takes at least one byte, after the working directory.
+     * Compare counts one at a time, as their sum can wrap around.
+     */
+    data = NULL;
+    argv = envp = NULL;
+    if (nfds != REQUEST_FDS
+        || header.magic != REQUEST_MAGIC
+        || header.argc < 1
+        || header.size == 0
+        || header.size > REQUEST_MAX_SIZE
+        || header.argc >= header.size
+        || header.envc >= header.size - header.argc)
+        goto done;
+
+    data = malloc(header.size);
+    if (recv_all(conn, data, header.size) || data[header.size - 1] != '\0')
+        goto done;
+
+    end = data + header.size;
+    argv = calloc(header.argc + 1, sizeof(*argv));
+    envp = calloc(header.envc + 1, sizeof(*envp));
+    p = data + strlen(data) + 1;
+    if (!(p = split_strings(p, end, argv, header.argc))
+        || !split_strings(p, end, envp, header.envc))
+        goto done;
+
+    switch ((pid = fork())) {
+    case 0:
+        close(conn);
+        for (i = 0; i < REQUEST_FDS; ++i) {
+            dup2(fds[i], i);
+            close(fds[i]);
+        }
+        if (chdir(data)) {
+            fprintf(stderr, "Cannot change directory to '%s'.\n", data);
+            _exit(1);
+        }
+        environ = envp;
+        status = main(header.argc, argv);
+        fflush(NULL);
+        _exit(status);
+    case -1:
+        reply = 1;
+        break;
+    default:
+        while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+            ;
+        reply = WIFEXITED(status)
+            ? WEXITSTATUS(status)
+            : 128 + WTERMSIG(status);
+        break;
+    }
+
+    send_all(conn, &reply, sizeof(reply));
+
+done:
+    for (i = 0; i < nfds; ++i) {
+        close(fds[i]);
+    }
+
+    free(argv);
+    free(envp);
+    free(data);
+}
+
+INTERNAL int serve(const char *path, int (*main)(int, char **))
+{
+    int fd, conn, rc;
+    mode_t mask;
+    struct stat st;
+    struct sockaddr_un addr;
+
+    if ((fd = open_socket(path, &addr)) < 0)
+        return 1;
+
+    /* Replace socket left behind by an earlier server, but no other file. */
+    if (!stat(path, &st) && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    /* Create the socket readable and writable by the owner only. */
+    mask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    rc = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+    umask(mask);
+
+    if (rc || listen(fd, SOMAXCONN)) {
+        fprintf(stderr, "Cannot listen on '%s'.\n", path);
+        close(fd);
+        return 1;
+    }
+
+    /*
+     * Fork one process to handle each connection, letting the server
+     * accept new ones right away. Handlers are reaped automatically.
+     */
+    signal(SIGCHLD, SIG_IGN);
+    fflush(NULL);
+    for (;;) {
+        conn = accept(fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+
+        switch (fork()) {
+        case 0:
+            close(fd);
+            signal(SIGCHLD, SIG_DFL);
+            handle(conn, main);
+            _exit(0);
+        case -1:
+            fprintf(stderr, "%s\n", "Failed to start request process.");
+            break;
+        }
+
+        close(conn);
+    }
+
+    close(fd);
+    return 1;
+}
+
+INTERNAL int request(const char *path, int argc, char **argv)
+{
+    int i, fd, fds[REQUEST_FDS] = {0, 1, 2};
+    char *data, *p, cwd[PATH_MAX];
+    struct request_header header;
+    struct sockaddr_un addr;
+    struct msghdr msg = {0};
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    size_t size;
+    int32_t reply;
+
+    if (!getcwd(cwd, sizeof(cwd)))
+        return -1;
+
+    if ((fd = open_socket(path, &addr)) < 0)
+        return -1;
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+
+    header.magic = REQUEST_MAGIC;
+    header.argc = argc;
+    header.envc = 0;
+    size = strlen(cwd) + 1;
+    for (i = 0; i < argc; ++i) {
+        size += strlen(argv[i]) + 1;
+    }
+    for (i = 0; environ[i]; ++i) {
+        size += strlen(environ[i]) + 1;
+        header.envc++;
+    }
+
+    header.size = size;
+    p = data = malloc(size);
+    p = stpcpy(p, cwd) + 1;
+    for (i = 0; i < argc; ++i) {
+        p = stpcpy(p, argv[i]) + 1;
+    }
+    for (i = 0; environ[i]; ++i) {
+        p = stpcpy(p, environ[i]) + 1;
+    }
+
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    fflush(NULL);
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(header)
+        || send_all(fd, data, size)
+        || recv_all(fd, &reply, sizeof(reply)))
+    {
+        fprintf(stderr, "Lost connection to server at '%s'.\n", path);
+        reply = 1;
+    }
+
+    free(data);
+    close(fd);
+    return reply;
+}
+
+#else
+
+INTERNAL int serve(const char *path, int (*main)(int, char **))
+{
+    fprintf(stderr, "%s\n", "Server mode is not supported on this platform.");
+    return 1;
+}
+
+INTERNAL int request(const char *path, int argc, char **argv)
+{
+    return -1;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/*
+ * Serve requests on a Unix domain socket at path. Each request carries
+ * the command line, environment, working directory and standard streams
+ * of a client, and is run by calling main in a process forked from the
+ * server. Return only if the socket cannot be set up.
+ */
+INTERNAL int serve(const char *path, int (*main)(int, char **));
+
+/*
+ * Forward command line to server listening at path, and return the exit
+ * status of running it. Return -1 if there is no server to connect to.
+ */
+INTERNAL int request(const char *path, int argc, char **argv);
+
+#endif
@@ -0,0 +1,176 @@
+#include <kcs.h>
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "thread.h"
+
+#include <kcs/assert.h>
+#include <stdlib.h>
+
+#if defined(KCC_WINDOWS)
+# include <windows.h>
+#else
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#define MAX_JOBS 64
+
+/*
+ * Work shared by all threads in parallel_for. Each worker takes the
+ * next index under lock until all are taken.
+ */
+struct work {
+#if defined(KCC_WINDOWS)
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+    int next;
+    int n;
+    void (*callback)(void *arg, int worker, int i);
+    void *arg;
+};
+
+struct worker {
+    struct work *work;
+    int id;
+};
+
+static int take_index(struct work *work)
+{
+    int i;
+
+#if defined(KCC_WINDOWS)
+    EnterCriticalSection(&work->lock);
+#else
+    pthread_mutex_lock(&work->lock);
+#endif
+    i = work->next < work->n ? work->next++ : -1;
+#if defined(KCC_WINDOWS)
+    LeaveCriticalSection(&work->lock);
+#else
+    pthread_mutex_unlock(&work->lock);
+#endif
+    return i;
+}
+
+static void run_worker(struct worker *worker)
+{
+    int i;
+    struct work *work = worker->work;
+
+    while ((i = take_index(work)) != -1) {
+        work->callback(work->arg, worker->id, i);
+    }
+}
+
+#if defined(KCC_WINDOWS)
+static DWORD WINAPI thread_main(LPVOID arg)
+{
+    run_worker(arg);
+    return 0;
+}
+#else
+static void *thread_main(void *arg)
+{
+    run_worker(arg);
+    return NULL;
+}
+#endif
+
+INTERNAL int cpu_count(void)
+{
+    long n;
+
+#if defined(KCC_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    n = info.dwNumberOfProcessors;
+#else
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n < 1 ? 1 : n > MAX_JOBS ? MAX_JOBS : (int) n;
+}
+
+INTERNAL void parallel_for(
+    int jobs,
+    int n,
+    void (*callback)(void *arg, int worker, int i),
+    void *arg)
+{
+    int i, started;
+    struct work work;
+    struct worker workers[MAX_JOBS];
+#if defined(KCC_WINDOWS)
+    HANDLE threads[MAX_JOBS];
+#else
+    pthread_t threads[MAX_JOBS];
+#endif
+
+    assert(jobs > 0);
+    if (jobs > n) {
+        jobs = n;
+    }
+
+    if (jobs > MAX_JOBS) {
+        jobs = MAX_JOBS;
+    }
+
+    if (jobs < 2) {
+        for (i = 0; i < n; ++i) {
+            callback(arg, 0, i);
+        }
+        return;
+    }
+
+    work.next = 0;
+    work.n = n;
+    work.callback = callback;
+    work.arg = arg;
+#if defined(KCC_WINDOWS)
+    InitializeCriticalSection(&work.lock);
+#else
+    pthread_mutex_init(&work.lock, NULL);
+#endif
+
+    /*
+     * Failing to start a thread is not fatal, remaining work is done
+     * by the threads that did start.
+     */
+    for (i = 1, started = 1; i < jobs; ++i) {
+        workers[started].work = &work;
+        workers[started].id = started;
+#if defined(KCC_WINDOWS)
+        threads[started] = CreateThread(
+            NULL, 0, thread_main, &workers[started], 0, NULL);
+        if (threads[started] == NULL)
+            break;
+#else
+        if (pthread_create(
+                &threads[started], NULL, thread_main, &workers[started]))
+            break;
+#endif
+        started++;
+    }
+
+    workers[0].work = &work;
+    workers[0].id = 0;
+    run_worker(&workers[0]);
+
+    for (i = 1; i < started; ++i) {
+#if defined(KCC_WINDOWS)
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+
+#if defined(KCC_WINDOWS)
+    DeleteCriticalSection(&work.lock);
+#else
+    pthread_mutex_destroy(&work.lock);
+#endif
+}
@@ -0,0 +1,22 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+/* Number of processors available to this process, at least 1. */
+INTERNAL int cpu_count(void);
+
+/*
+ * Invoke callback for each index in [0, n), distributed over at most
+ * the given number of threads. The calling thread participates as
+ * worker 0, other workers are numbered [1 .. jobs - 1]. Return when all
+ * calls have completed.
+ *
+ * Callbacks must not touch shared state that is not safe to access
+ * concurrently.
+ */
+INTERNAL void parallel_for(
+    int jobs,
+    int n,
+    void (*callback)(void *arg, int worker, int i),
+    void *arg);
+
+#endif
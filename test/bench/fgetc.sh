@@ -0,0 +1,48 @@
+#!/bin/bash
+#
+# Benchmark for calls into the extension library. Reads generated input
+# one character at a time with fgetc from stdin, running in the VM and
+# with the JIT, and reports time for each.
+#
+#   bash test/bench/fgetc.sh [size]
+#
+# Set KCS to compare a different compiler binary.
+
+KCS=${KCS:-`pwd`/kcs}
+SIZE=${1:-2000000}
+ROUNDS=${ROUNDS:-3}
+SOURCE=`mktemp /tmp/bench_fgetc_XXXXXX.c`
+INPUT=`mktemp /tmp/bench_fgetc_XXXXXX.txt`
+TIMEFORMAT="%R sec"
+
+run() {
+    echo "$1, $SIZE bytes, $ROUNDS rounds"
+    time (
+        for i in `seq $ROUNDS`; do
+            $KCS $2 $SOURCE < $INPUT > /dev/null || exit 1
+        done
+    )
+}
+
+head -c $SIZE /dev/urandom | base64 > $INPUT
+cat > $SOURCE <<'END'
+#include <stdio.h>
+
+int main(void)
+{
+    int c, lines = 0;
+
+    while ((c = fgetc(stdin)) != EOF) {
+        if (c == '\n') {
+            lines++;
+        }
+    }
+
+    printf("%d\n", lines);
+    return 0;
+}
+END
+run "VM" ""
+run "JIT" "-j"
+
+rm -f $SOURCE $INPUT
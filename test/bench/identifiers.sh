@@ -0,0 +1,39 @@
+#!/bin/bash
+#
+# Micro-benchmark for identifier-heavy sources, exercising the string
+# table, macro table and symbol tables. Generates a translation unit
+# with many distinct identifiers, and reports time to compile it.
+#
+#   bash test/bench/identifiers.sh [count]
+#
+# Set KCS to compare a different compiler binary.
+
+KCS=${KCS:-`pwd`/kcs}
+COUNT=${1:-20000}
+ROUNDS=${ROUNDS:-5}
+SOURCE=`mktemp /tmp/bench_identifiers_XXXXXX.c`
+
+awk -v n=$COUNT 'BEGIN {
+    for (i = 0; i < n; ++i) {
+        printf "#define identifier_macro_value_%d %d\n", i, i;
+        printf "static int global_identifier_number_%d = identifier_macro_value_%d;\n", i, i;
+    }
+    for (i = 0; i < n; i += 100) {
+        printf "int function_with_long_name_%d(int parameter_value)\n{\n", i;
+        printf "    int local_accumulator_variable = parameter_value;\n";
+        for (j = i; j < i + 100 && j < n; ++j) {
+            printf "    local_accumulator_variable += global_identifier_number_%d;\n", j;
+        }
+        printf "    return local_accumulator_variable;\n}\n";
+    }
+}' > $SOURCE
+
+echo "$COUNT identifiers, `wc -c < $SOURCE` bytes, $ROUNDS rounds"
+TIMEFORMAT="%R sec"
+time (
+    for i in `seq $ROUNDS`; do
+        $KCS -S $SOURCE -o /dev/null || exit 1
+    done
+)
+
+rm -f $SOURCE
@@ -0,0 +1,98 @@
+#!/bin/bash
+#
+# Benchmark for JSON parsing of the extension library. Generates a log
+# of newline delimited JSON records, and counts the records of level
+# "error" with the streaming reader and with the DOM of <kcs/jsonx.h>,
+# one line at a time. Then parses the same records as one array with
+# the parser of <kcs/json.h>. Runs in the VM and with the JIT, and
+# reports time for each.
+#
+#   bash test/bench/json.sh [records]
+#
+# Set KCS to compare a different compiler binary.
+
+KCS=${KCS:-`pwd`/kcs}
+RECORDS=${1:-20000}
+ROUNDS=${ROUNDS:-3}
+LOG=`mktemp /tmp/bench_json_XXXXXX.ndjson`
+ARRAY=`mktemp /tmp/bench_json_XXXXXX.json`
+SOURCE=`mktemp /tmp/bench_json_XXXXXX.c`
+TIMEFORMAT="%R sec"
+
+awk -v n=$RECORDS 'BEGIN {
+    split("info warn error", level, " ");
+    for (k = 0; k < n; k++) {
+        printf "{\"ts\": %d, \"level\": \"%s\", \"msg\": \"request %d served in %d ms\", \"user\": {\"id\": %d, \"name\": \"u%d\"}, \"tags\": [\"a\", \"b\"], \"score\": %d}\n", \
+            1600000000 + k, level[k % 3 + 1], k, k % 97, k, k, k % 1000;
+    }
+}' > $LOG
+(echo "["; sed '$!s/$/,/' $LOG; echo "]") > $ARRAY
+
+run() {
+    echo "$1, $RECORDS records, $ROUNDS rounds"
+    time (
+        for i in `seq $ROUNDS`; do
+            $KCS $2 -DMODE=$3 -DLOG=\"$LOG\" -DARRAY=\"$ARRAY\" $SOURCE > /dev/null || exit 1
+        done
+    )
+}
+
+cat > $SOURCE <<'END'
+#include <stdio.h>
+#include <string.h>
+#include <kcs/json.h>
+#include <kcs/jsonx.h>
+
+int stream(void)
+{
+    jsonx_reader_t *r = jsonx_reader_open(LOG);
+    int type, level = 0, errors = 0;
+    while ((type = jsonx_reader_next(r)) != JSONX_END && type != JSONX_ERROR) {
+        if (type == JSONX_KEY) {
+            level = r->depth == 1 && strcmp(r->str, "level") == 0;
+        } else if (type == JSONX_STRING && level) {
+            errors += strcmp(r->str, "error") == 0;
+        }
+    }
+    jsonx_reader_close(r);
+    return errors;
+}
+
+int lines(void)
+{
+    jsonx_doc_t *doc = jsonx_open_lines(LOG);
+    int errors = 0;
+    while (jsonx_next_line(doc) > 0) {
+        const char *level = jsonx_string(jsonx_get(doc->root, "level"));
+        errors += level && strcmp(level, "error") == 0;
+    }
+    jsonx_free(doc);
+    return errors;
+}
+
+int tree(void)
+{
+    json_object_t *j = json_parse_file(ARRAY);
+    int i, n = json_get_element_count(j), errors = 0;
+    for (i = 0; i < n; i++) {
+        string_t *level = json_get_string(json_get_property(json_get_element(j, i), "level"));
+        errors += level && strcmp(level->cstr, "error") == 0;
+    }
+    json_free_all(j);
+    return errors;
+}
+
+int main(void)
+{
+    printf("%d errors\n", MODE == 0 ? stream() : MODE == 1 ? lines() : tree());
+    return 0;
+}
+END
+run "VM, jsonx stream" "-x" 0
+run "VM, jsonx lines" "-x" 1
+run "VM, json tree" "-x" 2
+run "JIT, jsonx stream" "-j" 0
+run "JIT, jsonx lines" "-j" 1
+run "JIT, json tree" "-j" 2
+
+rm -f $SOURCE $LOG $ARRAY
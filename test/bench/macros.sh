@@ -0,0 +1,51 @@
+#!/bin/bash
+#
+# Stress benchmark for macro expansion. Generates sources with a large
+# X-macro table expanded in one line, and with deeply nested function
+# like macros, and reports time to preprocess each.
+#
+#   bash test/bench/macros.sh [count] [depth]
+#
+# Set KCS to compare a different compiler binary.
+
+KCS=${KCS:-`pwd`/kcs}
+COUNT=${1:-20000}
+DEPTH=${2:-400}
+ROUNDS=${ROUNDS:-3}
+SOURCE=`mktemp /tmp/bench_macros_XXXXXX.c`
+TIMEFORMAT="%R sec"
+
+run() {
+    echo "$1, `wc -c < $SOURCE` bytes, $ROUNDS rounds"
+    time (
+        for i in `seq $ROUNDS`; do
+            $KCS -E $SOURCE > /dev/null || exit 1
+        done
+    )
+}
+
+awk -v n=$COUNT 'BEGIN {
+    printf "#define TABLE(X)";
+    for (i = 0; i < n; ++i) {
+        printf " \\\n    X(entry_%d, %d)", i, i;
+    }
+    printf "\n";
+    printf "#define ENUM(name, value) name = value,\n";
+    printf "#define NAME(name, value) #name,\n";
+    printf "enum { TABLE(ENUM) };\n";
+    printf "const char *names[] = { TABLE(NAME) };\n";
+}' > $SOURCE
+run "X-macro table with $COUNT entries"
+
+awk -v n=$DEPTH 'BEGIN {
+    printf "#define F0(x) (x)\n";
+    for (i = 1; i < n; ++i) {
+        printf "#define F%d(x) F%d(x + %d)\n", i, i - 1, i;
+    }
+    for (i = 0; i < 20; ++i) {
+        printf "int value_%d = F%d(%d);\n", i, n - 1, i;
+    }
+}' > $SOURCE
+run "Nested expansion $DEPTH levels deep"
+
+rm -f $SOURCE
@@ -0,0 +1,45 @@
+#!/bin/bash
+#
+# Benchmark for formatted output. Prints lines mixing integer, floating
+# point and string conversions to stdout, running in the VM and with
+# the JIT, and reports time for each.
+#
+#   bash test/bench/printf.sh [lines]
+#
+# Set KCS to compare a different compiler binary.
+
+KCS=${KCS:-`pwd`/kcs}
+LINES=${1:-1000000}
+ROUNDS=${ROUNDS:-3}
+SOURCE=`mktemp /tmp/bench_printf_XXXXXX.c`
+TIMEFORMAT="%R sec"
+
+run() {
+    echo "$1, $LINES lines, $ROUNDS rounds"
+    time (
+        for i in `seq $ROUNDS`; do
+            $KCS $2 -DLINES=$LINES $SOURCE > /dev/null || exit 1
+        done
+    )
+}
+
+cat > $SOURCE <<'END'
+#include <stdio.h>
+
+int main(void)
+{
+    int i;
+    char name[32];
+
+    for (i = 0; i < LINES; ++i) {
+        snprintf(name, sizeof(name), "item-%04d", i % 10000);
+        printf("%8d %-12s %10.3f %#x\n", i, name, i * 0.25, i);
+    }
+
+    return 0;
+}
+END
+run "VM" "-x"
+run "JIT" "-j"
+
+rm -f $SOURCE
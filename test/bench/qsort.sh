@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Benchmark for sorting. Fills an array with random integers as in
+# samples/qsort.c, and sorts it with qsort and a comparison function,
+# and with the typed qsort_int from kcs/ext.h. Runs in the VM and with
+# the JIT, and reports time for each.
+#
+#   bash test/bench/qsort.sh [elements]
+#
+# Set KCS to compare a different compiler binary, and TYPED=0 to leave
+# out qsort_int when it is not available.
+
+KCS=${KCS:-`pwd`/kcs}
+N=${1:-200000}
+ROUNDS=${ROUNDS:-3}
+TYPED=${TYPED:-1}
+SOURCE=`mktemp /tmp/bench_qsort_XXXXXX.c`
+TIMEFORMAT="%R sec"
+
+run() {
+    echo "$1, $N elements, $ROUNDS rounds"
+    time (
+        for i in `seq $ROUNDS`; do
+            $KCS $2 -DN=$N $3 $SOURCE > /dev/null || exit 1
+        done
+    )
+}
+
+cat > $SOURCE <<'END'
+#include <stdio.h>
+#include <stdlib.h>
+#if TYPED
+#include <kcs/ext.h>
+#endif
+
+int cmp(const void *p, const void *q)
+{
+    return *(int*)p - *(int*)q;
+}
+
+int a[N];
+
+int main(void)
+{
+    int i;
+
+    for (i = 0; i < N; i++) {
+        a[i] = rand() / (RAND_MAX / 100 + 1) * 1000 + i % 1000;
+    }
+#if TYPED
+    qsort_int(a, N);
+#else
+    qsort(a, N, sizeof(a[0]), cmp);
+#endif
+    for (i = 1; i < N; i++) {
+        if (a[i - 1] > a[i]) {
+            printf("Not sorted at %d\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+END
+run "VM qsort" "-x" "-DTYPED=0"
+run "JIT qsort" "-j" "-DTYPED=0"
+if [ "$TYPED" != "0" ]; then
+    run "VM qsort_int" "-x" "-DTYPED=1"
+    run "JIT qsort_int" "-j" "-DTYPED=1"
+fi
+
+rm -f $SOURCE
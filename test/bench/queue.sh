@@ -0,0 +1,126 @@
+#!/bin/bash
+#
+# Benchmark for the queue of the extension library. Generates a maze
+# as in samples/algo-c/maze.c, and finds the shortest path through it
+# by breadth first search with a queue. Then enqueues every cell that
+# was visited and dequeues them again, as samples/queue.c does. Runs in
+# the VM and with the JIT, and reports time for each.
+#
+#   bash test/bench/queue.sh [size]
+#
+# The maze is size by size cells. Set KCS to compare a different
+# compiler binary.
+
+KCS=${KCS:-`pwd`/kcs}
+SIZE=${1:-600}
+ROUNDS=${ROUNDS:-3}
+SOURCE=`mktemp /tmp/bench_queue_XXXXXX.c`
+TIMEFORMAT="%R sec"
+
+run() {
+    echo "$1, $SIZE x $SIZE maze, $ROUNDS rounds"
+    time (
+        for i in `seq $ROUNDS`; do
+            $KCS $2 -DXMAX=$SIZE -DYMAX=$SIZE $SOURCE > /dev/null || exit 1
+        done
+    )
+}
+
+cat > $SOURCE <<'END'
+#include <stdio.h>
+#include <stdlib.h>
+#include <kcs/ext.h>
+
+#define MAXSITE  (XMAX * YMAX / 4)
+char map[XMAX + 1][YMAX + 1];
+int dist[XMAX + 1][YMAX + 1];
+int nsite = 0;
+int xx[MAXSITE], yy[MAXSITE];
+int dx[4] = { 2, 0, -2,  0 };
+int dy[4] = { 0, 2,  0, -2 };
+
+void add(int i, int j)
+{
+    xx[nsite] = i;  yy[nsite] = j;  nsite++;
+}
+
+int select(int *i, int *j)
+{
+    int r;
+
+    if (nsite == 0) return 0;
+    nsite--;  r = (int)(nsite * (rand() / (RAND_MAX + 1.0)));
+    *i = xx[r];  xx[r] = xx[nsite];
+    *j = yy[r];  yy[r] = yy[nsite];  return 1;
+}
+
+void generate(void)
+{
+    int i, j, i1, j1, d, t;
+
+    for (i = 0; i <= XMAX; i++)
+        for (j = 0; j <= YMAX; j++) map[i][j] = 1;
+    for (i = 3; i <= XMAX - 3; i++)
+        for (j = 3; j <= YMAX - 3; j++) map[i][j] = 0;
+    map[2][3] = 0;  map[XMAX - 2][YMAX - 3] = 0;
+    for (i = 4; i <= XMAX - 4; i += 2) {
+        add(i, 2);  add(i, YMAX - 2);
+    }
+    for (j = 4; j <= YMAX - 4; j += 2) {
+        add(2, j);  add(XMAX - 2, j);
+    }
+    while (select(&i, &j)) {
+        for ( ; ; ) {
+            t = rand() % 4;
+            for (d = 0; d < 4; d++) {
+                i1 = i + dx[(t + d) % 4];  j1 = j + dy[(t + d) % 4];
+                if (map[i1][j1] == 0) break;
+            }
+            if (d == 4) break;
+            map[(i + i1) / 2][(j + j1) / 2] = 1;
+            i = i1;  j = j1;  map[i][j] = 1;  add(i, j);
+        }
+    }
+}
+
+int main(void)
+{
+    int i, j, k, p, steps = 0;
+    long long sum = 0;
+    queue_of_(int, q);
+
+    generate();
+    for (i = 0; i <= XMAX; i++)
+        for (j = 0; j <= YMAX; j++) dist[i][j] = -1;
+
+    dist[2][3] = 0;
+    queue_enqueue(q, 2 * (YMAX + 1) + 3);
+    while (queue_size(q) > 0) {
+        p = queue_dequeue(q);
+        i = p / (YMAX + 1);  j = p % (YMAX + 1);
+        steps++;
+        for (k = 0; k < 4; k++) {
+            int i1 = i + dx[k] / 2, j1 = j + dy[k] / 2;
+            if (i1 < 2 || j1 < 2 || i1 > XMAX - 2 || j1 > YMAX - 2) continue;
+            if (map[i1][j1] || dist[i1][j1] >= 0) continue;
+            dist[i1][j1] = dist[i][j] + 1;
+            queue_enqueue(q, i1 * (YMAX + 1) + j1);
+        }
+    }
+
+    for (i = 0; i <= XMAX; i++)
+        for (j = 0; j <= YMAX; j++)
+            if (dist[i][j] >= 0) queue_enqueue(q, dist[i][j]);
+    while (queue_size(q) > 0) {
+        sum += queue_dequeue(q);
+    }
+    queue_free(q);
+
+    printf("visited %d, distance to exit %d, sum %lld\n", steps, dist[XMAX - 2][YMAX - 3], sum);
+    return 0;
+}
+END
+run "VM" "-x"
+run "JIT" "-j"
+
+rm -f $SOURCE
@@ -0,0 +1,15 @@
+#include <stdio.h>
+#include <assert.h>
+
+/*
+ * Output written before a failing assertion must not be lost, when
+ * stdout is not a terminal and is fully buffered.
+ */
+
+int main(void)
+{
+    printf("before\n");
+    assert(1 == 0);
+    printf("after\n");
+    return 0;
+}
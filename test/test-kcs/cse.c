@@ -0,0 +1,96 @@
+#include <stdio.h>
+
+/*
+ * Expressions computed twice in a row, where the second computation
+ * must not reuse the first. Each chain of && is sequenced, and the
+ * right operand is only reached from the left, letting the optimizer
+ * remember the first value unless something in between may change it.
+ */
+
+int g = 3;
+int arr[4] = {1, 2, 3, 4};
+volatile int vcount = 5;
+
+struct node {
+    int value;
+    int *ref;
+};
+
+static int bump(void)
+{
+    g += 10;
+    arr[1] *= 2;
+    return 1;
+}
+
+int reuse(int *a)
+{
+    return a[0] * 3 + g == 15 && a[0] * 3 + g == 15;
+}
+
+int store_through_pointer(int *a, int *p)
+{
+    return a[0] * 3 + g == 15 && (*p = 10) && a[0] * 3 + g == 15;
+}
+
+int store_to_global(int *p)
+{
+    return g * g + 1 == 10 && (*p = 7) && g * g + 1 == 10;
+}
+
+int store_to_member(struct node *n)
+{
+    return n->value + arr[2] == 4 && (*n->ref = 20) && n->value + arr[2] == 4;
+}
+
+int assign_global(int *a)
+{
+    return a[0] * g == 12 && (g = 5) && a[0] * g == 12;
+}
+
+int call_between(void)
+{
+    return g * 5 + arr[1] == 17 && bump() && g * 5 + arr[1] == 17;
+}
+
+int volatile_read(void)
+{
+    return vcount * 7 + 1 == 36 && vcount * 7 + 1 == 36;
+}
+
+int main(void)
+{
+    int a[2] = {4, 5};
+    struct node n;
+    int r;
+
+    printf("reuse: %d\n", reuse(a));
+    r = store_through_pointer(a, a + 1);
+    printf("pointer: %d %d %d\n", r, a[0], a[1]);
+    r = store_through_pointer(a, a);
+    printf("pointer to same: %d %d %d\n", r, a[0], a[1]);
+    a[0] = 4;
+    r = store_through_pointer(a, &g);
+    printf("pointer to global: %d %d\n", r, g);
+    g = 3;
+    r = store_to_global(&g);
+    printf("global: %d %d\n", r, g);
+    g = 3;
+    n.value = 1;
+    n.ref = &n.value;
+    r = store_to_member(&n);
+    printf("member: %d %d\n", r, n.value);
+    n.value = 1;
+    n.ref = &arr[2];
+    r = store_to_member(&n);
+    printf("member to global: %d %d\n", r, arr[2]);
+    arr[2] = 3;
+    a[0] = 4;
+    r = assign_global(a);
+    printf("assign: %d %d\n", r, g);
+    g = 3;
+    r = call_between();
+    printf("call: %d %d %d\n", r, g, arr[1]);
+    printf("volatile: %d\n", volatile_read());
+    return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef GUARDED_H
+#define GUARDED_H
+
+enum { E2 = 2 };
+
+struct guarded {
+    int x;
+};
+
+#endif
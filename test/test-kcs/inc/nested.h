@@ -0,0 +1,4 @@
+#include "guarded.h"
+#include "./once.h"
+#include "../inc/guarded.h"
+#include "../inc/once.h"
@@ -0,0 +1,7 @@
+#pragma once
+
+enum { E3 = 3 };
+
+struct once {
+    int y;
+};
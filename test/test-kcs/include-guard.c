@@ -0,0 +1,17 @@
+#include <stdio.h>
+#include "inc/guarded.h"
+#include "./inc/guarded.h"
+#include "inc/../inc/guarded.h"
+#include "inc/once.h"
+#include "./inc/once.h"
+#include "inc//once.h"
+#include "inc/nested.h"
+#include "./inc/nested.h"
+
+int main(void)
+{
+    struct guarded g = {E2};
+    struct once o = {E3};
+    printf("%d %d\n", g.x, o.y);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <stdio.h>
+
+/*
+ * Calls passing constant arguments, where the constant must not be
+ * folded into the function called.
+ */
+
+/* Address taken, and called through the pointer with another scale. */
+static int scale(int x, int k)
+{
+    switch (k) {
+    case 3:
+        return x * 3;
+    case 5:
+        return x * 5 + 555;
+    default:
+        return -x;
+    }
+}
+
+/* Called with different constants. */
+static int mix(int x, int mode)
+{
+    if (mode == 1) {
+        return x + 111;
+    } else if (mode == 2) {
+        return x - 222;
+    }
+
+    return x * mode;
+}
+
+/*
+ * Externally visible, and can be called with other arguments from
+ * another translation unit.
+ */
+int shift(int x, int mode)
+{
+    return mode == 2 ? x << 2 : x + 1000;
+}
+
+int (*pointer)(int, int) = scale;
+
+/* Not known to be constant. */
+volatile int seed = 7;
+
+int main(void)
+{
+    int n = seed;
+
+    printf("scale: %d %d", scale(n, 3), scale(n + 1, 3));
+    printf(" %d %d\n", pointer(n, 5), pointer(n, 7));
+    printf("mix: %d %d %d", mix(n, 1), mix(n, 2), mix(n + 1, 2));
+    printf(" %d\n", mix(n, seed - 3));
+    printf("shift: %d %d %d\n", shift(n, 2), shift(n + 1, 2), shift(n + 2, 2));
+    return 0;
+}
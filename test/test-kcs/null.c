@@ -0,0 +1,11 @@
+#include <stdio.h>
+
+/* Output written before a runtime error of the VM must not be lost. */
+
+int main(void)
+{
+    volatile int *p = 0;
+
+    printf("before\n");
+    return *p;
+}
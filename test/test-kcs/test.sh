@@ -0,0 +1,124 @@
+#!/bin/sh
+#
+# Tests of the compiler driver and the optimizer. Each program is run in
+# the VM and with the JIT at several optimization levels, and the output
+# is compared with the one built by gcc.
+
+KCC=../../kcc
+OPTS="-x|-x -O2|-j -O0|-j -O1|-j -O2|-j -O2 -fno-vectorize|-j -O2 -march=native"
+
+do_test() {
+    TARGET=$1
+    EXPECT=`basename ${TARGET%.*}`.expect
+    if [ ! -f $EXPECT ]; then
+        gcc $TARGET -o expect.exe > /dev/null 2>&1
+        ./expect.exe > $EXPECT
+        echo Result:$?>> $EXPECT
+    fi
+    IFS='|'
+    for OPT in $OPTS; do
+        IFS=' '
+        $KCC $OPT $TARGET > result.txt 2>&1
+        echo Result:$?>> result.txt
+        diff --strip-trailing-cr $EXPECT result.txt > /dev/null 2>&1
+        if [ $? -ne 0 ]; then
+            echo Error: $TARGET $OPT
+        else
+            echo Test Passed: $TARGET $OPT
+        fi
+        IFS='|'
+    done
+    IFS=' '
+}
+
+# Run a program which ends abnormally with stdout redirected, and check
+# that the output written before is kept, and the error is reported.
+do_abort() {
+    TARGET=$1 MESSAGE=$2
+    shift 2
+    for OPT in "$@"; do
+        $KCC $OPT $TARGET > result.txt 2> error.txt
+        if grep -qx before result.txt && ! grep -q after result.txt && grep -q "$MESSAGE" error.txt; then
+            echo Test Passed: $TARGET $OPT
+        else
+            echo Error: $TARGET $OPT
+        fi
+    done
+    rm -f error.txt
+}
+
+# Check that the assembly of a program has each of the given packed
+# instructions, to know that its loops are vectorized.
+do_packed() {
+    TARGET=$1
+    shift
+    RESULT=0
+    $KCC -S $TARGET -o packed.s > /dev/null 2>&1 || RESULT=1
+    for INSTR in "$@"; do
+        grep -qw $INSTR packed.s || RESULT=1
+    done
+    if [ $RESULT -ne 0 ]; then
+        echo Error: $TARGET vectorized
+    else
+        echo Test Passed: $TARGET vectorized
+    fi
+    rm -f packed.s
+}
+
+# Count the lines of a function in the assembly of a program, compiled
+# with the given options, which match a pattern, and check the number.
+do_count() {
+    TARGET=$1 OPT=$2 FUNC=$3 PATTERN=$4 COUNT=$5
+    RESULT=0
+    $KCC $OPT -S $TARGET -o count.s > /dev/null 2>&1 || RESULT=1
+    N=`awk "/^$FUNC:/,/\\.size\t$FUNC,/" count.s | grep -c "$PATTERN"`
+    [ "$N" = "$COUNT" ] || RESULT=1
+    if [ $RESULT -ne 0 ]; then
+        echo Error: $TARGET $OPT $FUNC $PATTERN x$COUNT
+    else
+        echo Test Passed: $TARGET $OPT $FUNC $PATTERN x$COUNT
+    fi
+    rm -f count.s
+}
+
+# Compile several translation units by one command, and check that each
+# of them produces an object and an assembly which can be assembled.
+do_units() {
+    for OPT in "-c" "-O2 -c" "-S"; do
+        RESULT=0
+        rm -f *.o *.s
+        $KCC $OPT "$@" > /dev/null 2>&1 || RESULT=1
+        for TARGET in "$@"; do
+            case "$OPT" in
+            *-S) gcc -c `basename $TARGET .c`.s -o unit.out > /dev/null 2>&1 || RESULT=1 ;;
+            *)   [ -s `basename $TARGET .c`.o ] || RESULT=1 ;;
+            esac
+        done
+        if [ $RESULT -ne 0 ]; then
+            echo Error: $OPT "$@"
+        else
+            echo Test Passed: $OPT "$@"
+        fi
+    done
+    rm -f *.o *.s unit.out
+}
+
+cd `dirname $0`
+do_test include-guard.c
+do_test vectorize.c
+do_packed vectorize.c paddd paddq mulpd subpd
+do_test cse.c
+do_count cse.c -O1 reuse mul 1
+do_count cse.c -O1 call_between mul 2
+do_count cse.c -O1 volatile_read 'vcount(%rip)' 2
+do_test ipcp.c
+do_count ipcp.c -O2 main 'call.scale\.constprop' 2
+do_count ipcp.c -O2 main 'call.mix$' 2
+do_count ipcp.c -O2 scale '\$555' 1
+do_count ipcp.c -O2 mix '\$111' 1
+do_count ipcp.c -O2 shift '\$1000' 1
+do_abort abort.c "Assertion failed" "-x" "-j"
+do_abort null.c "null-pointer access" "-x"
+do_units unit-main.c unit-sum.c
+do_units unit-sum.c unit-main.c unit-empty.c
+rm -f *.expect expect.exe result.txt
@@ -0,0 +1,13 @@
+#include <stdio.h>
+
+struct point { int x, y; };
+
+int sum(const struct point *p, int n);
+
+int main(void)
+{
+    struct point p[] = {{1, 2}, {3, 4}};
+    int v[4] = {[2] = 5};
+    printf("%d %d\n", sum(p, 2), v[2] + sum((struct point[]){{5, 6}}, 1));
+    return 0;
+}
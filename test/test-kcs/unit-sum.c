@@ -0,0 +1,14 @@
+struct point { int x, y; };
+
+static const int weight[] = {1, 10};
+
+int sum(const struct point *p, int n)
+{
+    int i, s = 0;
+    struct point q = {0};
+    for (i = 0; i < n; ++i) {
+        q = (struct point){p[i].x * weight[0], p[i].y * weight[1]};
+        s += q.x + q.y;
+    }
+    return s;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+
+#define N 1027
+
+int a[N], b[N], c[N];
+long la[N], lb[N];
+double da[N], db[N];
+
+void add(int *dst, const int *x, const int *y, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        dst[i] = x[i] + y[i];
+}
+
+void scale(long *dst, const long *x, long k, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        dst[i] = x[i] * k;
+}
+
+void mix(double *dst, const double *x, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        dst[i] = x[i] * 0.5 - dst[i];
+}
+
+int sum(const int *x, int n)
+{
+    int i, s = 0;
+    for (i = 0; i < n; ++i)
+        s += x[i];
+    return s;
+}
+
+long lsum(const long *x, int from, int n)
+{
+    int i;
+    long s = 7;
+    for (i = from; i < n; ++i)
+        s += x[i];
+    return s;
+}
+
+unsigned check(const int *x, int n)
+{
+    int i;
+    unsigned h = 0;
+    for (i = 0; i < n; ++i)
+        h = h * 31 + x[i];
+    return h;
+}
+
+int main(void)
+{
+    int i, n;
+
+    for (i = 0; i < N; ++i) {
+        a[i] = i * 3 - 500;
+        b[i] = 1000 - i * 7;
+        la[i] = (long) i * 100003;
+        da[i] = i * 0.25;
+        db[i] = N - i;
+    }
+
+    /* Trip counts around and not a multiple of the vector width. */
+    for (n = 0; n <= 19; ++n) {
+        add(c, a, b, n);
+        printf("add %d: %u %d\n", n, check(c, N), sum(a, n));
+    }
+    add(c, a, b, N);
+    printf("add: %u\n", check(c, N));
+
+    /* Overlapping source and destination, in both directions. */
+    add(a + 1, a, b, N - 1);
+    printf("alias up: %u\n", check(a, N));
+    add(b, b + 3, a, N - 3);
+    printf("alias down: %u\n", check(b, N));
+    add(c, c, c, N);
+    printf("alias same: %u\n", check(c, N));
+    add(c + 2, a, c, 9);
+    printf("alias short: %u\n", check(c, N));
+
+    scale(lb, la, -3, N);
+    scale(la + 1, la, 2, N - 1);
+    printf("scale: %ld %ld %ld\n", lsum(lb, 0, N), lsum(la, 0, N), lsum(la, 5, 17));
+
+    mix(db, da, N);
+    mix(db + 1, db, 13);
+    printf("mix: %.3f %.3f %.3f\n", db[0], db[13], db[N - 1]);
+
+    /* Reductions, also starting at an offset. */
+    printf("sum: %d %d %d %d\n", sum(a, N), sum(b, N), sum(c + 1, N - 1), sum(a, 3));
+    printf("lsum: %ld %ld %ld\n", lsum(la, 0, N), lsum(la, 1, N), lsum(la, 9, 10));
+    return 0;
+}